@@ -0,0 +1,156 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Topology
+//
+//       ipn:1 --- ipn:2 --- ipn:3
+//         \_________________/
+//
+// Contact graph routing over scheduled contacts.
+//
+// - Three agents are connected by BpLoopbackCla, whose Delay stands for
+//   the one-way light time, and each routes with its own
+//   BpCgrRoutingAgent over the same contact plan.
+// - Without --plan, the plan has ipn:1 -> ipn:2 on from 10 s to 20 s,
+//   ipn:2 -> ipn:3 from 30 s to 40 s, and ipn:1 -> ipn:3 directly from
+//   60 s to 70 s, all with a one-way light time of 1 s; with --plan, it is
+//   read from a contact plan file (see BpCgrRoutingAgent::LoadContactPlan).
+// - ipn:1 sends --bundles ADUs at 1 s to ipn:3.1.  They wait at ipn:1 for
+//   the first contact and at ipn:2 for the second, and arrive at 31 s,
+//   before the direct contact starts.
+// - This prints when the bundles arrive and how often each agent computed
+//   routes.
+
+#include <iostream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-agent.h"
+#include "ns3/bp-loopback-cla.h"
+#include "ns3/bp-cgr-routing-agent.h"
+#include "ns3/bp-agent-helper.h"
+#include "ns3/bp-agent-container.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BpCgrExample");
+
+namespace {
+
+const uint16_t PORT = 4556;
+
+void
+Send (Ptr<BpAgent> sender, uint32_t size, BpEndpointId src, BpEndpointId dst)
+{
+  sender->Send (Create<Packet> (size), src, dst);
+}
+
+void
+Receive (Ptr<BpAgent> receiver, BpEndpointId eid, uint32_t bundles)
+{
+  uint32_t received = 0;
+  while (receiver->Receive (eid) != NULL)
+    {
+      received++;
+    }
+  if (received > 0)
+    {
+      std::cout << Simulator::Now ().GetSeconds () << " s: " << received << " bundles arrive at " << eid.Uri () << std::endl;
+    }
+  if (receiver->GetBundlesDelivered () < bundles)
+    {
+      Simulator::Schedule (MilliSeconds (100), &Receive, receiver, eid, bundles);
+    }
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t bundles = 10;
+  uint32_t size = 1000;
+  uint32_t version = 7;
+  std::string plan;
+
+  CommandLine cmd;
+  cmd.AddValue ("bundles", "Number of ADUs to send", bundles);
+  cmd.AddValue ("size", "ADU size in bytes", size);
+  cmd.AddValue ("version", "Bundle protocol version, 6 or 7", version);
+  cmd.AddValue ("plan", "Contact plan file of nodes 1 to 3, instead of the built-in plan", plan);
+  cmd.Parse (argc, argv);
+
+  const uint32_t nodes = 3;
+  NodeContainer c;
+  c.Create (nodes);
+
+  TypeId claType = BpLoopbackCla::GetTypeId ();
+  BpEndpointId eidApp (3, 1);
+  std::vector<Ptr<BpAgent> > agents;
+  std::vector<Ptr<BpCgrRoutingAgent> > routes;
+  for (uint32_t n = 0; n < nodes; n++)
+    {
+      Ptr<BpCgrRoutingAgent> route = CreateObject<BpCgrRoutingAgent> ();
+      route->SetLocalEid (BpEndpointId (n + 1, 0));
+      for (uint32_t m = 0; m < nodes; m++)
+        {
+          route->AddNode (BpEndpointId (m + 1, 0), Ipv4Address (0x0a000001 + m), PORT, claType);
+        }
+      if (plan.empty ())
+        {
+          route->AddContact (BpEndpointId (1, 0), BpEndpointId (2, 0), Seconds (10), Seconds (20), 1000000, Seconds (1));
+          route->AddContact (BpEndpointId (2, 0), BpEndpointId (3, 0), Seconds (30), Seconds (40), 1000000, Seconds (1));
+          route->AddContact (BpEndpointId (1, 0), BpEndpointId (3, 0), Seconds (60), Seconds (70), 1000000, Seconds (1));
+        }
+      else if (route->LoadContactPlan (plan) != 0)
+        {
+          NS_FATAL_ERROR ("cannot load contact plan " << plan);
+        }
+      routes.push_back (route);
+
+      BpAgentHelper bpHelper;
+      bpHelper.SetBpVersion (version);
+      bpHelper.SetRoutingAgent (route);
+      bpHelper.SetBpEndpointId (BpEndpointId (n + 1, 0));
+      bpHelper.AddCla ("Loopback",
+                       "Ready", BooleanValue (true),
+                       "Delay", TimeValue (Seconds (1)));
+      agents.push_back (bpHelper.Install (c.Get (n)).Get (0));
+    }
+
+  Ptr<BpAgent> sender = agents.front ();
+  Ptr<BpAgent> receiver = agents.back ();
+  BpRegisterInfo info;
+  receiver->Register (eidApp, info);
+
+  for (uint32_t i = 0; i < bundles; i++)
+    {
+      Simulator::Schedule (Seconds (1), &Send, sender, size, BpEndpointId (1, 0), eidApp);
+    }
+  Simulator::Schedule (Seconds (1), &Receive, receiver, eidApp, bundles);
+  Simulator::Stop (Seconds (100));
+  Simulator::Run ();
+
+  std::cout << "delivered " << receiver->GetBundlesDelivered () << "/" << bundles << " bundles" << std::endl;
+  for (uint32_t n = 0; n < nodes; n++)
+    {
+      std::cout << "  ipn:" << n + 1 << ": routes computed " << routes[n]->GetRouteComputations () << " times" << std::endl;
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
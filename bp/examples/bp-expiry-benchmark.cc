@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Micro-benchmark of bundle lifetime expiry in the bundle store.
+//
+// - Builds N BPv6 bundles created over N/1000 seconds, with lifetimes of
+//   10 to 59 seconds, and stores them all in a BundleStore using:
+//     event:  one simulator event per bundle (BatchExpiry false)
+//     batch:  the store's expiry index and a single rescheduled event
+// - expire: the simulator runs until every bundle has expired.
+// - remove: every bundle is removed again (as when delivered or forwarded)
+//   before the simulator runs, so expiry only has to be cancelled.
+// - For each, the simulator events executed and the wall clock time of
+//   storing, removing and running are printed, for N = 10k and 100k by
+//   default (override with --sizes=a,b,...).
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-bundle-6.h"
+#include "ns3/bp-bundle-store.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BpExpiryBenchmark");
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double
+Ms (Clock::time_point start, Clock::time_point end)
+{
+  return std::chrono::duration<double, std::milli> (end - start).count ();
+}
+
+std::vector<Ptr<Bundle> >
+MakeBundles (uint32_t n)
+{
+  std::vector<Ptr<Bundle> > bundles;
+  bundles.reserve (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Bundle6> b = Create<Bundle6> (Create<Packet> (100));
+      BpHeader6 *bph = b->GetPrimaryHeader ();
+      bph->SetSourceEid (BpEndpointId ("dtn", "node0"));
+      bph->SetDestinationEid (BpEndpointId ("dtn", "sink"));
+      bph->SetCreateTimestamp (i / 1000);
+      bph->SetSequenceNumber (SequenceNumber32 (i % 1000));
+      bph->SetLifeTime (Seconds (10 + i % 50));
+      bundles.push_back (b);
+    }
+  return bundles;
+}
+
+void
+Run (const char *name, bool batch, bool remove, uint32_t n)
+{
+  std::vector<Ptr<Bundle> > bundles = MakeBundles (n);
+  BundleStore store;
+  store.SetBatchExpiry (batch);
+
+  uint64_t events0 = Simulator::GetEventCount ();
+  Clock::time_point t0 = Clock::now ();
+  for (uint32_t i = 0; i < bundles.size (); i++)
+    {
+      store.Store (bundles[i]);
+    }
+  Clock::time_point t1 = Clock::now ();
+  if (remove)
+    {
+      for (uint32_t i = 0; i < bundles.size (); i++)
+        {
+          store.Remove (bundles[i]);
+        }
+    }
+  Clock::time_point t2 = Clock::now ();
+  Simulator::Run ();
+  Clock::time_point t3 = Clock::now ();
+
+  std::cout << "  " << name << (remove ? " remove" : " expire") << ": "
+            << Simulator::GetEventCount () - events0 << " events, store " << Ms (t0, t1) << " ms";
+  if (remove)
+    {
+      std::cout << ", remove " << Ms (t1, t2) << " ms";
+    }
+  std::cout << ", run " << Ms (t2, t3) << " ms" << std::endl;
+
+  Simulator::Destroy ();
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string sizes = "10000,100000";
+
+  CommandLine cmd;
+  cmd.AddValue ("sizes", "Comma-separated bundle counts to run", sizes);
+  cmd.Parse (argc, argv);
+
+  std::istringstream in (sizes);
+  std::string item;
+  while (std::getline (in, item, ','))
+    {
+      uint32_t n = std::stoul (item);
+      std::cout << n << " bundles" << std::endl;
+      Run ("event", false, false, n);
+      Run ("batch", true, false, n);
+      Run ("event", false, true, n);
+      Run ("batch", true, true, n);
+    }
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Topology
+//
+//       n0 --- n1 --- ... --- n(N-1)
+//
+// Bundle processing cost without a network stack.
+//
+// - The --nodes agents are connected in a chain by BpLoopbackCla, with no
+//   devices or IP stack, each with its own static routes to the next.
+// - n0 sends --bundles ADUs of --size bytes, one every --interval of
+//   simulated time, to an application endpoint on the last node, and each
+//   agent in between forwards them.
+// - With --serialize, bundles are encoded and decoded at each hop, which
+//   adds the cost of the codec; otherwise bundle objects are handed over.
+// - This prints the bundles delivered and, from the wall clock time of the
+//   run, the bundles per second handled by each agent and by the chain.
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-agent.h"
+#include "ns3/bp-loopback-cla.h"
+#include "ns3/bp-static-routing-agent.h"
+#include "ns3/bp-agent-helper.h"
+#include "ns3/bp-agent-container.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BpLoopbackChainBenchmark");
+
+namespace {
+
+const uint16_t PORT = 4556;
+
+void
+Send (Ptr<BpAgent> sender, uint32_t size, BpEndpointId src, BpEndpointId dst, uint32_t left, Time interval)
+{
+  sender->Send (Create<Packet> (size), src, dst);
+  if (--left > 0)
+    {
+      Simulator::Schedule (interval, &Send, sender, size, src, dst, left, interval);
+    }
+}
+
+void
+Receive (Ptr<BpAgent> receiver, BpEndpointId eid, uint32_t bundles)
+{
+  while (receiver->Receive (eid) != NULL)
+    {
+    }
+  if (receiver->GetBundlesDelivered () < bundles)
+    {
+      Simulator::Schedule (MilliSeconds (1), &Receive, receiver, eid, bundles);
+    }
+}
+
+BpEndpointId
+NodeEid (uint32_t n)
+{
+  std::ostringstream ssp;
+  ssp << "node" << n;
+  return BpEndpointId ("dtn", ssp.str ());
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nodes = 4;
+  uint32_t bundles = 1000000;
+  uint32_t size = 100;
+  uint32_t version = 7;
+  bool serialize = false;
+  Time delay = Seconds (0);
+  Time interval = MicroSeconds (1);
+
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of agents in the chain, at least 2", nodes);
+  cmd.AddValue ("bundles", "Number of ADUs to send", bundles);
+  cmd.AddValue ("size", "ADU size in bytes", size);
+  cmd.AddValue ("version", "Bundle protocol version, 6 or 7", version);
+  cmd.AddValue ("serialize", "Encode and decode bundles at each hop", serialize);
+  cmd.AddValue ("delay", "Delay of each hop", delay);
+  cmd.AddValue ("interval", "Time between ADUs", interval);
+  cmd.Parse (argc, argv);
+
+  if (nodes < 2 || bundles == 0)
+    {
+      NS_FATAL_ERROR ("need at least 2 nodes and 1 bundle");
+    }
+
+  NodeContainer c;
+  c.Create (nodes);
+
+  // The loopback addresses only name the agents' CLAs; no node has an
+  // interface with them.
+  TypeId claType = BpLoopbackCla::GetTypeId ();
+  BpEndpointId eidApp ("dtn", "app");
+  std::vector<Ptr<BpAgent> > agents;
+  for (uint32_t n = 0; n < nodes; n++)
+    {
+      BpEndpointId eid = NodeEid (n);
+      BpEndpointId next = NodeEid (n + 1);
+      Ipv4Address address (0x0a000001 + n);
+
+      Ptr<BpStaticRoutingAgent> route = CreateObject<BpStaticRoutingAgent> ();
+      route->AddRoute (eid, eid, true, address, PORT, claType);
+      if (n + 1 < nodes)
+        {
+          Ipv4Address nextAddress (0x0a000001 + n + 1);
+          route->AddRoute (next, next, true, nextAddress, PORT, claType);
+          route->AddRoute (eidApp, next, true, nextAddress, PORT, claType);
+        }
+      else
+        {
+          route->AddRoute (eidApp, eid, true, address, PORT, claType);
+        }
+
+      BpAgentHelper bpHelper;
+      bpHelper.SetBpVersion (version);
+      bpHelper.SetRoutingAgent (route);
+      bpHelper.SetBpEndpointId (eid);
+      bpHelper.AddCla ("Loopback",
+                       "Ready", BooleanValue (true),
+                       "Serialize", BooleanValue (serialize),
+                       "Delay", TimeValue (delay));
+      agents.push_back (bpHelper.Install (c.Get (n)).Get (0));
+    }
+
+  Ptr<BpAgent> sender = agents.front ();
+  Ptr<BpAgent> receiver = agents.back ();
+  BpRegisterInfo info;
+  receiver->Register (eidApp, info);
+
+  Time start = Seconds (1.0);
+  Simulator::Schedule (start, &Send, sender, size, NodeEid (0), eidApp, bundles, interval);
+  Simulator::Schedule (start, &Receive, receiver, eidApp, bundles);
+  Simulator::Stop (start + Seconds (interval.GetSeconds () * bundles + delay.GetSeconds () * nodes + 1.0));
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now ();
+  double secs = std::chrono::duration<double> (t1 - t0).count ();
+
+  std::cout << "BPv" << version << (serialize ? ", serialized" : ", bundle objects") << ", " << nodes << " agents: delivered "
+            << receiver->GetBundlesDelivered () << "/" << bundles << " bundles of " << size << " bytes in "
+            << secs << " s wall clock" << std::endl;
+  uint64_t handled = 0;
+  for (uint32_t n = 0; n < nodes; n++)
+    {
+      Ptr<BpLoopbackCla> cla = DynamicCast<BpLoopbackCla> (agents[n]->GetCla (claType));
+      // bundles sent by the first agent, received by the others
+      uint64_t count = n == 0 ? cla->GetBundlesSent () : cla->GetBundlesReceived ();
+      handled += count;
+      std::cout << "  agent " << n << ": " << count << " bundles, " << count / secs << " bundles/sec" << std::endl;
+    }
+  std::cout << "  chain: " << handled / secs << " bundles/sec over all agents, "
+            << receiver->GetBundlesDelivered () / secs << " bundles/sec end to end" << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,202 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Network topology
+//
+//       n0 ----------- n1
+//            1 Mbps
+//             10 s
+//
+// Goodput of the LTP CLA against the TCP CLA on a long-delay link.
+//
+// - n0 sends --bundles ADUs of --size bytes to an application endpoint on
+//   n1, all at once.
+// - n1's device drops each received packet with probability --loss (a
+//   comma-separated list, one pair of runs per value).
+// - Each loss rate is run over BpTcpCla, and over BpLtpCla with its
+//   DataRate set to the link's and its OneWayDelay to the link delay.
+// - For each run this prints the bundles delivered, the time from the
+//   first send to the last delivery and the ADU goodput over that time.
+
+#include <iostream>
+#include <sstream>
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-agent.h"
+#include "ns3/bp-ltp-cla.h"
+#include "ns3/bp-static-routing-agent.h"
+#include "ns3/bp-agent-helper.h"
+#include "ns3/bp-agent-container.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BpLtpBenchmark");
+
+namespace {
+
+const Time START = Seconds (1.0);
+const Time POLL = MilliSeconds (100);
+
+uint64_t g_rxBytes;
+Time g_lastRx;
+
+void
+Send (Ptr<BpAgent> sender, uint32_t size, BpEndpointId src, BpEndpointId dst)
+{
+  sender->Send (Create<Packet> (size), src, dst);
+}
+
+void
+Receive (Ptr<BpAgent> receiver, BpEndpointId eid, uint64_t total)
+{
+  Ptr<Packet> p;
+  while ((p = receiver->Receive (eid)) != NULL)
+    {
+      g_rxBytes += p->GetSize ();
+      g_lastRx = Simulator::Now ();
+    }
+  if (g_rxBytes >= total)
+    {
+      Simulator::Stop ();
+      return;
+    }
+  Simulator::Schedule (POLL, &Receive, receiver, eid, total);
+}
+
+void
+Run (std::string l4type, double loss, uint32_t bundles, uint32_t size, std::string rate, Time delay, Time limit)
+{
+  g_rxBytes = 0;
+  g_lastRx = START;
+
+  NodeContainer nodes;
+  nodes.Create (2);
+
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue (rate));
+  pointToPoint.SetChannelAttribute ("Delay", TimeValue (delay));
+  NetDeviceContainer devices = pointToPoint.Install (nodes);
+
+  Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+  em->SetUnit (RateErrorModel::ERROR_UNIT_PACKET);
+  em->SetRate (loss);
+  devices.Get (1)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i = ipv4.Assign (devices);
+
+  BpEndpointId eidSender ("dtn", "node0");
+  BpEndpointId eidRecv ("dtn", "node1");
+  BpEndpointId eidApp ("dtn", "node1/app");
+
+  Ptr<BpStaticRoutingAgent> route = CreateObject<BpStaticRoutingAgent> ();
+
+  // each agent gets its own CLA of the type, which the routes name
+  uint16_t port = 4556;
+  BpAgentHelper bpSenderHelper;
+  bpSenderHelper.SetBpVersion (7);
+  bpSenderHelper.SetRoutingAgent (route);
+  bpSenderHelper.SetBpEndpointId (eidSender);
+  bpSenderHelper.AddCla (l4type, "Ready", BooleanValue (true));
+
+  BpAgentHelper bpReceiverHelper;
+  bpReceiverHelper.SetBpVersion (7);
+  bpReceiverHelper.SetRoutingAgent (route);
+  bpReceiverHelper.SetBpEndpointId (eidRecv);
+  bpReceiverHelper.AddCla (l4type);
+
+  if (l4type == "Ltp")
+    {
+      port = 1113;
+      bpSenderHelper.SetClaAttribute ("DataRate", DataRateValue (DataRate (rate)));
+      bpSenderHelper.SetClaAttribute ("OneWayDelay", TimeValue (delay));
+      bpReceiverHelper.SetClaAttribute ("DataRate", DataRateValue (DataRate (rate)));
+      bpReceiverHelper.SetClaAttribute ("OneWayDelay", TimeValue (delay));
+    }
+  Ptr<BpAgent> sender = bpSenderHelper.Install (nodes.Get (0)).Get (0);
+  Ptr<BpAgent> receiver = bpReceiverHelper.Install (nodes.Get (1)).Get (0);
+
+  TypeId claType;
+  BpCla::LookupType (l4type, &claType);
+  route->AddRoute (eidSender, eidSender, true, i.GetAddress (0), port, claType);
+  route->AddRoute (eidRecv, eidRecv, true, i.GetAddress (1), port, claType);
+  route->AddRoute (eidApp, eidRecv, true, i.GetAddress (1), port, claType);
+
+  BpRegisterInfo info;
+  receiver->Register (eidApp, info);
+
+  for (uint32_t n = 0; n < bundles; n++)
+    {
+      Simulator::Schedule (START, &Send, sender, size, eidSender, eidApp);
+    }
+  uint64_t total = (uint64_t) bundles * size;
+  Simulator::Schedule (START, &Receive, receiver, eidApp, total);
+  Simulator::Stop (START + limit);
+  Simulator::Run ();
+
+  double secs = (g_lastRx - START).GetSeconds ();
+  double kbps = secs > 0 ? g_rxBytes * 8 / secs / 1e3 : 0;
+  std::cout << l4type << ", loss " << loss << ": delivered " << g_rxBytes / size << "/" << bundles
+            << " bundles in " << secs << " s, goodput " << kbps << " kbps";
+  Ptr<BpLtpCla> ltp = DynamicCast<BpLtpCla> (sender->GetCla (0));
+  if (ltp)
+    {
+      std::cout << ", " << ltp->GetRetransmittedSegments () << " segments sent again";
+    }
+  std::cout << std::endl;
+
+  Simulator::Destroy ();
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string losses = "0,0.01";
+  uint32_t bundles = 50;
+  uint32_t size = 50000;
+  std::string rate = "1Mbps";
+  Time delay = Seconds (10);
+  Time limit = Seconds (3600);
+
+  CommandLine cmd;
+  cmd.AddValue ("loss", "Comma-separated packet loss rates to run with", losses);
+  cmd.AddValue ("bundles", "Number of ADUs to send", bundles);
+  cmd.AddValue ("size", "ADU size in bytes", size);
+  cmd.AddValue ("rate", "Link data rate", rate);
+  cmd.AddValue ("delay", "One-way link delay", delay);
+  cmd.AddValue ("limit", "Longest simulated time of one run", limit);
+  cmd.Parse (argc, argv);
+
+  std::istringstream list (losses);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      double loss = std::stod (item);
+      Run ("Tcp", loss, bundles, size, rate, delay, limit);
+      Run ("Ltp", loss, bundles, size, rate, delay, limit);
+    }
+
+  return 0;
+}
@@ -0,0 +1,159 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Micro-benchmark of bundle store insert/erase cost.
+//
+// - Builds N BPv6 bundles from a handful of sources, then times inserting
+//   them all into, and erasing them all from, an ordered set using:
+//     header:  the old comparator, which goes through the virtual BpHeader
+//              accessors and compares source URIs as strings
+//     key:     BundlePriorityCompare, which compares the precomputed
+//              BundleSortKey
+//     store:   BundleStore::Store() / Remove(), including its indexes
+// - Wall clock times are printed per operation, for N = 10k and 100k by
+//   default (override with --sizes=a,b,...).
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-bundle-6.h"
+#include "ns3/bp-bundle-store.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BpStoreBenchmark");
+
+namespace {
+
+// The comparator as it was before BundleSortKey, kept here for reference.
+struct HeaderPriorityCompare {
+  bool operator()(const Ptr<Bundle>& lhs, const Ptr<Bundle>& rhs) const {
+    BpHeader *lhsHdr = lhs->GetPrimaryHeader();
+    BpHeader *rhsHdr = rhs->GetPrimaryHeader();
+    if (lhsHdr->Priority() != rhsHdr->Priority())
+      return lhsHdr->Priority() < rhsHdr->Priority();
+    if (lhsHdr->GetCreateTimestamp() != rhsHdr->GetCreateTimestamp())
+      return lhsHdr->GetCreateTimestamp() < rhsHdr->GetCreateTimestamp();
+    if (lhsHdr->GetSequenceNumber() != rhsHdr->GetSequenceNumber())
+      return lhsHdr->GetSequenceNumber() < rhsHdr->GetSequenceNumber();
+    if (lhsHdr->GetFragOffset() != rhsHdr->GetFragOffset())
+      return lhsHdr->GetFragOffset() < rhsHdr->GetFragOffset();
+    if (lhsHdr->GetSourceEid().Uri() != rhsHdr->GetSourceEid().Uri())
+      return lhsHdr->GetSourceEid().Uri() < rhsHdr->GetSourceEid().Uri();
+    return lhs < rhs;
+  }
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double
+NsPerOp (Clock::time_point start, Clock::time_point end, uint32_t n)
+{
+  return std::chrono::duration<double, std::nano> (end - start).count () / n;
+}
+
+std::vector<Ptr<Bundle> >
+MakeBundles (uint32_t n)
+{
+  std::vector<Ptr<Bundle> > bundles;
+  bundles.reserve (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      std::ostringstream ssp;
+      ssp << "node" << (i % 8);
+      Ptr<Bundle6> b = Create<Bundle6> (Create<Packet> (100));
+      BpHeader6 *bph = b->GetPrimaryHeader ();
+      bph->SetSourceEid (BpEndpointId ("dtn", ssp.str ()));
+      bph->SetDestinationEid (BpEndpointId ("dtn", "sink"));
+      bph->SetPriority (i % 3);
+      bph->SetCreateTimestamp (i / 64);
+      bph->SetSequenceNumber (SequenceNumber32 (i % 64));
+      bph->SetLifeTime (Seconds (0));
+      b->UpdateSortKey ();
+      bundles.push_back (b);
+    }
+  return bundles;
+}
+
+template <class Compare>
+void
+RunSet (const char *name, const std::vector<Ptr<Bundle> > &bundles)
+{
+  std::set<Ptr<Bundle>, Compare> s;
+  Clock::time_point t0 = Clock::now ();
+  for (uint32_t i = 0; i < bundles.size (); i++)
+    {
+      s.insert (bundles[i]);
+    }
+  Clock::time_point t1 = Clock::now ();
+  for (uint32_t i = 0; i < bundles.size (); i++)
+    {
+      s.erase (bundles[i]);
+    }
+  Clock::time_point t2 = Clock::now ();
+  std::cout << "  " << name << ": insert " << NsPerOp (t0, t1, bundles.size ())
+            << " ns/op, erase " << NsPerOp (t1, t2, bundles.size ()) << " ns/op" << std::endl;
+}
+
+void
+RunStore (const std::vector<Ptr<Bundle> > &bundles)
+{
+  BundleStore store;
+  Clock::time_point t0 = Clock::now ();
+  for (uint32_t i = 0; i < bundles.size (); i++)
+    {
+      store.Store (bundles[i]);
+    }
+  Clock::time_point t1 = Clock::now ();
+  for (uint32_t i = 0; i < bundles.size (); i++)
+    {
+      store.Remove (bundles[i]);
+    }
+  Clock::time_point t2 = Clock::now ();
+  std::cout << "  store: insert " << NsPerOp (t0, t1, bundles.size ())
+            << " ns/op, erase " << NsPerOp (t1, t2, bundles.size ()) << " ns/op" << std::endl;
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string sizes = "10000,100000";
+
+  CommandLine cmd;
+  cmd.AddValue ("sizes", "Comma-separated bundle counts to run", sizes);
+  cmd.Parse (argc, argv);
+
+  std::istringstream in (sizes);
+  std::string item;
+  while (std::getline (in, item, ','))
+    {
+      uint32_t n = std::stoul (item);
+      std::vector<Ptr<Bundle> > bundles = MakeBundles (n);
+      std::cout << n << " bundles" << std::endl;
+      RunSet<HeaderPriorityCompare> ("header", bundles);
+      RunSet<BundlePriorityCompare> ("key", bundles);
+      RunStore (bundles);
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,207 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Network topology
+//
+//       n0 ----------- n1 ----------- n2
+//           10 Mbps        10 Mbps
+//            10 ms          10 ms
+//
+// Relay storage under a quota.
+//
+// - n0 sends --bundles ADUs of --size bytes to an application endpoint on
+//   n2, one every --interval, with priorities cycling through bulk, normal
+//   and expedited, and lifetimes cycling from 60 to 300 seconds.
+// - n1 relays them, but its CLA has no contact with n2 until --contact, so
+//   everything piles up in n1's store, which is limited to --quota bytes.
+// - The run is repeated for each eviction policy (or only the one given
+//   with --policy).  For each it prints the bundles evicted or refused at
+//   n1, the bundles delivered at n2 by priority, and n1's peak store size.
+
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-agent.h"
+#include "ns3/bp-static-routing-agent.h"
+#include "ns3/bp-agent-helper.h"
+#include "ns3/bp-agent-container.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BpStoreQuotaExample");
+
+namespace {
+
+uint32_t g_storeFull;
+uint32_t g_delivered[3];
+
+void
+Drop (void *bundle, int reason)
+{
+  if (reason == BpFlowProbe::DROP_STORE_FULL)
+    {
+      g_storeFull++;
+    }
+}
+
+void
+Send (Ptr<BpAgent> sender, uint32_t size, uint32_t n, BpEndpointId src, BpEndpointId dst)
+{
+  sender->Send (Create<Packet> (size), src, dst, Seconds (60 + 60 * (n % 5)), false, n % 3);
+}
+
+void
+Receive (Ptr<BpAgent> receiver, BpEndpointId eid)
+{
+  // The ADU carries no priority, so tell them apart by size.
+  Ptr<Packet> p;
+  while ((p = receiver->Receive (eid)) != NULL)
+    {
+      g_delivered[p->GetSize () % 3]++;
+    }
+  Simulator::Schedule (Seconds (1.0), &Receive, receiver, eid);
+}
+
+void
+Contact (Ptr<BpCla> cla)
+{
+  cla->SetReady (true);
+}
+
+void
+Run (std::string policy, uint32_t bundles, uint32_t size, Time interval, uint64_t quota, Time contact)
+{
+  g_storeFull = 0;
+  g_delivered[0] = g_delivered[1] = g_delivered[2] = 0;
+
+  NodeContainer nodes;
+  nodes.Create (3);
+
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  pointToPoint.SetChannelAttribute ("Delay", StringValue ("10ms"));
+  // Room for the relay's whole store to be sent at once when contact starts.
+  pointToPoint.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue ("1000p"));
+  NetDeviceContainer devices01 = pointToPoint.Install (nodes.Get (0), nodes.Get (1));
+  NetDeviceContainer devices12 = pointToPoint.Install (nodes.Get (1), nodes.Get (2));
+
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i01 = ipv4.Assign (devices01);
+  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer i12 = ipv4.Assign (devices12);
+
+  BpEndpointId eid0 ("dtn", "node0");
+  BpEndpointId eid1 ("dtn", "node1");
+  BpEndpointId eid2 ("dtn", "node2");
+  BpEndpointId eidApp ("dtn", "node2/app");
+
+  Ptr<BpStaticRoutingAgent> route0 = CreateObject<BpStaticRoutingAgent> ();
+  Ptr<BpStaticRoutingAgent> route1 = CreateObject<BpStaticRoutingAgent> ();
+  Ptr<BpStaticRoutingAgent> route2 = CreateObject<BpStaticRoutingAgent> ();
+
+  BpAgentHelper bpHelper;
+  bpHelper.SetRoutingAgent (route0);
+  bpHelper.SetBpEndpointId (eid0);
+  Ptr<BpAgent> sender = bpHelper.Install (nodes.Get (0)).Get (0);
+
+  bpHelper.SetAttribute ("StoreMaxBytes", UintegerValue (quota));
+  bpHelper.SetAttribute ("EvictionPolicy", StringValue (policy));
+  bpHelper.SetRoutingAgent (route1);
+  bpHelper.SetBpEndpointId (eid1);
+  Ptr<BpAgent> relay = bpHelper.Install (nodes.Get (1)).Get (0);
+  relay->TraceConnectWithoutContext ("Drop", MakeCallback (&Drop));
+
+  bpHelper.SetAttribute ("StoreMaxBytes", UintegerValue (0));
+  bpHelper.SetRoutingAgent (route2);
+  bpHelper.SetBpEndpointId (eid2);
+  Ptr<BpAgent> receiver = bpHelper.Install (nodes.Get (2)).Get (0);
+
+  Ptr<BpCla> cla0 = sender->AddCla ("Udp");
+  cla0->SetReady (true);
+  // The relay receives from n0 all along, but can only send once in contact.
+  Ptr<BpCla> cla1 = relay->AddCla ("Udp");
+  Ptr<BpCla> cla2 = receiver->AddCla ("Udp");
+  cla2->SetReady (true);
+
+  route0->AddRoute (eid0, eid0, true, i01.GetAddress (0), 4556, cla0);
+  route0->AddRoute (eid1, eid1, true, i01.GetAddress (1), 4556, cla0);
+  route0->AddRoute (eidApp, eid1, true, i01.GetAddress (1), 4556, cla0);
+  route1->AddRoute (eid1, eid1, true, i01.GetAddress (1), 4556, cla1);
+  route1->AddRoute (eid2, eid2, true, i12.GetAddress (1), 4556, cla1);
+  route1->AddRoute (eidApp, eid2, true, i12.GetAddress (1), 4556, cla1);
+  route2->AddRoute (eid2, eid2, true, i12.GetAddress (1), 4556, cla2);
+
+  BpRegisterInfo info;
+  receiver->Register (eidApp, info);
+
+  Time t = Seconds (1.0);
+  for (uint32_t n = 0; n < bundles; n++)
+    {
+      // One byte more per priority level, see Receive ().
+      Simulator::Schedule (t, &Send, sender, size + n % 3, n, eid0, eidApp);
+      t += interval;
+    }
+  Simulator::Schedule (contact, &Contact, cla1);
+  Simulator::Schedule (contact, &Receive, receiver, eidApp);
+  Simulator::Stop (Max (t, contact) + Seconds (10.0));
+  Simulator::Run ();
+
+  std::cout << policy << ": " << g_storeFull << "/" << bundles << " evicted or refused at the relay, delivered "
+            << g_delivered[0] << " bulk, " << g_delivered[1] << " normal, " << g_delivered[2]
+            << " expedited, relay peak " << relay->GetMaxBundlesStored () << " bundles" << std::endl;
+
+  Simulator::Destroy ();
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string policy = "all";
+  uint32_t bundles = 600;
+  uint32_t size = 1000;
+  Time interval = MilliSeconds (100);
+  uint64_t quota = 100000;
+  Time contact = Seconds (40);
+
+  CommandLine cmd;
+  cmd.AddValue ("policy", "Eviction policy: DropOldest, DropLowestPriority, DropSoonestExpiring or RefuseNew (all by default)", policy);
+  cmd.AddValue ("bundles", "Number of ADUs to send", bundles);
+  cmd.AddValue ("size", "ADU size in bytes", size);
+  cmd.AddValue ("interval", "Time between ADUs", interval);
+  cmd.AddValue ("quota", "Relay store quota in bytes", quota);
+  cmd.AddValue ("contact", "Time at which the relay can start sending to n2", contact);
+  cmd.Parse (argc, argv);
+
+  const char *policies[] = { "DropOldest", "DropLowestPriority", "DropSoonestExpiring", "RefuseNew" };
+  for (uint32_t n = 0; n < 4; n++)
+    {
+      if (policy == "all" || policy == policies[n])
+        {
+          Run (policies[n], bundles, size, interval, quota, contact);
+        }
+    }
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Network topology
+//
+//       n0 ----------- n1
+//           100 Mbps
+//             50 ms
+//
+// Goodput of the TCP CLA against the number of parallel sessions.
+//
+// - n0 sends --bundles ADUs of --size bytes to an application endpoint on
+//   n1, all at once, over BpTcpCla with Connections set to each value of
+//   --connections in turn.
+// - The TCP send and receive buffers are --window bytes, so that one
+//   connection is limited to about window / RTT.
+// - For each run this prints the ADU goodput from the first send to the
+//   last byte delivered, and the transfers carried by each session.
+
+#include <iostream>
+#include <sstream>
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-agent.h"
+#include "ns3/bp-tcp-cla.h"
+#include "ns3/bp-static-routing-agent.h"
+#include "ns3/bp-agent-helper.h"
+#include "ns3/bp-agent-container.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BpTcpPoolBenchmark");
+
+namespace {
+
+const Time START = Seconds (1.0);
+const Time POLL = MilliSeconds (10);
+
+uint64_t g_rxBytes;
+Time g_lastRx;
+
+void
+Send (Ptr<BpAgent> sender, uint32_t size, BpEndpointId src, BpEndpointId dst)
+{
+  sender->Send (Create<Packet> (size), src, dst);
+}
+
+void
+Receive (Ptr<BpAgent> receiver, BpEndpointId eid, uint64_t total)
+{
+  Ptr<Packet> p;
+  while ((p = receiver->Receive (eid)) != NULL)
+    {
+      g_rxBytes += p->GetSize ();
+      g_lastRx = Simulator::Now ();
+    }
+  if (g_rxBytes >= total)
+    {
+      Simulator::Stop ();
+      return;
+    }
+  Simulator::Schedule (POLL, &Receive, receiver, eid, total);
+}
+
+void
+Run (uint32_t connections, uint32_t bundles, uint32_t size, uint32_t window, Time delay, Time limit)
+{
+  g_rxBytes = 0;
+  g_lastRx = Seconds (0);
+
+  Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue (window));
+  Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue (window));
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (1448));
+
+  NodeContainer nodes;
+  nodes.Create (2);
+
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("100Mbps"));
+  pointToPoint.SetChannelAttribute ("Delay", TimeValue (delay));
+  NetDeviceContainer devices = pointToPoint.Install (nodes);
+
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i = ipv4.Assign (devices);
+
+  BpEndpointId eidSender ("dtn", "node0");
+  BpEndpointId eidRecv ("dtn", "node1");
+  BpEndpointId eidApp ("dtn", "node1/app");
+
+  Ptr<BpStaticRoutingAgent> route = CreateObject<BpStaticRoutingAgent> ();
+
+  BpAgentHelper bpSenderHelper;
+  bpSenderHelper.SetBpVersion (7);
+  bpSenderHelper.SetRoutingAgent (route);
+  bpSenderHelper.SetBpEndpointId (eidSender);
+  Ptr<BpAgent> sender = bpSenderHelper.Install (nodes.Get (0)).Get (0);
+
+  BpAgentHelper bpReceiverHelper;
+  bpReceiverHelper.SetBpVersion (7);
+  bpReceiverHelper.SetRoutingAgent (route);
+  bpReceiverHelper.SetBpEndpointId (eidRecv);
+  Ptr<BpAgent> receiver = bpReceiverHelper.Install (nodes.Get (1)).Get (0);
+
+  Ptr<BpTcpCla> cla = DynamicCast<BpTcpCla> (sender->AddCla ("Tcp"));
+  cla->SetAttribute ("Connections", UintegerValue (connections));
+  cla->SetAttribute ("PoolPolicy", EnumValue (BpTcpCla::LEAST_QUEUED));
+  cla->SetReady (true);
+  receiver->AddCla ("Tcp");
+
+  route->AddRoute (eidSender, eidSender, true, i.GetAddress (0), 4556, cla);
+  route->AddRoute (eidRecv, eidRecv, true, i.GetAddress (1), 4556, cla);
+  route->AddRoute (eidApp, eidRecv, true, i.GetAddress (1), 4556, cla);
+
+  BpRegisterInfo info;
+  receiver->Register (eidApp, info);
+
+  for (uint32_t n = 0; n < bundles; n++)
+    {
+      Simulator::Schedule (START, &Send, sender, size, eidSender, eidApp);
+    }
+  uint64_t total = (uint64_t) bundles * size;
+  Simulator::Schedule (START, &Receive, receiver, eidApp, total);
+  Simulator::Stop (START + limit);
+  Simulator::Run ();
+
+  double secs = (g_lastRx - START).GetSeconds ();
+  double mbps = secs > 0 ? g_rxBytes * 8 / secs / 1e6 : 0;
+  std::cout << connections << " connection(s): " << g_rxBytes << "/" << total
+            << " bytes in " << secs << " s, goodput " << mbps << " Mbps" << std::endl;
+
+  std::vector<BpTcpCla::SessionStats> stats = cla->GetSessionStats ();
+  for (uint32_t k = 0; k < stats.size (); k++)
+    {
+      std::cout << "  session " << k << ": " << stats[k].bundlesSent << " bundles, "
+                << stats[k].bytesSent << " bytes sent, " << stats[k].bundlesAcked
+                << " acknowledged" << std::endl;
+    }
+  std::map<std::string, BpTcpCla::SessionStats> peers = cla->GetPeerStats ();
+  std::map<std::string, BpTcpCla::SessionStats>::iterator it;
+  for (it = peers.begin (); it != peers.end (); it++)
+    {
+      std::cout << "  peer " << it->first << ": " << it->second.sessions << " session(s), "
+                << it->second.bytesSent << " bytes sent, " << it->second.bytesReceived
+                << " bytes received" << std::endl;
+    }
+
+  Simulator::Destroy ();
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string connections = "1,2,4,8";
+  uint32_t bundles = 40;
+  uint32_t size = 500000;
+  uint32_t window = 131072;
+  Time delay = MilliSeconds (50);
+  Time limit = Seconds (120);
+
+  CommandLine cmd;
+  cmd.AddValue ("connections", "Comma-separated numbers of parallel TCP sessions to run with", connections);
+  cmd.AddValue ("bundles", "Number of ADUs to send", bundles);
+  cmd.AddValue ("size", "ADU size in bytes", size);
+  cmd.AddValue ("window", "TCP send and receive buffer size in bytes", window);
+  cmd.AddValue ("delay", "One-way link delay", delay);
+  cmd.AddValue ("limit", "Longest simulated time of one run", limit);
+  cmd.Parse (argc, argv);
+
+  std::istringstream list (connections);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      Run (std::stoul (item), bundles, size, window, delay, limit);
+    }
+
+  return 0;
+}
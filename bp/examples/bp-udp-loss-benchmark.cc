@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Network topology
+//
+//       n0 ----------- n1
+//           10 Mbps
+//             10 ms
+//
+// Delivery of large bundles over the UDP CLA on a lossy link.
+//
+// - n0 sends --bundles ADUs of --size bytes to an application endpoint on
+//   n1, one every --interval.
+// - n1's device drops each received packet with probability --loss (a
+//   comma-separated list, one run per value).
+// - Each loss rate is run with three ways of fitting bundles to the
+//   1500 byte MTU:
+//     agent: the agent fragments to the CLA MaxBundleSize (the default);
+//     ip:    whole bundles are sent as one datagram and IPv4 fragments it;
+//     cla:   whole bundles are split by the CLA SegmentSize and reassembled
+//            by the receiving CLA.
+// - For each run this prints the bundles delivered, the ADU goodput and the
+//   bundles the receiving CLA gave up reassembling.
+
+#include <iostream>
+#include <sstream>
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-agent.h"
+#include "ns3/bp-udp-cla.h"
+#include "ns3/bp-static-routing-agent.h"
+#include "ns3/bp-agent-helper.h"
+#include "ns3/bp-agent-container.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BpUdpLossBenchmark");
+
+namespace {
+
+const Time START = Seconds (1.0);
+const Time POLL = MilliSeconds (10);
+
+enum Mode {
+  AGENT,
+  IP,
+  CLA
+};
+
+const char *MODE_NAMES[] = { "agent", "ip", "cla" };
+
+uint64_t g_rxBytes;
+Time g_lastRx;
+
+void
+Send (Ptr<BpAgent> sender, uint32_t size, BpEndpointId src, BpEndpointId dst)
+{
+  sender->Send (Create<Packet> (size), src, dst);
+}
+
+void
+Receive (Ptr<BpAgent> receiver, BpEndpointId eid)
+{
+  Ptr<Packet> p;
+  while ((p = receiver->Receive (eid)) != NULL)
+    {
+      g_rxBytes += p->GetSize ();
+      g_lastRx = Simulator::Now ();
+    }
+  Simulator::Schedule (POLL, &Receive, receiver, eid);
+}
+
+void
+Run (Mode mode, double loss, uint32_t bundles, uint32_t size, Time interval)
+{
+  g_rxBytes = 0;
+  g_lastRx = START;
+
+  NodeContainer nodes;
+  nodes.Create (2);
+
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  pointToPoint.SetChannelAttribute ("Delay", StringValue ("10ms"));
+  NetDeviceContainer devices = pointToPoint.Install (nodes);
+
+  Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+  em->SetUnit (RateErrorModel::ERROR_UNIT_PACKET);
+  em->SetRate (loss);
+  devices.Get (1)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i = ipv4.Assign (devices);
+
+  BpEndpointId eidSender ("dtn", "node0");
+  BpEndpointId eidRecv ("dtn", "node1");
+  BpEndpointId eidApp ("dtn", "node1/app");
+
+  Ptr<BpStaticRoutingAgent> route = CreateObject<BpStaticRoutingAgent> ();
+
+  BpAgentHelper bpSenderHelper;
+  bpSenderHelper.SetBpVersion (7);
+  bpSenderHelper.SetRoutingAgent (route);
+  bpSenderHelper.SetBpEndpointId (eidSender);
+  Ptr<BpAgent> sender = bpSenderHelper.Install (nodes.Get (0)).Get (0);
+
+  BpAgentHelper bpReceiverHelper;
+  bpReceiverHelper.SetBpVersion (7);
+  bpReceiverHelper.SetRoutingAgent (route);
+  bpReceiverHelper.SetBpEndpointId (eidRecv);
+  Ptr<BpAgent> receiver = bpReceiverHelper.Install (nodes.Get (1)).Get (0);
+
+  Ptr<BpCla> cla = sender->AddCla ("Udp");
+  if (mode != AGENT)
+    {
+      cla->SetAttribute ("MaxBundleSize", UintegerValue (0));
+    }
+  if (mode == CLA)
+    {
+      cla->SetAttribute ("SegmentSize", UintegerValue (1472));
+    }
+  cla->SetReady (true);
+  Ptr<BpUdpCla> receiverCla = DynamicCast<BpUdpCla> (receiver->AddCla ("Udp"));
+
+  route->AddRoute (eidSender, eidSender, true, i.GetAddress (0), 4556, cla);
+  route->AddRoute (eidRecv, eidRecv, true, i.GetAddress (1), 4556, cla);
+  route->AddRoute (eidApp, eidRecv, true, i.GetAddress (1), 4556, cla);
+
+  BpRegisterInfo info;
+  receiver->Register (eidApp, info);
+
+  Time t = START;
+  for (uint32_t n = 0; n < bundles; n++)
+    {
+      Simulator::Schedule (t, &Send, sender, size, eidSender, eidApp);
+      t += interval;
+    }
+  Simulator::Schedule (START, &Receive, receiver, eidApp);
+  Simulator::Stop (t + Seconds (10));
+  Simulator::Run ();
+
+  double secs = (g_lastRx - START).GetSeconds ();
+  double mbps = secs > 0 ? g_rxBytes * 8 / secs / 1e6 : 0;
+  std::cout << MODE_NAMES[mode] << ", loss " << loss << ": delivered "
+            << g_rxBytes / size << "/" << bundles << " bundles, goodput "
+            << mbps << " Mbps, " << receiverCla->GetReassemblyDrops ()
+            << " CLA reassemblies dropped" << std::endl;
+
+  Simulator::Destroy ();
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string losses = "0,0.01,0.05,0.1";
+  uint32_t bundles = 200;
+  uint32_t size = 20000;
+  Time interval = MilliSeconds (20);
+
+  CommandLine cmd;
+  cmd.AddValue ("loss", "Comma-separated packet loss rates to run with", losses);
+  cmd.AddValue ("bundles", "Number of ADUs to send", bundles);
+  cmd.AddValue ("size", "ADU size in bytes", size);
+  cmd.AddValue ("interval", "Time between ADUs", interval);
+  cmd.Parse (argc, argv);
+
+  std::istringstream list (losses);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      double loss = std::stod (item);
+      for (uint32_t mode = AGENT; mode <= CLA; mode++)
+        {
+          Run ((Mode) mode, loss, bundles, size, interval);
+        }
+    }
+
+  return 0;
+}
@@ -40,7 +40,7 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("BundleProtocolSimpleExample");
 
-void Send (Ptr<BpAgent6> sender, uint32_t size, BpEndpointId src, BpEndpointId dst)
+void Send (Ptr<BpAgent> sender, uint32_t size, BpEndpointId src, BpEndpointId dst)
 {
   std::cout << Simulator::Now ().GetMilliSeconds () << " Send a PDU with size " << size << std::endl;
 
@@ -48,7 +48,7 @@ void Send (Ptr<BpAgent6> sender, uint32_t size, BpEndpointId src, BpEndpointId d
   sender->Send (packet, src, dst);
 }
 
-void Receive (Ptr<BpAgent6> receiver, BpEndpointId eid)
+void Receive (Ptr<BpAgent> receiver, BpEndpointId eid)
 {
 
   Ptr<Packet> p = receiver->Receive (eid);
@@ -94,7 +94,6 @@ main (int argc, char *argv[])
   l4type << "Tcp";
   Config::SetDefault ("ns3::BpAgent::L4Type", StringValue (l4type.str ()));
   Config::SetDefault ("ns3::BpAgent::BundleSize", UintegerValue (400)); 
-  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (512));
 
   // build endpoint ids
   BpEndpointId eidSender ("dtn", "node0");
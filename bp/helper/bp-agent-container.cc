@@ -28,14 +28,14 @@ BpAgentContainer::BpAgentContainer ()
 {
 }
 
-BpAgentContainer::BpAgentContainer (Ptr<BpAgent6> bpAgent)
+BpAgentContainer::BpAgentContainer (Ptr<BpAgent> bpAgent)
 {
   m_bpAgents.push_back (bpAgent);
 }
 
 BpAgentContainer::BpAgentContainer (std::string name)
 {
-  Ptr<BpAgent6> bpAgent = Names::Find<BpAgent6> (name);
+  Ptr<BpAgent> bpAgent = Names::Find<BpAgent> (name);
   m_bpAgents.push_back (bpAgent);
 }
 
@@ -57,7 +57,7 @@ BpAgentContainer::GetN (void) const
   return m_bpAgents.size ();
 }
 
-Ptr<BpAgent6> 
+Ptr<BpAgent> 
 BpAgentContainer::Get (uint32_t i) const
 {
   return m_bpAgents[i];
@@ -72,14 +72,14 @@ BpAgentContainer::Add (BpAgentContainer other)
     }
 }
 void 
-BpAgentContainer::Add (Ptr<BpAgent6> bpAgent)
+BpAgentContainer::Add (Ptr<BpAgent> bpAgent)
 {
   m_bpAgents.push_back (bpAgent);
 }
 void 
 BpAgentContainer::Add (std::string name)
 {
-  Ptr<BpAgent6> bpAgent = Names::Find<BpAgent6> (name);
+  Ptr<BpAgent> bpAgent = Names::Find<BpAgent> (name);
   m_bpAgents.push_back (bpAgent);
 }
 
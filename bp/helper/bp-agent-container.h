@@ -24,7 +24,7 @@
 
 #include <stdint.h>
 #include <vector>
-#include "ns3/bp-agent-6.h"
+#include "ns3/bp-agent.h"
 
 namespace ns3 {
 
@@ -54,7 +54,7 @@ public:
    *
    * \param bp application The Ptr<BpAgent> to add to the container.
    */
-  BpAgentContainer (Ptr<BpAgent6> bpAgent);
+  BpAgentContainer (Ptr<BpAgent> bpAgent);
 
   /**
    * Create an BpAgentContainer with exactly one BpAgent which has
@@ -68,7 +68,7 @@ public:
   /**
    * iterator for BpAgent
    */
-  typedef std::vector<Ptr<BpAgent6> >::const_iterator Iterator;
+  typedef std::vector<Ptr<BpAgent> >::const_iterator Iterator;
 
   /**
    * \brief Get an iterator which refers to the first BpAgent in the 
@@ -155,7 +155,7 @@ public:
    * \param i the index of the requested application pointer.
    * \returns the requested application pointer.
    */
-  Ptr<BpAgent6> Get (uint32_t i) const;
+  Ptr<BpAgent> Get (uint32_t i) const;
 
   /**
    * \brief Append the contents of another BpAgent to the end of
@@ -170,7 +170,7 @@ public:
    *
    * \param application The Ptr<BpAgent> to append.
    */
-  void Add (Ptr<BpAgent6> application);
+  void Add (Ptr<BpAgent> application);
 
   /**
    * \brief Append to this container the single Ptr<BpAgent> referred to
@@ -197,7 +197,7 @@ public:
   void Stop (Time stop);
 
 private:
-  std::vector<Ptr<BpAgent6> > m_bpAgents; /// vector of bundle protocol agents
+  std::vector<Ptr<BpAgent> > m_bpAgents; /// vector of bundle protocol agents
 };
 
 } // namespace ns3
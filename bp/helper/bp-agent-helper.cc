@@ -19,6 +19,8 @@
  */
 
 #include "bp-agent-helper.h"
+#include "ns3/bp-agent-6.h"
+#include "ns3/bp-agent-7.h"
 #include "ns3/string.h"
 #include "ns3/names.h"
 #include "ns3/simulator.h"
@@ -30,6 +32,7 @@ BpAgentHelper::BpAgentHelper ()
   : m_eid ("dtn:none"),
     m_routingAgent (0)
 {
+  m_factory.SetTypeId (BpAgent6::GetTypeId ());
 }
 
 BpAgentContainer
@@ -57,7 +60,7 @@ BpAgentHelper::Install (NodeContainer c)
   return apps;
 }
 
-Ptr<BpAgent6>
+Ptr<BpAgent>
 BpAgentHelper::InstallPriv (Ptr<Node> node)
 {
   if (m_eid.Uri () == "dtn:none")
@@ -65,11 +68,15 @@ BpAgentHelper::InstallPriv (Ptr<Node> node)
   if (m_routingAgent == 0)
     NS_FATAL_ERROR ("BpAgentHelper::InstallPriv (): do not have bundle routing agent! " << m_eid.Uri ());
 
-  Ptr<BpAgent6> bpAgent = CreateObject<BpAgent6> ();
+  Ptr<BpAgent> bpAgent = m_factory.Create<BpAgent> ();
   bpAgent->Open (node);   
   bpAgent->SetBpEndpointId (m_eid);
   bpAgent->SetRoutingAgent (m_routingAgent);
-  Simulator::Schedule (Seconds (0.0), &BpAgent6::Initialize, bpAgent);
+  for (std::vector<ObjectFactory>::const_iterator i = m_claFactories.begin (); i != m_claFactories.end (); ++i)
+    {
+      bpAgent->AddCla (*i);
+    }
+  Simulator::Schedule (Seconds (0.0), &BpAgent::Initialize, bpAgent);
 
   return bpAgent;
 }
@@ -86,5 +93,56 @@ BpAgentHelper::SetRoutingAgent (Ptr<BpRoutingAgent> rt)
   m_routingAgent = rt;
 }
 
+void 
+BpAgentHelper::SetBpVersion (uint8_t version)
+{
+  if (version == 6)
+    m_factory.SetTypeId (BpAgent6::GetTypeId ());
+  else if (version == 7)
+    m_factory.SetTypeId (BpAgent7::GetTypeId ());
+  else
+    NS_FATAL_ERROR ("BpAgentHelper::SetBpVersion (): unsupported bundle protocol version " << (uint32_t)version);
+}
+
+void 
+BpAgentHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+void 
+BpAgentHelper::AddCla (std::string type,
+                       std::string n0, const AttributeValue &v0,
+                       std::string n1, const AttributeValue &v1,
+                       std::string n2, const AttributeValue &v2,
+                       std::string n3, const AttributeValue &v3)
+{
+  TypeId tid;
+  if (!BpCla::LookupType (type, &tid))
+    NS_FATAL_ERROR ("BpAgentHelper::AddCla (): no CLA type " << type);
+
+  ObjectFactory factory;
+  factory.SetTypeId (tid);
+  factory.Set (n0, v0);
+  factory.Set (n1, v1);
+  factory.Set (n2, v2);
+  factory.Set (n3, v3);
+  m_claFactories.push_back (factory);
+}
+
+void 
+BpAgentHelper::SetClaAttribute (std::string name, const AttributeValue &value)
+{
+  if (m_claFactories.empty ())
+    NS_FATAL_ERROR ("BpAgentHelper::SetClaAttribute (): no CLA added");
+  m_claFactories.back ().Set (name, value);
+}
+
+void 
+BpAgentHelper::ClearClas ()
+{
+  m_claFactories.clear ();
+}
+
 
 } // namespace ns3
@@ -23,6 +23,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include "ns3/object-factory.h"
 #include "ns3/attribute.h"
 #include "ns3/net-device.h"
@@ -90,6 +91,56 @@ public:
    */
   void SetRoutingAgent (Ptr<BpRoutingAgent> rt);
 
+  /**
+   * Select the bundle protocol version of the agents to install
+   *
+   * \param version 6 (BpAgent6, the default) or 7 (BpAgent7)
+   */
+  void SetBpVersion (uint8_t version);
+
+  /**
+   * Set an attribute on each BpAgent to be installed
+   *
+   * \param name the name of the attribute to set
+   * \param value the value of the attribute to set
+   */
+  void SetAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Add a CLA to each BpAgent to be installed, in addition to those added
+   * before.  Each agent gets its own instance.
+   *
+   * \param type the name of the CLA type, as taken by BpCla::LookupType (),
+   * e.g. "Tcp" or "ns3::BpLtpCla"
+   * \param n0 the name of an attribute to set on the CLA
+   * \param v0 the value of the attribute
+   * \param n1 the name of an attribute to set on the CLA
+   * \param v1 the value of the attribute
+   * \param n2 the name of an attribute to set on the CLA
+   * \param v2 the value of the attribute
+   * \param n3 the name of an attribute to set on the CLA
+   * \param v3 the value of the attribute
+   */
+  void AddCla (std::string type,
+               std::string n0 = "", const AttributeValue &v0 = EmptyAttributeValue (),
+               std::string n1 = "", const AttributeValue &v1 = EmptyAttributeValue (),
+               std::string n2 = "", const AttributeValue &v2 = EmptyAttributeValue (),
+               std::string n3 = "", const AttributeValue &v3 = EmptyAttributeValue ());
+
+  /**
+   * Set an attribute on the CLA added last
+   *
+   * \param name the name of the attribute to set
+   * \param value the value of the attribute to set
+   */
+  void SetClaAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * Install agents without the CLAs added so far, e.g. to give the next
+   * nodes other CLAs.  Agents installed already keep theirs.
+   */
+  void ClearClas ();
+
 private:
   /**
    * \internal
@@ -98,11 +149,13 @@ private:
    * \param node The node on which an BpAgent will be installed.
    * \returns Ptr to the BpAgent installed.
    */
-  Ptr<BpAgent6> InstallPriv (Ptr<Node> node);
+  Ptr<BpAgent> InstallPriv (Ptr<Node> node);
 
 private:
+  ObjectFactory m_factory;                   /// factory for BpAgent6 or BpAgent7
   BpEndpointId m_eid;                        /// endpoint id
   Ptr<BpRoutingAgent> m_routingAgent;  /// bundle routing agent
+  std::vector<ObjectFactory> m_claFactories; /// a CLA of each for every agent
 };
 
 } // namespace ns3
@@ -2,15 +2,35 @@
 #define ACS_CTEB_H
 
 #include <stdint.h>
+#include <string>
+#include <vector>
 #include "ns3/header.h"
 #include "ns3/buffer.h"
+#include "sdnv.h"
+#include "bp-range-set.h"
 
 namespace ns3 {
 
+/**
+ * \brief Custody Transfer Enhancement Block
+ *
+ * An RFC 5050 extension block, placed between the primary and payload
+ * blocks, that gives a bundle a custody ID chosen by its custodian so that
+ * custody can be acknowledged by ID in an aggregate custody signal.
+ *
+ * Block type, processing flags (SDNV) and block length (SDNV) are followed
+ * by the custody ID (SDNV) and the creating custodian's EID, which runs to
+ * the end of the block.
+ */
 class CTEB : public Header
 {
 public:
-  CTEB () {};
+  /// block type code for a CTEB
+  static const uint8_t BLOCK_TYPE = 0x0a;
+  /// block processing flag: replicate the block in every fragment
+  static const uint8_t REPLICATE_IN_FRAGMENT = 0x01;
+
+  CTEB () : custodyID (0) {};
   virtual ~CTEB () {};
 
   static TypeId GetTypeId (void) {
@@ -22,19 +42,55 @@ public:
 
   virtual TypeId GetInstanceTypeId (void) const { return GetTypeId(); }
 
-  virtual void Print (std::ostream &os) const {};
-  virtual uint32_t GetSerializedSize (void) const { return 1; } // TODO
-  virtual void Serialize (Buffer::Iterator start) const { };
-  virtual uint32_t Deserialize (Buffer::Iterator start) { return 1; } // TODO
+  virtual void Print (std::ostream &os) const {
+    os << "custody id " << custodyID << " creator " << creatorEID;
+  };
+  virtual uint32_t GetSerializedSize (void) const {
+    uint32_t length = GetBodyLength ();
+    return 1 + Sdnv::EncodedSize (REPLICATE_IN_FRAGMENT) + Sdnv::EncodedSize (length) + length;
+  }
+  virtual void Serialize (Buffer::Iterator start) const {
+    start.WriteU8 (BLOCK_TYPE);
+    Sdnv::Encode (REPLICATE_IN_FRAGMENT, start);
+    Sdnv::Encode (GetBodyLength (), start);
+    Sdnv::Encode (custodyID, start);
+    start.Write (reinterpret_cast<const uint8_t *> (creatorEID.data ()), creatorEID.length ());
+  };
+  virtual uint32_t Deserialize (Buffer::Iterator start) {
+    Buffer::Iterator i = start;
+    i.ReadU8 ();
+    Sdnv::Decode (i);
+    uint32_t length = (uint32_t)Sdnv::Decode (i);
+    Buffer::Iterator body = i;
+    custodyID = Sdnv::Decode (i);
+    uint32_t eidLen = length - i.GetDistanceFrom (body);
+    creatorEID.resize (eidLen);
+    if (eidLen > 0) i.Read (reinterpret_cast<uint8_t *> (&creatorEID[0]), eidLen);
+    return i.GetDistanceFrom (start);
+  }
 
   uint64_t custodyID;
-  std::string creatorEID; 
+  std::string creatorEID;
+
+private:
+  uint32_t GetBodyLength (void) const {
+    return Sdnv::EncodedSize (custodyID) + creatorEID.length ();
+  }
 };
 
+/**
+ * \brief Aggregate Custody Signal
+ *
+ * The body of an ACS administrative record: a status byte followed by the
+ * runs ("fills") of consecutive custody IDs being signalled, as SDNVs.  The
+ * first fill is its left edge and length; each following fill is the gap
+ * from the end of the previous fill to its left edge, and its length.
+ * The fills run to the end of the record.
+ */
 class ACS : public Header
 {
 public:
-  ACS () {}
+  ACS () : status (0), leftEdgeFirstFill (0), lenFirstFill (0) {}
   virtual ~ACS () {}
 
   static TypeId GetTypeId (void) {
@@ -46,15 +102,82 @@ public:
 
   virtual TypeId GetInstanceTypeId (void) const { return GetTypeId(); }
 
-  virtual void Print (std::ostream &os) const {};
-  virtual uint32_t GetSerializedSize (void) const { return 1; } // TODO;
-  virtual void Serialize (Buffer::Iterator start) const { };
-  virtual uint32_t Deserialize (Buffer::Iterator start) { return 1; } // TODO;
+  virtual void Print (std::ostream &os) const {
+    os << "status " << (uint32_t)status << " fills " << (lenFirstFill ? 1 + nextEdgeLenPairs.size () : 0);
+  };
+  virtual uint32_t GetSerializedSize (void) const {
+    if (lenFirstFill == 0) return 1;
+    uint32_t size = 1 + Sdnv::EncodedSize (leftEdgeFirstFill) + Sdnv::EncodedSize (lenFirstFill);
+    for (uint32_t n = 0; n < nextEdgeLenPairs.size (); n++) {
+      size += Sdnv::EncodedSize (nextEdgeLenPairs[n].first) + Sdnv::EncodedSize (nextEdgeLenPairs[n].second);
+    }
+    return size;
+  }
+  virtual void Serialize (Buffer::Iterator start) const {
+    start.WriteU8 (status);
+    if (lenFirstFill == 0) return;
+    Sdnv::Encode (leftEdgeFirstFill, start);
+    Sdnv::Encode (lenFirstFill, start);
+    for (uint32_t n = 0; n < nextEdgeLenPairs.size (); n++) {
+      Sdnv::Encode (nextEdgeLenPairs[n].first, start);
+      Sdnv::Encode (nextEdgeLenPairs[n].second, start);
+    }
+  };
+  virtual uint32_t Deserialize (Buffer::Iterator start) {
+    Buffer::Iterator i = start;
+    status = i.ReadU8 ();
+    leftEdgeFirstFill = 0;
+    lenFirstFill = 0;
+    nextEdgeLenPairs.clear ();
+    if (!i.IsEnd ()) {
+      leftEdgeFirstFill = Sdnv::Decode (i);
+      lenFirstFill = Sdnv::Decode (i);
+    }
+    while (!i.IsEnd ()) {
+      uint64_t gap = Sdnv::Decode (i);
+      nextEdgeLenPairs.push_back (std::make_pair (gap, Sdnv::Decode (i)));
+    }
+    return i.GetDistanceFrom (start);
+  }
+
+  /**
+   * \brief set the fills from a set of custody ID ranges
+   */
+  void SetFills (const BpRangeSet &ids) {
+    leftEdgeFirstFill = 0;
+    lenFirstFill = 0;
+    nextEdgeLenPairs.clear ();
+    uint64_t prevEnd = 0;
+    for (BpRangeSet::const_iterator it = ids.begin (); it != ids.end (); it++) {
+      if (lenFirstFill == 0) {
+        leftEdgeFirstFill = it->first;
+        lenFirstFill = it->second - it->first;
+      } else {
+        nextEdgeLenPairs.push_back (std::make_pair (it->first - prevEnd, it->second - it->first));
+      }
+      prevEnd = it->second;
+    }
+  }
+
+  /**
+   * \brief add the custody IDs of every fill to a set of ranges
+   */
+  void GetFills (BpRangeSet &ids) const {
+    if (lenFirstFill == 0) return;
+    uint64_t edge = leftEdgeFirstFill;
+    ids.Add (edge, edge + lenFirstFill);
+    edge += lenFirstFill;
+    for (uint32_t n = 0; n < nextEdgeLenPairs.size (); n++) {
+      edge += nextEdgeLenPairs[n].first;
+      ids.Add (edge, edge + nextEdgeLenPairs[n].second);
+      edge += nextEdgeLenPairs[n].second;
+    }
+  }
 
   uint8_t status;
   uint64_t leftEdgeFirstFill;
   uint64_t lenFirstFill;
-  std::vector<std::pair<uint64_t, uint64_t>> nextEdgeLenPairs;
+  std::vector<std::pair<uint64_t, uint64_t>> nextEdgeLenPairs;  /// (gap, length) of each fill after the first
 };
 
 
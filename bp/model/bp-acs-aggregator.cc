@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-acs-aggregator.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+NS_LOG_COMPONENT_DEFINE ("AcsAggregator");
+
+namespace ns3 {
+
+AcsAggregator::AcsAggregator(void)
+  : m_delay (Seconds(1.0)),
+    m_maxCount (0)
+{
+}
+
+AcsAggregator::~AcsAggregator(void) {
+  Clear();
+}
+
+void AcsAggregator::SetSendCallback(SendCallback cb) {
+  m_send = cb;
+}
+
+void AcsAggregator::SetDelay(Time delay) {
+  m_delay = delay;
+}
+
+Time AcsAggregator::GetDelay() const {
+  return m_delay;
+}
+
+void AcsAggregator::SetMaxCount(uint32_t count) {
+  m_maxCount = count;
+}
+
+uint32_t AcsAggregator::GetMaxCount() const {
+  return m_maxCount;
+}
+
+void AcsAggregator::Add(const BpEndpointId &custodian, uint32_t custodyId) {
+  Pending &p = m_pending[custodian];
+  if (p.ids.IsEmpty()) {
+    p.timer = Simulator::Schedule(m_delay, &AcsAggregator::Flush, this, custodian);
+  }
+  p.ids.Add(custodyId, custodyId + 1);
+  NS_LOG_DEBUG("custody id " << custodyId << " for " << custodian.Uri() << ", "
+    << p.ids.GetCovered() << " ids pending in " << p.ids.GetNRanges() << " fills");
+  if (m_maxCount != 0 && p.ids.GetCovered() >= m_maxCount) {
+    Flush(custodian);
+  }
+}
+
+void AcsAggregator::Flush(const BpEndpointId &custodian) {
+  pendingType::iterator it = m_pending.find(custodian);
+  if (it == m_pending.end()) return;
+  it->second.timer.Cancel();
+
+  ACS acs;
+  acs.status = 0x80;
+  acs.SetFills(it->second.ids);
+  NS_LOG_DEBUG("signalling " << it->second.ids.GetCovered() << " custody ids to " << custodian.Uri()
+    << " in " << it->second.ids.GetNRanges() << " fills");
+  m_pending.erase(it);
+
+  if (!m_send.IsNull()) m_send(custodian, acs);
+}
+
+void AcsAggregator::Clear() {
+  pendingType::iterator it;
+  for (it = m_pending.begin(); it != m_pending.end(); it++) {
+    it->second.timer.Cancel();
+  }
+  m_pending.clear();
+}
+
+} // namespace ns3
@@ -0,0 +1,95 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_ACS_AGGREGATOR_H
+#define BP_ACS_AGGREGATOR_H
+
+#include "acs-cteb.h"
+#include "bp-endpoint-id.h"
+#include "bp-range-set.h"
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief Batches custody acceptances into aggregate custody signals
+ *
+ * Custody IDs accepted for each custodian are collected in a BpRangeSet.
+ * One ACS covering all of them is handed to the send callback when the
+ * first ID has waited for the delay, or as soon as the count of IDs
+ * reaches the maximum, whichever comes first.
+ *
+ * Custody IDs are limited to 32 bits, which is what BpAgent6 assigns.
+ */
+class AcsAggregator {
+public:
+  /// called with the custodian and the ACS to send to it
+  typedef Callback<void, const BpEndpointId &, const ACS &> SendCallback;
+
+  AcsAggregator(void);
+  ~AcsAggregator(void);
+
+  void SetSendCallback(SendCallback cb);
+
+  /**
+   * \param delay longest time an accepted custody ID waits to be signalled
+   */
+  void SetDelay(Time delay);
+  Time GetDelay() const;
+
+  /**
+   * \param count number of custody IDs that triggers a signal at once, or 0
+   * for no limit
+   */
+  void SetMaxCount(uint32_t count);
+  uint32_t GetMaxCount() const;
+
+  /**
+   * Record that custody of a bundle was accepted.
+   *
+   * \param custodian the bundle's current custodian
+   * \param custodyId the custody ID from the bundle's CTEB
+   */
+  void Add(const BpEndpointId &custodian, uint32_t custodyId);
+
+  /**
+   * Signal everything pending for a custodian now.
+   */
+  void Flush(const BpEndpointId &custodian);
+
+  /**
+   * Drop everything pending, without signalling it.
+   */
+  void Clear();
+
+private:
+  struct Pending {
+    BpRangeSet ids;
+    EventId timer;
+  };
+  typedef std::map<BpEndpointId, Pending> pendingType;
+
+  Time m_delay;
+  uint32_t m_maxCount;
+  pendingType m_pending;     /// custody IDs waiting per custodian
+  SendCallback m_send;
+};
+
+} // namespace ns3
+
+#endif /* BP_ACS_AGGREGATOR_H */
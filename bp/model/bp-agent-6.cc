@@ -24,6 +24,9 @@
 #include "acs-cteb.h"
 #include "bp-tcp-cla.h"
 #include "bp-udp-cla.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("BpAgent6");
 
@@ -31,9 +34,12 @@ namespace ns3 {
 
 BpAgent6::BpAgent6 ()
   : BpAgent(),
-    m_acsEnabled (false)
+    m_acsEnabled (false),
+    m_nextCustodyId (0)
 { 
   NS_LOG_FUNCTION (this);
+  m_acs.SetSendCallback (MakeCallback (&BpAgent6::SendAggregateCustodySignal, this));
+  m_bundleStore.SetRemoveCallback (MakeCallback (&BpAgent6::BundleRemoved, this));
 }
 
 BpAgent6::~BpAgent6 ()
@@ -46,12 +52,38 @@ BpAgent6::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::BpAgent6")
     .SetParent<BpAgent> ()
-    .AddConstructor<BpAgent6> ();
+    .AddConstructor<BpAgent6> ()
+    .AddAttribute ("EnableAcs", "Use CTEBs and aggregate custody signals (ACS) for custody transfer",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&BpAgent6::m_acsEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("AcsDelay", "Longest time a custody acceptance waits to be sent in an ACS",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&BpAgent6::SetAcsDelay, &BpAgent6::GetAcsDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("AcsMaxCount", "Number of custody acceptances that triggers an ACS at once, or 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&BpAgent6::SetAcsMaxCount, &BpAgent6::GetAcsMaxCount),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("CustodyTransferRtoMin", "Lower bound of the custody transfer retransmission timeout",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&BpAgent6::m_rtoMin),
+                   MakeTimeChecker ())
+    .AddAttribute ("CustodyTransferRtoMax", "Upper bound of the custody transfer retransmission timeout, after backoff",
+                   TimeValue (Seconds (60.0)),
+                   MakeTimeAccessor (&BpAgent6::m_rtoMax),
+                   MakeTimeChecker ());
   return tid;
 }
 
 int 
 BpAgent6::Send (Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst, const Time &lifetime, bool custody, uint32_t priority)
+{ 
+  return SendAdu (p, src, dst, lifetime, custody, priority, false);
+}
+
+int
+BpAgent6::SendAdu (Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst, const Time &lifetime, bool custody, uint32_t priority, bool admin)
 { 
   NS_LOG_FUNCTION (this << " " << src.Uri () << " " << dst.Uri ());
 
@@ -68,12 +100,13 @@ BpAgent6::Send (Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst,
       } 
   }
   
-  Ptr<Bundle6> bundle = Create<Bundle6>(p);
+  Ptr<Bundle6> bundle = Create<Bundle6>(NewBundleAdu(p, admin));
   BpHeader6 *bph = bundle->GetPrimaryHeader();  
   uint32_t size = p->GetSize();
   
   bph->SetSourceEid(src);
   bph->SetDestinationEid(dst);
+  bph->SetIsAdmin(admin);
   bph->SetCustTxReq(custody);
   bph->SetIsFragment(false);
   bph->SetFragOffset(0);
@@ -87,9 +120,18 @@ BpAgent6::Send (Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst,
   if (custody) {
     bph->SetCustEid(GetBpEndpointId());
     bundle->retentionConstraints |= _BP_CUSTODY_ACCEPTED;
+    if (m_acsEnabled) {
+      bundle->ctebPresent = true;
+      bundle->cteb.custodyID = m_nextCustodyId++;
+      bundle->cteb.creatorEID = GetBpEndpointId().Uri();
+      m_custodyIds[bundle->cteb.custodyID] = bundle;
+    }
   }
 
-  m_bundleStore.Store(bundle);
+  if (!m_bundleStore.Store(bundle)) {
+    if (bundle->ctebPresent) m_custodyIds.erase(bundle->cteb.custodyID);
+    return -1;
+  }
 
   // Step 3 
   Forward(GetPointer(bundle));
@@ -100,12 +142,13 @@ BpAgent6::Send (Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst,
 void BpAgent6::Forward(Bundle* b) { 
   Bundle6 *bundle = dynamic_cast<Bundle6*>(b);
   BpHeader6 *header = bundle->GetPrimaryHeader();
-  BpBlockHeader6 *payload_header = bundle->GetPayloadHeader();
   // Follows section 5.4 of RFC 5050.
   // Step 1 - modify retention constraints.
   bundle->retentionConstraints |= _BP_FORWARD_PENDING;
   bundle->retentionConstraints &= ~(_BP_DISPATCH_PENDING);
   NS_LOG_DEBUG(" fwd - retention " << bundle->retentionConstraints);
+  // A retry of a refused send is done by this attempt.
+  bundle->sendRetry.Cancel();
 
   // Step 2 - select endpoints for forwarding.
   BpEndpointId destEid = header->GetDestinationEid();
@@ -128,12 +171,22 @@ void BpAgent6::Forward(Bundle* b) {
     // Note: According to RFC 5050, we should restart at Step 5, but we actually do at Step 1.
 
     // If the bundle has not been removed from the store, it will still be found there with the FORWARD_PEINDING flag set.
+    // Custody retransmissions are suspended until ClaReady () forwards it again.
     NS_LOG_DEBUG("forwarding contraindicated");
+    bundle->nextRetrans.Cancel();
+    m_bundleStore.SetForwardPending(bundle, cla);
     return;
   }
 
   m_unicastForwardTrace((void*)bundle);
 
+  // The custody state is put back if the CLA refuses the bundle, so that
+  // a refused send is not counted as a custody retransmission.
+  uint32_t custodyTx = bundle->custodyTx;
+  Time custodyTxTime = bundle->custodyTxTime;
+  BpEndpointId custodyNextHop = bundle->custodyNextHop;
+  BpRtoEstimator custodyRtt;
+
   NS_LOG_DEBUG("  fwd - CT is " << ((header->CustTxReq()) ? "requested" : "not requested"));
   // Step 4 - custody transfer release procedure (seciont 5.10.2).
   //pTODO implement this part (that deals with custody) in children classes and put the rest of the function in bp-agent parent
@@ -143,41 +196,76 @@ void BpAgent6::Forward(Bundle* b) {
     // TODO cancel custody transfer timer XXX
     // NOTE: this makes no sense, because it's releasing custody based just on forwarding, not on any signal that the agent we're forwarding to either got the bundle or accepted custody.  RFC is backwards?
     // This is where we instead will actually schedule next retransmission.
-    bundle->nextRetrans = Simulator::Schedule(ct_rto, &BpAgent::Forward, this, bundle);
+    // The timeout comes from the custody signal latency seen from this next hop,
+    // backed off for each time the bundle has already been sent.
+    BpEndpointId nextHop = m_bpRoutingAgent->NextHopEid(destEid);
+    custodyRtt = m_custodyRtt[nextHop];
+    if (bundle->custodyTx > 0) m_custodyRtt[nextHop].Backoff(bundle->custodyTx);
+    Time rto = GetCustodyRto(nextHop, bundle->custodyTx);
+    NS_LOG_DEBUG("  fwd - send " << bundle->custodyTx << " to " << nextHop.Uri() << ", rto " << rto.GetSeconds() << " s");
+    bundle->custodyTx++;
+    bundle->custodyTxTime = Simulator::Now();
+    bundle->custodyNextHop = nextHop;
+    bundle->nextRetrans.Cancel();
+    bundle->nextRetrans = Simulator::Schedule(rto, &BpAgent::Forward, this, bundle);
   }
 
   // Step 5 - for each endpoint, trigger CLA.
   // NOTE: This is where we trigger fragmentation.  It is very unclear in RFC 5050 about when
   // and where in the processing logic the right time to trigger fragmentation is.
-  // TODO - completely fix this once >1 CLA.
-  uint32_t bytesLeft = bundle->m_adu->GetSize();
-  bool fragment = (bundle->m_adu->GetSize() > m_bundleSize) ? true : false;  // TODO - should base on CLA "MTU" not just m_bundleSize
-
-  while (bytesLeft > 0) {
-    uint32_t size = std::min(bytesLeft, m_bundleSize); // TODO - should base on CLA not m_bundleSize
-    uint32_t offset = (fragment) ? bundle->m_adu->GetSize() - bytesLeft : 0;
+  // Fragments are sized to the outgoing CLA's MaxBundleSize, and each is sent through one
+  // view of the stored header that is encoded once here, so the stored bundle is not modified.
+  uint32_t aduSize = bundle->m_adu->GetSize();
+  uint32_t base = header->GetFragOffset();
+  BpFragmentHeader6 fragHeader(*header);
+  // The largest offset and length bound the header overhead of every fragment.
+  fragHeader.SetFragment(base + aduSize, aduSize, true);
+  uint32_t maxSize = GetMaxPayloadSize(cla, BpCla::GetSerializedBundleSize(bundle, fragHeader) - aduSize);
+  bool fragment = (aduSize > maxSize && !header->DonotFragment()) ? true : false;
+
+  // An ADU kept on disk by the store is read back for the CLA, and dropped
+  // from memory again if the bundle stays stored.
+  m_bundleStore.Load(bundle);
+  uint32_t bytesLeft = aduSize;
+  do {
+    uint32_t size = (fragment) ? std::min(bytesLeft, maxSize) : bytesLeft;
+    uint32_t offset = base + aduSize - bytesLeft;
     bytesLeft -= size;
 
-    header->SetBlockLength(size);
-    header->SetIsFragment(fragment);
-    header->SetFragOffset(offset);
+    fragHeader.SetFragment(offset, size, fragment || header->IsFragment());
 
-    payload_header->SetBlockLength(size);
-    
     NS_LOG_DEBUG("   sending " << size << " bytes from offset " << offset);
     m_sendOutgoingTrace((void*)bundle);
-    cla->SendBundle(bundle, GetEidAddress(destEid), GetNode());
-  }
+    if (cla->SendBundle(bundle, fragHeader, GetEidAddress(destEid), GetNode()) < 0) {
+      // The CLA did not take it (e.g. no connection to the next hop), so
+      // the bundle stays stored and forward-pending until it is forwarded
+      // again.  Fragments already taken are sent again with the rest.
+      NS_LOG_WARN("CLA did not accept the bundle, keeping it forward-pending");
+      bundle->nextRetrans.Cancel();
+      if (header->CustTxReq()) {
+        m_custodyRtt[bundle->custodyNextHop] = custodyRtt;
+        bundle->custodyTx = custodyTx;
+        bundle->custodyTxTime = custodyTxTime;
+        bundle->custodyNextHop = custodyNextHop;
+      }
+      SendRefused(bundle, cla);
+      return;
+    }
+  } while (bytesLeft > 0);
 
   // Step 6 - wrap up.
-  // TODO wait for CLA notifications?  we need to add a new event handler for this, not block
+  // Every fragment has been taken by the CLA's transmit queue, which sends
+  // it as the socket has room.
   bundle->retentionConstraints &= ~(_BP_FORWARD_PENDING);
+  m_bundleStore.ClearForwardPending(bundle);
 
   NS_LOG_DEBUG("  retention constraints " << bundle->retentionConstraints);
   if (!(bundle->retentionConstraints)) {
     m_bundleStore.Remove(bundle);
     bundle->DoDispose();
     NS_LOG_DEBUG("removed without retention constraints");
+  } else {
+    m_bundleStore.Unload(bundle);
   }
 }
 
@@ -189,6 +277,10 @@ int BpAgent6::EnqueueForDeliveryToApplication(Bundle* b) {
   // First check if this if for the local agent, rather than an application.
   if (header->GetDestinationEid() == GetBpEndpointId()) {
     NS_LOG_DEBUG("local agent delivery");
+    // Take the bundle out of the store before its ADU is parsed, so that the
+    // store's byte count is reduced by what it was increased by.
+    m_bundleStore.Load(bundle);
+    m_bundleStore.Remove(bundle);
     // Assume the bundle contents is an admin record and try to process it.
     AdminRecord ar;
     if (bundle->m_adu->RemoveHeader(ar) != 1) {
@@ -204,28 +296,32 @@ int BpAgent6::EnqueueForDeliveryToApplication(Bundle* b) {
       NS_LOG_DEBUG(" ->CS: " << " " << cs.fragmentOffset << " " << cs.fragmentLength << " " << cs.timeOfSignal << " " << cs.creationTimestamp << " " << cs.seqNo << " " << cs.srcEidLen << " " << cs.srcEid);
       if (cs.status == 0x80) {
         NS_LOG_DEBUG("    success");
-        // pTODO maybe use template in bundle store instead of requring dynamic cast here
-        Ptr<Bundle6> s = DynamicCast<Bundle6, Bundle>(m_bundleStore.GetBundle(cs.srcEid, cs.creationTimestamp, cs.seqNo.GetValue()));
-        if (s != NULL) {
-          BpHeader6 *sHeader = s->GetPrimaryHeader();
-          // Attempt to combine w/ existing ACKs before adding as new.
-          std::list<std::pair<uint32_t, uint32_t>>::iterator ackit;
-          std::pair<uint32_t,uint32_t> thisack(cs.fragmentOffset, cs.fragmentOffset + cs.fragmentLength);
-          for (ackit = s->acks.begin(); ackit != s->acks.end(); ackit++) {
-            NS_LOG_DEBUG(" comparing " << thisack.first << " - " << thisack.second << " to " << ackit->first << " through " << ackit->second);
-            if (ackit->second == thisack.first) ackit->second = thisack.second;
-            if (thisack.second == ackit->first) ackit->first = thisack.first;
-            // TODO - the above logic does not catch all possibilities of overlap, fill-in, etc.
+        // A signal for a fragment covers only its range of the ADU; otherwise it
+        // covers the whole bundle.  It applies to every piece of the bundle we
+        // hold, and each piece is freed as soon as all of its range is acked.
+        bool fragAck = (ar.typeFlags & _BP_AR_FRAG) ? true : false;
+        std::list<Ptr<Bundle>> held;
+        m_bundleStore.GetBundles(cs.srcEid, cs.creationTimestamp, cs.seqNo.GetValue(), held);
+        if (held.empty()) {
+          NS_LOG_DEBUG("FAILED TO FIND BUNDLE FOR CUSTODY SIGNAL");
+          m_bundleStore.DebugDump();
+        }
+        for (std::list<Ptr<Bundle>>::iterator it = held.begin(); it != held.end(); it++) {
+          // pTODO maybe use template in bundle store instead of requring dynamic cast here
+          Ptr<Bundle6> s = DynamicCast<Bundle6, Bundle>(*it);
+          uint32_t start = s->GetPrimaryHeader()->GetFragOffset();
+          uint32_t end = start + s->m_adu->GetSize();
+          if (fragAck) {
+            s->acks.Add(std::max(start, cs.fragmentOffset), std::min(end, cs.fragmentOffset + cs.fragmentLength));
+          } else {
+            s->acks.Add(start, end);
           }
-          if (s->acks.size() == 0) s->acks.push_back(thisack);
-          if (s->acks.size() == 1 && s->acks.begin()->first == 0 && s->acks.begin()->second == sHeader->GetAduLength()) {
+          if (s->acks.GetCovered() == end - start) {
             NS_LOG_DEBUG("fully acked - removing");
+            CustodyReleased(s);
             m_bundleStore.Remove(s);
             s->DoDispose();
-          } else NS_LOG_DEBUG("acklist size " << s->acks.size() << " first " << s->acks.begin()->first << " - " << s->acks.begin()->second);
-        } else {
-          NS_LOG_DEBUG("FAILED TO FIND BUNDLE FOR CUSTODY SIGNAL");
-          m_bundleStore.DebugDump();
+          } else NS_LOG_DEBUG("acked " << s->acks.GetCovered() << " of " << end - start << " bytes in " << s->acks.GetNRanges() << " ranges");
         }
       } else {
         NS_LOG_DEBUG("    failure");
@@ -236,13 +332,13 @@ int BpAgent6::EnqueueForDeliveryToApplication(Bundle* b) {
       NS_LOG_DEBUG(" ->ACS");
       if (acs.status == 0x80) {
         NS_LOG_DEBUG("    success");
+        ProcessAggregateCustodySignal(acs);
       } else {
         NS_LOG_DEBUG("    failure");
       } 
     } else {
       NS_LOG_DEBUG("  unhandled type+flags combination in admin record");
     }
-    m_bundleStore.Remove(bundle);
     bundle->DoDispose();
     NS_LOG_DEBUG("removed custody signal");
   }
@@ -250,35 +346,24 @@ int BpAgent6::EnqueueForDeliveryToApplication(Bundle* b) {
   // Otherwise the bundle is already in the store and ready for an application
   // to call Receive() and get it.
 
-  // If the bundle is a fragment, we should check to see if it coincides with
-  // be beginning or end of any other fragments stored, and coalesce them at
-  // this point.
+  // If the bundle is a fragment, add it to the reassembly of its bundle.
+  // Once the fragments cover the whole ADU, the reassembled bundle is stored
+  // in their place for the application.
   if (header->IsFragment()) {
-    NS_LOG_DEBUG("matching new fragment " << header->GetFragOffset() << " sz " << bundle->m_adu->GetSize());
-    std::list<Ptr<Bundle>> prevFrags;
-    m_bundleStore.GetBundles(header->GetSourceEid(), header->GetCreateTimestamp(), header->GetSequenceNumber().GetValue(), prevFrags);
-    std::list<Ptr<Bundle>>::iterator it = prevFrags.begin();
-    while (it != prevFrags.end()) {
-      Ptr<Bundle6> it6 = DynamicCast<Bundle6, Bundle>(*it);
-      BpHeader6 *itHeader = it6->GetPrimaryHeader();
-      if (header->GetFragOffset() == itHeader->GetFragOffset() + it6->m_adu->GetSize()) {
-        NS_LOG_DEBUG("combining new fragment at tail of previous");
-        it6->m_adu->AddAtEnd(bundle->m_adu);
-        m_bundleStore.Remove(bundle);
-        if (it6->m_adu->GetSize() == itHeader->GetAduLength()) {
-          itHeader->SetIsFragment(false);
-        }
-      } else if (header->GetFragOffset() + bundle->m_adu->GetSize() == itHeader->GetFragOffset()) {
-        NS_LOG_DEBUG("combining new fragment at head of previous");
-        bundle->m_adu->AddAtEnd(it6->m_adu);
-        m_bundleStore.Remove(it6);
-        if (bundle->m_adu->GetSize() == header->GetAduLength()) {
-          header->SetIsFragment(false);
-        }
-      } else {
-        NS_LOG_DEBUG("new fragment does not match head or tail of previous " << itHeader->GetFragOffset() << " sz " << it6->m_adu->GetSize());
+    NS_LOG_DEBUG("reassembling new fragment " << header->GetFragOffset() << " sz " << bundle->m_adu->GetSize());
+    Ptr<Packet> adu = ReassembleFragment(bundle);
+    if (adu != NULL) {
+      NS_LOG_DEBUG("reassembled " << adu->GetSize() << " byte ADU");
+      Ptr<Bundle6> whole = Create<Bundle6>(adu);
+      BpHeader6 *wholeHeader = whole->GetPrimaryHeader();
+      *wholeHeader = *header;
+      wholeHeader->SetIsFragment(false);
+      wholeHeader->SetFragOffset(0);
+      if (!m_bundleStore.Store(whole)) {
+        // The store's evict callback has traced the drop.
+        NS_LOG_WARN("no room to store the reassembled bundle, dropping it");
+        return 1;
       }
-      it++;
     }
   }
   return 0;
@@ -310,18 +395,24 @@ void BpAgent6::Deliver(Bundle* b) {
   NS_LOG_DEBUG("  del - CT is " << ((header->CustTxReq()) ? "requested" : "not requested"));
   if (header->CustTxReq()) {
     NS_LOG_DEBUG("  del - Custodian is " << header->GetCustEid().Uri()); 
-    // Generate a succeeded custody signal.
-    SendCustodySignal(bundle, true, header->GetLifeTime());
+    // Generate a succeeded custody signal.  Whole bundles with a CTEB from
+    // their custodian are acknowledged by custody ID in an aggregate signal.
+    if (m_acsEnabled && bundle->ctebPresent && !header->IsFragment()
+        && bundle->cteb.creatorEID == header->GetCustEid().Uri()) {
+      m_acs.Add(header->GetCustEid(), bundle->cteb.custodyID);
+    } else {
+      SendCustodySignal(bundle, true, header->GetLifeTime());
+    }
   }
 }
 
-void BpAgent6::SendCustodySignal(Ptr<Bundle6> b, bool success, const Time& lifetime) {
+void BpAgent6::SendCustodySignal(Ptr<Bundle6> b, bool success, const Time& lifetime, uint8_t reason) {
   NS_LOG_FUNCTION(this);
   BpHeader6 *header = b->GetPrimaryHeader();
   Ptr<Packet> s = Create<Packet>();
 
   CustodySignal cs;
-  if (success) cs.status = 0x80;
+  cs.status = success ? _BP_CS_SUCCEEDED : reason;
   cs.fragmentOffset = header->GetFragOffset();
   cs.fragmentLength = header->IsFragment() ? b->m_adu->GetSize() : 0;
   cs.timeOfSignal = Simulator::Now();
@@ -338,10 +429,103 @@ void BpAgent6::SendCustodySignal(Ptr<Bundle6> b, bool success, const Time& lifet
 
   NS_LOG_DEBUG("  sending custody signal to " << header->GetCustEid().Uri() << " for seq " << cs.seqNo.GetValue() 
     << " AR type flags: " << (uint32_t)ar.typeFlags);
-  if (Send(s, GetBpEndpointId(), header->GetCustEid(), lifetime) != 0)
+  if (SendAdu(s, GetBpEndpointId(), header->GetCustEid(), lifetime, false, 0, true) != 0)
     NS_LOG_WARN("failed to send custody signal");
 }
 
+void BpAgent6::ReceivedBundleRefused(Ptr<Bundle> b) {
+  Ptr<Bundle6> bundle = DynamicCast<Bundle6>(b);
+  BpHeader6 *header = bundle->GetPrimaryHeader();
+  // An expired bundle is just dropped; one there is no room for has its
+  // custody refused, so that the custodian need not wait for its timeout.
+  if (!header->CustTxReq() || BundleStore::IsExpired(b)) return;
+  NS_LOG_DEBUG("  refusing custody, store full");
+  SendCustodySignal(bundle, false, header->GetLifeTime(), _BP_CS_DEPLETED_STORAGE);
+}
+
+void BpAgent6::SendAggregateCustodySignal(const BpEndpointId &custodian, const ACS &acs) {
+  NS_LOG_FUNCTION(this << " " << custodian.Uri());
+  Ptr<Packet> s = Create<Packet>();
+  s->AddHeader(acs);
+
+  AdminRecord ar;
+  ar.typeFlags = _BP_AR_ACS<<4;
+  s->AddHeader(ar);
+
+  NS_LOG_DEBUG("  sending aggregate custody signal to " << custodian.Uri() << " size " << s->GetSize());
+  if (SendAdu(s, GetBpEndpointId(), custodian, Seconds(0), false, 0, true) != 0)
+    NS_LOG_WARN("failed to send aggregate custody signal");
+}
+
+void BpAgent6::ProcessAggregateCustodySignal(const ACS &acs) {
+  BpRangeSet ids;
+  acs.GetFills(ids);
+  for (BpRangeSet::const_iterator fill = ids.begin(); fill != ids.end(); fill++) {
+    NS_LOG_DEBUG("  custody ids " << fill->first << " - " << fill->second);
+    std::map<uint32_t, Ptr<Bundle6>>::iterator it = m_custodyIds.lower_bound(fill->first);
+    while (it != m_custodyIds.end() && it->first < fill->second) {
+      // Removing the bundle from the store erases its entry.
+      Ptr<Bundle6> s = (it++)->second;
+      CustodyReleased(s);
+      m_bundleStore.Remove(s);
+      s->DoDispose();
+    }
+  }
+}
+
+Time BpAgent6::GetCustodyRto(const BpEndpointId &nextHop, uint32_t retransmissions) const {
+  Time rto = ct_rto;
+  std::map<BpEndpointId, BpRtoEstimator>::const_iterator it = m_custodyRtt.find(nextHop);
+  if (it != m_custodyRtt.end()) {
+    if (it->second.HasSample()) rto = it->second.GetRto();
+    retransmissions = std::max(retransmissions, it->second.GetBackoff());
+  }
+  rto = Max(rto, m_rtoMin);
+  for (uint32_t n = 0; n < retransmissions && rto < m_rtoMax; n++) rto = rto * 2;
+  return Min(rto, m_rtoMax);
+}
+
+void BpAgent6::CustodyReleased(Ptr<Bundle6> b) {
+  // Only a bundle sent once gives an unambiguous round trip (Karn's algorithm).
+  if (b->custodyTx != 1) return;
+  Time rtt = Simulator::Now() - b->custodyTxTime;
+  BpRtoEstimator &est = m_custodyRtt[b->custodyNextHop];
+  est.Update(rtt);
+  NS_LOG_DEBUG("custody rtt " << rtt.GetSeconds() << " s from " << b->custodyNextHop.Uri()
+    << ", rto now " << GetCustodyRto(b->custodyNextHop, 0).GetSeconds() << " s");
+}
+
+void BpAgent6::BundleRemoved(Ptr<Bundle> b) {
+  Ptr<Bundle6> bundle = DynamicCast<Bundle6>(b);
+  if (bundle == 0 || !bundle->ctebPresent) return;
+  std::map<uint32_t, Ptr<Bundle6>>::iterator it = m_custodyIds.find(bundle->cteb.custodyID);
+  // Received bundles keep the custody ID of their creator, which may match one of ours.
+  if (it != m_custodyIds.end() && it->second == bundle) m_custodyIds.erase(it);
+}
+
+void BpAgent6::SetAcsDelay(Time delay) {
+  m_acs.SetDelay(delay);
+}
+
+Time BpAgent6::GetAcsDelay() const {
+  return m_acs.GetDelay();
+}
+
+void BpAgent6::SetAcsMaxCount(uint32_t count) {
+  m_acs.SetMaxCount(count);
+}
+
+uint32_t BpAgent6::GetAcsMaxCount() const {
+  return m_acs.GetMaxCount();
+}
+
+void BpAgent6::DoDispose(void) {
+  NS_LOG_FUNCTION(this);
+  m_acs.Clear();
+  m_custodyIds.clear();
+  BpAgent::DoDispose();
+}
+
 void BpAgent6::EnableACS() {
   m_acsEnabled = true;
 }
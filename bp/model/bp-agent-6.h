@@ -23,6 +23,8 @@
 
 #include "bp-agent.h"
 #include "bp-bundle-6.h"
+#include "bp-acs-aggregator.h"
+#include "bp-rto-estimator.h"
 
 namespace ns3 {
 
@@ -58,10 +60,45 @@ class BpAgent6 : public BpAgent {
         int Send (Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst, 
             const Time &lifetime = Seconds(0), bool custody = false, uint32_t priority = 0);
 
+        uint8_t GetBpVersion () const { return 6; }
+
+        /**
+         * Accept custody with a CTEB on bundles sent from here, and
+         * acknowledge custody of received bundles that carry one with
+         * aggregate custody signals.
+         */
+        void EnableACS();
+
+        void DisableACS();
+
+        void SetAcsDelay(Time delay);
+        Time GetAcsDelay() const;
+
+        void SetAcsMaxCount(uint32_t count);
+        uint32_t GetAcsMaxCount() const;
+
+        /**
+         * \param nextHop the next hop a custody bundle is sent to
+         * \param retransmissions times the bundle has been sent already
+         *
+         * \return how long to wait for a custody signal before sending the
+         * bundle again
+         */
+        Time GetCustodyRto(const BpEndpointId &nextHop, uint32_t retransmissions) const;
+
+    protected:
+
+        virtual void DoDispose (void);
 
     private:
 
         bool m_acsEnabled;
+        AcsAggregator m_acs;                               /// custody acceptances waiting to be signalled
+        uint32_t m_nextCustodyId;                          /// custody ID for the next CTEB
+        std::map<uint32_t, Ptr<Bundle6>> m_custodyIds;     /// bundles in custody here, by CTEB custody ID
+        std::map<BpEndpointId, BpRtoEstimator> m_custodyRtt; /// custody signal latency per next hop
+        Time m_rtoMin;                                     /// lower bound of the custody retransmission timeout
+        Time m_rtoMax;                                     /// upper bound of the custody retransmission timeout, after backoff
 
         /**
          * \param b the bundle to be delivered
@@ -84,11 +121,44 @@ class BpAgent6 : public BpAgent {
          */
         int EnqueueForDeliveryToApplication(Bundle* b);
 
-        void SendCustodySignal(Ptr<Bundle6> b, bool success, const Time& lifetime);
+        /**
+         * Send (), for an application ADU or, with admin set, an
+         * administrative record of this agent.
+         */
+        int SendAdu(Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst,
+            const Time &lifetime, bool custody, uint32_t priority, bool admin);
 
-        void EnableACS();
+        /**
+         * \param reason why custody is refused, if not success
+         */
+        void SendCustodySignal(Ptr<Bundle6> b, bool success, const Time& lifetime, uint8_t reason = 0);
 
-        void DisableACS();
+        /**
+         * Refuse custody of a received bundle the store has no room for.
+         */
+        virtual void ReceivedBundleRefused(Ptr<Bundle> b);
+
+        /**
+         * Send an aggregate custody signal, from the aggregator.
+         */
+        void SendAggregateCustodySignal(const BpEndpointId &custodian, const ACS &acs);
+
+        /**
+         * Release custody of every bundle whose custody ID is signalled.
+         */
+        void ProcessAggregateCustodySignal(const ACS &acs);
+
+        /**
+         * Take a round trip sample from a bundle whose custody was just
+         * released.
+         */
+        void CustodyReleased(Ptr<Bundle6> b);
+
+        /**
+         * Called when a bundle leaves the store, however it leaves, to forget
+         * its custody ID.
+         */
+        void BundleRemoved(Ptr<Bundle> b);
 }; 
 
 } // namespace ns3
@@ -19,13 +19,14 @@
  */
 
 #include "bp-agent-7.h"
+#include "bp-bundle-7.h"
 
 NS_LOG_COMPONENT_DEFINE ("BpAgent7");
 
 namespace ns3 {
 
 BpAgent7::BpAgent7 ()
-  /*: BpAgent()*/
+  : BpAgent()
 { 
   NS_LOG_FUNCTION (this);
 }
@@ -33,8 +34,6 @@ BpAgent7::BpAgent7 ()
 BpAgent7::~BpAgent7 ()
 { 
   NS_LOG_FUNCTION (this);
-
-  //pTODO implement
 }
 
 TypeId
@@ -51,25 +50,181 @@ BpAgent7::Send (Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst,
 { 
   NS_LOG_FUNCTION (this << " " << src.Uri () << " " << dst.Uri ());
 
-  //pTODO implement
+  // The steps below follow RFC 9171 section 5.2 Bundle Transmission.
+  // NOTE: BPv7 has neither custody transfer nor a priority field in the
+  // primary block, so those arguments are only kept for API compatibility.
+  if (custody) NS_LOG_WARN("custody transfer is not part of BPv7; ignoring");
+  if (priority) NS_LOG_DEBUG("priority " << priority << " cannot be encoded in BPv7; ignoring");
+
+  // Step 1 - create outbound bundle.
+  if (src != defaultEid) {
+    if (!IsNodeMember(src))
+      {
+        NS_LOG_ERROR("the source eid " << src.Uri() << " is not registered");
+        return -1;
+      } 
+  }
+
+  Ptr<Bundle7> bundle = Create<Bundle7>(NewBundleAdu(p, false));
+  BpHeader7 *bph = bundle->GetPrimaryHeader();
+  uint32_t size = p->GetSize();
+
+  bph->SetSourceEid(src);
+  bph->SetDestinationEid(dst);
+  bph->SetReportEid(src);
+  bph->SetIsFragment(false);
+  bph->SetFragOffset(0);
+  bph->SetCreateTimestamp(Simulator::Now().GetSeconds());
+  bph->SetSequenceNumber(m_seq++);
+  bph->SetLifeTime(lifetime);
+  bph->SetAduLength(size);
+
+  bundle->retentionConstraints = _BP_DISPATCH_PENDING;
+
+  if (!m_bundleStore.Store(bundle)) return -1;
+
+  // Step 2 
+  Forward(GetPointer(bundle));
 
   return 0;
 }
 
 void BpAgent7::Forward(Bundle* b) {
-  //pTODO implement
+  Bundle7 *bundle = dynamic_cast<Bundle7*>(b);
+  BpHeader7 *header = bundle->GetPrimaryHeader();
+  // Follows section 5.4 of RFC 9171.
+  // Step 1 - modify retention constraints.
+  bundle->retentionConstraints |= _BP_FORWARD_PENDING;
+  bundle->retentionConstraints &= ~(_BP_DISPATCH_PENDING);
+  NS_LOG_DEBUG(" fwd - retention " << bundle->retentionConstraints);
+  // A retry of a refused send is done by this attempt.
+  bundle->sendRetry.Cancel();
+
+  // Step 2 - select endpoints for forwarding.
+  BpEndpointId destEid = header->GetDestinationEid();
+  Ptr<BpCla> cla = OutgoingCla(destEid);
+
+  // Step 3 - fowarding contraindicated procedure (section 5.4.1).
+  if (!cla || !cla->IsReady()) {
+    NS_LOG_INFO("no CLA found for next hop");
+    // If the bundle has not been removed from the store, it will still be found there with the FORWARD_PEINDING flag set.
+    NS_LOG_DEBUG("forwarding contraindicated");
+    m_bundleStore.SetForwardPending(bundle, cla);
+    return;
+  }
+
+  m_unicastForwardTrace((void*)bundle);
+
+  // Step 4 - for each endpoint, trigger CLA.
+  // NOTE: Fragmentation is done here, as in BpAgent6, unless the bundle
+  // asks not to be fragmented.  Fragments are sized to the outgoing CLA's
+  // MaxBundleSize, and each is sent through one view of the stored header
+  // that is encoded once here, so the stored bundle is not modified.
+  uint32_t aduSize = bundle->m_adu->GetSize();
+  uint32_t base = header->GetFragOffset();
+  BpFragmentHeader7 fragHeader(*header);
+  // The largest offset and length bound the header overhead of every fragment.
+  fragHeader.SetFragment(base + aduSize, aduSize, true);
+  uint32_t maxSize = GetMaxPayloadSize(cla, BpCla::GetSerializedBundleSize(bundle, fragHeader) - aduSize);
+  bool fragment = (aduSize > maxSize && !header->DonotFragment()) ? true : false;
+
+  // An ADU kept on disk by the store is read back for the CLA, and dropped
+  // from memory again if the bundle stays stored.
+  m_bundleStore.Load(bundle);
+  uint32_t bytesLeft = aduSize;
+  do {
+    uint32_t size = (fragment) ? std::min(bytesLeft, maxSize) : bytesLeft;
+    uint32_t offset = base + aduSize - bytesLeft;
+    bytesLeft -= size;
+
+    fragHeader.SetFragment(offset, size, fragment || header->IsFragment());
+
+    NS_LOG_DEBUG("   sending " << size << " bytes from offset " << offset);
+    m_sendOutgoingTrace((void*)bundle);
+    if (cla->SendBundle(bundle, fragHeader, GetEidAddress(destEid), GetNode()) < 0) {
+      // The CLA did not take it (e.g. no connection to the next hop), so
+      // the bundle stays stored and forward-pending until it is forwarded
+      // again.  Fragments already taken are sent again with the rest.
+      NS_LOG_WARN("CLA did not accept the bundle, keeping it forward-pending");
+      SendRefused(bundle, cla);
+      return;
+    }
+  } while (bytesLeft > 0);
+
+  // Step 5 - wrap up.
+  bundle->retentionConstraints &= ~(_BP_FORWARD_PENDING);
+  m_bundleStore.ClearForwardPending(bundle);
+
+  NS_LOG_DEBUG("  retention constraints " << bundle->retentionConstraints);
+  if (!(bundle->retentionConstraints)) {
+    m_bundleStore.Remove(bundle);
+    bundle->DoDispose();
+    NS_LOG_DEBUG("removed without retention constraints");
+  } else {
+    m_bundleStore.Unload(bundle);
+  }
 }
 
 int BpAgent7::EnqueueForDeliveryToApplication(Bundle* b) {
-  //pTODO implement
+  Bundle7 *bundle = dynamic_cast<Bundle7*>(b);
+
+  m_localDeliverTrace((void*)bundle);
+  BpHeader7 *header = bundle->GetPrimaryHeader();
+  // Administrative records are flagged in the primary block in BPv7.
+  if (header->IsAdmin()) {
+    // TODO - process status reports.
+    NS_LOG_DEBUG("discarding unhandled administrative record");
+    m_bundleStore.Remove(bundle);
+    bundle->DoDispose();
+    return 0;
+  }
+
+  // Otherwise the bundle is already in the store and ready for an application
+  // to call Receive() and get it.
 
+  // If the bundle is a fragment, add it to the reassembly of its bundle.
+  // Once the fragments cover the whole ADU, the reassembled bundle is stored
+  // in their place for the application.
+  if (header->IsFragment()) {
+    NS_LOG_DEBUG("reassembling new fragment " << header->GetFragOffset() << " sz " << bundle->m_adu->GetSize());
+    Ptr<Packet> adu = ReassembleFragment(bundle);
+    if (adu != NULL) {
+      NS_LOG_DEBUG("reassembled " << adu->GetSize() << " byte ADU");
+      Ptr<Bundle7> whole = Create<Bundle7>(adu);
+      BpHeader7 *wholeHeader = whole->GetPrimaryHeader();
+      *wholeHeader = *header;
+      wholeHeader->SetIsFragment(false);
+      wholeHeader->SetFragOffset(0);
+      if (!m_bundleStore.Store(whole)) {
+        // The store's evict callback has traced the drop.
+        NS_LOG_WARN("no room to store the reassembled bundle, dropping it");
+        return 1;
+      }
+    }
+  }
   return 0;
 }
 
 void BpAgent7::Deliver(Bundle* b) {
   NS_LOG_FUNCTION(this);
-  
-  //pTODO implement
+  Bundle7 *bundle = dynamic_cast<Bundle7*>(b);
+  BpHeader7 *header = bundle->GetPrimaryHeader();
+
+  // Follows section 5.7 of RFC 9171.
+  // Step 1 - check registration state.
+  std::map<BpEndpointId, BpRegisterInfo>::iterator it = BpRegistration.end();
+  it = BpRegistration.find(header->GetDestinationEid());
+  if (it == BpRegistration.end()) {
+    NS_LOG_ERROR("registration not found for " << header->GetDestinationEid().Uri());
+    return;
+  }
+  if (((*it).second.state == false) || (EnqueueForDeliveryToApplication(bundle) != 0)) {
+    // Delivery failure action.
+    // TODO
+  } 
+
+  // Step 2 - reporting
+  // TODO - if delivery status reports are requested, generate one
 }
 
-} // namespace ns3
\ No newline at end of file
+} // namespace ns3
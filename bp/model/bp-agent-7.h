@@ -58,6 +58,8 @@ class BpAgent7 : public BpAgent {
         int Send (Ptr<Packet> p, const BpEndpointId &src, const BpEndpointId &dst, 
             const Time &lifetime = Seconds(0), bool custody = false, uint32_t priority = 0);
 
+        uint8_t GetBpVersion () const { return 7; }
+
 
     private:
 
@@ -81,8 +83,6 @@ class BpAgent7 : public BpAgent {
          * NOTE: NOTE: the bundle "b" should be dynamically casted to a Bundle7
          */
         int EnqueueForDeliveryToApplication(Bundle* b);
-
-        //pTODO implement custody transfer
 }; 
 
 } // namespace ns3
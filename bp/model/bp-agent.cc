@@ -26,12 +26,14 @@
 #include "ns3/packet.h"
 #include "ns3/socket.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
 #include "ns3/string.h"
 #include "ns3/buffer.h"
-#include "bp-tcp-cla.h"
-#include "bp-udp-cla.h"
 #include "bp-agent.h"
+#include "bp-payload-hash-tag.h"
 #include <algorithm>
+#include <limits>
 #include <map>
 
 NS_LOG_COMPONENT_DEFINE ("BpAgent");
@@ -45,10 +47,57 @@ BpAgent::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::BpAgent")
     .SetParent<Object> ()
-    .AddAttribute ("BundleSize", "Max size of a bundle in bytes",
-           UintegerValue (512),
+    .AddAttribute ("BundleSize", "Max payload size of a bundle in bytes, or 0 for no limit but the CLA's MaxBundleSize",
+           UintegerValue (0),
            MakeUintegerAccessor (&BpAgent::m_bundleSize),
            MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ReassemblyTimeout", "Time to wait for all fragments of a bundle after the first, or 0 to wait for as long as the bundle's lifetime",
+                   TimeValue (Seconds (60.0)),
+                   MakeTimeAccessor (&BpAgent::m_reassemblyTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("CustodyTransferRto", "Custody transfer retransmission timeout used until the round trip to a next hop has been measured",
+                   TimeValue (Seconds (3.0)),
+                   MakeTimeAccessor (&BpAgent::ct_rto),
+                   MakeTimeChecker ())
+    .AddAttribute ("SendRetryInterval", "Time to wait before forwarding a bundle again that its CLA refused while staying ready",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&BpAgent::m_sendRetryInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("BatchExpiry", "Expire stored bundles in batches from one simulator event, rather than one event per bundle",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&BpAgent::SetBatchExpiry, &BpAgent::GetBatchExpiry),
+                   MakeBooleanChecker ())
+    .AddAttribute ("StoreMaxBytes", "Most ADU bytes the bundle store holds, or 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&BpAgent::SetStoreMaxBytes, &BpAgent::GetStoreMaxBytes),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("StoreMaxBundles", "Most bundles the bundle store holds, or 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&BpAgent::SetStoreMaxBundles, &BpAgent::GetStoreMaxBundles),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("EvictionPolicy", "What the bundle store drops when a new bundle would exceed its quota",
+                   EnumValue (BundleStore::REFUSE_NEW),
+                   MakeEnumAccessor (&BpAgent::SetEvictionPolicy, &BpAgent::GetEvictionPolicy),
+                   MakeEnumChecker (BundleStore::EVICT_OLDEST, "DropOldest",
+                                    BundleStore::EVICT_LOWEST_PRIORITY, "DropLowestPriority",
+                                    BundleStore::EVICT_SOONEST_EXPIRING, "DropSoonestExpiring",
+                                    BundleStore::REFUSE_NEW, "RefuseNew"))
+    .AddAttribute ("DiskStore", "Keep the ADUs of stored bundles in memory-mapped segment files in a temporary directory, rather than in memory",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&BpAgent::SetDiskStore, &BpAgent::GetDiskStore),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DiskSegmentSize", "Size in bytes of each segment file of the disk store",
+                   UintegerValue (64 << 20),
+                   MakeUintegerAccessor (&BpAgent::SetDiskSegmentSize, &BpAgent::GetDiskSegmentSize),
+                   MakeUintegerChecker<uint64_t> (1))
+    .AddAttribute ("VirtualPayload", "Carry ADUs only as their length, in zero-filled packets, rather than the bytes applications send",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&BpAgent::SetVirtualPayload, &BpAgent::GetVirtualPayload),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PayloadHash", "With VirtualPayload, tag each new ADU with a hash of the bytes the application sent",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&BpAgent::m_payloadHash),
+                   MakeBooleanChecker ())
     .AddAttribute ("StartTime", "Time at which the bundle protocol agent will start",
                    TimeValue (Seconds (0.0)),
                    MakeTimeAccessor (&BpAgent::m_startTime),
@@ -81,6 +130,8 @@ BpAgent::GetTypeId (void)
 
 BpAgent::BpAgent ()
   : m_node (0),
+    m_virtualPayload (false),
+    m_payloadHash (false),
     m_seq (0),
     m_eid ("dtn:none"),
     m_bpRegInfo (),
@@ -89,6 +140,8 @@ BpAgent::BpAgent ()
     bytesDelivered (0)
 { 
   NS_LOG_FUNCTION (this);
+  m_reassembly.SetTimeoutCallback (MakeCallback (&BpAgent::ReassemblyTimeout, this));
+  m_bundleStore.SetEvictCallback (MakeCallback (&BpAgent::BundleEvicted, this));
 }
 
 BpAgent::~BpAgent ()
@@ -104,18 +157,22 @@ BpAgent::Open (Ptr<Node> node)
 }
 
 Ptr<BpCla> BpAgent::AddCla(std::string l4type) {
-  Callback<void, Ptr<Bundle>> processBundleCallback = MakeCallback(&BpAgent::ProcessBundle, this);
-  if (l4type == "Tcp") {
-    Ptr<BpTcpCla> cla = CreateObject<BpTcpCla>(processBundleCallback);
-    m_clas.push_back(cla);
-    return cla;
+  TypeId tid;
+  if (!BpCla::LookupType(l4type, &tid)) {
+    NS_LOG_WARN("no CLA type " << l4type);
+    return Ptr<BpCla>(0);
   }
-  if (l4type == "Udp") {
-    Ptr<BpUdpCla> cla = CreateObject<BpUdpCla>(processBundleCallback);
-    m_clas.push_back(cla);
-    return cla;
-  }
-  return Ptr<BpCla>(0);
+  ObjectFactory factory;
+  factory.SetTypeId(tid);
+  return AddCla(factory);
+}
+
+Ptr<BpCla> BpAgent::AddCla(const ObjectFactory &factory) {
+  Ptr<BpCla> cla = DynamicCast<BpCla>(factory.Create());
+  if (cla == 0)
+    NS_FATAL_ERROR("BpAgent::AddCla (): " << factory.GetTypeId().GetName() << " is not a CLA type");
+  AddCla(cla);
+  return cla;
 }
 
 BpEndpointId
@@ -255,11 +312,20 @@ BpAgent::ProcessBundle (Ptr<Bundle> b)
   BpHeader *header = b->GetPrimaryHeader();
   NS_LOG_FUNCTION (this << " " << b << " seqno " << header->GetSequenceNumber() << " ADU size: " << b->m_adu->GetSize());
 
+  if (header->GetVersion() != GetBpVersion()) {
+    NS_LOG_WARN("discarding version " << (uint32_t)header->GetVersion() << " bundle at a version " << (uint32_t)GetBpVersion() << " agent");
+    return;
+  }
+
   // Follow Section 5.6 of RFC 5050.
  
   // Step 1 - set dispatch pending flag.
   b->retentionConstraints |= _BP_DISPATCH_PENDING;
 
+  // Whatever the previous hop's CLA delivered, keep only the length (and
+  // byte tags) of a virtual ADU, rather than the received packet.
+  if (m_virtualPayload && !header->IsAdmin()) b->m_adu = BundleStore::Placeholder(b->m_adu);
+
   // Step 2 - send report, if requested.
   // TODO
 
@@ -274,7 +340,10 @@ BpAgent::ProcessBundle (Ptr<Bundle> b)
   }*/
 
 //if (GetBpEndpointId().Uri() == "dtn:gateway") std::cout << m_bundleStore.GetMaxBundlesStored() << std::endl;
-  m_bundleStore.Store(b);
+  if (!m_bundleStore.Store(b)) {
+    ReceivedBundleRefused(b);
+    return;
+  }
 //if (GetBpEndpointId().Uri() == "dtn:gateway") std::cout << m_bundleStore.GetMaxBundlesStored() << std::endl;
 
   // Step 5 - Dispatch
@@ -305,6 +374,9 @@ BpAgent::SetRoutingAgent (Ptr<BpRoutingAgent> route)
 { 
   NS_LOG_FUNCTION (this << " " << route);
   m_bpRoutingAgent = route;
+  // e.g. as a contact starts, bundles waiting for the next hop may go
+  m_bpRoutingAgent->SetNextHopReadyCallback (MakeCallback (&BpAgent::NextHopReady, this));
+  m_bpRoutingAgent->SetNextHopDownCallback (MakeCallback (&BpAgent::NextHopDown, this));
 }
 
 Ptr<BpRoutingAgent> 
@@ -381,7 +453,33 @@ Ptr<BpCla> BpAgent::OutgoingCla(BpEndpointId dstEid) {
   BpEndpointId nextHop = m_bpRoutingAgent->NextHopEid(dstEid);
   NS_LOG_DEBUG("*** nextHop " << nextHop.Uri());
   if (nextHop == defaultEid) return Ptr<BpCla>(0);
-  return m_bpRoutingAgent->NextHopCla(nextHop);
+  return NextHopCla(nextHop);
+}
+
+Ptr<BpCla> BpAgent::NextHopCla(BpEndpointId nextHop) {
+  Ptr<BpCla> cla = m_bpRoutingAgent->NextHopCla(nextHop);
+  // a route may name the type of CLA instead, to use this agent's own
+  if (cla == 0) cla = GetCla(m_bpRoutingAgent->NextHopClaType(nextHop));
+  return cla;
+}
+
+void BpAgent::NextHopReady(BpEndpointId nextHop) {
+  NS_LOG_FUNCTION(this << " " << nextHop.Uri());
+  Ptr<BpCla> cla = NextHopCla(nextHop);
+  if (cla != 0 && cla->IsReady()) ClaReady(cla);
+}
+
+void BpAgent::NextHopDown(BpEndpointId nextHop, Ptr<BpCla> cla, TypeId claType) {
+  NS_LOG_FUNCTION(this << " " << nextHop.Uri());
+  // Only the bundles waiting on the next hop's CLA, and those that had no
+  // route, can have been routed to it.  Each is forwarded again, and waits
+  // again, on whatever CLA, if its new route cannot be used.
+  if (cla == 0) cla = GetCla(claType);
+  std::list<Ptr<Bundle>> bundles;
+  m_bundleStore.GetForwardPendingBundles(&bundles, cla);
+  for (std::list<Ptr<Bundle>>::iterator it = bundles.begin(); it != bundles.end(); it++) {
+    Forward(GetPointer(*it));
+  }
 }
 
 void BpAgent::ClaReady(Ptr<BpCla> cla) {
@@ -418,13 +516,94 @@ BpAgent::DoDispose (void)
   m_clas.clear();
   BpRegistration.clear();
   m_bpRoutingAgent = NULL;
+  m_reassembly.Clear ();
   m_startEvent.Cancel ();
   m_stopEvent.Cancel ();
   Object::DoDispose ();
 }
 
+Ptr<Packet>
+BpAgent::ReassembleFragment (Ptr<Bundle> fragment)
+{
+  NS_LOG_FUNCTION (this << " " << fragment);
+  // The fragment's bytes are held by its reassembly from here on.
+  m_bundleStore.Load (fragment);
+  m_bundleStore.Remove (fragment);
+  Ptr<Packet> adu = m_reassembly.Add (fragment, m_reassemblyTimeout);
+  if (adu != NULL && m_virtualPayload && !BpPayloadHashTag::Verify (adu))
+    {
+      NS_LOG_WARN ("payload hashes of the fragments of a " << adu->GetSize () << " byte ADU do not agree");
+      m_dropTrace ((void*)PeekPointer (fragment), BpFlowProbe::DROP_PAYLOAD_HASH);
+      return Ptr<Packet> (0);
+    }
+  return adu;
+}
+
+Ptr<Packet>
+BpAgent::NewBundleAdu (Ptr<Packet> p, bool admin)
+{
+  NS_LOG_FUNCTION (this << " " << p << " " << admin);
+  if (!m_virtualPayload || admin)
+    {
+      return p;
+    }
+  Ptr<Packet> adu = BundleStore::Placeholder (p);
+  BpPayloadHashTag tag;
+  if (m_payloadHash && !p->FindFirstMatchingByteTag (tag))
+    {
+      tag.SetHash (BpPayloadHashTag::Compute (p));
+      adu->AddByteTag (tag);
+    }
+  return adu;
+}
+
+void
+BpAgent::SetVirtualPayload (bool virtualPayload)
+{
+  NS_LOG_FUNCTION (this << " " << virtualPayload);
+  m_virtualPayload = virtualPayload;
+  m_bundleStore.SetVirtualPayload (virtualPayload);
+  m_reassembly.SetVirtualPayload (virtualPayload);
+}
+
+void
+BpAgent::BundleEvicted (Ptr<Bundle> bundle)
+{
+  NS_LOG_FUNCTION (this << " " << bundle);
+  m_dropTrace ((void*)PeekPointer (bundle), BpFlowProbe::DROP_STORE_FULL);
+}
+
+void
+BpAgent::ReceivedBundleRefused (Ptr<Bundle> bundle)
+{
+  NS_LOG_FUNCTION (this << " " << bundle);
+}
+
+void
+BpAgent::SendRefused (Bundle *bundle, Ptr<BpCla> cla)
+{
+  NS_LOG_FUNCTION (this << " " << bundle);
+  m_bundleStore.SetForwardPending (bundle, cla);
+  m_bundleStore.Unload (bundle);
+  if (cla->IsReady () && !bundle->sendRetry.IsRunning ())
+    {
+      NS_LOG_DEBUG ("forwarding again in " << m_sendRetryInterval.GetSeconds () << " s");
+      bundle->sendRetry = Simulator::Schedule (m_sendRetryInterval, &BpAgent::Forward, this, bundle);
+    }
+}
+
+void
+BpAgent::ReassemblyTimeout (Ptr<Bundle> first)
+{
+  NS_LOG_FUNCTION (this << " " << first);
+  m_dropTrace ((void*)PeekPointer (first), BpFlowProbe::DROP_REASSEMBLY_TIMEOUT);
+}
+
 void BpAgent::AddCla(Ptr<BpCla> cla) {
   m_clas.push_back(cla);
+  cla->SetProcessBundleCallback(MakeCallback(&BpAgent::ProcessBundle, this));
+  // Bundles waiting on the CLA are forwarded as soon as it is ready.
+  cla->SetReadyCallback(MakeCallback(&BpAgent::ClaReady, this));
 }
 
 void BpAgent::RemoveCla(Ptr<BpCla> cla) {
@@ -441,11 +620,30 @@ Ptr<BpCla> BpAgent::GetCla(size_t n) {
   return m_clas.at(n);
 }
 
+Ptr<BpCla> BpAgent::GetCla(TypeId tid) {
+  for (std::deque<Ptr<BpCla>>::iterator i = m_clas.begin(); i != m_clas.end(); i++) {
+    if ((*i)->GetInstanceTypeId() == tid) return *i;
+  }
+  return Ptr<BpCla>(0);
+}
+
 InetSocketAddress BpAgent::GetEidAddress(const BpEndpointId &eid) {
   NS_LOG_FUNCTION("get eid address");
-  // TBD: do not use dynamicast here
-  // check route for endpoint id
-  Ptr<BpStaticRoutingAgent> route = DynamicCast <BpStaticRoutingAgent> (m_bpRoutingAgent);
-  return route->GetRoute (eid);
+  return m_bpRoutingAgent->GetRoute (eid);
+}
+
+uint32_t BpAgent::GetMaxPayloadSize(Ptr<BpCla> cla, uint32_t overhead) const {
+  uint32_t size = std::numeric_limits<uint32_t>::max();
+  uint32_t claSize = cla->GetMaxBundleSize();
+  if (claSize != 0) {
+    if (claSize <= overhead) {
+      NS_LOG_WARN("CLA MaxBundleSize " << claSize << " does not leave room for any payload after " << overhead << " header bytes");
+      claSize = overhead + 1;
+    }
+    size = claSize - overhead;
+  }
+  if (m_bundleSize != 0) size = std::min(size, m_bundleSize);
+  return size;
 }
+
 } // namespace ns3
\ No newline at end of file
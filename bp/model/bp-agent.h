@@ -28,6 +28,7 @@
 #include "bp-flowstats.h"
 #include "bp-bundle.h"
 #include "bp-bundle-store.h"
+#include "bp-bundle-reassembly.h"
 #include "bp-admin-record.h"
 #include "bp-custody-signal.h"
 #include "bp-routing-agent.h"
@@ -39,6 +40,7 @@
 #include "bp-flowstats.h"
 #include "ns3/sequence-number.h"
 #include "ns3/object.h"
+#include "ns3/object-factory.h"
 #include "ns3/event-id.h"
 #include "ns3/nstime.h"
 #include "ns3/header.h"
@@ -278,15 +280,105 @@ public:
   ssize_t GetStoredByteCount() { return m_bundleStore.GetStoredByteCount(); };
   ssize_t GetMaxBundlesStored() { return m_bundleStore.GetMaxBundlesStored(); };
 
+  /**
+   * \param batch true to expire stored bundles in batches from one simulator
+   * event, false for one event per bundle
+   */
+  void SetBatchExpiry(bool batch) { m_bundleStore.SetBatchExpiry(batch); };
+  bool GetBatchExpiry() const { return m_bundleStore.GetBatchExpiry(); };
+
+  /**
+   * \param bytes most ADU bytes to store, or 0 for no limit
+   */
+  void SetStoreMaxBytes(uint64_t bytes) { m_bundleStore.SetMaxBytes(bytes); };
+  uint64_t GetStoreMaxBytes() const { return m_bundleStore.GetMaxBytes(); };
+
+  /**
+   * \param bundles most bundles to store, or 0 for no limit
+   */
+  void SetStoreMaxBundles(uint32_t bundles) { m_bundleStore.SetMaxBundles(bundles); };
+  uint32_t GetStoreMaxBundles() const { return m_bundleStore.GetMaxBundles(); };
+
+  /**
+   * \param policy what to drop when a new bundle would exceed the store's quota
+   */
+  void SetEvictionPolicy(BundleStore::EvictionPolicy policy) { m_bundleStore.SetEvictionPolicy(policy); };
+  BundleStore::EvictionPolicy GetEvictionPolicy() const { return m_bundleStore.GetEvictionPolicy(); };
+
+  /**
+   * \param disk true to keep the ADUs of stored bundles on disk
+   */
+  void SetDiskStore(bool disk) { m_bundleStore.SetDiskStore(disk); };
+  bool GetDiskStore() const { return m_bundleStore.GetDiskStore(); };
+
+  void SetDiskSegmentSize(uint64_t bytes) { m_bundleStore.SetDiskSegmentSize(bytes); };
+  uint64_t GetDiskSegmentSize() const { return m_bundleStore.GetDiskSegmentSize(); };
+
+  /**
+   * \param virtualPayload true to carry ADUs as zero-filled placeholders of
+   * their length
+   */
+  void SetVirtualPayload(bool virtualPayload);
+  bool GetVirtualPayload() const { return m_virtualPayload; };
+
+  /**
+   * Create a CLA by its type name (see BpCla::LookupType ()), with the
+   * type's default attributes, and add it to the agent.
+   *
+   * \return the CLA, or 0 if there is no CLA type of that name
+   */
   Ptr<BpCla> AddCla(std::string l4type);
+
+  /**
+   * Create a CLA with a factory set to a CLA type and its attributes, and
+   * add it to the agent.
+   */
+  Ptr<BpCla> AddCla(const ObjectFactory &factory);
+
+  /**
+   * Add a CLA; bundles it receives are passed to this agent.
+   */
   void AddCla(Ptr<BpCla> cla);
   void RemoveCla(Ptr<BpCla> cla);
   Ptr<BpCla> GetCla(size_t n);
+
+  /**
+   * \return the first CLA of exactly the type tid, or 0
+   */
+  Ptr<BpCla> GetCla(TypeId tid);
+  size_t GetNClas() const { return m_clas.size(); };
   Ptr<BpCla> OutgoingCla(BpEndpointId dstEid);
+
+  /**
+   * \return the CLA the routing agent uses for a next hop, or 0
+   */
+  Ptr<BpCla> NextHopCla(BpEndpointId nextHop);
   void ClaReady(Ptr<BpCla> cla);
 
+  /**
+   * Forward the bundles waiting for a next hop that can be reached now,
+   * if its CLA is ready.
+   */
+  void NextHopReady(BpEndpointId nextHop);
+
+  /**
+   * Forward the bundles waiting on the CLA of a next hop that cannot be
+   * reached any more, and those with no route, on the routes left.
+   *
+   * \param nextHop the next hop
+   * \param cla the CLA it was reached over, or 0 to use the agent's CLA
+   * of type claType
+   * \param claType the type of that CLA, if cla is 0
+   */
+  void NextHopDown(BpEndpointId nextHop, Ptr<BpCla> cla, TypeId claType);
+
   virtual void Forward(Bundle* b) = 0;
 
+  /**
+   * \return the bundle protocol version (6 or 7) this agent speaks
+   */
+  virtual uint8_t GetBpVersion () const = 0;
+
   uint64_t GetBytesDelivered() { return bytesDelivered; }
   uint64_t GetBundlesDelivered() { return bundlesDelivered; }
  
@@ -335,12 +427,75 @@ protected:
 
   InetSocketAddress GetEidAddress(const BpEndpointId &eid);
 
+  /**
+   * \brief Largest payload of one bundle sent through a CLA
+   *
+   * \param cla the outgoing CLA
+   * \param overhead encoded bytes of such a bundle besides its payload
+   *
+   * \return payload bytes per bundle, limited by the CLA's MaxBundleSize
+   * and by the BundleSize attribute, if set
+   */
+  uint32_t GetMaxPayloadSize(Ptr<BpCla> cla, uint32_t overhead) const;
+
+  /**
+   * \brief Add a fragment to be delivered locally to its reassembly
+   *
+   * The fragment is taken out of the bundle store.  A virtual ADU whose
+   * payload hashes do not agree is dropped once it is complete.
+   *
+   * \param fragment the fragment
+   *
+   * \return the whole ADU once this fragment completes it, otherwise 0
+   */
+  Ptr<Packet> ReassembleFragment(Ptr<Bundle> fragment);
+
+  /**
+   * Called when a bundle has not been reassembled within the
+   * ReassemblyTimeout.
+   *
+   * \param first the first fragment received of the bundle
+   */
+  void ReassemblyTimeout(Ptr<Bundle> first);
+
+  /**
+   * Called when the bundle store evicts or refuses a bundle to stay within
+   * its quota.
+   */
+  void BundleEvicted(Ptr<Bundle> bundle);
+
+  /**
+   * Called when a received bundle is not stored, because it has expired
+   * or the store has no room for it.  Does nothing by default.
+   */
+  virtual void ReceivedBundleRefused(Ptr<Bundle> bundle);
+
+  /**
+   * Keep a bundle that its CLA did not take forward-pending.  ClaReady ()
+   * forwards it again once a CLA that is no longer ready is again, but a
+   * CLA that stays ready never calls it, so then the bundle is forwarded
+   * again after the SendRetryInterval.
+   */
+  void SendRefused(Bundle *bundle, Ptr<BpCla> cla);
+
+  /**
+   * \return the ADU to put in a new bundle: the application's packet, or
+   * with VirtualPayload a placeholder of its length, tagged with the hash of
+   * its bytes if PayloadHash is set.  Administrative records always keep
+   * their bytes.
+   */
+  Ptr<Packet> NewBundleAdu(Ptr<Packet> p, bool admin);
+
   Ptr<Node>           m_node;  /// bundle node
   std::deque<Ptr<BpCla>> m_clas;
 
-  uint32_t m_bundleSize;       /// bundle size
+  uint32_t m_bundleSize;       /// max bundle payload size, 0 to use only the CLA's limit
 
   BundleStore m_bundleStore; // local bundle storage
+  BundleReassembly m_reassembly; // fragments being reassembled for local delivery
+  Time m_reassemblyTimeout;      /// how long to wait for the rest of a fragmented bundle
+  bool m_virtualPayload;         /// ADUs are placeholders of their length
+  bool m_payloadHash;            /// tag virtual ADUs with the hash of the application's bytes
 
   std::map<BpEndpointId, BpRegisterInfo> BpRegistration; /// persistant storage of registrations: map (local endpoint id, registration information)
 
@@ -361,6 +516,7 @@ protected:
            bytesDelivered;   // Does not include any bundle headers.
 
   Time ct_rto; // Retransmission timer for custody transfer.
+  Time m_sendRetryInterval;  /// wait before forwarding again a bundle that a ready CLA refused
 
   TracedCallback<void*> m_sendOutgoingTrace;
   TracedCallback<void*> m_unicastForwardTrace;
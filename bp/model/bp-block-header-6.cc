@@ -24,7 +24,6 @@
 #include "bp-block-header-6.h"
 #include "sdnv.h"
 #include <stdio.h>
-#include <vector>
 
 NS_LOG_COMPONENT_DEFINE ("BpBlockHeader6");
 
@@ -64,7 +63,7 @@ uint32_t
 BpBlockHeader6::GetSerializedSize (void) const
 {
   NS_LOG_FUNCTION (this);
-  return m_length;
+  return 1 + Sdnv::EncodedSize (m_processingControlFlags) + Sdnv::EncodedSize (m_blockLength);
 }
 
 void
@@ -78,20 +77,10 @@ BpBlockHeader6::Serialize (Buffer::Iterator start) const
 {
   NS_LOG_FUNCTION (this);
   Buffer::Iterator i = start;
-  Sdnv sdnv;
-  std::vector<uint8_t> result; // store encoded results
-
-  std::vector<uint8_t> processingControlFlags = sdnv.Encode (m_processingControlFlags);
-  std::vector<uint8_t> blockLength = sdnv.Encode (m_blockLength);
-  result.insert (result.end (), processingControlFlags.begin (), processingControlFlags.end ());
-  result.insert (result.end (), blockLength.begin (), blockLength.end ());
 
   i.WriteU8 (m_blockType);
-
-  for (uint32_t k = 0; k < result.size (); k++)
-    i.WriteU8 (result.at (k));
-
-  // pTODO: modify encode, maybe return end of iterator so the serilization can be added to
+  Sdnv::Encode (m_processingControlFlags, i);
+  Sdnv::Encode (m_blockLength, i);
 }
 
 uint32_t
@@ -99,13 +88,12 @@ BpBlockHeader6::Deserialize (Buffer::Iterator start)
 {
   NS_LOG_FUNCTION (this);
   Buffer::Iterator i = start;
-  Sdnv sdnv;
 
   m_blockType = i.ReadU8 ();
-  m_processingControlFlags = (uint8_t) sdnv.Decode (i);
-  m_blockLength = (uint32_t) sdnv.Decode (i);
+  m_processingControlFlags = (uint8_t) Sdnv::Decode (i);
+  m_blockLength = (uint32_t) Sdnv::Decode (i);
 
-  return GetSerializedSize ();
+  return i.GetDistanceFrom (start);
 }
 
 void
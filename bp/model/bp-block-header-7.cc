@@ -24,6 +24,7 @@
 #include "ns3/log.h"
 #include "bp-block-header-7.h"
 #include "codec.h"
+#include "cbor-buffer.h"
 #include <stdio.h>
 #include <vector>
 
@@ -146,16 +147,9 @@ BpBlockHeader7::Serialize (Buffer::Iterator start) const
 uint32_t
 BpBlockHeader7::Deserialize (Buffer::Iterator start)
 {
-  Buffer::Iterator i = start;
-  size_t j, size;
-  std::vector<uint8_t> temp;
-  size =  i.GetRemainingSize();
-
-  // Creates buffer for cbor decoding
-  for(j = 0; j < size; j++) temp.push_back(i.ReadU8());
-  
-  auto pos = begin(temp);
-  auto stop = end(temp);
+  // Decode straight out of the buffer; only the bytes of this block are read.
+  CborBufferReader pos (start);
+  CborBufferReader stop = CborBufferReader::End (start);
   size_t length, tempNumeric;
 
   length = CborLite::decodeArraySize(pos, stop, tempNumeric);
@@ -26,7 +26,9 @@ NS_LOG_COMPONENT_DEFINE ("Bundle6");
 namespace ns3 {
 
 Bundle6::Bundle6(Ptr<Packet> adu)
-: Bundle(adu) 
+: Bundle(adu),
+  custodyTx(0),
+  ctebPresent(false)
 {
   NS_LOG_FUNCTION("bundle6 creation");
   m_primaryHeader = new BpHeader6();
@@ -23,6 +23,7 @@
 #include "bp-bundle.h"
 #include "bp-header-6.h"
 #include "bp-block-header-6.h"
+#include "acs-cteb.h"
 
 namespace ns3 {
 
@@ -50,6 +51,13 @@ public:
   // pTODO maybe put this in parent
   EventId nextRetrans;
 
+  uint32_t custodyTx;            /// times sent while in custody here
+  Time custodyTxTime;            /// when it was last sent while in custody here
+  BpEndpointId custodyNextHop;   /// next hop it was last sent to while in custody here
+
+  bool ctebPresent;   /// true if the bundle carries a CTEB
+  CTEB cteb;          /// custody ID given by the custodian, for ACS
+
 private:
   BpHeader6* m_primaryHeader;
 
@@ -0,0 +1,167 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-bundle-reassembly.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include <algorithm>
+#include <vector>
+
+NS_LOG_COMPONENT_DEFINE ("BundleReassembly");
+
+namespace ns3 {
+
+BundleReassembly::BundleReassembly(void)
+  : m_pendingBytes (0),
+    m_virtualPayload (false)
+{
+}
+
+BundleReassembly::~BundleReassembly(void) {
+  Clear();
+}
+
+void BundleReassembly::SetTimeoutCallback(Callback<void, Ptr<Bundle>> cb) {
+  m_timeoutCallback = cb;
+}
+
+void BundleReassembly::SetVirtualPayload(bool virtualPayload) {
+  m_virtualPayload = virtualPayload;
+}
+
+Ptr<Packet> BundleReassembly::Add(Ptr<Bundle> fragment, Time timeout) {
+  BpHeader *header = fragment->GetPrimaryHeader();
+  BundleSourceKey key(header->GetSourceEid(), header->GetCreateTimestamp(), header->GetSequenceNumber().GetValue());
+
+  contextType::iterator c = m_contexts.find(key);
+  if (c == m_contexts.end()) {
+    c = m_contexts.insert(std::make_pair(key, Context())).first;
+    Context &ctx = c->second;
+    ctx.first = fragment;
+    ctx.aduLength = header->GetAduLength();
+    ctx.received = 0;
+
+    // Setting lifetime to 0 is a special way in the simulator to never expire.
+    Time wait = timeout;
+    if (header->GetLifeTime() != 0) {
+      Time timeLeft = (Seconds(header->GetCreateTimestamp()) + header->GetLifeTime()) - Simulator::Now();
+      if (wait.IsZero() || timeLeft < wait) wait = std::max(timeLeft, Seconds(0));
+    }
+    if (!wait.IsZero() || header->GetLifeTime() != 0) {
+      ctx.timeout = Simulator::Schedule(wait, &BundleReassembly::Timeout, this, key);
+    }
+  }
+  Context &ctx = c->second;
+
+  // A fragment that disagrees on the length of the ADU cannot belong to
+  // the bundle the others make up.
+  if (header->GetAduLength() != ctx.aduLength) {
+    NS_LOG_DEBUG("dropping fragment at " << header->GetFragOffset() << " with ADU length "
+      << header->GetAduLength() << ", other fragments have " << ctx.aduLength);
+    return Ptr<Packet>(0);
+  }
+
+  // Keep only the bytes of [start, end) that are not already held, as new
+  // ranges in the gaps between the held ones.
+  uint32_t start = header->GetFragOffset();
+  uint32_t end = std::min(start + fragment->m_adu->GetSize(), ctx.aduLength);
+  uint32_t cur = start;
+  std::map<uint32_t, Ptr<Packet>>::iterator it = ctx.ranges.upper_bound(start);
+  if (it != ctx.ranges.begin()) {
+    std::map<uint32_t, Ptr<Packet>>::iterator prev = it;
+    prev--;
+    cur = std::max(cur, prev->first + prev->second->GetSize());
+  }
+  while (cur < end) {
+    if (it != ctx.ranges.end() && it->first <= cur) {
+      cur = std::max(cur, it->first + it->second->GetSize());
+      it++;
+      continue;
+    }
+    uint32_t gapEnd = (it == ctx.ranges.end()) ? end : std::min(end, it->first);
+    ctx.ranges.insert(it, std::make_pair(cur, fragment->m_adu->CreateFragment(cur - start, gapEnd - cur)));
+    ctx.received += gapEnd - cur;
+    m_pendingBytes += gapEnd - cur;
+    cur = gapEnd;
+  }
+  NS_LOG_DEBUG("fragment " << start << " - " << end << " of " << ctx.aduLength << ", holding "
+    << ctx.received << " bytes in " << ctx.ranges.size() << " ranges");
+
+  if (ctx.received < ctx.aduLength) return Ptr<Packet>(0);
+
+  Ptr<Packet> adu = Assemble(ctx);
+  ctx.timeout.Cancel();
+  m_pendingBytes -= ctx.received;
+  m_contexts.erase(c);
+  return adu;
+}
+
+Ptr<Packet> BundleReassembly::Assemble(const Context &ctx) const {
+  std::map<uint32_t, Ptr<Packet>>::const_iterator it;
+  if (m_virtualPayload) {
+    // Appending a packet that is all zero area to one that ends in zero
+    // area only grows the zero area, so this copies nothing, and it keeps
+    // the byte tags of every range (e.g. payload hashes and flow tags).
+    Ptr<Packet> adu = Create<Packet>();
+    for (it = ctx.ranges.begin(); it != ctx.ranges.end(); it++) {
+      adu->AddAtEnd(it->second);
+    }
+    return adu;
+  }
+
+  // Copy every range into one buffer, rather than appending packets one at
+  // a time, which would copy the ADU built so far on every append.  The
+  // byte tags of each range are then put back at its offset in the ADU.
+  std::vector<uint8_t> data(ctx.aduLength);
+  for (it = ctx.ranges.begin(); it != ctx.ranges.end(); it++) {
+    it->second->CopyData(data.data() + it->first, it->second->GetSize());
+  }
+  Ptr<Packet> adu = Create<Packet>(data.data(), ctx.aduLength);
+  for (it = ctx.ranges.begin(); it != ctx.ranges.end(); it++) {
+    BundleStore::CopyByteTags(it->second, adu, it->first);
+  }
+  return adu;
+}
+
+void BundleReassembly::Timeout(BundleSourceKey key) {
+  contextType::iterator c = m_contexts.find(key);
+  if (c == m_contexts.end()) return;
+  Ptr<Bundle> first = c->second.first;
+  NS_LOG_DEBUG("reassembly timed out --source: " << key.src.Uri() << " time: " << key.timestamp
+    << " seq: " << key.seqno << " with " << c->second.received << " of " << c->second.aduLength << " bytes");
+  m_pendingBytes -= c->second.received;
+  m_contexts.erase(c);
+  if (!m_timeoutCallback.IsNull()) m_timeoutCallback(first);
+}
+
+uint32_t BundleReassembly::GetPendingBundles() const {
+  return m_contexts.size();
+}
+
+uint64_t BundleReassembly::GetPendingBytes() const {
+  return m_pendingBytes;
+}
+
+void BundleReassembly::Clear() {
+  contextType::iterator c;
+  for (c = m_contexts.begin(); c != m_contexts.end(); c++) {
+    c->second.timeout.Cancel();
+  }
+  m_contexts.clear();
+  m_pendingBytes = 0;
+}
+
+} // namespace ns3
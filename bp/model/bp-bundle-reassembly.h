@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_BUNDLE_REASSEMBLY_H
+#define BP_BUNDLE_REASSEMBLY_H
+
+#include "bp-bundle.h"
+#include "bp-bundle-store.h"
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief Fragments of bundles that are being reassembled for delivery.
+ *
+ * Fragments are grouped per bundle by BundleSourceKey, and the bytes
+ * received for each bundle are kept as a set of disjoint ranges of the ADU.
+ * Fragments may arrive in any order and may overlap; only the bytes not
+ * already held are kept.  A fragment whose total ADU length differs from
+ * that of the first fragment of its bundle is dropped.  The ADU is put
+ * together once, when the ranges cover all of it, and keeps the byte tags
+ * of every range.  With virtual payloads the ranges are zero-filled
+ * placeholders, and the ADU is put together from them without any bytes
+ * being copied or allocated.
+ *
+ * A bundle that is not complete within its timeout is dropped, and the
+ * timeout callback is called with the first fragment received for it.
+ */
+class BundleReassembly {
+public:
+  BundleReassembly(void);
+  ~BundleReassembly(void);
+
+  /**
+   * \param cb called with the first fragment of each bundle that times out
+   */
+  void SetTimeoutCallback(Callback<void, Ptr<Bundle>> cb);
+
+  /**
+   * \param virtualPayload true if fragment ADUs are only placeholders of
+   * their length
+   */
+  void SetVirtualPayload(bool virtualPayload);
+
+  /**
+   * Add a received fragment.
+   *
+   * \param fragment the fragment; its ADU is kept, not copied, until the
+   * bundle is complete
+   * \param timeout how long to wait for the rest of the bundle after its
+   * first fragment, or 0 to wait as long as the bundle's lifetime.  The
+   * wait never runs past the end of the bundle's lifetime.
+   *
+   * \return the whole ADU once the fragment completes it, otherwise 0
+   */
+  Ptr<Packet> Add(Ptr<Bundle> fragment, Time timeout);
+
+  /**
+   * \return the number of bundles with fragments held
+   */
+  uint32_t GetPendingBundles() const;
+
+  /**
+   * \return the number of ADU bytes held for incomplete bundles
+   */
+  uint64_t GetPendingBytes() const;
+
+  /**
+   * Drop all incomplete bundles, without calling the timeout callback.
+   */
+  void Clear();
+
+private:
+  struct Context {
+    Ptr<Bundle> first;                      /// first fragment received
+    uint32_t aduLength;                     /// length of the whole ADU
+    uint32_t received;                      /// ADU bytes held
+    std::map<uint32_t, Ptr<Packet>> ranges; /// disjoint ranges held, by ADU offset
+    EventId timeout;
+  };
+  typedef std::map<BundleSourceKey, Context> contextType;
+
+  void Timeout(BundleSourceKey key);
+  Ptr<Packet> Assemble(const Context &ctx) const;
+
+  contextType m_contexts;
+  uint64_t m_pendingBytes;
+  bool m_virtualPayload;
+  Callback<void, Ptr<Bundle>> m_timeoutCallback;
+};
+
+} // namespace ns3
+
+#endif /* BP_BUNDLE_REASSEMBLY_H */
@@ -28,26 +28,170 @@ NS_LOG_COMPONENT_DEFINE ("BundleStore");
 
 namespace ns3 {
 
-void BundleStore::Store(Ptr<Bundle> b) {
+bool BundleStore::Store(Ptr<Bundle> b) {
   BpHeader *header = b->GetPrimaryHeader();
   Time lifetime = header->GetLifeTime();
-  // Setting lifetime to 0 is a special way in the simulator to never expire.
+  Time expiry = Seconds(header->GetCreateTimestamp()) + lifetime;
+  if (IsExpired(b)) {
+    NS_LOG_DEBUG("bundle is already expired!");
+    return false;
+  }
+
+  // A bundle larger than the whole quota is refused without evicting anything.
+  uint32_t size = b->m_adu->GetSize();
+  bool fits = WithinQuota(m_storedBytes + size, m_store.size() + 1);
+  if (!fits && (m_evictionPolicy == REFUSE_NEW || (m_maxBytes != 0 && size > m_maxBytes))) {
+    NS_LOG_DEBUG("store full, refusing " << size << " byte bundle");
+    if (!m_evictCallback.IsNull()) m_evictCallback(b);
+    return false;
+  }
+
   if (lifetime != 0) {
-    // Create an event to destroy the bundle when it expires.
-    Time timeLeft = (Seconds(header->GetCreateTimestamp()) + lifetime) - Simulator::Now();
-    if (timeLeft.IsPositive()) {
-      EventId evid = Simulator::Schedule (timeLeft, &BundleStore::Expire, this, b);
-      b->expireEvent = evid;
+    b->expireTime = expiry;
+    m_expiryIndex.insert(std::make_pair(expiry, b));
+    if (m_batchExpiry) {
+      ScheduleExpiry();
     } else {
-      NS_LOG_DEBUG("bundle is already expired!");
-      return;
+      // Create an event to destroy the bundle when it expires.
+      b->expireEvent = Simulator::Schedule (expiry - Simulator::Now(), &BundleStore::Expire, this, b);
     }
   }
+  b->UpdateSortKey();
   m_store.insert(b);
+  IndexInsert(b);
+  m_storedBytes += size;
+
+  // Make room, unless the new bundle is the one to go.
+  if (OverQuota()) {
+    std::vector<Ptr<Bundle>> victims;
+    if (!ChooseVictims(b, victims)) {
+      NS_LOG_DEBUG("store full, refusing " << size << " byte bundle");
+      if (!m_evictCallback.IsNull()) m_evictCallback(b);
+      // The bundle was never taken, so nothing is told of its removal.
+      Erase(b);
+      return false;
+    }
+    for (std::vector<Ptr<Bundle>>::iterator it = victims.begin(); it != victims.end(); it++) {
+      NS_LOG_DEBUG("store over quota, evicting " << (*it)->m_adu->GetSize() << " byte bundle");
+      if (!m_evictCallback.IsNull()) m_evictCallback(*it);
+      Remove(*it);
+      (*it)->DoDispose();
+    }
+  }
 
   if (m_store.size() > maxBundlesStored) maxBundlesStored = m_store.size();
+  if (m_diskStore && !m_virtualPayload) Spill(b);
+  return true;
+}
+
+bool BundleStore::IsExpired(Ptr<Bundle> b) {
+  BpHeader *header = b->GetPrimaryHeader();
+  Time lifetime = header->GetLifeTime();
+  // Setting lifetime to 0 is a special way in the simulator to never expire.
+  if (lifetime == 0) return false;
+  return !(Seconds(header->GetCreateTimestamp()) + lifetime - Simulator::Now()).IsPositive();
+}
+
+void BundleStore::Spill(Ptr<Bundle> b) {
+  if (b->m_adu->GetSize() == 0) return;
+  if (m_disk == NULL) m_disk = Create<BpSegmentStore>(m_diskSegmentSize);
+  b->diskExtent = m_disk->Append(b->m_adu);
+  m_segmentBundles[b->diskExtent.segment].insert(b);
+  b->m_adu = Placeholder(b->m_adu);
+}
 
-  m_storedBytes += b->m_adu->GetSize();
+Ptr<Packet> BundleStore::Placeholder(Ptr<const Packet> p) {
+  // The bytes of a packet made with only a size are a virtual zero area.
+  Ptr<Packet> placeholder = Create<Packet>(p->GetSize());
+  CopyByteTags(p, placeholder);
+  return placeholder;
+}
+
+void BundleStore::CopyByteTags(Ptr<const Packet> from, Ptr<Packet> to, uint32_t offset) {
+  ByteTagIterator it = from->GetByteTagIterator();
+  while (it.HasNext()) {
+    ByteTagIterator::Item item = it.Next();
+    // A tag is read into an instance of its type, which only a type with a
+    // constructor registered can give.
+    if (!item.GetTypeId().HasConstructor()) {
+      NS_LOG_WARN("dropping byte tag " << item.GetTypeId().GetName() << ", which has no constructor");
+      continue;
+    }
+    Callback<ObjectBase *> constructor = item.GetTypeId().GetConstructor();
+    ObjectBase *instance = constructor();
+    Tag *tag = dynamic_cast<Tag *>(instance);
+    if (tag == NULL) {
+      delete instance;
+      continue;
+    }
+    item.GetTag(*tag);
+    // Keep the bytes the tag covers, e.g. one fragment of a reassembled ADU.
+    to->AddByteTag(*tag, offset + item.GetStart(), offset + item.GetEnd());
+    delete tag;
+  }
+}
+
+void BundleStore::Load(Ptr<Bundle> b) {
+  if (b->diskExtent.length == 0) return;
+  Ptr<Packet> adu = m_disk->Read(b->diskExtent);
+  CopyByteTags(b->m_adu, adu);
+  b->m_adu = adu;
+}
+
+void BundleStore::Unload(Ptr<Bundle> b) {
+  if (b->diskExtent.length == 0 || b->m_adu == NULL) return;
+  b->m_adu = Placeholder(b->m_adu);
+}
+
+void BundleStore::Compact() {
+  if (m_disk == NULL) return;
+  uint64_t before = m_disk->GetFileBytes();
+  // Only the bundles in sparse segments are moved, which are found by segment.
+  std::vector<uint32_t> sparse;
+  for (segmentIndexType::iterator seg = m_segmentBundles.begin(); seg != m_segmentBundles.end(); seg++) {
+    if (m_disk->IsSparse(seg->first)) sparse.push_back(seg->first);
+  }
+  for (std::vector<uint32_t>::iterator seg = sparse.begin(); seg != sparse.end(); seg++) {
+    std::set<Ptr<Bundle>> moving;
+    moving.swap(m_segmentBundles[*seg]);
+    m_segmentBundles.erase(*seg);
+    for (std::set<Ptr<Bundle>>::iterator it = moving.begin(); it != moving.end(); it++) {
+      BpSegmentStore::Extent old = (*it)->diskExtent;
+      (*it)->diskExtent = m_disk->Append(m_disk->Read(old));
+      m_segmentBundles[(*it)->diskExtent.segment].insert(*it);
+      m_disk->Release(old);
+    }
+  }
+  NS_LOG_DEBUG("compacted disk store from " << before << " to " << m_disk->GetFileBytes() << " bytes in "
+    << m_disk->GetNSegments() << " segments");
+}
+
+Ptr<BpSegmentStore> BundleStore::GetSegmentStore() const {
+  return m_disk;
+}
+
+void BundleStore::SetDiskStore(bool disk) {
+  m_diskStore = disk;
+}
+
+bool BundleStore::GetDiskStore() const {
+  return m_diskStore;
+}
+
+void BundleStore::SetDiskSegmentSize(uint64_t bytes) {
+  m_diskSegmentSize = bytes;
+}
+
+uint64_t BundleStore::GetDiskSegmentSize() const {
+  return m_diskSegmentSize;
+}
+
+void BundleStore::SetVirtualPayload(bool virtualPayload) {
+  m_virtualPayload = virtualPayload;
+}
+
+bool BundleStore::GetVirtualPayload() const {
+  return m_virtualPayload;
 }
 
 ssize_t BundleStore::GetMaxBundlesStored() { return maxBundlesStored; }
@@ -66,76 +210,279 @@ void BundleStore::Expire(Ptr<Bundle> b) {
 
 void BundleStore::Remove(Ptr<Bundle> b) {
   NS_LOG_DEBUG("cancelling events and removing from store");
+  if (Erase(b)) {
+    if (!m_removeCallback.IsNull()) m_removeCallback(b);
+  } else {
+    NS_LOG_DEBUG("NOT FOUND IN STORE!");
+  }
+}
+
+bool BundleStore::Erase(Ptr<Bundle> b) {
   b->ClearEvents();
   storeType::iterator it = m_store.find(b);
   if (it != m_store.end()) {
     m_store.erase(it);
+    IndexErase(b);
     m_storedBytes -= b->m_adu->GetSize();
-  } else {
-    NS_LOG_DEBUG("NOT FOUND IN STORE!");
+    if (b->diskExtent.length != 0) {
+      segmentIndexType::iterator seg = m_segmentBundles.find(b->diskExtent.segment);
+      seg->second.erase(b);
+      if (seg->second.empty()) m_segmentBundles.erase(seg);
+      m_disk->Release(b->diskExtent);
+      b->diskExtent = BpSegmentStore::Extent();
+      if (m_disk->NeedsCompaction()) Compact();
+    }
+    return true;
   }
+  return false;
 }
 
-Ptr<Packet> BundleStore::GetBundleADU(const BpEndpointId &eid) {
-  storeType::iterator it = m_store.begin();
-  while (it != m_store.end()) {
-    BpHeader *header = (*it)->GetPrimaryHeader();
-    if (header->GetDestinationEid() == eid) return (*it)->m_adu;
-    it++;
+void BundleStore::ExpireDue() {
+  // Take everything that is due off of the index before expiring any of it,
+  // since removal from the store erases from the index.
+  std::list<Ptr<Bundle>> due;
+  Time now = Simulator::Now();
+  while (!m_expiryIndex.empty() && m_expiryIndex.begin()->first <= now) {
+    due.push_back(m_expiryIndex.begin()->second);
+    m_expiryIndex.erase(m_expiryIndex.begin());
   }
-  return Ptr<Packet>(0);
+  NS_LOG_DEBUG(due.size() << " bundles expired, " << m_expiryIndex.size() << " left to expire");
+  for (std::list<Ptr<Bundle>>::iterator it = due.begin(); it != due.end(); it++) {
+    Expire(*it);
+  }
+  ScheduleExpiry();
+}
+
+void BundleStore::ScheduleExpiry() {
+  if (!m_batchExpiry) return;
+  if (m_expiryIndex.empty()) {
+    m_expiryEvent.Cancel();
+    return;
+  }
+  // A bundle removed from the head of the index leaves the event early,
+  // which is harmless: it finds nothing due and reschedules.
+  Time next = m_expiryIndex.begin()->first;
+  if (m_expiryEvent.IsRunning() && m_expiryTime <= next) return;
+  m_expiryEvent.Cancel();
+  m_expiryTime = next;
+  m_expiryEvent = Simulator::Schedule(next - Simulator::Now(), &BundleStore::ExpireDue, this);
+}
+
+void BundleStore::SetBatchExpiry(bool batch) {
+  m_batchExpiry = batch;
+}
+
+bool BundleStore::GetBatchExpiry() const {
+  return m_batchExpiry;
+}
+
+bool BundleStore::OverQuota() const {
+  return !WithinQuota(m_storedBytes, m_store.size());
+}
+
+bool BundleStore::WithinQuota(uint64_t bytes, uint32_t bundles) const {
+  return (m_maxBytes == 0 || bytes <= m_maxBytes) && (m_maxBundles == 0 || bundles <= m_maxBundles);
+}
+
+bool BundleStore::ChooseVictims(Ptr<Bundle> b, std::vector<Ptr<Bundle>> &victims) const {
+  uint64_t freed = 0;
+  bool done = false;
+  switch (m_evictionPolicy) {
+    case EVICT_LOWEST_PRIORITY:
+      // The store is ordered by priority, then creation time.
+      for (storeType::const_iterator it = m_store.begin(); !done && it != m_store.end(); it++) {
+        done = TakeVictim(*it, b, victims, freed);
+      }
+      break;
+    case EVICT_SOONEST_EXPIRING:
+      for (expiryIndexType::const_iterator it = m_expiryIndex.begin(); !done && it != m_expiryIndex.end(); it++) {
+        done = TakeVictim(it->second, b, victims, freed);
+      }
+      break;
+    default:
+      break;
+  }
+  if (m_evictionPolicy != EVICT_LOWEST_PRIORITY) {
+    // The source index is ordered by creation timestamp.  After the bundles
+    // that expire, the oldest of those that never do.
+    for (sourceIndexType::const_iterator key = m_sourceIndex.begin(); !done && key != m_sourceIndex.end(); key++) {
+      for (storeType::const_iterator it = key->second.begin(); !done && it != key->second.end(); it++) {
+        if (m_evictionPolicy == EVICT_SOONEST_EXPIRING && (*it)->GetPrimaryHeader()->GetLifeTime() != 0) continue;
+        done = TakeVictim(*it, b, victims, freed);
+      }
+    }
+  }
+  return !victims.empty() && WithinQuota(m_storedBytes - freed, m_store.size() - victims.size());
+}
+
+bool BundleStore::TakeVictim(Ptr<Bundle> c, Ptr<Bundle> b, std::vector<Ptr<Bundle>> &victims, uint64_t &freed) const {
+  // Bundles in custody here are kept until their custody is released.
+  if (c->retentionConstraints & _BP_CUSTODY_ACCEPTED) return false;
+  if (c == b) {
+    // The new bundle would go before the rest make room for it.
+    victims.clear();
+    return true;
+  }
+  victims.push_back(c);
+  freed += c->m_adu->GetSize();
+  return WithinQuota(m_storedBytes - freed, m_store.size() - victims.size());
+}
+
+void BundleStore::SetMaxBytes(uint64_t bytes) {
+  m_maxBytes = bytes;
+}
+
+uint64_t BundleStore::GetMaxBytes() const {
+  return m_maxBytes;
+}
+
+void BundleStore::SetMaxBundles(uint32_t bundles) {
+  m_maxBundles = bundles;
+}
+
+uint32_t BundleStore::GetMaxBundles() const {
+  return m_maxBundles;
+}
+
+void BundleStore::SetEvictionPolicy(EvictionPolicy policy) {
+  m_evictionPolicy = policy;
+}
+
+BundleStore::EvictionPolicy BundleStore::GetEvictionPolicy() const {
+  return m_evictionPolicy;
+}
+
+void BundleStore::SetEvictCallback(EvictCallback cb) {
+  m_evictCallback = cb;
+}
+
+void BundleStore::SetRemoveCallback(RemoveCallback cb) {
+  m_removeCallback = cb;
+}
+
+BundleSourceKey BundleStore::SourceKey(Ptr<Bundle> b) {
+  BpHeader *header = b->GetPrimaryHeader();
+  return BundleSourceKey(header->GetSourceEid(), header->GetCreateTimestamp(), header->GetSequenceNumber().GetValue());
+}
+
+void BundleStore::IndexInsert(Ptr<Bundle> b) {
+  m_destIndex[b->GetPrimaryHeader()->GetDestinationEid()].insert(b);
+  m_sourceIndex[SourceKey(b)].insert(b);
+}
+
+void BundleStore::IndexErase(Ptr<Bundle> b) {
+  destIndexType::iterator d = m_destIndex.find(b->GetPrimaryHeader()->GetDestinationEid());
+  if (d != m_destIndex.end()) {
+    d->second.erase(b);
+    if (d->second.empty()) m_destIndex.erase(d);
+  }
+  sourceIndexType::iterator s = m_sourceIndex.find(SourceKey(b));
+  if (s != m_sourceIndex.end()) {
+    s->second.erase(b);
+    if (s->second.empty()) m_sourceIndex.erase(s);
+  }
+  if (m_expiryIndex.erase(std::make_pair(b->expireTime, b)) && m_expiryIndex.empty()) {
+    m_expiryEvent.Cancel();
+  }
+  ClearForwardPending(b);
+}
+
+Ptr<Packet> BundleStore::GetBundleADU(const BpEndpointId &eid) {
+  destIndexType::iterator d = m_destIndex.find(eid);
+  if (d == m_destIndex.end()) return Ptr<Packet>(0);
+  Ptr<Bundle> b = *d->second.begin();
+  if (b->diskExtent.length != 0) return m_disk->Read(b->diskExtent);
+  return b->m_adu;
 }
 
 Ptr<Packet> BundleStore::GetAndRemoveBundle(const BpEndpointId &eid, bool fragOk) {
-  storeType::iterator it = m_store.begin();
-  for (; it != m_store.end(); it++) {
+  destIndexType::iterator d = m_destIndex.find(eid);
+  if (d == m_destIndex.end()) return Ptr<Packet>(0);
+  storeType::iterator it = d->second.begin();
+  for (; it != d->second.end(); it++) {
     BpHeader *header = (*it)->GetPrimaryHeader();
-    if (header->GetDestinationEid() == eid) {
-      Ptr<Bundle> b = (*it);
-      NS_LOG_DEBUG("matching bundle found " << (header->IsFragment() ? "frag":"unfrag") 
-        << " TS " << header->GetCreateTimestamp() << " seqno " << header->GetSequenceNumber().GetValue());
-      if (header->IsFragment() && !fragOk) continue;
-      Remove(b);
-      Ptr<Packet> adu = b->m_adu;
-      b->DoDispose();
-      NS_LOG_DEBUG("got and removed");
-      return adu;
-    }
+    NS_LOG_DEBUG("matching bundle found " << (header->IsFragment() ? "frag":"unfrag") 
+      << " TS " << header->GetCreateTimestamp() << " seqno " << header->GetSequenceNumber().GetValue());
+    if (header->IsFragment() && !fragOk) continue;
+    // Removal invalidates both iterators, so take our own reference first.
+    Ptr<Bundle> b = (*it);
+    Load(b);
+    Remove(b);
+    Ptr<Packet> adu = b->m_adu;
+    b->DoDispose();
+    NS_LOG_DEBUG("got and removed");
+    return adu;
   }
   return Ptr<Packet>(0);
 }
 
 Ptr<Bundle> BundleStore::GetBundle(const BpEndpointId &src, uint32_t ts, uint32_t seqno) {
-  storeType::iterator it = m_store.begin();
-  while (it != m_store.end()) {
-    BpHeader *header = (*it)->GetPrimaryHeader();
-    if ((header->GetSourceEid() == src) &&
-        (header->GetCreateTimestamp() == ts) &&
-        (header->GetSequenceNumber().GetValue() == seqno)) return (*it);
-    it++;
-  }
-  return Ptr<Bundle>(0);
+  sourceIndexType::iterator s = m_sourceIndex.find(BundleSourceKey(src, ts, seqno));
+  if (s == m_sourceIndex.end()) return Ptr<Bundle>(0);
+  return *s->second.begin();
 }
 
 void BundleStore::GetBundles(const BpEndpointId &src, uint32_t ts, uint32_t seqno, std::list<Ptr<Bundle>> &bundles) {
-  storeType::iterator it = m_store.begin();
-  while (it != m_store.end()) {
-    BpHeader *header = (*it)->GetPrimaryHeader();
-    if ((header->GetSourceEid() == src) &&
-        (header->GetCreateTimestamp() == ts) &&
-        (header->GetSequenceNumber().GetValue() == seqno)) bundles.push_back(*it);
-    it++;
+  sourceIndexType::iterator s = m_sourceIndex.find(BundleSourceKey(src, ts, seqno));
+  if (s == m_sourceIndex.end()) return;
+  bundles.insert(bundles.end(), s->second.begin(), s->second.end());
+}
+
+void BundleStore::SetForwardPending(Ptr<Bundle> b, Ptr<BpCla> cla) {
+  if (m_store.find(b) == m_store.end()) {
+    NS_LOG_DEBUG("forward pending bundle is not in store");
+    return;
   }
+  ClearForwardPending(b);
+  m_pendingIndex[cla].insert(b);
+  m_pendingCla[b] = cla;
+}
+
+void BundleStore::ClearForwardPending(Ptr<Bundle> b) {
+  std::map<Ptr<Bundle>, Ptr<BpCla>>::iterator p = m_pendingCla.find(b);
+  if (p == m_pendingCla.end()) return;
+  claIndexType::iterator c = m_pendingIndex.find(p->second);
+  if (c != m_pendingIndex.end()) {
+    c->second.erase(b);
+    if (c->second.empty()) m_pendingIndex.erase(c);
+  }
+  m_pendingCla.erase(p);
 }
 
 void BundleStore::GetForwardPendingBundles(std::list<Ptr<Bundle>> *bundles, Ptr<BpCla> cla, Callback<Ptr<BpCla>, BpEndpointId> outgoingClaCallback) {
-  storeType::iterator it = m_store.begin();
-  while (it != m_store.end()) {
-    BpEndpointId destEid = (*it)->GetPrimaryHeader()->GetDestinationEid();
-    if (((*it)->retentionConstraints & _BP_FORWARD_PENDING) == _BP_FORWARD_PENDING && outgoingClaCallback(destEid) == cla)
-        bundles->push_back(*it);
-    it++;
+  // Only the bundles queued on this CLA, and those that had no route at all,
+  // can have become sendable.  Routes may have changed since they were
+  // queued, so re-check each one and move any that now use another CLA.
+  storeType ready;
+  std::list<std::pair<Ptr<Bundle>, Ptr<BpCla>>> moved;
+  Ptr<BpCla> keys[2] = { cla, Ptr<BpCla>(0) };
+  for (int k = 0; k < ((cla == 0) ? 1 : 2); k++) {
+    claIndexType::iterator c = m_pendingIndex.find(keys[k]);
+    if (c == m_pendingIndex.end()) continue;
+    for (storeType::iterator it = c->second.begin(); it != c->second.end(); it++) {
+      if (((*it)->retentionConstraints & _BP_FORWARD_PENDING) != _BP_FORWARD_PENDING) continue;
+      Ptr<BpCla> outgoing = outgoingClaCallback((*it)->GetPrimaryHeader()->GetDestinationEid());
+      if (outgoing == cla) ready.insert(*it);
+      else if (outgoing != keys[k]) moved.push_back(std::make_pair(*it, outgoing));
+    }
+  }
+  for (std::list<std::pair<Ptr<Bundle>, Ptr<BpCla>>>::iterator it = moved.begin(); it != moved.end(); it++) {
+    SetForwardPending(it->first, it->second);
+  }
+  bundles->insert(bundles->end(), ready.begin(), ready.end());
+}
+
+void BundleStore::GetForwardPendingBundles(std::list<Ptr<Bundle>> *bundles, Ptr<BpCla> cla) {
+  storeType pending;
+  Ptr<BpCla> keys[2] = { cla, Ptr<BpCla>(0) };
+  for (int k = 0; k < ((cla == 0) ? 1 : 2); k++) {
+    claIndexType::iterator c = m_pendingIndex.find(keys[k]);
+    if (c == m_pendingIndex.end()) continue;
+    for (storeType::iterator it = c->second.begin(); it != c->second.end(); it++) {
+      if (((*it)->retentionConstraints & _BP_FORWARD_PENDING) == _BP_FORWARD_PENDING) pending.insert(*it);
+    }
   }
+  bundles->insert(bundles->end(), pending.begin(), pending.end());
 }
 
 void BundleStore::DebugDump() {
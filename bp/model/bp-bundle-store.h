@@ -26,6 +26,9 @@
 #include "bp-header.h"
 #include "bp-cla.h"
 #include "bp-endpoint-id.h"
+#include <map>
+#include <set>
+#include <vector>
 
 namespace ns3 {
 
@@ -36,31 +39,111 @@ namespace ns3 {
 #define _BP_CUSTODY_ACCEPTED 0x04
 
 struct BundlePriorityCompare {
-  bool operator()(const Ptr<Bundle>& lhs, const Ptr<Bundle>& rhs) {
-    BpHeader *lhsHdr = lhs->GetPrimaryHeader();
-    BpHeader *rhsHdr = rhs->GetPrimaryHeader();
-    if (lhsHdr->Priority() != rhsHdr->Priority())
-      return lhsHdr->Priority() < rhsHdr->Priority();
-    if (lhsHdr->GetCreateTimestamp() != rhsHdr->GetCreateTimestamp())
-      return lhsHdr->GetCreateTimestamp() < rhsHdr->GetCreateTimestamp();
-    if (lhsHdr->GetSequenceNumber() != rhsHdr->GetSequenceNumber())
-      return lhsHdr->GetSequenceNumber() < rhsHdr->GetSequenceNumber();
-    if (lhsHdr->GetFragOffset() != rhsHdr->GetFragOffset())
-      return lhsHdr->GetFragOffset() < rhsHdr->GetFragOffset();
-    if (lhsHdr->GetSourceEid().Uri() != rhsHdr->GetSourceEid().Uri())
-      return lhsHdr->GetSourceEid().Uri() < rhsHdr->GetSourceEid().Uri();
+  bool operator()(const Ptr<Bundle>& lhs, const Ptr<Bundle>& rhs) const {
+    if (lhs->sortKey < rhs->sortKey) return true;
+    if (rhs->sortKey < lhs->sortKey) return false;
     return lhs < rhs;
   }
 };
 
 typedef std::set<Ptr<Bundle>, BundlePriorityCompare> storeType;
 
+/**
+ * \brief Identifies a bundle and all of its fragments, per section 5.8 of
+ * RFC 5050 (source EID, creation timestamp and sequence number).
+ */
+struct BundleSourceKey {
+  BundleSourceKey(const BpEndpointId &s, uint32_t t, uint32_t q)
+    : src (s), timestamp (t), seqno (q)
+    {
+    }
+
+  BpEndpointId src;
+  uint32_t timestamp;
+  uint32_t seqno;
+};
+
+inline bool operator < (const BundleSourceKey &a, const BundleSourceKey &b)
+{
+  if (a.timestamp != b.timestamp) return a.timestamp < b.timestamp;
+  if (a.seqno != b.seqno) return a.seqno < b.seqno;
+  return a.src < b.src;
+}
+
+/**
+ * \brief Bundles held by an agent, with indexes by destination, source and
+ * forward-pending CLA
+ *
+ * Bundles with a lifetime are expired by the store.  By default they are
+ * kept in an index sorted by expiry time, and a single simulator event is
+ * rescheduled for the earliest one, so bundles that expire together go in
+ * one batch and removing a bundle only erases it from the index.  With
+ * batch expiry disabled each bundle gets its own simulator event.
+ *
+ * The store can be given a quota in bytes and/or bundles.  When a new
+ * bundle would exceed it, the eviction policy either refuses the new
+ * bundle or drops stored bundles until it fits.  Bundles in custody here
+ * are never dropped.  If the bundles the policy would drop before the new
+ * one do not make room for it (e.g. it is the oldest, or the rest are in
+ * custody), the new bundle is refused and nothing is dropped.
+ *
+ * With the disk store enabled, the ADU of each stored bundle is written to
+ * a BpSegmentStore and the bundle keeps only a placeholder packet of the
+ * same size (and byte tags), which takes no payload memory.  The bytes are
+ * read back by Load () when they are needed, e.g. by a CLA sending the
+ * bundle, and whenever a bundle is handed out of the store by
+ * GetAndRemoveBundle ().  Callers that take a bundle out with Remove () and
+ * still need its bytes must Load () it first.  With virtual payloads the
+ * ADUs are placeholders to begin with, so nothing is written to disk.
+ */
 class BundleStore {
 public:
-  BundleStore(void) { maxBundlesStored = 0; }
-  ~BundleStore(void) { m_store.clear(); }
+  /// what to drop when a new bundle would exceed the quota
+  enum EvictionPolicy {
+    EVICT_OLDEST,              /// bundles with the earliest creation timestamp
+    EVICT_LOWEST_PRIORITY,     /// bundles of the lowest priority, oldest first
+    EVICT_SOONEST_EXPIRING,    /// bundles closest to expiry, then the oldest without a lifetime
+    REFUSE_NEW,                /// nothing stored; the new bundle is refused
+  };
+
+  /// called with each bundle that is evicted or refused to stay within the quota
+  typedef Callback<void, Ptr<Bundle>> EvictCallback;
+
+  /// called with each bundle taken out of the store, however it leaves
+  typedef Callback<void, Ptr<Bundle>> RemoveCallback;
+
+  BundleStore(void)
+    : maxBundlesStored(0),
+      m_storedBytes(0),
+      m_maxBytes(0),
+      m_maxBundles(0),
+      m_evictionPolicy(REFUSE_NEW),
+      m_batchExpiry(true),
+      m_diskStore(false),
+      m_diskSegmentSize(64 << 20),
+      m_virtualPayload(false)
+  {}
+  ~BundleStore(void) { m_expiryEvent.Cancel(); m_store.clear(); }
+
+  /**
+   * \return false if the bundle was not stored, because it has already
+   * expired or there is no room for it under the quota
+   */
+  bool Store(Ptr<Bundle> b);
+
+  /**
+   * \return true if the bundle has a lifetime and it has run out
+   */
+  static bool IsExpired(Ptr<Bundle> b);
+
+  /**
+   * Add the byte tags of one packet to the bytes of another, e.g. when the
+   * bytes are copied into a new packet.
+   *
+   * \param offset where the bytes of from start in to
+   */
+  static void CopyByteTags(Ptr<const Packet> from, Ptr<Packet> to, uint32_t offset = 0);
 
-  void Store(Ptr<Bundle> b);
   ssize_t GetMaxBundlesStored();
   ssize_t GetStoredByteCount();
   void Expire(Ptr<Bundle> b);
@@ -72,13 +155,197 @@ public:
   void GetBundles(const BpEndpointId &src, uint32_t ts, uint32_t seqno, std::list<Ptr<Bundle>> &bundles);
   void GetForwardPendingBundles(std::list<Ptr<Bundle>> *bundles, Ptr<BpCla> cla, Callback<Ptr<BpCla>, BpEndpointId> outgoingClaCallback);
 
+  /**
+   * \param bundles the list to add, in priority order, the forward-pending
+   * bundles queued on cla and those with no CLA to
+   * \param cla the CLA, or 0 for only the bundles with no CLA
+   */
+  void GetForwardPendingBundles(std::list<Ptr<Bundle>> *bundles, Ptr<BpCla> cla);
+
+  /**
+   * Queue a stored bundle for forwarding once a CLA becomes ready.
+   *
+   * \param b the bundle, which must already be in the store
+   * \param cla the CLA the bundle is waiting on, or 0 if there is no route
+   */
+  void SetForwardPending(Ptr<Bundle> b, Ptr<BpCla> cla);
+
+  /**
+   * Take a bundle off of the forward-pending queues.
+   */
+  void ClearForwardPending(Ptr<Bundle> b);
+
+  /**
+   * \param batch true to expire bundles from the expiry index, false for one
+   * simulator event per bundle.  Must be set before anything is stored.
+   */
+  void SetBatchExpiry(bool batch);
+  bool GetBatchExpiry() const;
+
+  /**
+   * \param bytes most ADU bytes to store, or 0 for no limit
+   */
+  void SetMaxBytes(uint64_t bytes);
+  uint64_t GetMaxBytes() const;
+
+  /**
+   * \param bundles most bundles to store, or 0 for no limit
+   */
+  void SetMaxBundles(uint32_t bundles);
+  uint32_t GetMaxBundles() const;
+
+  void SetEvictionPolicy(EvictionPolicy policy);
+  EvictionPolicy GetEvictionPolicy() const;
+
+  void SetEvictCallback(EvictCallback cb);
+
+  /**
+   * \param cb called by Remove () with each bundle it takes out of the
+   * store, so also for expired, evicted and delivered bundles; before the
+   * bundle is disposed of
+   */
+  void SetRemoveCallback(RemoveCallback cb);
+
+  /**
+   * \param disk true to keep stored ADUs in memory-mapped segment files
+   * rather than in memory.  Must be set before anything is stored.
+   */
+  void SetDiskStore(bool disk);
+  bool GetDiskStore() const;
+
+  /**
+   * \param bytes size of each segment file of the disk store
+   */
+  void SetDiskSegmentSize(uint64_t bytes);
+  uint64_t GetDiskSegmentSize() const;
+
+  /**
+   * Bring the ADU of a stored bundle back into memory, if it is on disk.
+   */
+  void Load(Ptr<Bundle> b);
+
+  /**
+   * Drop the in-memory copy of a stored bundle's ADU again, if it is on
+   * disk.
+   */
+  void Unload(Ptr<Bundle> b);
+
+  /**
+   * Move the ADUs kept in sparse segment files to the end of the disk
+   * store, so that those files can be deleted.  This is done on its own
+   * when the dead space in the disk store exceeds the live data.
+   */
+  void Compact();
+
+  /**
+   * \return the disk store, or 0 if nothing has been written to it yet
+   */
+  Ptr<BpSegmentStore> GetSegmentStore() const;
+
+  /**
+   * \param virtualPayload true if stored ADUs are only placeholders of
+   * their length, which the disk store then leaves alone
+   */
+  void SetVirtualPayload(bool virtualPayload);
+  bool GetVirtualPayload() const;
+
+  /**
+   * \return a packet of the same size that takes no payload memory, with
+   * the same byte tags
+   */
+  static Ptr<Packet> Placeholder(Ptr<const Packet> p);
+
   void DebugDump();
 
 private:
+  typedef std::map<BpEndpointId, storeType> destIndexType;
+  typedef std::map<BundleSourceKey, storeType> sourceIndexType;
+  typedef std::map<Ptr<BpCla>, storeType> claIndexType;
+  typedef std::map<uint32_t, std::set<Ptr<Bundle>>> segmentIndexType;
+
+  static BundleSourceKey SourceKey(Ptr<Bundle> b);
+
+  void IndexInsert(Ptr<Bundle> b);
+  void IndexErase(Ptr<Bundle> b);
+
+  /**
+   * Expire every bundle that is due, then reschedule for the next one.
+   */
+  void ExpireDue();
+
+  /**
+   * Make sure the expiry event is set for the earliest bundle in the index.
+   */
+  void ScheduleExpiry();
+
+  /**
+   * \return true if more than the quota is stored
+   */
+  bool OverQuota() const;
+
+  /**
+   * \return true if the given bytes and number of bundles are within the quota
+   */
+  bool WithinQuota(uint64_t bytes, uint32_t bundles) const;
+
+  /**
+   * Choose the stored bundles the eviction policy drops, in its order, to
+   * make room for a newly stored bundle.  Bundles in custody here are
+   * skipped.
+   *
+   * \param b the new bundle, already in the store
+   * \return false if there is no room without dropping the new bundle
+   */
+  bool ChooseVictims(Ptr<Bundle> b, std::vector<Ptr<Bundle>> &victims) const;
+
+  /**
+   * Take a bundle as a victim for ChooseVictims (), unless it is in custody
+   * here.  The new bundle itself clears the victims.
+   *
+   * \param freed bytes of the victims so far
+   * \return true once there is no need to look further
+   */
+  bool TakeVictim(Ptr<Bundle> c, Ptr<Bundle> b, std::vector<Ptr<Bundle>> &victims, uint64_t &freed) const;
+
+  /**
+   * Take a bundle out of the store and its indexes, without calling the
+   * remove callback.
+   *
+   * \return false if the bundle is not stored
+   */
+  bool Erase(Ptr<Bundle> b);
+
+  /**
+   * Move a newly stored bundle's ADU to the disk store.
+   */
+  void Spill(Ptr<Bundle> b);
+
   //x std::deque<Ptr<Bundle>> m_store;
   storeType m_store;
+  destIndexType m_destIndex;       /// stored bundles per destination EID
+  sourceIndexType m_sourceIndex;   /// stored bundles and fragments per source key
+  claIndexType m_pendingIndex;     /// forward-pending bundles per outgoing CLA (0 if unrouted)
+  std::map<Ptr<Bundle>, Ptr<BpCla>> m_pendingCla; /// CLA each forward-pending bundle is queued on
   uint32_t maxBundlesStored;
   ssize_t m_storedBytes;
+
+  uint64_t m_maxBytes;             /// byte quota, 0 for none
+  uint32_t m_maxBundles;           /// bundle quota, 0 for none
+  EvictionPolicy m_evictionPolicy;
+  EvictCallback m_evictCallback;
+  RemoveCallback m_removeCallback;
+
+  typedef std::set<std::pair<Time, Ptr<Bundle>>> expiryIndexType;
+  bool m_batchExpiry;
+  expiryIndexType m_expiryIndex;   /// stored bundles with a lifetime, by expiry time (scheduled only for batch expiry)
+  EventId m_expiryEvent;           /// runs ExpireDue () at m_expiryTime
+  Time m_expiryTime;
+
+  bool m_diskStore;
+  uint64_t m_diskSegmentSize;
+  Ptr<BpSegmentStore> m_disk;      /// ADUs of stored bundles, if m_diskStore
+  segmentIndexType m_segmentBundles; /// stored bundles by the disk segment of their ADU
+  bool m_virtualPayload;
 };
 
 } // namespace ns3
@@ -30,6 +30,7 @@ Bundle::Bundle(Ptr<Packet> adu) {
   NS_LOG_FUNCTION("bundle creation");
   m_adu = adu;
   retentionConstraints = 0;
+  sortKey = BundleSortKey();
 }
 
 Bundle::~Bundle() {}
@@ -39,7 +40,8 @@ Bundle::DoDispose(void) {
   NS_LOG_FUNCTION("bundle disposal");
   m_adu = NULL;
   if (GetPrimaryHeader()->GetLifeTime() != 0) Simulator::Remove(expireEvent);
-  acks.clear();
+  Simulator::Remove(sendRetry);
+  acks.Clear();
   NS_LOG_DEBUG("refcnt: " << this->GetReferenceCount());
 }
 
@@ -48,6 +50,17 @@ Bundle::ClearEvents() {
   if (GetPrimaryHeader()->GetLifeTime() != 0 && expireEvent.IsRunning()) {
     expireEvent.Cancel();
   }
+  sendRetry.Cancel();
+}
+
+void
+Bundle::UpdateSortKey() {
+  BpHeader *header = GetPrimaryHeader();
+  sortKey.priority = header->Priority();
+  sortKey.timestamp = header->GetCreateTimestamp();
+  sortKey.seqno = header->GetSequenceNumber().GetValue();
+  sortKey.fragOffset = header->GetFragOffset();
+  sortKey.sourceId = header->GetSourceEid().Id();
 }
 
 } // namespace ns3
\ No newline at end of file
@@ -29,6 +29,8 @@
 #include "ns3/simulator.h"
 #include "bp-header.h"
 #include "bp-block-header.h"
+#include "bp-range-set.h"
+#include "bp-segment-store.h"
 
 namespace ns3 {
 
@@ -37,6 +39,31 @@ namespace ns3 {
 // Commonly referenced default endpoint ID.
 static BpEndpointId defaultEid = BpEndpointId("dtn:none");
 
+/**
+ * \brief Ordering key for a stored bundle.
+ *
+ * Filled in once from the primary header when the bundle enters the store,
+ * so that store comparisons do not go through the header at all.  Later
+ * changes to the header (e.g. per-fragment fields set while forwarding) do
+ * not affect the key.
+ */
+struct BundleSortKey {
+  uint8_t priority;
+  uint32_t timestamp;
+  uint32_t seqno;
+  uint32_t fragOffset;
+  uint32_t sourceId;    /// source BpEndpointId::Id ()
+};
+
+inline bool operator < (const BundleSortKey &a, const BundleSortKey &b)
+{
+  if (a.priority != b.priority) return a.priority < b.priority;
+  if (a.timestamp != b.timestamp) return a.timestamp < b.timestamp;
+  if (a.seqno != b.seqno) return a.seqno < b.seqno;
+  if (a.fragOffset != b.fragOffset) return a.fragOffset < b.fragOffset;
+  return a.sourceId < b.sourceId;
+}
+
 class Bundle : public SimpleRefCount<Bundle> {
 public:
   Bundle(Ptr<Packet> adu);
@@ -57,6 +84,11 @@ public:
 
   virtual void ClearEvents();
 
+  /**
+   * Rebuild sortKey from the current primary header.
+   */
+  void UpdateSortKey();
+
   /*
   pTODO these methods might be helpful for enabling/disabling cust tx, but it may be okay 
   to remove them from here since places dealing w/ cust tx with bundles should know if that
@@ -70,15 +102,21 @@ public:
 
   uint32_t retentionConstraints;
 
+  BundleSortKey sortKey;
+
   Ptr<Packet> m_adu;
 
   // TODO don't assume block ordering
   //  bool bundleHdrPresent, ctebPresent, payloadHdrPresent;
   //  CTEB cteb;
 
-  EventId expireEvent;
+  EventId expireEvent;   /// expires the bundle, if the store is not expiring in batches
+  EventId sendRetry;     /// forwards the bundle again after a CLA that stayed ready refused it
+  Time expireTime;       /// when the bundle expires, if it has a lifetime
+
+  BpRangeSet acks;   /// ranges of the ADU that custody has been accepted for
 
-  std::list<std::pair<uint32_t, uint32_t>> acks;
+  BpSegmentStore::Extent diskExtent;   /// where the store keeps the ADU on disk, if its length is not 0
 };
 
 } // namespace ns3
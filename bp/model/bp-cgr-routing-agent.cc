@@ -0,0 +1,553 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-cgr-routing-agent.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE ("BpCgrRoutingAgent");
+
+namespace ns3 {
+
+namespace {
+
+/**
+ * Read a node of a contact plan line: an EID, or an ipn node number.
+ */
+bool
+ParseNode (const std::string &token, BpEndpointId &node)
+{
+  if (token.find (':') != std::string::npos)
+    {
+      node = BpEndpointId (token);
+      return true;
+    }
+  if (token.empty () || token.find_first_not_of ("0123456789") != std::string::npos)
+    return false;
+  node = BpEndpointId (strtoull (token.c_str (), NULL, 10), 0);
+  return true;
+}
+
+} // anonymous namespace
+
+NS_OBJECT_ENSURE_REGISTERED (BpCgrRoutingAgent);
+
+TypeId
+BpCgrRoutingAgent::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpCgrRoutingAgent")
+    .SetParent<BpRoutingAgent> ()
+    .AddConstructor<BpCgrRoutingAgent> ()
+    .AddAttribute ("MaxRoutes", "Number of routes kept for each destination",
+                   UintegerValue (5),
+                   MakeUintegerAccessor (&BpCgrRoutingAgent::m_maxRoutes),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ExpectedBundleSize", "Bytes a route must have time to send on each contact, which adds their transmission time to the arrival",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&BpCgrRoutingAgent::m_expectedBundleSize),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+BpCgrRoutingAgent::BpCgrRoutingAgent ()
+  : m_maxRoutes (5),
+    m_expectedBundleSize (0),
+    m_nextContact (0),
+    m_computations (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+BpCgrRoutingAgent::~BpCgrRoutingAgent ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+BpCgrRoutingAgent::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  ClearContactPlan ();
+  m_neighbors.clear ();
+  m_endpoints.clear ();
+  BpRoutingAgent::DoDispose ();
+}
+
+void
+BpCgrRoutingAgent::SetLocalEid (BpEndpointId eid)
+{
+  NS_LOG_FUNCTION (this << " " << eid.Uri ());
+  m_localEid = eid;
+  m_routes.clear ();
+}
+
+void
+BpCgrRoutingAgent::AddNode (BpEndpointId node, Ipv4Address addr, uint16_t port, TypeId claType)
+{
+  NS_LOG_FUNCTION (this << " " << node.Uri ());
+  if (!claType.IsChildOf (BpCla::GetTypeId ()))
+    NS_FATAL_ERROR ("BpCgrRoutingAgent::AddNode (): " << claType.GetName () << " is not a CLA type");
+  Neighbor &n = m_neighbors[node];
+  n.addr = addr;
+  n.port = port;
+  n.cla = 0;
+  n.claType = claType;
+}
+
+void
+BpCgrRoutingAgent::AddNode (BpEndpointId node, Ipv4Address addr, uint16_t port, Ptr<BpCla> cla)
+{
+  NS_LOG_FUNCTION (this << " " << node.Uri ());
+  Neighbor &n = m_neighbors[node];
+  n.addr = addr;
+  n.port = port;
+  n.cla = cla;
+  n.claType = TypeId ();
+}
+
+void
+BpCgrRoutingAgent::AddEndpoint (BpEndpointId eid, BpEndpointId node)
+{
+  NS_LOG_FUNCTION (this << " " << eid.Uri () << " " << node.Uri ());
+  m_endpoints[eid] = node;
+}
+
+uint32_t
+BpCgrRoutingAgent::AddContact (BpEndpointId from, BpEndpointId to, Time start, Time end, uint64_t rate, Time owlt)
+{
+  NS_LOG_FUNCTION (this << " " << from.Uri () << " " << to.Uri () << " " << start.GetSeconds () << " " << end.GetSeconds ());
+  uint32_t id = m_nextContact++;
+  Time now = Simulator::Now ();
+  if (end <= now || end <= start)
+    {
+      NS_LOG_WARN ("BpCgrRoutingAgent::AddContact (): contact from " << from.Uri () << " to " << to.Uri ()
+                   << " ending at " << end.GetSeconds () << " s is never on");
+      return id;
+    }
+
+  Contact &c = m_contacts[id];
+  c.from = from;
+  c.to = to;
+  c.start = start;
+  c.end = end;
+  c.rate = rate;
+  c.owlt = owlt;
+  c.startEvent = Simulator::Schedule (start > now ? start - now : Seconds (0), &BpCgrRoutingAgent::ContactStart, this, id);
+  c.endEvent = Simulator::Schedule (end - now, &BpCgrRoutingAgent::ContactEnd, this, id);
+  m_contactsFrom[from].push_back (id);
+
+  // any route may now be bettered
+  m_routes.clear ();
+  return id;
+}
+
+int
+BpCgrRoutingAgent::RemoveContact (uint32_t id)
+{
+  NS_LOG_FUNCTION (this << " " << id);
+  std::map<uint32_t, Contact>::iterator it = m_contacts.find (id);
+  if (it == m_contacts.end ())
+    return -1;
+
+  it->second.startEvent.Cancel ();
+  it->second.endEvent.Cancel ();
+  ContactEnd (id);
+  return 0;
+}
+
+int
+BpCgrRoutingAgent::LoadContactPlan (std::string filename)
+{
+  NS_LOG_FUNCTION (this << " " << filename);
+  std::ifstream file (filename.c_str ());
+  if (!file)
+    {
+      NS_LOG_WARN ("BpCgrRoutingAgent::LoadContactPlan (): cannot read " << filename);
+      return -1;
+    }
+
+  // read the whole file first, so that a bad line leaves the plan as it was
+  std::vector<Contact> contacts;
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline (file, line))
+    {
+      lineNumber++;
+      std::string::size_type comment = line.find ('#');
+      if (comment != std::string::npos)
+        line.erase (comment);
+
+      std::istringstream fields (line);
+      std::string from, to, rest;
+      double start, end, owlt;
+      uint64_t rate;
+      if (!(fields >> from))
+        continue;
+
+      Contact c;
+      if (!(fields >> to >> start >> end >> rate >> owlt) || (fields >> rest)
+          || !ParseNode (from, c.from) || !ParseNode (to, c.to)
+          || start < 0 || end <= start || owlt < 0)
+        {
+          NS_LOG_WARN ("BpCgrRoutingAgent::LoadContactPlan (): " << filename << ":" << lineNumber
+                       << ": expected <from> <to> <start> <end> <rate> <owlt>, found \"" << line << "\"");
+          return -1;
+        }
+      c.start = Seconds (start);
+      c.end = Seconds (end);
+      c.rate = rate;
+      c.owlt = Seconds (owlt);
+      contacts.push_back (c);
+    }
+
+  for (std::vector<Contact>::iterator it = contacts.begin (); it != contacts.end (); it++)
+    {
+      AddContact (it->from, it->to, it->start, it->end, it->rate, it->owlt);
+    }
+  NS_LOG_DEBUG ("loaded " << contacts.size () << " contacts from " << filename);
+  return 0;
+}
+
+void
+BpCgrRoutingAgent::ClearContactPlan ()
+{
+  NS_LOG_FUNCTION (this);
+  for (std::map<uint32_t, Contact>::iterator it = m_contacts.begin (); it != m_contacts.end (); it++)
+    {
+      it->second.startEvent.Cancel ();
+      it->second.endEvent.Cancel ();
+    }
+  m_contacts.clear ();
+  m_contactsFrom.clear ();
+  m_routes.clear ();
+}
+
+uint32_t
+BpCgrRoutingAgent::GetNContacts () const
+{
+  return m_contacts.size ();
+}
+
+uint64_t
+BpCgrRoutingAgent::GetRouteComputations () const
+{
+  return m_computations;
+}
+
+BpEndpointId
+BpCgrRoutingAgent::NodeOf (BpEndpointId eid) const
+{
+  std::map<BpEndpointId, BpEndpointId>::const_iterator it = m_endpoints.find (eid);
+  if (it != m_endpoints.end ())
+    return it->second;
+  if (eid.IsIpnCbhe ())
+    return BpEndpointId (eid.IpnNode (), 0);
+
+  // dtn:node/service or dtn://node/service
+  const std::string &ssp = eid.Ssp ();
+  std::string::size_type begin = ssp.compare (0, 2, "//") == 0 ? 2 : 0;
+  std::string::size_type slash = ssp.find ('/', begin);
+  if (slash == std::string::npos)
+    return eid;
+  return BpEndpointId (eid.Scheme (), ssp.substr (0, slash));
+}
+
+Time
+BpCgrRoutingAgent::TransmitTime (const Contact &contact) const
+{
+  if (contact.rate == 0 || m_expectedBundleSize == 0)
+    return Seconds (0);
+  return Seconds ((double)m_expectedBundleSize / contact.rate);
+}
+
+bool
+BpCgrRoutingAgent::FindRoute (BpEndpointId node, const std::set<uint32_t> &excluded, CgrRoute &route) const
+{
+  // Dijkstra over contacts: the distance of a contact is when a bundle
+  // taking it arrives at its receiving node, and a contact follows
+  // another if it leaves that node after the bundle arrives.
+  typedef std::pair<int64_t, uint32_t> Entry;   /// arrival time step, contact
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+  std::map<uint32_t, Time> arrival;
+  std::map<uint32_t, uint32_t> previous;
+  std::set<uint32_t> done;
+  Time now = Simulator::Now ();
+
+  std::map<BpEndpointId, std::vector<uint32_t> >::const_iterator from = m_contactsFrom.find (m_localEid);
+  if (from == m_contactsFrom.end ())
+    return false;
+  for (std::vector<uint32_t>::const_iterator i = from->second.begin (); i != from->second.end (); i++)
+    {
+      const Contact &c = m_contacts.find (*i)->second;
+      if (excluded.count (*i) || c.to == m_localEid)
+        continue;
+      Time sent = std::max (now, c.start) + TransmitTime (c);
+      if (sent > c.end)
+        continue;
+      arrival[*i] = sent + c.owlt;
+      queue.push (Entry (arrival[*i].GetTimeStep (), *i));
+    }
+
+  while (!queue.empty ())
+    {
+      uint32_t id = queue.top ().second;
+      queue.pop ();
+      if (!done.insert (id).second)
+        continue;
+
+      const Contact &c = m_contacts.find (id)->second;
+      if (c.to == node)
+        {
+          route.contacts.clear ();
+          route.arrival = arrival[id];
+          route.expiry = c.end;
+          for (std::map<uint32_t, uint32_t>::iterator p = previous.find (id); ; p = previous.find (id))
+            {
+              route.contacts.push_back (id);
+              route.expiry = std::min (route.expiry, m_contacts.find (id)->second.end);
+              if (p == previous.end ())
+                break;
+              id = p->second;
+            }
+          std::reverse (route.contacts.begin (), route.contacts.end ());
+          route.nextHop = m_contacts.find (route.contacts.front ())->second.to;
+          return true;
+        }
+
+      from = m_contactsFrom.find (c.to);
+      if (from == m_contactsFrom.end ())
+        continue;
+      for (std::vector<uint32_t>::const_iterator i = from->second.begin (); i != from->second.end (); i++)
+        {
+          const Contact &next = m_contacts.find (*i)->second;
+          if (excluded.count (*i) || done.count (*i) || next.to == m_localEid)
+            continue;
+
+          // no loops: the route so far must not pass the next node
+          bool loop = false;
+          for (uint32_t p = id; !loop; )
+            {
+              loop = m_contacts.find (p)->second.from == next.to;
+              std::map<uint32_t, uint32_t>::iterator q = previous.find (p);
+              if (q == previous.end ())
+                break;
+              p = q->second;
+            }
+          if (loop)
+            continue;
+
+          Time sent = std::max (arrival[id], next.start) + TransmitTime (next);
+          if (sent > next.end)
+            continue;
+          Time arrives = sent + next.owlt;
+          std::map<uint32_t, Time>::iterator a = arrival.find (*i);
+          if (a == arrival.end () || arrives < a->second)
+            {
+              arrival[*i] = arrives;
+              previous[*i] = id;
+              queue.push (Entry (arrives.GetTimeStep (), *i));
+            }
+        }
+    }
+  return false;
+}
+
+const std::vector<BpCgrRoutingAgent::CgrRoute> &
+BpCgrRoutingAgent::GetRoutes (BpEndpointId node)
+{
+  std::map<BpEndpointId, std::vector<CgrRoute> >::iterator it = m_routes.find (node);
+  if (it != m_routes.end ())
+    {
+      // a route found earlier may have run out of time on a contact since
+      bool usable = true;
+      for (std::vector<CgrRoute>::iterator r = it->second.begin (); r != it->second.end () && usable; r++)
+        {
+          usable = CheckRoute (*r);
+        }
+      if (usable)
+        return it->second;
+      NS_LOG_DEBUG ("cached routes to " << node.Uri () << " no longer usable");
+      m_routes.erase (it);
+    }
+
+  // Each route is searched for without the contact that ends first on
+  // the one before, so the routes last past each other's end, and arrive
+  // no earlier.  An empty list is kept too, until the plan changes.
+  m_computations++;
+  std::vector<CgrRoute> &routes = m_routes[node];
+  std::set<uint32_t> excluded;
+  CgrRoute route;
+  while (routes.size () < m_maxRoutes && FindRoute (node, excluded, route))
+    {
+      NS_LOG_DEBUG ("route to " << node.Uri () << " via " << route.nextHop.Uri () << ", " << route.contacts.size ()
+                    << " contacts, arrives at " << route.arrival.GetSeconds () << " s, until " << route.expiry.GetSeconds () << " s");
+      routes.push_back (route);
+      for (std::vector<uint32_t>::iterator c = route.contacts.begin (); c != route.contacts.end (); c++)
+        {
+          if (m_contacts.find (*c)->second.end == route.expiry)
+            {
+              excluded.insert (*c);
+              break;
+            }
+        }
+    }
+  return routes;
+}
+
+bool
+BpCgrRoutingAgent::CheckRoute (CgrRoute &route) const
+{
+  Time now = Simulator::Now ();
+  if (route.expiry <= now)
+    return false;
+  Time arrival = now;
+  for (std::vector<uint32_t>::const_iterator i = route.contacts.begin (); i != route.contacts.end (); i++)
+    {
+      std::map<uint32_t, Contact>::const_iterator c = m_contacts.find (*i);
+      if (c == m_contacts.end ())
+        return false;
+      Time sent = std::max (arrival, c->second.start) + TransmitTime (c->second);
+      if (sent > c->second.end)
+        return false;
+      arrival = sent + c->second.owlt;
+    }
+  route.arrival = arrival;
+  return true;
+}
+
+void
+BpCgrRoutingAgent::InvalidateRoutes (uint32_t id)
+{
+  std::map<BpEndpointId, std::vector<CgrRoute> >::iterator it = m_routes.begin ();
+  while (it != m_routes.end ())
+    {
+      bool uses = false;
+      for (std::vector<CgrRoute>::iterator r = it->second.begin (); r != it->second.end () && !uses; r++)
+        {
+          uses = std::find (r->contacts.begin (), r->contacts.end (), id) != r->contacts.end ();
+        }
+      if (uses)
+        m_routes.erase (it++);
+      else
+        it++;
+    }
+}
+
+bool
+BpCgrRoutingAgent::IsContactOn (BpEndpointId neighbor) const
+{
+  std::map<BpEndpointId, std::vector<uint32_t> >::const_iterator from = m_contactsFrom.find (m_localEid);
+  if (from == m_contactsFrom.end ())
+    return false;
+  Time now = Simulator::Now ();
+  for (std::vector<uint32_t>::const_iterator i = from->second.begin (); i != from->second.end (); i++)
+    {
+      const Contact &c = m_contacts.find (*i)->second;
+      if (c.to == neighbor && c.start <= now && now < c.end)
+        return true;
+    }
+  return false;
+}
+
+void
+BpCgrRoutingAgent::ContactStart (uint32_t id)
+{
+  const Contact &c = m_contacts[id];
+  NS_LOG_FUNCTION (this << " " << id << " " << c.from.Uri () << " " << c.to.Uri ());
+  if (c.from == m_localEid)
+    NotifyNextHopReady (c.to);
+}
+
+void
+BpCgrRoutingAgent::ContactEnd (uint32_t id)
+{
+  NS_LOG_FUNCTION (this << " " << id);
+  InvalidateRoutes (id);
+  std::map<uint32_t, Contact>::iterator it = m_contacts.find (id);
+  BpEndpointId sender = it->second.from;
+  BpEndpointId receiver = it->second.to;
+  std::vector<uint32_t> &from = m_contactsFrom[sender];
+  from.erase (std::find (from.begin (), from.end (), id));
+  if (from.empty ())
+    m_contactsFrom.erase (sender);
+  m_contacts.erase (it);
+
+  // the bundles waiting for the neighbor take the routes left
+  if (sender == m_localEid && !IsContactOn (receiver))
+    {
+      std::map<BpEndpointId, Neighbor>::iterator n = m_neighbors.find (receiver);
+      if (n == m_neighbors.end ())
+        NotifyNextHopDown (receiver, 0, TypeId ());
+      else
+        NotifyNextHopDown (receiver, n->second.cla, n->second.claType);
+    }
+}
+
+BpEndpointId
+BpCgrRoutingAgent::NextHopEid (BpEndpointId &dst)
+{
+  NS_LOG_FUNCTION (this << " " << dst.Uri ());
+  BpEndpointId node = NodeOf (dst);
+  if (node == m_localEid)
+    return BpEndpointId ("dtn:none");
+  const std::vector<CgrRoute> &routes = GetRoutes (node);
+  if (routes.empty ())
+    return BpEndpointId ("dtn:none");
+  return routes.front ().nextHop;
+}
+
+Ptr<BpCla>
+BpCgrRoutingAgent::NextHopCla (BpEndpointId &eid)
+{
+  NS_LOG_FUNCTION (this << " " << eid.Uri ());
+  std::map<BpEndpointId, Neighbor>::iterator it = m_neighbors.find (eid);
+  if (it == m_neighbors.end () || !IsContactOn (eid))
+    return NULL;
+  return it->second.cla;
+}
+
+TypeId
+BpCgrRoutingAgent::NextHopClaType (BpEndpointId &eid)
+{
+  NS_LOG_FUNCTION (this << " " << eid.Uri ());
+  std::map<BpEndpointId, Neighbor>::iterator it = m_neighbors.find (eid);
+  if (it == m_neighbors.end () || !IsContactOn (eid))
+    return TypeId ();
+  return it->second.claType;
+}
+
+InetSocketAddress
+BpCgrRoutingAgent::GetRoute (BpEndpointId eid)
+{
+  NS_LOG_FUNCTION (this << " " << eid.Uri ());
+  BpEndpointId node = NodeOf (eid);
+  if (node != m_localEid)
+    node = NextHopEid (eid);
+  std::map<BpEndpointId, Neighbor>::iterator it = m_neighbors.find (node);
+  if (it == m_neighbors.end ())
+    return InetSocketAddress ("127.0.0.1", 0);
+  return InetSocketAddress (it->second.addr, it->second.port);
+}
+
+} // namespace ns3
@@ -0,0 +1,245 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_CGR_ROUTING_AGENT_H
+#define BP_CGR_ROUTING_AGENT_H
+
+#include "bp-routing-agent.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Contact graph routing agent
+ *
+ * Routes by a contact plan: the times at which each node can send to
+ * another, at what rate and with what one-way light time (OWLT).  The
+ * route to a destination is found by a Dijkstra search over the contacts
+ * for the earliest arrival, and MaxRoutes routes in all are kept for it,
+ * each found again without the contact that ends first on the one before.
+ * The routes are cached per destination node until the plan changes, a
+ * contact they use ends or one no longer leaves time to send
+ * ExpectedBundleSize bytes, so most bundles cost a map lookup.
+ *
+ * Nodes are named by EID: an ipn node by ipn:N.0, a dtn node by its
+ * scheme and SSP up to the first '/'.  Bundles for other endpoints are
+ * routed to the node AddEndpoint () gives them.  Each neighbor of the
+ * local node needs an address and a CLA, given by AddNode ().
+ *
+ * A bundle is sent to the next hop of its best route only while a contact
+ * to that neighbor is on, and waits in the agent otherwise; as each
+ * contact from the local node starts, the agent is told to send the
+ * bundles waiting for that neighbor, and as the last one ends, to route
+ * the bundles still waiting again.  The agent calls the routing agent
+ * for its own node only, so each agent needs its own BpCgrRoutingAgent.
+ */
+class BpCgrRoutingAgent : public BpRoutingAgent
+{
+public:
+  static TypeId GetTypeId (void);
+
+  /**
+   * Constructor
+   */
+  BpCgrRoutingAgent ();
+
+  /**
+   * Destroy
+   */
+  virtual ~BpCgrRoutingAgent ();
+
+  /**
+   * \param eid the EID of the node this agent routes for
+   */
+  void SetLocalEid (BpEndpointId eid);
+
+  /**
+   * \brief Set how a node is reached: the address bundles to it are sent
+   * to, and the type of CLA they are sent on; each agent uses its own CLA
+   * of that type.
+   *
+   * \param node the node EID
+   * \param claType the type of the CLA, e.g. BpTcpCla::GetTypeId ()
+   */
+  void AddNode (BpEndpointId node, Ipv4Address addr, uint16_t port, TypeId claType);
+
+  /**
+   * \brief Set how a node is reached, on a given CLA instance
+   */
+  void AddNode (BpEndpointId node, Ipv4Address addr, uint16_t port, Ptr<BpCla> cla);
+
+  /**
+   * \brief Route bundles for an endpoint to a node, for EIDs that do not
+   * name their node
+   */
+  void AddEndpoint (BpEndpointId eid, BpEndpointId node);
+
+  /**
+   * \brief Add a contact to the plan
+   *
+   * \param start when the contact starts, in simulation time
+   * \param end when it ends
+   * \param rate bytes per second, or 0 to ignore transmission time
+   * \param owlt the one-way light time
+   * \return the id of the contact
+   */
+  uint32_t AddContact (BpEndpointId from, BpEndpointId to, Time start, Time end, uint64_t rate, Time owlt);
+
+  /**
+   * \brief Remove a contact from the plan
+   *
+   * \return 0 on success, -1 if there is no such contact
+   */
+  int RemoveContact (uint32_t id);
+
+  /**
+   * \brief Add the contacts of a contact plan file.  Each line is
+   *
+   *   from to start end rate owlt
+   *
+   * where from and to are EIDs or ipn node numbers, start, end and owlt are
+   * seconds and rate is bytes per second.  Blank lines and text after '#'
+   * are skipped.
+   *
+   * \return 0 on success, -1 if the file cannot be read or a line is
+   * malformed, in which case no contact is added
+   */
+  int LoadContactPlan (std::string filename);
+
+  /**
+   * \brief Remove every contact
+   */
+  void ClearContactPlan ();
+
+  /**
+   * \return the number of contacts in the plan that have not ended
+   */
+  uint32_t GetNContacts () const;
+
+  /**
+   * \return the number of times routes were computed for a destination,
+   * to see how often the cache is missed
+   */
+  uint64_t GetRouteComputations () const;
+
+  virtual BpEndpointId NextHopEid (BpEndpointId &dst);
+  virtual Ptr<BpCla> NextHopCla (BpEndpointId &eid);
+  virtual TypeId NextHopClaType (BpEndpointId &eid);
+
+  /**
+   *  \return the address of the local node for its own endpoints, or of
+   *  the next hop to eid; if there is none, return 127.0.0.1 with port 0
+   */
+  virtual InetSocketAddress GetRoute (BpEndpointId eid);
+
+protected:
+
+  virtual void DoDispose (void);
+
+private:
+
+  struct Contact {
+    BpEndpointId from;
+    BpEndpointId to;
+    Time start;
+    Time end;
+    uint64_t rate;                   /// bytes per second, 0 for no limit
+    Time owlt;
+    EventId startEvent;
+    EventId endEvent;
+  };
+
+  struct Neighbor {
+    Ipv4Address addr;
+    uint16_t port;
+    Ptr<BpCla> cla;
+    TypeId claType;
+  };
+
+  struct CgrRoute {
+    BpEndpointId nextHop;
+    Time arrival;                    /// of a bundle sent when the route was found
+    Time expiry;                     /// end of the first contact of the route to end
+    std::vector<uint32_t> contacts;  /// in the order taken
+  };
+
+  /**
+   * \return the node that takes bundles for an endpoint
+   */
+  BpEndpointId NodeOf (BpEndpointId eid) const;
+
+  /**
+   * \return the routes to a node, best first, found if they are not cached;
+   * empty if there are none
+   */
+  const std::vector<CgrRoute> &GetRoutes (BpEndpointId node);
+
+  /**
+   * Search for the route of earliest arrival to a node that takes none of
+   * the excluded contacts.
+   *
+   * \return false if there is none
+   */
+  bool FindRoute (BpEndpointId node, const std::set<uint32_t> &excluded, CgrRoute &route) const;
+
+  /**
+   * Check that a bundle sent now can still take each contact of a route,
+   * and set its arrival.
+   *
+   * \return false if a contact is gone or ends too soon
+   */
+  bool CheckRoute (CgrRoute &route) const;
+
+  /**
+   * \return the time to send ExpectedBundleSize bytes on a contact
+   */
+  Time TransmitTime (const Contact &contact) const;
+
+  /**
+   * \return whether a contact from the local node to a neighbor is on
+   */
+  bool IsContactOn (BpEndpointId neighbor) const;
+
+  void ContactStart (uint32_t id);
+  void ContactEnd (uint32_t id);
+
+  /**
+   * Drop the cached routes that take a contact.
+   */
+  void InvalidateRoutes (uint32_t id);
+
+  uint32_t m_maxRoutes;              /// MaxRoutes attribute
+  uint32_t m_expectedBundleSize;     /// ExpectedBundleSize attribute
+
+  BpEndpointId m_localEid;
+  std::map<BpEndpointId, Neighbor> m_neighbors;
+  std::map<BpEndpointId, BpEndpointId> m_endpoints;  /// node of each endpoint
+  std::map<uint32_t, Contact> m_contacts;
+  std::map<BpEndpointId, std::vector<uint32_t> > m_contactsFrom;  /// contact ids by sending node
+  uint32_t m_nextContact;
+
+  std::map<BpEndpointId, std::vector<CgrRoute> > m_routes;  /// by destination node
+  uint64_t m_computations;
+};
+
+}  // namespace ns3
+
+#endif /* BP_CGR_ROUTING_AGENT_H */
@@ -24,11 +24,88 @@
 #include "bp-header-6.h"
 #include "bp-block-header-6.h"
 #include "codec.h"
+#include "cbor-buffer.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include <cstdlib>
 
 NS_LOG_COMPONENT_DEFINE ("BpCla");
 
 namespace ns3 {
 
+namespace {
+
+/**
+ * \brief The initial bytes of one CBOR data item (major type and argument),
+ * so that the framing around a BPv7 bundle can be added to and removed from
+ * a packet as a header, without touching the data that follows it.
+ */
+class CborItemHead : public Header
+{
+public:
+  /// additional information value marking an indefinite-length item
+  static const uint8_t INDEFINITE = 31;
+
+  CborItemHead (CborLite::Tag major = CborLite::Major::unsignedInteger, uint64_t value = 0, bool indefinite = false)
+    : m_major (major), m_value (value), m_indefinite (indefinite)
+    {
+    }
+
+  static TypeId GetTypeId (void)
+    {
+      static TypeId tid = TypeId ("ns3::CborItemHead")
+        .SetParent<Header> ()
+        .AddConstructor<CborItemHead> ()
+      ;
+      return tid;
+    }
+
+  virtual TypeId GetInstanceTypeId (void) const { return GetTypeId (); }
+  virtual void Print (std::ostream &os) const { os << "major " << (m_major >> 5) << " value " << m_value; }
+
+  virtual uint32_t GetSerializedSize (void) const
+    {
+      if (m_indefinite) return 1;
+      CborSizeCounter out;
+      return CborLite::encodeTagAndValue (out, m_major, m_value);
+    }
+
+  virtual void Serialize (Buffer::Iterator start) const
+    {
+      if (m_indefinite)
+        {
+          start.WriteU8 (m_major | INDEFINITE);
+          return;
+        }
+      CborBufferWriter out (start);
+      CborLite::encodeTagAndValue (out, m_major, m_value);
+    }
+
+  virtual uint32_t Deserialize (Buffer::Iterator start)
+    {
+      Buffer::Iterator peek = start;
+      uint8_t initial = peek.ReadU8 ();
+      m_indefinite = (initial & CborLite::Minor::mask) == INDEFINITE;
+      if (m_indefinite)
+        {
+          m_major = initial & CborLite::Major::mask;
+          m_value = 0;
+          return 1;
+        }
+      CborBufferReader pos (start);
+      return CborLite::decodeTagAndValue (pos, CborBufferReader::End (start), m_major, m_value);
+    }
+
+  CborLite::Tag m_major;
+  uint64_t m_value;
+  bool m_indefinite;
+};
+
+/// first byte of an encoded BPv7 bundle (start of an indefinite-length array)
+const uint8_t BPV7_BUNDLE_START = CborLite::Major::array | CborItemHead::INDEFINITE;
+
+} // anonymous namespace
+
 NS_OBJECT_ENSURE_REGISTERED (BpCla);
 
 TypeId 
@@ -36,12 +113,39 @@ BpCla::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::BpCla")
     .SetParent<Object> ()
+    .AddAttribute ("TxQueueBytes", "Bytes queued for one sending socket at which the CLA stops being ready, or 0 for no limit",
+                   UintegerValue (1 << 20),
+                   MakeUintegerAccessor (&BpCla::m_txQueueLimit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Ready", "Whether the CLA has contact; set to make a CLA ready as it is created",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&BpCla::SetReady),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
 
+bool
+BpCla::LookupType (std::string name, TypeId *tid)
+{
+  TypeId found;
+  if (!TypeId::LookupByNameFailSafe (name, &found)
+      && !TypeId::LookupByNameFailSafe ("ns3::" + name, &found)
+      && !TypeId::LookupByNameFailSafe ("ns3::Bp" + name + "Cla", &found))
+    return false;
+  if (found == BpCla::GetTypeId () || !found.IsChildOf (BpCla::GetTypeId ()))
+    return false;
+  *tid = found;
+  return true;
+}
+
 BpCla::BpCla (Callback<void, Ptr<Bundle>> processBundleCallback)
-: m_ready(false),
+: m_maxBundleSize(0),
+  m_duplex(false),
+  m_ready(false),
+  m_blocked(false),
+  m_draining(false),
+  m_txQueueLimit(1 << 20),
   m_cbhe(false),
   m_processBundleCallback(processBundleCallback)
 {
@@ -53,6 +157,16 @@ BpCla::~BpCla ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+BpCla::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_txQueues.clear ();
+  m_l4SendSockets.clear ();
+  m_l4RecvSockets.clear ();
+  Object::DoDispose ();
+}
+
 int 
 BpCla::EnableSend (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode)
 { 
@@ -65,23 +179,9 @@ BpCla::EnableSend (const BpEndpointId &src, const BpEndpointId &dst, InetSocketA
       return -1;
     }
 
-  // create socket
-  Ptr<Socket> socket = Socket::CreateSocket (bpNode, GetSocketTypeId());
-  if (socket->Bind () < 0) {
-    NS_LOG_DEBUG ("BpCla::EnableSend (): Bind");
-    return -1;
-  }
-  if (socket->Connect (dstAddress) < 0) {
-    NS_LOG_DEBUG ("BpCla::EnableSend (): Connect");
+  Ptr<Socket> socket = OpenSendSocket (dstAddress, bpNode);
+  if (socket == NULL)
     return -1;
-  }
-  if (socket->ShutdownRecv () < 0) {
-    NS_LOG_DEBUG ("BpCla::EnableSend (): ShutdownRecv");
-    return -1;
-  }
-
-  socket->SetIpTos(m_tos);
-  SetL4SocketCallbacks (socket);
 
   // store the sending socket so that the convergence layer can dispatch the bundles to different sockets
   std::map<BpEndpointId, Ptr<Socket> >::iterator it = m_l4SendSockets.end ();
@@ -94,15 +194,44 @@ BpCla::EnableSend (const BpEndpointId &src, const BpEndpointId &dst, InetSocketA
   return 0;
 }
 
+Ptr<Socket>
+BpCla::OpenSendSocket (InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
+  NS_LOG_FUNCTION (this);
+  // create socket
+  Ptr<Socket> socket = Socket::CreateSocket (bpNode, GetSocketTypeId());
+  if (socket->Bind () < 0) {
+    NS_LOG_DEBUG ("BpCla::OpenSendSocket (): Bind");
+    return NULL;
+  }
+  if (socket->Connect (dstAddress) < 0) {
+    NS_LOG_DEBUG ("BpCla::OpenSendSocket (): Connect");
+    return NULL;
+  }
+  if (!m_duplex && socket->ShutdownRecv () < 0) {
+    NS_LOG_DEBUG ("BpCla::OpenSendSocket (): ShutdownRecv");
+    return NULL;
+  }
+
+  socket->SetIpTos(m_tos);
+  SetL4SocketCallbacks (socket);
+
+  return socket;
+}
+
 Ptr<Socket>
 BpCla::GetL4Socket (Ptr<Packet> packet, InetSocketAddress dstAddress, Ptr<Node> bpNode)
 { 
   NS_LOG_FUNCTION (this << " " << packet);
   BpHeader6 bph (m_cbhe);
   packet->PeekHeader (bph);
-  BpEndpointId dst = bph.GetDestinationEid ();
-  BpEndpointId src = bph.GetSourceEid ();
+  return GetL4Socket (bph.GetSourceEid (), bph.GetDestinationEid (), dstAddress, bpNode);
+}
 
+Ptr<Socket>
+BpCla::GetL4Socket (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{ 
+  NS_LOG_FUNCTION (this << " " << src.Uri () << " " << dst.Uri ());
   std::map<BpEndpointId, Ptr<Socket> >::iterator it = m_l4SendSockets.end ();
   it = m_l4SendSockets.find (src);
   if (it == m_l4SendSockets.end ())
@@ -128,35 +257,79 @@ BpCla::SendPacket (Ptr<Packet> packet, InetSocketAddress dstAddress, Ptr<Node> b
   if ( socket == NULL)
     return -1;
 
-  socket->Send (packet);
-  return 0;
+  return Transmit (socket, packet);
 }
 
 int
 BpCla::SendBundle (Ptr<Bundle6> bundle, InetSocketAddress dstAddress, Ptr<Node> bpNode)
 {
-  // pTODO cbhe encode here
+  BpHeader6 *bph = bundle->GetPrimaryHeader();
+  BpFragmentHeader6 fragment (*bph);
+  fragment.SetFragment (bph->GetFragOffset(), bundle->m_adu->GetSize(), bph->IsFragment());
+  return SendBundle (bundle, fragment, dstAddress, bpNode);
+}
 
+int
+BpCla::SendBundle (Ptr<Bundle6> bundle, const BpFragmentHeader6 &fragment, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
   BpHeader6 *bph = bundle->GetPrimaryHeader();
-  BpBlockHeader6 *bpph = bundle->GetPayloadHeader();
-  uint32_t size = bph->GetBlockLength();
+  uint32_t size = fragment.GetBlockLength();
 
   NS_LOG_FUNCTION (this << " " << bundle << " size " << size);
 
-  Ptr<Packet> p = bundle->m_adu->CreateFragment(bph->GetFragOffset(), size);  
-  p->AddHeader(*bpph);
-  NS_LOG_FUNCTION("size after payload header: " << p->GetSize());
-  p->AddHeader(*bph);
-  NS_LOG_FUNCTION("size after BP header: " << p->GetSize());
+  Ptr<Packet> p = SerializeBundle(bundle, fragment);
 
   NS_LOG_DEBUG("Send bundle" << " seq " << bph->GetSequenceNumber().GetValue() <<
                " src eid " << bph->GetSourceEid().Uri() <<
                " dst eid " << bph->GetDestinationEid().Uri() <<
                " size " << p->GetSize() << " bytes with " << size << " payload bytes");
-  NS_LOG_DEBUG(" fragment: " << ((bph->IsFragment())?"yes":"no"));
+  NS_LOG_DEBUG(" fragment: " << ((fragment.IsFragment())?"yes":"no") << " offset " << fragment.GetFragOffset());
 
-  SendPacket(p, dstAddress, bpNode);
-  return 0;
+  // The EIDs are at hand here, so look up the socket directly rather than
+  // decoding the header back out of the packet in SendPacket ().
+  Ptr<Socket> socket = GetL4Socket (bph->GetSourceEid (), bph->GetDestinationEid (), dstAddress, bpNode);
+  if (socket == NULL)
+    return -1;
+
+  return Transmit (socket, p);
+}
+
+int
+BpCla::SendBundle (Ptr<Bundle7> bundle, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
+  BpHeader7 *bph = bundle->GetPrimaryHeader();
+  BpFragmentHeader7 fragment (*bph);
+  fragment.SetFragment (bph->GetFragOffset(), bundle->m_adu->GetSize(), bph->IsFragment());
+  return SendBundle (bundle, fragment, dstAddress, bpNode);
+}
+
+int
+BpCla::SendBundle (Ptr<Bundle7> bundle, const BpFragmentHeader7 &fragment, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
+  BpHeader7 *bph = bundle->GetPrimaryHeader();
+  uint32_t size = fragment.GetBlockLength();
+
+  NS_LOG_FUNCTION (this << " " << bundle << " size " << size);
+
+  Ptr<Packet> p = SerializeBundle(bundle, fragment);
+
+  NS_LOG_DEBUG("Send bundle" << " seq " << bph->GetSequenceNumber().GetValue() <<
+               " src eid " << bph->GetSourceEid().Uri() <<
+               " dst eid " << bph->GetDestinationEid().Uri() <<
+               " size " << p->GetSize() << " bytes with " << size << " payload bytes");
+  NS_LOG_DEBUG(" fragment: " << ((fragment.IsFragment())?"yes":"no") << " offset " << fragment.GetFragOffset());
+
+  Ptr<Socket> socket = GetL4Socket (bph->GetSourceEid (), bph->GetDestinationEid (), dstAddress, bpNode);
+  if (socket == NULL)
+    return -1;
+
+  return Transmit (socket, p);
+}
+
+uint32_t
+BpCla::GetMaxBundleSize () const
+{
+  return m_maxBundleSize;
 }
 
 int
@@ -182,12 +355,14 @@ void
 BpCla::NormalClose (Ptr<Socket> socket)
 { 
   NS_LOG_FUNCTION (this << " " << socket);
+  FlushTxQueue (socket);
 }
 
 void 
 BpCla::ErrorClose (Ptr<Socket> socket)
 { 
   NS_LOG_FUNCTION (this << " " << socket);
+  FlushTxQueue (socket);
 }
 
 void 
@@ -200,51 +375,267 @@ void
 BpCla::Sent (Ptr<Socket> socket, uint32_t size)
 { 
   NS_LOG_FUNCTION (this << " " << socket << " " << size);
+  // The socket has room again; sockets may also call this from within
+  // their Send (), while Drain () is already sending.
+  if (m_draining)
+    return;
+  Drain (socket);
+  CheckUnblocked ();
+}
+
+int
+BpCla::Transmit (Ptr<Socket> socket, Ptr<Packet> bundle)
+{
+  return Enqueue (socket, bundle);
+}
+
+int
+BpCla::Enqueue (Ptr<Socket> socket, Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << " " << socket << " " << packet->GetSize ());
+  TxQueue &queue = m_txQueues[socket];
+  if (socket->GetSocketType () != Socket::NS3_SOCK_STREAM && queue.packets.empty () && !queue.held && !m_draining)
+    {
+      // A datagram socket takes or refuses the packet at once, so tell the
+      // caller, which keeps the bundle, rather than drop it in Drain ().
+      if (socket->Send (packet) < 0)
+        {
+          NS_LOG_WARN ("socket refused a " << packet->GetSize () << " byte datagram, errno " << socket->GetErrno ());
+          return -1;
+        }
+      return 0;
+    }
+  queue.packets.push_back (packet);
+  queue.bytes += packet->GetSize ();
+  Drain (socket);
+  if (m_txQueueLimit != 0 && queue.bytes >= m_txQueueLimit)
+    {
+      NS_LOG_DEBUG ("transmit queue full with " << queue.bytes << " bytes");
+      m_blocked = true;
+    }
+  return 0;
+}
+
+void
+BpCla::Drain (Ptr<Socket> socket)
+{
+  std::map<Ptr<Socket>, TxQueue>::iterator it = m_txQueues.find (socket);
+  if (it == m_txQueues.end () || it->second.held || m_draining)
+    return;
+  TxQueue &queue = it->second;
+  bool stream = socket->GetSocketType () == Socket::NS3_SOCK_STREAM;
+
+  m_draining = true;
+  while (!queue.packets.empty ())
+    {
+      Ptr<Packet> p = queue.packets.front ();
+      if (stream)
+        {
+          uint32_t room = socket->GetTxAvailable ();
+          if (room == 0)
+            break;
+          if (p->GetSize () > room)
+            {
+              // A stream carries the bytes in order however they are split.
+              if (socket->Send (p->CreateFragment (0, room)) < 0)
+                break;
+              queue.packets.front () = p->CreateFragment (room, p->GetSize () - room);
+              queue.bytes -= room;
+              continue;
+            }
+          if (socket->Send (p) < 0)
+            break;
+        }
+      else if (socket->Send (p) < 0)
+        {
+          // A datagram socket takes or refuses each packet at once.
+          NS_LOG_WARN ("socket refused a " << p->GetSize () << " byte datagram, errno " << socket->GetErrno ());
+        }
+      queue.packets.pop_front ();
+      queue.bytes -= p->GetSize ();
+    }
+  m_draining = false;
+  NS_LOG_DEBUG ("transmit queue " << queue.bytes << " bytes in " << queue.packets.size () << " packets");
+}
+
+void
+BpCla::HoldTxQueue (Ptr<Socket> socket, bool hold)
+{
+  NS_LOG_FUNCTION (this << " " << socket << " " << hold);
+  m_txQueues[socket].held = hold;
+  if (!hold)
+    {
+      Drain (socket);
+      CheckUnblocked ();
+    }
+}
+
+void
+BpCla::FlushTxQueue (Ptr<Socket> socket)
+{
+  std::map<Ptr<Socket>, TxQueue>::iterator it = m_txQueues.find (socket);
+  if (it == m_txQueues.end ())
+    return;
+  if (it->second.bytes != 0)
+    NS_LOG_WARN ("dropping " << it->second.bytes << " queued bytes of a closed socket");
+  m_txQueues.erase (it);
+  CheckUnblocked ();
+}
+
+bool
+BpCla::TxQueueFull () const
+{
+  if (m_txQueueLimit == 0)
+    return false;
+  std::map<Ptr<Socket>, TxQueue>::const_iterator it;
+  for (it = m_txQueues.begin (); it != m_txQueues.end (); it++)
+    {
+      if (it->second.bytes >= m_txQueueLimit)
+        return true;
+    }
+  return false;
+}
+
+void
+BpCla::CheckUnblocked ()
+{
+  if (!m_blocked || TxQueueFull ())
+    return;
+  NS_LOG_DEBUG ("transmit queues have room again");
+  m_blocked = false;
+  NotifyReady ();
+}
+
+uint32_t
+BpCla::GetTxQueueLimit () const
+{
+  return m_txQueueLimit;
+}
+
+void
+BpCla::NotifyReady ()
+{
+  if (IsReady () && !m_readyCallback.IsNull ())
+    m_readyCallback (this);
+}
+
+uint64_t
+BpCla::GetTxQueueBytes (Ptr<Socket> socket) const
+{
+  std::map<Ptr<Socket>, TxQueue>::const_iterator it = m_txQueues.find (socket);
+  return it == m_txQueues.end () ? 0 : it->second.bytes;
+}
+
+uint64_t
+BpCla::GetTxQueueBytes () const
+{
+  uint64_t bytes = 0;
+  std::map<Ptr<Socket>, TxQueue>::const_iterator it;
+  for (it = m_txQueues.begin (); it != m_txQueues.end (); it++)
+    bytes += it->second.bytes;
+  return bytes;
 }
 
 void 
 BpCla::DataRecv (Ptr<Socket> socket)
 { 
-  // pTODO cbhe decode here
-
   NS_LOG_FUNCTION (this << " " << socket);
   Ptr<Packet> packet;
   Address from;
   while ((packet = socket->RecvFrom (from)))
   {
-    NS_LOG_DEBUG ("DataRecv size (before header removal) " << packet->GetSize());
     // In this CLA there is one bundle per packet.
-    BpHeader6 *bpHeader = new BpHeader6(m_cbhe);
-    BpBlockHeader6 *bppHeader = new BpBlockHeader6(BpBlockHeader6::BUNDLE_PAYLOAD_BLOCK);
+    ProcessReceivedBundle (packet);
+  }
+}
 
-    packet->RemoveHeader(*bpHeader);
-    NS_LOG_DEBUG ("DataRecv size (after BP header removal) " << packet->GetSize());
-    packet->RemoveHeader(*bppHeader);
-    NS_LOG_DEBUG ("DataRecv size (after payload header removal) " << packet->GetSize());
+void
+BpCla::ProcessReceivedBundle (Ptr<Packet> packet)
+{
+  // pTODO cbhe decode here
 
-    NS_LOG_DEBUG ("Recv bundle:" << " seq " << bpHeader->GetSequenceNumber().GetValue() <<
-                  " src eid " << bpHeader->GetSourceEid().Uri() <<
-                  " dst eid " << bpHeader->GetDestinationEid().Uri() <<
-                  " packet size " << packet->GetSize ());
+  NS_LOG_DEBUG ("DataRecv size (before header removal) " << packet->GetSize());
 
-    // pTODO maybe use a template in the CLA class so instead of "Bundle6" we use "T"
-    // then when we create a CLA we tell it to use either v6 or v7 bundles
-    // note: may need to also specificy the Header and BlockHeader as v6 or v7 in template
-    Ptr<Bundle6> b = Create<Bundle6>(packet);
-    b->SetPrimaryHeader(bpHeader);
-    b->SetPayloadHeader(bppHeader);
+  // A BPv7 bundle is a CBOR indefinite-length array, while a BPv6 bundle
+  // starts with its version byte, so the first byte tells them apart.
+  uint8_t initial = 0;
+  packet->CopyData (&initial, 1);
+  if (initial == BPV7_BUNDLE_START)
+    {
+      Ptr<Bundle7> b = DeserializeBundle (packet);
+      if (b == 0)
+        {
+          NS_LOG_WARN ("BpCla::ProcessReceivedBundle (): dropping a malformed bundle");
+          return;
+        }
+      BpHeader7 *bpHeader = b->GetPrimaryHeader ();
+      NS_LOG_DEBUG ("Recv bundle:" << " seq " << bpHeader->GetSequenceNumber().GetValue() <<
+                    " src eid " << bpHeader->GetSourceEid().Uri() <<
+                    " dst eid " << bpHeader->GetDestinationEid().Uri() <<
+                    " payload size " << b->m_adu->GetSize ());
+      m_processBundleCallback (b);
+      return;
+    }
 
-    NS_LOG_DEBUG(" fragment: " << ((bpHeader->IsFragment())?"yes":"no") << " offset " << bpHeader->GetFragOffset());
+  BpHeader6 *bpHeader = new BpHeader6(m_cbhe);
+  BpBlockHeader6 *bppHeader = new BpBlockHeader6(BpBlockHeader6::BUNDLE_PAYLOAD_BLOCK);
 
-    // pTODO: maybe make callback to a process packet call in bp-agent (this would be an alternative to 
-    // using a template here to build bundle from packet)
-    m_processBundleCallback(b);
+  packet->RemoveHeader(*bpHeader);
+  NS_LOG_DEBUG ("DataRecv size (after BP header removal) " << packet->GetSize());
+  // A CTEB, if there is one, comes before the payload block.
+  CTEB cteb;
+  bool ctebPresent = false;
+  uint8_t blockType = 0;
+  if (packet->CopyData(&blockType, 1) == 1 && blockType == CTEB::BLOCK_TYPE) {
+    packet->RemoveHeader(cteb);
+    ctebPresent = true;
   }
+  packet->RemoveHeader(*bppHeader);
+  NS_LOG_DEBUG ("DataRecv size (after payload header removal) " << packet->GetSize());
+
+  NS_LOG_DEBUG ("Recv bundle:" << " seq " << bpHeader->GetSequenceNumber().GetValue() <<
+                " src eid " << bpHeader->GetSourceEid().Uri() <<
+                " dst eid " << bpHeader->GetDestinationEid().Uri() <<
+                " packet size " << packet->GetSize ());
+
+  // pTODO maybe use a template in the CLA class so instead of "Bundle6" we use "T"
+  // then when we create a CLA we tell it to use either v6 or v7 bundles
+  // note: may need to also specificy the Header and BlockHeader as v6 or v7 in template
+  Ptr<Bundle6> b = Create<Bundle6>(packet);
+  b->SetPrimaryHeader(bpHeader);
+  b->SetPayloadHeader(bppHeader);
+  b->ctebPresent = ctebPresent;
+  b->cteb = cteb;
+
+  NS_LOG_DEBUG(" fragment: " << ((bpHeader->IsFragment())?"yes":"no") << " offset " << bpHeader->GetFragOffset());
+
+  // pTODO: maybe make callback to a process packet call in bp-agent (this would be an alternative to 
+  // using a template here to build bundle from packet)
+  m_processBundleCallback(b);
+}
+
+void
+BpCla::ReceiveBundle (Ptr<Bundle> bundle)
+{
+  m_processBundleCallback (bundle);
 }
 
 void 
 BpCla::SetReady(bool ready) {
+  bool wasReady = IsReady();
   m_ready = ready; 
+  if (IsReady() && !wasReady && !m_readyCallback.IsNull())
+    m_readyCallback(this);
+}
+
+void
+BpCla::SetReadyCallback(Callback<void, Ptr<BpCla>> cb) {
+  m_readyCallback = cb;
+}
+
+void
+BpCla::SetProcessBundleCallback(Callback<void, Ptr<Bundle>> cb) {
+  m_processBundleCallback = cb;
 }
 
 void
@@ -258,54 +649,78 @@ BpCla::UsesCbhe() {
 }
 
 Ptr<Packet>
-BpCla::SerializeBundle(Ptr<Bundle7> bundle){
+BpCla::SerializeBundle(Ptr<Bundle6> bundle, const BpFragmentHeader6 &fragment){
+  // pTODO cbhe encode here
 
-  BpHeader7 *bph = bundle->GetPrimaryHeader();
-  BpBlockHeader7 *bpph = bundle->GetPayloadHeader();
-  uint32_t size  = bph->GetBlockLength();
-  uint32_t headerSize = 1 + bph->GetSerializedSize() + bpph->GetSerializedSize(); // Byte lenght of  headers + initial byte for encoding
-  
-  Buffer data(0);
-  data.AddAtStart(headerSize);
-  Buffer::Iterator i = data.Begin();
+  BpHeader6 *bph = bundle->GetPrimaryHeader();
+  uint32_t size = fragment.GetBlockLength();
+
+  // The stored ADU starts at the stored header's fragment offset.
+  Ptr<Packet> p = bundle->m_adu->CreateFragment(fragment.GetFragOffset() - bph->GetFragOffset(), size);  
+  BpBlockHeader6 bpph = *bundle->GetPayloadHeader();
+  bpph.SetBlockLength(size);
+  p->AddHeader(bpph);
+  if (bundle->ctebPresent)
+    p->AddHeader(bundle->cteb);
+  p->AddHeader(fragment);
+  return p;
+}
 
-  i.WriteU8(0x9f);
+Ptr<Packet>
+BpCla::SerializeBundle(Ptr<Bundle7> bundle){
+  BpHeader7 *bph = bundle->GetPrimaryHeader();
+  BpFragmentHeader7 fragment (*bph);
+  fragment.SetFragment (bph->GetFragOffset(), bundle->m_adu->GetSize(), bph->IsFragment());
+  return SerializeBundle (bundle, fragment);
+}
 
-  // Encode Headers
-  bph->Serialize(i);
-  i.Next(bph->GetSerializedSize());
-  bpph->Serialize(i);
-  i.Next(bpph->GetSerializedSize());
+Ptr<Packet>
+BpCla::SerializeBundle(Ptr<Bundle7> bundle, const BpFragmentHeader7 &fragment){
 
-  std::vector<uint8_t> temp;
+  BpHeader7 *bph = bundle->GetPrimaryHeader();
+  BpBlockHeader7 *bpph = bundle->GetPayloadHeader();
+  uint32_t size  = fragment.GetBlockLength();
 
-  // Encode Adu
-  Ptr<Packet> p = bundle->m_adu->CreateFragment(bph->GetFragOffset(), size); 
-  uint8_t buf[size];
-  std::string adu;
-  p->CopyData(&buf[0],size);
-  for (auto elem : buf) adu.push_back(elem);
-  size_t length = CborLite::encodeBytes(temp, adu);
+  // The payload is a fragment of the ADU, so its bytes are shared rather
+  // than copied; the CBOR framing is added around it as headers.  The
+  // stored ADU starts at the stored header's fragment offset.
+  Ptr<Packet> p = bundle->m_adu->CreateFragment(fragment.GetFragOffset() - bph->GetFragOffset(), size); 
+  p->AddHeader(CborItemHead(CborLite::Major::byteString, size));
+  p->AddHeader(*bpph);
+  p->AddHeader(fragment);
+  p->AddHeader(CborItemHead(CborLite::Major::array, 0, true));
 
-  // Encode CRC
+  // Encode CRC and the break that closes the indefinite array
+  std::vector<uint8_t> tail;
   if (bpph->BlockCrcType() != 0){
     std::string crcStr = std::to_string(bpph->BlockCrc());
-    length += CborLite::encodeBytes(temp, crcStr);       
+    CborLite::encodeBytes(tail, crcStr);       
   }
+  tail.push_back(0xff);
+  p->AddAtEnd(Create<Packet>(tail.data(), tail.size()));
 
-  //Increase buffer size by byte lenght of (adu + block CRC + final byte for encoding)
-  data.AddAtEnd(length+1); 
-  i = data.Begin();
-  i.Next(headerSize);
+  return p;
+}
 
-  for(uint32_t k = 0; k < temp.size (); k++)  i.WriteU8(temp.at(k));
-  i.WriteU8(0xff);
+uint32_t
+BpCla::GetSerializedBundleSize(Ptr<Bundle6> bundle, const BpFragmentHeader6 &fragment){
+  BpBlockHeader6 bpph = *bundle->GetPayloadHeader();
+  bpph.SetBlockLength(fragment.GetBlockLength());
+  uint32_t ctebSize = bundle->ctebPresent ? bundle->cteb.GetSerializedSize() : 0;
+  return fragment.GetSerializedSize() + ctebSize + bpph.GetSerializedSize() + fragment.GetBlockLength();
+}
 
-  // Initialize Packet
-  length = data.GetSize();
-  uint8_t buffer[length];
-  data.CopyData(&buffer[0], length);
-  return Create<Packet>(&buffer[0], length);
+uint32_t
+BpCla::GetSerializedBundleSize(Ptr<Bundle7> bundle, const BpFragmentHeader7 &fragment){
+  BpBlockHeader7 *bpph = bundle->GetPayloadHeader();
+  uint32_t size = fragment.GetBlockLength();
+  uint32_t length = 1 + fragment.GetSerializedSize() + bpph->GetSerializedSize()
+    + CborItemHead(CborLite::Major::byteString, size).GetSerializedSize() + size + 1;
+  if (bpph->BlockCrcType() != 0){
+    CborSizeCounter out;
+    length += CborLite::encodeBytes(out, std::to_string(bpph->BlockCrc()));
+  }
+  return length;
 }
 
 Ptr<Bundle7>
@@ -314,31 +729,46 @@ BpCla::DeserializeBundle(Ptr<Packet> packet){
   BpHeader7 *bpHeader = new BpHeader7(false);  //TODO use bool var m_cbhe
   BpBlockHeader7 *bppHeader = new BpBlockHeader7(BpBlockHeader7::BUNDLE_PAYLOAD_BLOCK);  
 
-  packet->RemoveAtStart(1);
-  packet->RemoveAtEnd(1);
-  packet->RemoveHeader(*bpHeader);
-  packet->RemoveHeader(*bppHeader);
+  // The input comes off the network, so every length is checked against
+  // what is left of the packet, and a decoder running out of input throws.
+  CborItemHead head;
+  Ptr<Packet> p;
+  try {
+    if (packet->GetSize() < 1 || (packet->RemoveHeader(head), !head.m_indefinite || head.m_major != CborLite::Major::array))
+      throw CborLite::Exception("bundle is not an indefinite array");
+    packet->RemoveHeader(*bpHeader);
+    packet->RemoveHeader(*bppHeader);
 
-  // Copy adu and CRC for decoding
-  size_t size = packet->GetSize();
-  uint8_t buffer[size];
-  packet->CopyData(buffer, size);
-  std::vector<uint8_t> encodedContent;
-  for (auto elem : buffer) encodedContent.push_back(elem);
-
-  auto pos = begin(encodedContent);
-  auto stop = end(encodedContent);
-  std::string strAdu, strCrc;
-  size_t len = CborLite::decodeBytes(pos, stop, strAdu);
-  if(bppHeader->BlockCrc() != 0){
-    len += CborLite::decodeBytes(pos, stop, strCrc);
-    bppHeader->SetBlockCrc(stoi(strCrc, 0, 16));
+    // The ADU is a fragment of the received packet; nothing is copied.
+    if (packet->GetSize() < 1 || (packet->RemoveHeader(head), head.m_major != CborLite::Major::byteString || head.m_indefinite))
+      throw CborLite::Exception("payload is not a byte string");
+    if (head.m_value > packet->GetSize())
+      throw CborLite::Exception("payload longer than the bundle");
+    uint32_t size = head.m_value;
+    p = packet->CreateFragment(0, size);
+    packet->RemoveAtStart(size);
+
+    if(bppHeader->BlockCrcType() != 0){
+      if (packet->GetSize() < 1 || (packet->RemoveHeader(head), head.m_major != CborLite::Major::byteString || head.m_indefinite))
+        throw CborLite::Exception("CRC is not a byte string");
+      if (head.m_value > packet->GetSize())
+        throw CborLite::Exception("CRC longer than the bundle");
+      std::string strCrc(head.m_value, '\0');
+      packet->CopyData(reinterpret_cast<uint8_t *>(&strCrc[0]), head.m_value);
+      packet->RemoveAtStart(head.m_value);
+      bppHeader->SetBlockCrc(strtoull(strCrc.c_str(), NULL, 10));
+    }
+    if (packet->GetSize() < 1)
+      throw CborLite::Exception("no break closing the bundle");
+    packet->RemoveAtStart(1);  // break closing the indefinite array
+  } catch (const CborLite::Exception &e) {
+    NS_LOG_WARN("BpCla::DeserializeBundle (): malformed bundle, " << e.what());
+    delete bpHeader;
+    delete bppHeader;
+    return 0;
   }
 
   // Bundle Reconstruction
-  uint8_t aduBuf[strAdu.length()];
-  for(uint32_t i = 0; i < strAdu.length(); i++) aduBuf[i] = strAdu.at(i);
-  Ptr<Packet> p = Create<Packet>(aduBuf, strAdu.length());
   Ptr<Bundle7> b = Create<Bundle7>(p);
   b->SetPrimaryHeader(bpHeader);
   b->SetPayloadHeader(bppHeader);
@@ -31,6 +31,8 @@
 #include "ns3/bp-bundle-7.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/log.h"
+#include <deque>
+#include <map>
 
 namespace ns3 {
 
@@ -38,6 +40,21 @@ namespace ns3 {
  * \brief CLA protocol abstract base class 
  *
  * This is an abstract base class for CLA protocol of BP layer 
+ *
+ * Encoded bundles are not handed to a sending socket directly, but go
+ * through a transmit queue per socket (i.e. per peer), which is drained as
+ * the socket has room for them and again from its send callback.  Once a
+ * queue holds TxQueueBytes or more, the CLA is not ready, so that the agent
+ * keeps further bundles forward-pending in its store, and the ready
+ * callback is called when the queues are below that again.  The bound is
+ * checked between bundles, so a queue may go over it by the fragments of
+ * one bundle.  Datagram sockets take or refuse each packet at once, so only
+ * stream sockets hold packets back, and a datagram refused by its socket
+ * fails the SendBundle () it came from.
+ *
+ * A CLA that runs a session protocol over its sockets overrides Transmit ()
+ * to frame each encoded bundle, and hands the bundles it takes out of the
+ * received bytes to ProcessReceivedBundle ().
  */
 class BpCla : public Object
 {
@@ -50,6 +67,17 @@ public:
    */
   BpCla (Callback<void, Ptr<Bundle>> processBundleCallback);
 
+  /**
+   * Look up a CLA type, so that CLAs can be made by an ObjectFactory.  The
+   * name is that of a TypeId, with or without the "ns3::" prefix, or the
+   * short name of a CLA named Bp<name>Cla, e.g. "Tcp" for ns3::BpTcpCla.
+   *
+   * \param name the name of the CLA type
+   * \param tid set to the type found
+   * \return true if name is a registered subclass of BpCla
+   */
+  static bool LookupType (std::string name, TypeId *tid);
+
   /**
    * Destroy
    */
@@ -65,16 +93,50 @@ public:
   virtual int SendPacket (Ptr<Packet> packet, InetSocketAddress dstAddress, Ptr<Node> bpNode);
 
   /**
-   * Send a bundle, the CLA will handle all encoding of headers.
+   * Send a bundle as it is stored, the CLA will handle all encoding of headers.
    *
    * \param bundle to be sent
-   * \param size number of bytes of bundle ADU to be sent
-   * \param offset offest to read ADU bytes from
    * \param dstAddress the address of the destination endpoint id
    * \param bpNode the node of sender bpAgent
    */
   virtual int SendBundle (Ptr<Bundle6> bundle, InetSocketAddress dstAddress, Ptr<Node> bpNode);
 
+  /**
+   * Send one fragment of a bundle, the CLA will handle all encoding of headers.
+   *
+   * \param bundle to be sent
+   * \param fragment the primary block of the fragment, which selects the
+   * ADU bytes to be sent; the bundle itself is not modified
+   * \param dstAddress the address of the destination endpoint id
+   * \param bpNode the node of sender bpAgent
+   */
+  virtual int SendBundle (Ptr<Bundle6> bundle, const BpFragmentHeader6 &fragment, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+
+  /**
+   * Send a BPv7 bundle as it is stored, encoded by SerializeBundle ().
+   *
+   * \param bundle to be sent
+   * \param dstAddress the address of the destination endpoint id
+   * \param bpNode the node of sender bpAgent
+   */
+  virtual int SendBundle (Ptr<Bundle7> bundle, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+
+  /**
+   * Send one fragment of a BPv7 bundle, encoded by SerializeBundle ().
+   *
+   * \param bundle to be sent
+   * \param fragment the primary block of the fragment
+   * \param dstAddress the address of the destination endpoint id
+   * \param bpNode the node of sender bpAgent
+   */
+  virtual int SendBundle (Ptr<Bundle7> bundle, const BpFragmentHeader7 &fragment, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+
+  /**
+   * \return the largest encoded bundle, in bytes, that this CLA sends in
+   * one piece (0 for no limit); bundles are fragmented to fit it
+   */
+  virtual uint32_t GetMaxBundleSize () const;
+
   /**
    * Enable the transport layer to receive packets
    *
@@ -112,6 +174,18 @@ public:
    */
   virtual Ptr<Socket> GetL4Socket (Ptr<Packet> packet, InetSocketAddress dstAddress, Ptr<Node> bpNode);
 
+  /**
+   * Get the transport layer socket for bundles from src to dst
+   *
+   * \param src the source endpoint id
+   * \param dst the destination endpoint id
+   * \param dstAddress the address of the destination endpoint id
+   * \param bpNode the node of the sender bpAgent
+   *
+   * \return the sender socket
+   */
+  virtual Ptr<Socket> GetL4Socket (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+
   /**
    * \brief normal close callback
    */
@@ -137,10 +211,31 @@ public:
    */
   virtual void DataRecv (Ptr<Socket> socket);
 
-  virtual bool IsReady() { return m_ready; }
+  /**
+   * \return true if the CLA has contact (SetReady ()) and room in its
+   * transmit queues
+   */
+  virtual bool IsReady() { return m_ready && !m_blocked; }
 
   virtual void SetReady(bool ready);
 
+  /**
+   * \param cb called with this CLA each time it becomes ready, so that
+   * bundles waiting for it can be forwarded
+   */
+  void SetReadyCallback(Callback<void, Ptr<BpCla>> cb);
+
+  /**
+   * \param cb called with each bundle received, normally the agent's
+   * ProcessBundle (); set by the agent when the CLA is added to it
+   */
+  void SetProcessBundleCallback(Callback<void, Ptr<Bundle>> cb);
+
+  /**
+   * \return the bytes waiting in all transmit queues
+   */
+  uint64_t GetTxQueueBytes () const;
+
   /**
    * Enable Compressed Bundle Header Encoding (CBHE).
    */
@@ -151,22 +246,125 @@ public:
    */
   virtual bool UsesCbhe();
 
+  /**
+   * \brief Builds one serialized fragment of a BPv6 bundle, as SendBundle ()
+   * sends it
+   *
+   * \param bundle bundle to serialize
+   * \param fragment primary block of the fragment
+   */
+  static Ptr<Packet> SerializeBundle(Ptr<Bundle6> bundle, const BpFragmentHeader6 &fragment);
+
   /**
    * \brief Builds serialized bundle as CBOR indefinite array for BPv7
    * 
    * \param bundle bundle to serialize
    */
   static Ptr<Packet> SerializeBundle(Ptr<Bundle7> bundle); //TODO static modifier for testing purposes; remove later
+
+  /**
+   * \brief Builds one serialized fragment of a bundle as CBOR indefinite array for BPv7
+   * 
+   * \param bundle bundle to serialize
+   * \param fragment primary block of the fragment
+   */
+  static Ptr<Packet> SerializeBundle(Ptr<Bundle7> bundle, const BpFragmentHeader7 &fragment);
+
+  /**
+   * \return the size of a fragment of bundle as encoded by SendBundle ()
+   */
+  static uint32_t GetSerializedBundleSize(Ptr<Bundle6> bundle, const BpFragmentHeader6 &fragment);
+
+  /**
+   * \return the size of a fragment of bundle as encoded by SerializeBundle ()
+   */
+  static uint32_t GetSerializedBundleSize(Ptr<Bundle7> bundle, const BpFragmentHeader7 &fragment);
   
   /**
    * \brief Decodes packet at reception and constructs bundle from contents 
    * 
    * \param packet the encoded bundle to deserialize
+   * \return the bundle, or 0 if the packet does not hold a whole,
+   * well-formed BPv7 bundle
    */
   static Ptr<Bundle7> DeserializeBundle(Ptr<Packet> packet); //TODO static modifier for testing purposes; remove later
   
 protected:
 
+  virtual void DoDispose (void);
+
+  /**
+   * Hand an encoded bundle to a sending socket; by default it is queued
+   * as it is.
+   *
+   * \return 0, or -1 if the bundle cannot be sent on this socket
+   */
+  virtual int Transmit (Ptr<Socket> socket, Ptr<Packet> bundle);
+
+  /**
+   * Decode one encoded bundle and pass it to the agent.
+   *
+   * \param packet exactly the bytes of one bundle as sent by SendBundle ()
+   */
+  void ProcessReceivedBundle (Ptr<Packet> packet);
+
+  /**
+   * Pass a bundle that was received as an object rather than as encoded
+   * bytes to the agent.
+   */
+  void ReceiveBundle (Ptr<Bundle> bundle);
+
+  /**
+   * Create a socket connected to a peer, with the CLA's callbacks set.
+   *
+   * \return the socket, or 0 if it could not be bound or connected
+   */
+  Ptr<Socket> OpenSendSocket (InetSocketAddress dstAddress, Ptr<Node> bpNode);
+
+  /**
+   * Queue an encoded bundle for a sending socket, and send what it has
+   * room for.
+   *
+   * \return 0, or -1 if a datagram socket refused the packet.  Packets
+   * held or queued behind others are sent once the socket can take them.
+   */
+  int Enqueue (Ptr<Socket> socket, Ptr<Packet> packet);
+
+  /**
+   * Keep the queue of a socket from being sent, e.g. until a session is
+   * set up on it, or send it again.  Held bytes still count against
+   * TxQueueBytes.
+   */
+  void HoldTxQueue (Ptr<Socket> socket, bool hold);
+
+  /**
+   * \return the bytes waiting in the transmit queue of one socket
+   */
+  uint64_t GetTxQueueBytes (Ptr<Socket> socket) const;
+
+  /**
+   * Send queued packets while the socket has room for them.  A stream
+   * socket is also given the part of a packet that it has room for.
+   */
+  void Drain (Ptr<Socket> socket);
+
+  /**
+   * Drop what is queued for a socket that has been closed.
+   */
+  void FlushTxQueue (Ptr<Socket> socket);
+
+  /**
+   * \return the TxQueueBytes attribute, for a CLA that queues packets of
+   * its own
+   */
+  uint32_t GetTxQueueLimit () const;
+
+  /**
+   * Call the ready callback if the CLA is ready, for a CLA whose own queue
+   * has room again.
+   */
+  void NotifyReady ();
+
   std::map<BpEndpointId, Ptr<Socket> > m_l4SendSockets; /// the transport layer sender sockets
   std::map<BpEndpointId, Ptr<Socket> > m_l4RecvSockets; /// the transport layer receiver sockets
 
@@ -179,14 +377,43 @@ protected:
 
   virtual TypeId GetSocketTypeId() = 0;
 
+  uint32_t m_maxBundleSize; /// largest encoded bundle sent in one piece, set by the CLA's MaxBundleSize attribute
+
+  bool m_duplex; /// sending sockets also receive, for CLAs that run a session over them
+
 private:
+  /// encoded bundles waiting for a sending socket
+  struct TxQueue {
+    TxQueue () : bytes (0), held (false) {}
+
+    std::deque<Ptr<Packet> > packets;
+    uint64_t bytes;
+    bool held;
+  };
+
+  /**
+   * \return true if a transmit queue holds TxQueueBytes or more
+   */
+  bool TxQueueFull () const;
+
+  /**
+   * Clear m_blocked once the transmit queues have room again, and call the
+   * ready callback if that makes the CLA ready.
+   */
+  void CheckUnblocked ();
 
   bool m_ready;
+  bool m_blocked;                              /// a transmit queue is full
+  bool m_draining;                             /// in Drain (), which sockets may call back into
+  uint32_t m_txQueueLimit;                     /// TxQueueBytes attribute
+  std::map<Ptr<Socket>, TxQueue> m_txQueues;   /// per sending socket
 
   bool m_cbhe; // Set to true if CBHE should be used.
 
   Callback<void, Ptr<Bundle>> m_processBundleCallback;
 
+  Callback<void, Ptr<BpCla>> m_readyCallback;
+
   uint8_t m_tos; // IP ToS value used in sending packets.
 };
 
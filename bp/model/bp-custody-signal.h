@@ -42,50 +42,43 @@ public:
 
   virtual TypeId GetInstanceTypeId() const { return GetTypeId(); }
 
-  std::vector<uint8_t> Encode() const {
-    std::vector<uint8_t> result;
-    Sdnv sdnv;
-    result.push_back(status);
-    std::vector<uint8_t> sdnvBytes;
-    sdnvBytes = sdnv.Encode(fragmentOffset);
-    result.insert(result.end(), sdnvBytes.begin(), sdnvBytes.end());
-    sdnvBytes = sdnv.Encode(fragmentLength);
-    result.insert(result.end(), sdnvBytes.begin(), sdnvBytes.end());
-    sdnvBytes = sdnv.Encode(timeOfSignal.GetSeconds()); // TODO not DTN epoch?
-    result.insert(result.end(), sdnvBytes.begin(), sdnvBytes.end());
-    sdnvBytes = sdnv.Encode(creationTimestamp);
-    result.insert(result.end(), sdnvBytes.begin(), sdnvBytes.end());
-    sdnvBytes = sdnv.Encode(seqNo.GetValue());
-    result.insert(result.end(), sdnvBytes.begin(), sdnvBytes.end());
-    sdnvBytes = sdnv.Encode(srcEidLen);
-    result.insert(result.end(), sdnvBytes.begin(), sdnvBytes.end());
-    result.insert(result.end(), srcEid.begin(), srcEid.end());
-    return result;
+  virtual uint32_t GetSerializedSize() const {
+    return 1 + Sdnv::EncodedSize(fragmentOffset) + Sdnv::EncodedSize(fragmentLength)
+      + Sdnv::EncodedSize(timeOfSignal.GetSeconds()) + Sdnv::EncodedSize(creationTimestamp)
+      + Sdnv::EncodedSize(seqNo.GetValue()) + Sdnv::EncodedSize(srcEidLen) + srcEid.length();
   }
-
-  virtual uint32_t GetSerializedSize() const { return Encode().size(); }
   virtual void Print(std::ostream &os) const {};
   virtual void Serialize(Buffer::Iterator start) const {
-    std::vector<uint8_t> result = Encode();
-    for (size_t i = 0; i < result.size(); i++) start.WriteU8(result.at(i));
+    start.WriteU8(status);
+    Sdnv::Encode(fragmentOffset, start);
+    Sdnv::Encode(fragmentLength, start);
+    Sdnv::Encode(timeOfSignal.GetSeconds(), start); // TODO not DTN epoch?
+    Sdnv::Encode(creationTimestamp, start);
+    Sdnv::Encode(seqNo.GetValue(), start);
+    Sdnv::Encode(srcEidLen, start);
+    start.Write(reinterpret_cast<const uint8_t *>(srcEid.data()), srcEid.length());
   };
   virtual uint32_t Deserialize(Buffer::Iterator start) {
-     Sdnv sdnv;
-     status = start.ReadU8();
-     fragmentOffset = (uint32_t)sdnv.Decode(start);
-     fragmentLength = (uint32_t)sdnv.Decode(start);
-     timeOfSignal = Seconds((uint64_t)sdnv.Decode(start)/1000.0);
-     creationTimestamp = (uint32_t)sdnv.Decode(start);
-     seqNo = (uint32_t)sdnv.Decode(start);
-     srcEidLen = (uint32_t)sdnv.Decode(start);
-     srcEid.clear();
-     for (size_t j = 0; j < srcEidLen; j++) srcEid.push_back(start.ReadU8());
-     return GetSerializedSize();
+     Buffer::Iterator i = start;
+     status = i.ReadU8();
+     fragmentOffset = (uint32_t)Sdnv::Decode(i);
+     fragmentLength = (uint32_t)Sdnv::Decode(i);
+     timeOfSignal = Seconds((uint64_t)Sdnv::Decode(i)/1000.0);
+     creationTimestamp = (uint32_t)Sdnv::Decode(i);
+     seqNo = (uint32_t)Sdnv::Decode(i);
+     srcEidLen = (uint32_t)Sdnv::Decode(i);
+     srcEid.resize(srcEidLen);
+     i.Read(reinterpret_cast<uint8_t *>(&srcEid[0]), srcEidLen);
+     return i.GetDistanceFrom(start);
   };
 
 
   // below fields are specific to custody status
   uint8_t status;
+
+  // status: the succeeded flag, or a reason for refusing custody (RFC 5050 section 6.1.2)
+  #define _BP_CS_SUCCEEDED 0x80
+  #define _BP_CS_DEPLETED_STORAGE 0x04
   uint32_t fragmentOffset;
   uint32_t fragmentLength;
   Time timeOfSignal;
@@ -21,6 +21,10 @@
 
 #include <string>
 #include <climits>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <unordered_map>
 #include "ns3/log.h"
 #include "ns3/names.h"
 #include "bp-endpoint-id.h"
@@ -29,21 +33,143 @@ NS_LOG_COMPONENT_DEFINE ("BpEndpointId");
 
 namespace ns3 {
 
+namespace {
+
+/**
+ * One interned endpoint id, with its components already split out.
+ */
+struct EidRecord {
+  EidRecord (const std::string &s, const std::string &p)
+    : uri (s.empty () && p.empty () ? "" : s + ":" + p), scheme (s), ssp (p),
+      ipn (false), node (0), service (0)
+    {
+    }
+
+  std::string uri;
+  std::string scheme;
+  std::string ssp;
+  bool ipn;           /// valid CBHE-eligible ipn EID
+  uint64_t node;      /// ipn node number
+  uint64_t service;   /// ipn service number
+};
+
+/**
+ * Process-wide intern table.  Accessed through a function so that it is
+ * ready before any static BpEndpointId (e.g. defaultEid) is built.
+ */
+struct EidTable {
+  EidTable ()
+    {
+      // id 0 is the empty endpoint id built by the default constructor
+      records.push_back (EidRecord ("", ""));
+      byUri[""] = 0;
+    }
+
+  std::deque<EidRecord> records;  /// deque so references handed out stay valid
+  std::unordered_map<std::string, uint32_t> byUri;
+  std::map<std::pair<uint64_t, uint64_t>, uint32_t> byIpn;
+};
+
+EidTable &
+Table ()
+{
+  static EidTable table;
+  return table;
+}
+
+/**
+ * Parse a positive decimal number filling [begin, end).
+ *
+ * \return false if the range is empty, has a non-digit, overflows or is 0
+ */
+bool
+ParseIpnNumber (const char *begin, const char *end, uint64_t &value)
+{
+  if (begin == end) return false;
+  value = 0;
+  for (const char *c = begin; c != end; c++)
+    {
+      if (*c < '0' || *c > '9') return false;
+      uint64_t digit = *c - '0';
+      if (value > (UINT64_MAX - digit) / 10) return false;
+      value = value * 10 + digit;
+    }
+  return value != 0;
+}
+
+uint32_t
+Intern (const std::string &scheme, const std::string &ssp)
+{
+  EidTable &table = Table ();
+  std::string uri = scheme + ":" + ssp;
+  std::unordered_map<std::string, uint32_t>::iterator it = table.byUri.find (uri);
+  if (it != table.byUri.end ()) return it->second;
+
+  uint32_t id = table.records.size ();
+  table.records.push_back (EidRecord (scheme, ssp));
+  table.byUri[uri] = id;
+
+  // Check for ipn schema with two positive integers separated by a period.
+  EidRecord &r = table.records.back ();
+  size_t dot = ssp.find ('.');
+  if (scheme == "ipn" && dot != std::string::npos)
+    {
+      const char *p = ssp.c_str ();
+      uint64_t node, service;
+      if (ParseIpnNumber (p, p + dot, node) && ParseIpnNumber (p + dot + 1, p + ssp.length (), service))
+        {
+          r.ipn = true;
+          r.node = node;
+          r.service = service;
+          table.byIpn.insert (std::make_pair (std::make_pair (node, service), id));
+        }
+    }
+  return id;
+}
+
+const EidRecord &
+Record (uint32_t id)
+{
+  return Table ().records[id];
+}
+
+} // anonymous namespace
 
 BpEndpointId::BpEndpointId (const std::string scheme, const std::string ssp)
-  : m_uri ("")
+  : m_id (0)
 { 
   NS_LOG_FUNCTION (this << " " << scheme << " " << ssp);
-  m_uri = scheme + ":" + ssp;
   ParseComponent (scheme, ssp);
 }
 
 BpEndpointId::BpEndpointId (const std::string uri)
-  : m_uri ("")
+  : m_id (0)
 { 
   NS_LOG_FUNCTION (this << " " << uri);
+  EidTable &table = Table ();
+  std::unordered_map<std::string, uint32_t>::iterator it = table.byUri.find (uri);
+  if (it != table.byUri.end () && it->second != 0)
+    {
+      m_id = it->second;
+      return;
+    }
   ParseUri (uri);
-  m_uri = uri;
+}
+
+BpEndpointId::BpEndpointId (uint64_t node, uint64_t service)
+  : m_id (0)
+{
+  NS_LOG_FUNCTION (this << " " << node << " " << service);
+  EidTable &table = Table ();
+  std::map<std::pair<uint64_t, uint64_t>, uint32_t>::iterator it = table.byIpn.find (std::make_pair (node, service));
+  if (it != table.byIpn.end ())
+    {
+      m_id = it->second;
+      return;
+    }
+  std::ostringstream ssp;
+  ssp << node << "." << service;
+  ParseComponent ("ipn", ssp.str ());
 }
 
 void 
@@ -72,16 +198,9 @@ BpEndpointId::ParseComponent (const std::string &scheme, const std::string &ssp)
       NS_LOG_WARN ("BpEndpointId::BuildUri (), both scheme and ssp lengths cannot exceed 1023 bytes");
       schemeStr = schemeStr.substr (0, 1023);
       sspStr = sspStr.substr (0,1023);
-      schemeLen = schemeStr.length ();
-      sspLen = sspStr.length ();
     }
 
-  // build URI
-  m_scheme.offset = 0;
-  m_scheme.length = schemeLen;
-  m_ssp.offset = schemeLen + 1; 
-  m_ssp.length = m_uri.length () - m_ssp.offset;
-
+  m_id = Intern (schemeStr, sspStr);
 }
 
 void 
@@ -99,11 +218,12 @@ BpEndpointId::ParseUri (const std::string uri)
     }
 
   size_t semicolon_pos = 0; 
-  if((semicolon_pos = uri.find(':')) == std::string::npos)
+  if((semicolon_pos = uriStr.find(':')) == std::string::npos)
     {
       NS_LOG_WARN ("BpEndpointId::BuildUri (), uri must include semicolon ':'");
       uriStr = "dtn:none";
       uriLen = uriStr.length ();
+      semicolon_pos = uriStr.find(':');
     }
 
   std::string scheme = uriStr.substr(0, semicolon_pos);
@@ -112,42 +232,44 @@ BpEndpointId::ParseUri (const std::string uri)
   ParseComponent (scheme, ssp);
 }
 
-std::string
+const std::string &
 BpEndpointId::Scheme () const
 { 
   NS_LOG_FUNCTION (this);
-  return m_uri.substr(m_scheme.offset, m_scheme.length);
+  return Record (m_id).scheme;
 }
 
-std::string
+const std::string &
 BpEndpointId::Ssp () const
 { 
   NS_LOG_FUNCTION (this);
-  return m_uri.substr(m_ssp.offset, m_ssp.length);
+  return Record (m_id).ssp;
 }
 
-std::string 
+const std::string &
 BpEndpointId::Uri () const
 { 
   NS_LOG_FUNCTION (this);
-  return m_uri;
+  return Record (m_id).uri;
 }
 
 int
 BpEndpointId::IsIpnCbhe () const
 {
   NS_LOG_FUNCTION (this);
-  // Check for ipn schema.
-  if (Scheme() != "ipn") return 0;
-  // Check that we have two positive integers separated by a period.
-  size_t dot = Ssp().find('.');
-  if (dot == std::string::npos) return 0;
-  long long number = strtoll(Ssp().c_str(), NULL, 10);
-  if (number == 0 || number == LLONG_MAX || number == LLONG_MIN) return 0;
-  if (dot+1 == Ssp().length()) return 0;
-  number = strtoll(Ssp().c_str() + dot + 1, NULL, 10);
-  if (number == 0 || number == LLONG_MAX || number == LLONG_MIN) return 0;
-  return 1;
+  return Record (m_id).ipn ? 1 : 0;
+}
+
+uint64_t
+BpEndpointId::IpnNode () const
+{
+  return Record (m_id).node;
+}
+
+uint64_t
+BpEndpointId::IpnService () const
+{
+  return Record (m_id).service;
 }
 
 } // namespace ns3
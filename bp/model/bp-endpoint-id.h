@@ -23,30 +23,22 @@
 
 #include<string>
 #include<iostream>
+#include<functional>
+#include<stdint.h>
 namespace ns3 {
 
-/**
- * \brief A data structure that stores a single std::string buffer containing
- * the whole URI (scheme:ssp) and offset/length pairs for the scheme and ssp. 
- *
- * This structure is referred from oasys/util/URI.h in DTN2
- */
-struct Component {
-  Component() 
-    : offset (0), length (0)
-    {
-    }
-
-  size_t offset;  /// string offset within endpoint id
-  size_t length;  /// string length
-};
-
 /**
  * \brief The endpoint id of bundle node. 
  *
  * The format of the endpoint id is defined at the section 4.4 in RFC 5050. An endpoint id
  * of a bundle node is represented as a string "scheme:ssp"
  *
+ * Every distinct URI is stored once in a process-wide table, and a
+ * BpEndpointId only holds its 32-bit index there.  Copies, equality and
+ * ordering are integer operations, and the scheme, ssp and (for ipn EIDs)
+ * node and service numbers are parsed once when the URI is first seen.
+ * Ordering is by first appearance, not lexicographic.
+ *
  * Part of methods in this class is referred from oasys/util/URI.h in DTN2 
  */
 class BpEndpointId 
@@ -57,7 +49,7 @@ public:
    * Build an empty URI
    */
   BpEndpointId ()
-    : m_uri ("")
+    : m_id (0)
     {
     }
 
@@ -76,31 +68,35 @@ public:
    */
   BpEndpointId (const std::string uri);
 
-  /** 
-   * Destroy
+  /**
+   * Build an ipn URI as "ipn:node.service" without going through strings
+   * when the EID has been seen before.
+   *
+   * \param node ipn node number
+   * \param service ipn service number
    */
-  virtual ~BpEndpointId () { m_uri.clear(); };
-  
+  BpEndpointId (uint64_t node, uint64_t service);
+
   /**
    * Return the scheme part of endpoint id
    *
    * \return the scheme part of endpoint id
    */
-  std::string Scheme () const;
+  const std::string &Scheme () const;
 
   /**
    * Return the ssp part of endpoint id
    *
    * \return the ssp part of endpoint id
    */
-  std::string Ssp () const; 
+  const std::string &Ssp () const; 
 
   /**
    * Return the full name (uri) of endpoint id
    *
    * \return the full name (uri) of endpoint id
    */
-  std::string Uri () const;
+  const std::string &Uri () const;
 
   /**
    * Indicate whether this is an IPN EID eligible for CBHE.
@@ -109,10 +105,29 @@ public:
    */
    int IsIpnCbhe () const;
 
+  /**
+   * \return the ipn node number, or 0 if IsIpnCbhe () is false
+   */
+  uint64_t IpnNode () const;
+
+  /**
+   * \return the ipn service number, or 0 if IsIpnCbhe () is false
+   */
+  uint64_t IpnService () const;
+
+  /**
+   * \return the index of this URI in the intern table; equal EIDs have
+   * equal ids
+   */
+  uint32_t Id () const
+    {
+      return m_id;
+    }
+
 private:
 
   /**
-   * Check the naming rules of scheme and ssp
+   * Check the naming rules of scheme and ssp, and intern the result
    *
    * \param scheme scheme string of endpoint id
    * \param ssp ssp string of endpoint id
@@ -120,7 +135,8 @@ private:
   void ParseComponent (const std::string &scheme, const std::string &ssp);
 
   /**
-   * Check the naming rule of full name (uri) of endpoint id
+   * Check the naming rule of full name (uri) of endpoint id, and intern
+   * the result
    *
    * \param uri full name of endpoint id
    */
@@ -142,28 +158,38 @@ private:
   friend bool operator < (BpEndpointId const &a, BpEndpointId const &b);
 
 private:
-  std::string m_uri;  /// the endpoint id is represented by an URI in BP protocol
-
-  Component m_scheme; /// the offset and the length of scheme part of URI
-  Component m_ssp;    /// the offset and the length of ssp part of URI
+  uint32_t m_id;      /// index of the URI in the intern table
 };
 
 inline bool operator == (const BpEndpointId &a, const BpEndpointId &b)
 {
-  return (a.m_uri == b.m_uri);
+  return (a.m_id == b.m_id);
 }
 
 inline bool operator != (const BpEndpointId &a, const BpEndpointId &b)
 {
-  return (a.m_uri != b.m_uri);
+  return (a.m_id != b.m_id);
 }
 
 inline bool operator < (const BpEndpointId &a, const BpEndpointId &b)
 {
-  return (a.m_uri < b.m_uri);
+  return (a.m_id < b.m_id);
 }
 
 
 } // namespace ns3
 
+namespace std {
+
+template <>
+struct hash<ns3::BpEndpointId>
+{
+  size_t operator() (const ns3::BpEndpointId &eid) const
+  {
+    return eid.Id ();
+  }
+};
+
+} // namespace std
+
 #endif /* BP_ENDPOINT_ID_H */
@@ -86,6 +86,9 @@ public:
 
   enum DropReason {
     DROP_EXPIRED,
+    DROP_REASSEMBLY_TIMEOUT,
+    DROP_STORE_FULL,
+    DROP_PAYLOAD_HASH,
     DROP_INVALID_REASON,
   };
 
@@ -76,84 +76,32 @@ uint32_t
 BpHeader6::SerializeAndGetSize (Buffer::Iterator start, bool forReal) const
 {
   NS_LOG_FUNCTION (this);
-  Buffer::Iterator i = start;
-  Sdnv s;
-  std::vector<uint8_t> temp;
-  uint32_t length = 0;
-  size_t j;
-
-  length = 1;
-  if (forReal) i.WriteU8(m_version);
-
-  temp = s.Encode(m_processingFlags);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_blockLength);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_dstSchemeOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_dstSspOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_srcSchemeOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_srcSspOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_reportSchemeOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
+  if (!forReal) return GetSerializedSize ();
 
-  temp = s.Encode(m_reportSspOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_custSchemeOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_custSspOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_createTimestamp);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_timestampSeqNum.GetValue());
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_lifeTime.GetSeconds());
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_dictionary.length());
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-
-  if (forReal)
-    for (uint32_t k = 0; k < m_dictionary.length(); k++)
-      i.WriteU8 (m_dictionary[k]);
+  Buffer::Iterator i = start;
+  uint32_t length = 1;
+  i.WriteU8(m_version);
+
+  length += Sdnv::Encode(m_processingFlags, i);
+  length += Sdnv::Encode(m_blockLength, i);
+  length += Sdnv::Encode(m_dstSchemeOffset, i);
+  length += Sdnv::Encode(m_dstSspOffset, i);
+  length += Sdnv::Encode(m_srcSchemeOffset, i);
+  length += Sdnv::Encode(m_srcSspOffset, i);
+  length += Sdnv::Encode(m_reportSchemeOffset, i);
+  length += Sdnv::Encode(m_reportSspOffset, i);
+  length += Sdnv::Encode(m_custSchemeOffset, i);
+  length += Sdnv::Encode(m_custSspOffset, i);
+  length += Sdnv::Encode(m_createTimestamp, i);
+  length += Sdnv::Encode(m_timestampSeqNum.GetValue(), i);
+  length += Sdnv::Encode(m_lifeTime.GetSeconds(), i);
+  length += Sdnv::Encode(m_dictionary.length(), i);
+
+  i.Write (reinterpret_cast<const uint8_t *> (m_dictionary.data ()), m_dictionary.length ());
   length += m_dictionary.length();
 
-  temp = s.Encode(m_fragOffset);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
-
-  temp = s.Encode(m_aduLength);
-  length += temp.size();
-  if (forReal) for (j = 0; j < temp.size(); j++) i.WriteU8(temp.at(j));
+  length += Sdnv::Encode(m_fragOffset, i);
+  length += Sdnv::Encode(m_aduLength, i);
    
   return length;
 }
@@ -161,8 +109,24 @@ BpHeader6::SerializeAndGetSize (Buffer::Iterator start, bool forReal) const
 uint32_t 
 BpHeader6::GetSerializedSize (void) const
 {
-  Buffer b(300); 
-  return SerializeAndGetSize(b.Begin(), false);
+  return 1
+    + Sdnv::EncodedSize(m_processingFlags)
+    + Sdnv::EncodedSize(m_blockLength)
+    + Sdnv::EncodedSize(m_dstSchemeOffset)
+    + Sdnv::EncodedSize(m_dstSspOffset)
+    + Sdnv::EncodedSize(m_srcSchemeOffset)
+    + Sdnv::EncodedSize(m_srcSspOffset)
+    + Sdnv::EncodedSize(m_reportSchemeOffset)
+    + Sdnv::EncodedSize(m_reportSspOffset)
+    + Sdnv::EncodedSize(m_custSchemeOffset)
+    + Sdnv::EncodedSize(m_custSspOffset)
+    + Sdnv::EncodedSize(m_createTimestamp)
+    + Sdnv::EncodedSize(m_timestampSeqNum.GetValue())
+    + Sdnv::EncodedSize(m_lifeTime.GetSeconds())
+    + Sdnv::EncodedSize(m_dictionary.length())
+    + m_dictionary.length()
+    + Sdnv::EncodedSize(m_fragOffset)
+    + Sdnv::EncodedSize(m_aduLength);
 }
 
 void 
@@ -176,33 +140,31 @@ BpHeader6::Deserialize (Buffer::Iterator start)
 { 
   NS_LOG_FUNCTION (this);
   Buffer::Iterator i = start;
-  Sdnv sdnv;
 
   m_version = i.ReadU8 ();
-  m_processingFlags = (uint32_t) sdnv.Decode (i);
+  m_processingFlags = (uint32_t) Sdnv::Decode (i);
   NS_LOG_DEBUG("received processing flags: " << m_processingFlags);
-  m_blockLength = (uint32_t) sdnv.Decode (i);
+  m_blockLength = (uint32_t) Sdnv::Decode (i);
 
-  m_dstSchemeOffset = (uint16_t) sdnv.Decode (i);
-  m_dstSspOffset = (uint16_t) sdnv.Decode (i); 
-  m_srcSchemeOffset = (uint16_t) sdnv.Decode (i);
-  m_srcSspOffset = (uint16_t) sdnv.Decode (i);
-  m_reportSchemeOffset = (uint16_t) sdnv.Decode (i); 
-  m_reportSspOffset = (uint16_t) sdnv.Decode (i);
-  m_custSchemeOffset = (uint16_t) sdnv.Decode (i);
-  m_custSspOffset = (uint16_t) sdnv.Decode (i);
+  m_dstSchemeOffset = (uint16_t) Sdnv::Decode (i);
+  m_dstSspOffset = (uint16_t) Sdnv::Decode (i); 
+  m_srcSchemeOffset = (uint16_t) Sdnv::Decode (i);
+  m_srcSspOffset = (uint16_t) Sdnv::Decode (i);
+  m_reportSchemeOffset = (uint16_t) Sdnv::Decode (i); 
+  m_reportSspOffset = (uint16_t) Sdnv::Decode (i);
+  m_custSchemeOffset = (uint16_t) Sdnv::Decode (i);
+  m_custSspOffset = (uint16_t) Sdnv::Decode (i);
 
-  m_createTimestamp = sdnv.Decode (i);
-  m_timestampSeqNum = (uint32_t)sdnv.Decode (i);
-  m_lifeTime = Seconds((uint64_t) sdnv.Decode (i));
-  uint32_t m_dictLength = (uint32_t) sdnv.Decode (i);
+  m_createTimestamp = Sdnv::Decode (i);
+  m_timestampSeqNum = (uint32_t)Sdnv::Decode (i);
+  m_lifeTime = Seconds((uint64_t) Sdnv::Decode (i));
+  uint32_t m_dictLength = (uint32_t) Sdnv::Decode (i);
 
-  m_dictionary = std::string(" ", m_dictLength);
-  for (uint32_t k = 0; k < m_dictLength; k++)
-    m_dictionary[k] = i.ReadU8 ();
+  m_dictionary.resize (m_dictLength);
+  i.Read (reinterpret_cast<uint8_t *> (&m_dictionary[0]), m_dictLength);
 
-  m_fragOffset = (uint32_t) sdnv.Decode (i);
-  m_aduLength = (uint32_t) sdnv.Decode (i);
+  m_fragOffset = (uint32_t) Sdnv::Decode (i);
+  m_aduLength = (uint32_t) Sdnv::Decode (i);
 
   return i.GetDistanceFrom(start);
 }
@@ -286,12 +248,12 @@ void
 BpHeader6::SetDestinationEid (const BpEndpointId &dst)
 { 
   NS_LOG_FUNCTION (this << " " << dst.Uri ());
-  std::string scheme = dst.Scheme ();
-  std::string ssp = dst.Ssp ();
+  const std::string &scheme = dst.Scheme ();
+  const std::string &ssp = dst.Ssp ();
 
   if (m_cbhe) {
-    m_dstSchemeOffset = IpnNode(ssp);
-    m_dstSspOffset = IpnService(ssp);
+    m_dstSchemeOffset = dst.IpnNode();
+    m_dstSspOffset = dst.IpnService();
   } else {
     m_dstSchemeOffset = m_dictionary.size ();
     m_dictionary.append (scheme);
@@ -309,12 +271,12 @@ void
 BpHeader6::SetSourceEid (const BpEndpointId &src)
 { 
   NS_LOG_FUNCTION (this << " " << src.Uri ());
-  std::string scheme = src.Scheme ();
-  std::string ssp = src.Ssp ();
+  const std::string &scheme = src.Scheme ();
+  const std::string &ssp = src.Ssp ();
 
   if (m_cbhe) {
-    m_srcSchemeOffset = IpnNode(ssp);
-    m_srcSspOffset = IpnService(ssp);
+    m_srcSchemeOffset = src.IpnNode();
+    m_srcSspOffset = src.IpnService();
   } else {
     m_srcSchemeOffset = m_dictionary.size ();
     m_dictionary.append (scheme); 
@@ -332,12 +294,12 @@ void
 BpHeader6::SetReportEid (const BpEndpointId &report)
 { 
   NS_LOG_FUNCTION (this << " " << report.Uri ());
-  std::string scheme = report.Scheme ();
-  std::string ssp = report.Ssp ();
+  const std::string &scheme = report.Scheme ();
+  const std::string &ssp = report.Ssp ();
 
   if (m_cbhe) {
-    m_reportSchemeOffset = IpnNode(ssp);
-    m_reportSspOffset = IpnService(ssp);
+    m_reportSchemeOffset = report.IpnNode();
+    m_reportSspOffset = report.IpnService();
   } else {
     m_reportSchemeOffset = m_dictionary.size ();
     m_dictionary.append (scheme); 
@@ -353,12 +315,12 @@ void
 BpHeader6::SetCustEid (const BpEndpointId &cust)
 { 
   NS_LOG_FUNCTION (this << " " << cust.Uri ());
-  std::string scheme = cust.Scheme ();
-  std::string ssp = cust.Ssp ();
+  const std::string &scheme = cust.Scheme ();
+  const std::string &ssp = cust.Ssp ();
 
   if (m_cbhe) {
-    m_custSchemeOffset = IpnNode(ssp);
-    m_custSspOffset = IpnService(ssp);
+    m_custSchemeOffset = cust.IpnNode();
+    m_custSspOffset = cust.IpnService();
   } else {
     m_custSchemeOffset = m_dictionary.size ();
     m_dictionary.append (scheme); 
@@ -378,8 +340,7 @@ BpHeader6::GetDestinationEid () const
 NS_LOG_DEBUG("cbhe:" << m_cbhe);
   std::string scheme, ssp;
   if (m_cbhe) {
-    scheme = "ipn";
-    ssp = IpnSsp(m_dstSchemeOffset, m_dstSspOffset);
+    return BpEndpointId (m_dstSchemeOffset, m_dstSspOffset);
   } else {
     scheme = m_dictionary.substr(m_dstSchemeOffset).c_str();
     ssp = m_dictionary.substr(m_dstSspOffset).c_str();
@@ -399,8 +360,7 @@ BpHeader6::GetSourceEid () const
 NS_LOG_DEBUG("cbhe:" << m_cbhe);
   std::string scheme, ssp;
   if (m_cbhe) {
-    scheme = "ipn";
-    ssp = IpnSsp(m_srcSchemeOffset, m_srcSspOffset);
+    return BpEndpointId (m_srcSchemeOffset, m_srcSspOffset);
   } else {
     scheme = m_dictionary.substr(m_srcSchemeOffset).c_str();
     ssp = m_dictionary.substr(m_srcSspOffset).c_str();
@@ -416,8 +376,7 @@ BpHeader6::GetCustEid () const
   NS_LOG_FUNCTION (this);
   std::string scheme, ssp;
   if (m_cbhe) {
-    scheme = "ipn";
-    ssp = IpnSsp(m_custSchemeOffset, m_custSspOffset);
+    return BpEndpointId (m_custSchemeOffset, m_custSspOffset);
   } else {
     scheme = m_dictionary.substr(m_custSchemeOffset).c_str();
     ssp = m_dictionary.substr(m_custSspOffset).c_str();
@@ -432,8 +391,7 @@ BpHeader6::GetReportEid () const
   NS_LOG_FUNCTION (this);
   std::string scheme, ssp;
   if (m_cbhe) {
-    scheme = "ipn";
-    ssp = IpnSsp(m_reportSchemeOffset, m_reportSspOffset);
+    return BpEndpointId (m_reportSchemeOffset, m_reportSspOffset);
   } else {
     scheme = m_dictionary.substr(m_reportSchemeOffset).c_str();
     ssp = m_dictionary.substr(m_reportSspOffset).c_str();
@@ -456,4 +414,121 @@ BpHeader6::GetBlockLength () const
   return m_blockLength;
 }
 
+BpFragmentHeader6::BpFragmentHeader6 ()
+  : m_version (6),
+    m_processingFlags (0),
+    m_aduLength (0),
+    m_fragOffset (0),
+    m_blockLength (0),
+    m_isFragment (false)
+{
+}
+
+BpFragmentHeader6::BpFragmentHeader6 (const BpHeader6 &header)
+  : m_version (header.m_version),
+    m_processingFlags (header.m_processingFlags & ~(uint32_t)BpHeader::BUNDLE_IS_FRAGMENT),
+    m_aduLength (header.m_aduLength),
+    m_fragOffset (header.m_fragOffset),
+    m_blockLength (header.m_blockLength),
+    m_isFragment (header.IsFragment ())
+{
+  NS_LOG_FUNCTION (this);
+  const uint64_t fields[] = {
+    header.m_dstSchemeOffset, header.m_dstSspOffset,
+    header.m_srcSchemeOffset, header.m_srcSspOffset,
+    header.m_reportSchemeOffset, header.m_reportSspOffset,
+    header.m_custSchemeOffset, header.m_custSspOffset,
+    header.m_createTimestamp, header.m_timestampSeqNum.GetValue (),
+    (uint64_t) header.m_lifeTime.GetSeconds (), header.m_dictionary.length ()
+  };
+  uint8_t sdnv[10];
+  for (uint32_t n = 0; n < sizeof (fields) / sizeof (fields[0]); n++)
+    {
+      m_encoded.append (reinterpret_cast<char *> (sdnv), Sdnv::Encode (fields[n], sdnv));
+    }
+  m_encoded.append (header.m_dictionary);
+}
+
+void
+BpFragmentHeader6::SetFragment (uint32_t offset, uint32_t length, bool isFragment)
+{
+  m_fragOffset = offset;
+  m_blockLength = length;
+  m_isFragment = isFragment;
+}
+
+uint32_t
+BpFragmentHeader6::GetFragOffset () const
+{
+  return m_fragOffset;
+}
+
+uint32_t
+BpFragmentHeader6::GetBlockLength () const
+{
+  return m_blockLength;
+}
+
+bool
+BpFragmentHeader6::IsFragment () const
+{
+  return m_isFragment;
+}
+
+TypeId 
+BpFragmentHeader6::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpFragmentHeader6")
+    .SetParent<Header> ()
+    .AddConstructor<BpFragmentHeader6> ()
+  ;
+
+  return tid;
+}
+
+TypeId 
+BpFragmentHeader6::GetInstanceTypeId (void) const
+{ 
+  return GetTypeId ();
+}
+
+void 
+BpFragmentHeader6::Print (std::ostream &os) const
+{ 
+  os << "fragment offset " << m_fragOffset << " length " << m_blockLength;
+}
+
+uint32_t 
+BpFragmentHeader6::GetSerializedSize (void) const
+{
+  uint32_t flags = m_processingFlags | (m_isFragment ? BpHeader::BUNDLE_IS_FRAGMENT : 0);
+  return 1
+    + Sdnv::EncodedSize (flags)
+    + Sdnv::EncodedSize (m_blockLength)
+    + m_encoded.length ()
+    + Sdnv::EncodedSize (m_fragOffset)
+    + Sdnv::EncodedSize (m_aduLength);
+}
+
+void 
+BpFragmentHeader6::Serialize (Buffer::Iterator start) const
+{
+  // Same layout as BpHeader6::SerializeAndGetSize ().
+  Buffer::Iterator i = start;
+  uint32_t flags = m_processingFlags | (m_isFragment ? BpHeader::BUNDLE_IS_FRAGMENT : 0);
+  i.WriteU8 (m_version);
+  Sdnv::Encode (flags, i);
+  Sdnv::Encode (m_blockLength, i);
+  i.Write (reinterpret_cast<const uint8_t *> (m_encoded.data ()), m_encoded.length ());
+  Sdnv::Encode (m_fragOffset, i);
+  Sdnv::Encode (m_aduLength, i);
+}
+
+uint32_t 
+BpFragmentHeader6::Deserialize (Buffer::Iterator start)
+{ 
+  NS_FATAL_ERROR ("BpFragmentHeader6 is send-only; decode into a BpHeader6");
+  return 0;
+}
+
 } // namespace ns3
@@ -194,6 +194,54 @@ private:
   uint16_t m_custSchemeOffset;            /// scheme offset of custodian endpoint id
   uint16_t m_custSspOffset;               /// ssp offset of custodian endpoint id
   std::string m_dictionary;               /// dictionary
+
+  friend class BpFragmentHeader6;
+};
+
+/**
+ * \brief The primary block of a BPv6 bundle as it is sent for one fragment
+ *
+ * Every field but the fragment flag, the payload length and the fragment
+ * offset is encoded once, when this is built from the stored header, so a
+ * bundle can be sliced into fragments without rewriting the stored header
+ * or re-encoding it per fragment.  This is for sending only; received
+ * blocks are decoded into a BpHeader6.
+ */
+class BpFragmentHeader6 : public Header
+{
+public:
+  BpFragmentHeader6 ();
+  BpFragmentHeader6 (const BpHeader6 &header);
+
+  /**
+   * \brief Select the fragment to be encoded
+   *
+   * \param offset offset of the fragment payload in the whole ADU
+   * \param length number of payload bytes
+   * \param isFragment false if the payload is the whole ADU
+   */
+  void SetFragment (uint32_t offset, uint32_t length, bool isFragment);
+
+  uint32_t GetFragOffset () const;
+  uint32_t GetBlockLength () const;
+  bool IsFragment () const;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  uint8_t m_version;
+  uint32_t m_processingFlags;             /// flags without BUNDLE_IS_FRAGMENT
+  std::string m_encoded;                  /// encoded fields from the dictionary offsets through the dictionary
+  uint32_t m_aduLength;
+  uint32_t m_fragOffset;
+  uint32_t m_blockLength;
+  bool m_isFragment;
 };
 
 
@@ -26,6 +26,7 @@
 #include <string>
 
 #include "codec.h"
+#include "cbor-buffer.h"
 #include <vector>
 
 NS_LOG_COMPONENT_DEFINE ("BpHeader7");
@@ -68,50 +69,70 @@ BpHeader7::Print (std::ostream &os) const
   NS_LOG_FUNCTION (this);
 }
 
+template <typename Output>
 uint32_t
-BpHeader7::SerializeAndGetSize (Buffer::Iterator start, bool forReal) const
+BpHeader7::Encode (Output &out) const
 {
-  NS_LOG_FUNCTION (this);
-  
   uint32_t length = 0;
-  Buffer::Iterator i = start;
-  std::vector<uint8_t> temp;
 
-  if (IsFragment()) length = CborLite::encodeArraySize(temp, 10u);
-  else length = CborLite::encodeArraySize(temp, 8u);
+  if (IsFragment()) length = CborLite::encodeArraySize(out, 10u);
+  else length = CborLite::encodeArraySize(out, 8u);
 
-  length += CborLite::encodeInteger(temp, m_version);
+  length += EncodeFixed(out);
 
-  length += CborLite::encodeInteger(temp, m_processingFlags);
+  if (IsFragment()){
+      length += CborLite::encodeInteger(out, m_fragOffset);
+      length += CborLite::encodeInteger(out, m_aduLength);
+  }
 
-  length += CborLite::encodeInteger(temp, 0);   // CRC type place holder
+  return length;
+}
 
-  length += EncodeEID(temp, m_dstUriCode, m_dstSsp);
-  
-  length += EncodeEID(temp, m_srcUriCode, m_srcSsp);
+template <typename Output>
+uint32_t
+BpHeader7::EncodeFixed (Output &out) const
+{
+  uint32_t length = CborLite::encodeInteger(out, m_version);
 
-  length += EncodeEID(temp, m_reportUriCode, m_reportSsp);
+  length += CborLite::encodeInteger(out, m_processingFlags);
 
-  length += CborLite::encodeArraySize(temp, 2u);
-  length += CborLite::encodeInteger(temp, m_createTimestamp);
-  length += CborLite::encodeInteger(temp, m_timestampSeqNum.GetValue());   
-  length += CborLite::encodeInteger(temp, m_lifeTime.GetMilliSeconds());          
+  length += CborLite::encodeInteger(out, 0);   // CRC type place holder
 
-  if (IsFragment()){
-      length += CborLite::encodeInteger(temp, m_fragOffset);
-      length += CborLite::encodeInteger(temp, m_aduLength);
-  }
+  length += EncodeEID(out, m_dstEid);
+  
+  length += EncodeEID(out, m_srcEid);
+
+  length += EncodeEID(out, m_reportEid);
 
-  if (forReal) for(uint32_t k = 0; k < temp.size (); k++) i.WriteU8(temp.at(k));
+  length += CborLite::encodeArraySize(out, 2u);
+  length += CborLite::encodeInteger(out, m_createTimestamp);
+  length += CborLite::encodeInteger(out, m_timestampSeqNum.GetValue());   
+  length += CborLite::encodeInteger(out, m_lifeTime.GetMilliSeconds());          
 
   return length;
 }
 
+uint32_t
+BpHeader7::SerializeAndGetSize (Buffer::Iterator start, bool forReal) const
+{
+  NS_LOG_FUNCTION (this);
+  if (!forReal) return GetSerializedSize ();
+
+  Buffer::Iterator i = start;
+  CborBufferWriter out (i);
+  m_serializedSize = Encode (out);
+  return m_serializedSize;
+}
+
 uint32_t 
 BpHeader7::GetSerializedSize (void) const
 {
-  Buffer b(300); 
-  return SerializeAndGetSize(b.Begin(), false);
+  if (m_serializedSize == 0)
+    {
+      CborSizeCounter out;
+      m_serializedSize = Encode (out);
+    }
+  return m_serializedSize;
 }
 
 void 
@@ -125,15 +146,9 @@ BpHeader7::Deserialize (Buffer::Iterator start)
 { 
   NS_LOG_FUNCTION (this);
 
-  Buffer::Iterator i = start;
-  size_t j, size;
-  std::vector<uint8_t> temp;
-  size =  i.GetRemainingSize();
-
-  // Creates buffer for cbor decoding
-  for(j = 0; j < size; j++) temp.push_back(i.ReadU8());
-  std::vector<uint8_t>::iterator pos = begin(temp);
-  std::vector<uint8_t>::iterator stop = end(temp);
+  // Decode straight out of the buffer; only the bytes of this block are read.
+  CborBufferReader pos (start);
+  CborBufferReader stop = CborBufferReader::End (start);
 
   size_t dataSize, tempNumeric;
   uint32_t seqNum, msLifeTime;
@@ -145,9 +160,9 @@ BpHeader7::Deserialize (Buffer::Iterator start)
   length += CborLite::decodeUnsigned(pos, stop, tempNumeric); // Handles CRC type place holder value
 
 
-  length += DecodeEID(pos, stop, m_dstUriCode, m_dstSsp);
-  length += DecodeEID(pos, stop, m_srcUriCode, m_srcSsp);
-  length += DecodeEID(pos, stop, m_reportUriCode, m_reportSsp);
+  length += DecodeEID(pos, stop, m_dstEid);
+  length += DecodeEID(pos, stop, m_srcEid);
+  length += DecodeEID(pos, stop, m_reportEid);
 
   length += CborLite::decodeArraySize(pos, stop, tempNumeric);
   length += CborLite::decodeUnsigned(pos, stop, m_createTimestamp);
@@ -161,6 +176,7 @@ BpHeader7::Deserialize (Buffer::Iterator start)
       length += CborLite::decodeUnsigned(pos, stop, m_fragOffset);
       length += CborLite::decodeUnsigned(pos, stop, m_aduLength);
   }
+  m_serializedSize = length;
   return length;
 }
 
@@ -172,6 +188,7 @@ BpHeader7::SetStatusTimeReq (const bool value)
     m_processingFlags |= REQ_STATUS_TIME_IN_REPORTS;
   else
     m_processingFlags &= (~(REQ_STATUS_TIME_IN_REPORTS));
+  m_serializedSize = 0;
 }
 
 bool 
@@ -185,52 +202,24 @@ void
 BpHeader7::SetDestinationEid (const BpEndpointId &dst)
 { 
   NS_LOG_FUNCTION (this << " " << dst.Uri ());
-  
-  std::string scheme = dst.Scheme ();
-  std::string ssp = dst.Ssp ();
-
-  if (scheme == "ipn") {
-    m_dstUriCode = 2u;
-    m_dstSsp = IpnSsp(IpnNode(ssp), IpnService(ssp));
-  } else {
-    m_dstUriCode = 1u;
-    m_dstSsp = ssp;
-  }
+  m_dstEid = dst;
+  m_serializedSize = 0;
 }
 
 void 
 BpHeader7::SetSourceEid (const BpEndpointId &src)
 { 
   NS_LOG_FUNCTION (this << " " << src.Uri ());
-  
-  std::string scheme = src.Scheme ();
-  std::string ssp = src.Ssp ();
-
-  if (scheme == "ipn") {
-    m_srcUriCode = 2u;
-    m_srcSsp = IpnSsp(IpnNode(ssp), IpnService(ssp));
-  } else {
-    m_srcUriCode = 1u;
-    m_srcSsp = ssp;
-  }
-
+  m_srcEid = src;
+  m_serializedSize = 0;
 }
 
 void 
 BpHeader7::SetReportEid (const BpEndpointId &report)
 { 
   NS_LOG_FUNCTION (this << " " << report.Uri ());
-  
-  std::string scheme = report.Scheme ();
-  std::string ssp = report.Ssp ();
-
-  if (scheme == "ipn") {
-    m_reportUriCode = 2u;
-    m_reportSsp = IpnSsp(IpnNode(ssp), IpnService(ssp));
-  } else {
-    m_reportUriCode = 1u;
-    m_reportSsp = ssp;
-  }
+  m_reportEid = report;
+  m_serializedSize = 0;
 }
 
 uint8_t 
@@ -244,30 +233,21 @@ BpEndpointId
 BpHeader7::GetDestinationEid () const
 { 
   NS_LOG_FUNCTION (this);
-  
-  //pTODO implement
-  BpEndpointId eid ("", "");
-  return eid;
+  return m_dstEid;
 }
 
 BpEndpointId 
 BpHeader7::GetSourceEid () const
 { 
   NS_LOG_FUNCTION (this);
-  
-  //pTODO implement
-  BpEndpointId eid ("", "");
-  return eid;
+  return m_srcEid;
 }
 
-BpEndpointId
+BpEndpointId 
 BpHeader7::GetReportEid () const
 { 
   NS_LOG_FUNCTION (this);
-  
-  //pTODO implement
-  BpEndpointId eid ("", "");
-  return eid;
+  return m_reportEid;
 }
 
 void 
@@ -284,49 +264,162 @@ BpHeader7::GetBlockLength () const
   return m_blockLength;
 }
 
-uint8_t
-BpHeader7::EncodeEID(std::vector<uint8_t> &buffer, uint16_t uriCode, std::string ssp) const
+template <typename Output>
+uint32_t
+BpHeader7::EncodeEID(Output &out, const BpEndpointId &eid) const
 {       
-  uint8_t length = CborLite::encodeArraySize(buffer, 2u);
-  if (uriCode == 1){
-    length += CborLite::encodeInteger(buffer, 1);
-    if (ssp == "none") length += CborLite::encodeInteger(buffer, 0);
-    else length += CborLite::encodeBytes(buffer, ssp);
+  uint32_t length = CborLite::encodeArraySize(out, 2u);
+  if (eid.Scheme() != "ipn"){
+    length += CborLite::encodeInteger(out, 1);
+    if (eid.Ssp() == "none") length += CborLite::encodeInteger(out, 0);
+    else length += CborLite::encodeBytes(out, eid.Ssp());
   }
   else{ 
-    uint32_t n, s;
-    sscanf(ssp.c_str(), "%d.%d", &n, &s);
-    length += CborLite::encodeInteger(buffer, 2);
-    length += CborLite::encodeArraySize(buffer, 2u);
-    length += CborLite::encodeInteger(buffer, n);
-    length += CborLite::encodeInteger(buffer, s);
+    length += CborLite::encodeInteger(out, 2);
+    length += CborLite::encodeArraySize(out, 2u);
+    length += CborLite::encodeInteger(out, eid.IpnNode());
+    length += CborLite::encodeInteger(out, eid.IpnService());
   }
   return length;
 }
 
+template <typename InputIterator>
 uint32_t 
-BpHeader7::DecodeEID(std::vector<uint8_t>::iterator &pos, std::vector<uint8_t>::iterator end, uint16_t &uri, std::string &ssp)
+BpHeader7::DecodeEID(InputIterator &pos, InputIterator end, BpEndpointId &eid)
 {
   uint32_t length;
   size_t tempNumeric;
+  uint16_t uri;
 
   length = CborLite::decodeArraySize(pos, end, tempNumeric);
   length += CborLite::decodeUnsigned(pos, end, uri);
   if (uri == 2 ){
     length += CborLite::decodeArraySize(pos, end, tempNumeric);
-    uint32_t node, service;
+    uint64_t node, service;
     length += CborLite::decodeUnsigned(pos, end, node);
     length += CborLite::decodeUnsigned(pos, end, service);
-    char tmp[1024];
-    sprintf(tmp, "%u.%u", node, service);
-    ssp = tmp;
+    eid = BpEndpointId (node, service);
   }
-  else if ((int)(*pos) == 00) {
+  else if (pos != end && (int)(*pos) == 00) {
       length += CborLite::decodeUnsigned(pos, end, tempNumeric);
-      ssp = std::to_string((int)tempNumeric);
+      eid = BpEndpointId ("dtn", "none");
+  }
+  else {
+      std::string ssp;
+      length += CborLite::decodeBytes(pos, end, ssp);  
+      eid = BpEndpointId ("dtn", ssp);
   }
-  else length += CborLite::decodeBytes(pos, end, ssp);  
   return length;
 }
 
+BpFragmentHeader7::BpFragmentHeader7 ()
+  : m_aduLength (0),
+    m_fragOffset (0),
+    m_blockLength (0),
+    m_isFragment (false)
+{
+}
+
+BpFragmentHeader7::BpFragmentHeader7 (const BpHeader7 &header)
+  : m_aduLength (header.GetAduLength ()),
+    m_fragOffset (header.GetFragOffset ()),
+    m_blockLength (header.GetBlockLength ()),
+    m_isFragment (header.IsFragment ())
+{
+  NS_LOG_FUNCTION (this);
+  // The fragment flag is the only per-fragment bit in the flags field.
+  BpHeader7 whole = header;
+  whole.SetIsFragment (false);
+  whole.EncodeFixed (m_encoded);
+  whole.SetIsFragment (true);
+  whole.EncodeFixed (m_fragmentEncoded);
+}
+
+void
+BpFragmentHeader7::SetFragment (uint32_t offset, uint32_t length, bool isFragment)
+{
+  m_fragOffset = offset;
+  m_blockLength = length;
+  m_isFragment = isFragment;
+}
+
+uint32_t
+BpFragmentHeader7::GetFragOffset () const
+{
+  return m_fragOffset;
+}
+
+uint32_t
+BpFragmentHeader7::GetBlockLength () const
+{
+  return m_blockLength;
+}
+
+bool
+BpFragmentHeader7::IsFragment () const
+{
+  return m_isFragment;
+}
+
+TypeId 
+BpFragmentHeader7::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpFragmentHeader7")
+    .SetParent<Header> ()
+    .AddConstructor<BpFragmentHeader7> ()
+  ;
+
+  return tid;
+}
+
+TypeId 
+BpFragmentHeader7::GetInstanceTypeId (void) const
+{ 
+  return GetTypeId ();
+}
+
+void 
+BpFragmentHeader7::Print (std::ostream &os) const
+{ 
+  os << "fragment offset " << m_fragOffset << " length " << m_blockLength;
+}
+
+uint32_t 
+BpFragmentHeader7::GetSerializedSize (void) const
+{
+  CborSizeCounter out;
+  if (!m_isFragment)
+    {
+      return CborLite::encodeArraySize(out, 8u) + m_encoded.size ();
+    }
+  return CborLite::encodeArraySize(out, 10u) + m_fragmentEncoded.size ()
+    + CborLite::encodeInteger(out, m_fragOffset)
+    + CborLite::encodeInteger(out, m_aduLength);
+}
+
+void 
+BpFragmentHeader7::Serialize (Buffer::Iterator start) const
+{
+  // Same layout as BpHeader7::Encode ().
+  Buffer::Iterator i = start;
+  CborBufferWriter out (i);
+  if (!m_isFragment)
+    {
+      CborLite::encodeArraySize(out, 8u);
+      out.insert (out.end (), m_encoded.begin (), m_encoded.end ());
+      return;
+    }
+  CborLite::encodeArraySize(out, 10u);
+  out.insert (out.end (), m_fragmentEncoded.begin (), m_fragmentEncoded.end ());
+  CborLite::encodeInteger(out, m_fragOffset);
+  CborLite::encodeInteger(out, m_aduLength);
+}
+
+uint32_t 
+BpFragmentHeader7::Deserialize (Buffer::Iterator start)
+{ 
+  NS_FATAL_ERROR ("BpFragmentHeader7 is send-only; decode into a BpHeader7");
+  return 0;
+}
+
 } // namespace ns3
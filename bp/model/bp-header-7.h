@@ -109,23 +109,25 @@ public:
   /**
    * \brief Helper function to encode EID
    * 
-   * \param buffer the buffer to store encoded EID
-   * \param uriCode the EID Uris
-   * \param ssp the EID ssp
+   * \param out CborLite output (CborBufferWriter or CborSizeCounter)
+   * \param eid the EID to encode
    * 
-   * \return the expected size in bytes of the encoded EID
+   * \return the size in bytes of the encoded EID
    */
-  uint8_t EncodeEID(std::vector<uint8_t> &buffer, uint16_t uriCode, std::string ssp) const;
+  template <typename Output>
+  uint32_t EncodeEID(Output &out, const BpEndpointId &eid) const;
 
   /**
    * \brief Helper function to decode EIDs
    * 
    * \param pos an iterator pointing to start of encoded EID
    * \param end an iterator pointing to end of encoded data 
+   * \param eid set to the decoded EID
    * 
    * \return the number of bytes decoded
    */
-  uint32_t DecodeEID(std::vector<uint8_t>::iterator &pos, std::vector<uint8_t>::iterator end, uint16_t &uri, std::string &ssp);
+  template <typename InputIterator>
+  uint32_t DecodeEID(InputIterator &pos, InputIterator end, BpEndpointId &eid);
 
 
   /**
@@ -148,16 +150,77 @@ public:
   uint32_t GetBlockLength () const;
 
 private:
+  /**
+   * \brief Encode the whole primary block into a CborLite output
+   *
+   * \return the encoded length
+   */
+  template <typename Output>
+  uint32_t Encode (Output &out) const;
+
+  /**
+   * \brief Encode the fields that are the same in every fragment, from
+   * the version through the lifetime
+   *
+   * \return the encoded length
+   */
+  template <typename Output>
+  uint32_t EncodeFixed (Output &out) const;
+
   // unique to primary bundle block https://datatracker.ietf.org/doc/html/draft-ietf-dtn-bpbis-30#section-4.3.1
-  uint16_t m_dstUriCode;
-  std::string m_dstSsp; 
-  uint16_t m_srcUriCode;
-  std::string m_srcSsp; 
-  uint16_t m_reportUriCode;
-  std::string m_reportSsp; 
+  BpEndpointId m_dstEid;
+  BpEndpointId m_srcEid;
+  BpEndpointId m_reportEid;
 
   // Not included in bpv7; strictly for simulator purposes
   uint32_t m_blockLength;
+
+  friend class BpFragmentHeader7;
+};
+
+/**
+ * \brief The primary block of a BPv7 bundle as it is sent for one fragment
+ *
+ * The fields from the version through the lifetime are encoded once, when
+ * this is built from the stored header, so a bundle can be sliced into
+ * fragments without rewriting the stored header or re-encoding it per
+ * fragment.  This is for sending only; received blocks are decoded into a
+ * BpHeader7.
+ */
+class BpFragmentHeader7 : public Header
+{
+public:
+  BpFragmentHeader7 ();
+  BpFragmentHeader7 (const BpHeader7 &header);
+
+  /**
+   * \brief Select the fragment to be encoded
+   *
+   * \param offset offset of the fragment payload in the whole ADU
+   * \param length number of payload bytes
+   * \param isFragment false if the payload is the whole ADU
+   */
+  void SetFragment (uint32_t offset, uint32_t length, bool isFragment);
+
+  uint32_t GetFragOffset () const;
+  uint32_t GetBlockLength () const;
+  bool IsFragment () const;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  std::string m_encoded;                  /// fixed fields of a whole bundle
+  std::string m_fragmentEncoded;          /// fixed fields of a fragment (the flags differ)
+  uint32_t m_aduLength;
+  uint32_t m_fragOffset;
+  uint32_t m_blockLength;
+  bool m_isFragment;
 };
 
 
@@ -40,7 +40,8 @@ BpHeader::BpHeader (uint8_t version, bool useCbhe)
     m_lifeTime (0),
     m_fragOffset (0),
     m_aduLength (0),
-    m_cbhe (useCbhe)
+    m_cbhe (useCbhe),
+    m_serializedSize (0)
 { 
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG("BpHeader *** " << useCbhe);
@@ -55,6 +56,7 @@ void
 BpHeader::SetIsFragment (const bool value)
 { 
   NS_LOG_FUNCTION (this << " " << value);
+  m_serializedSize = 0;
   if (value)
     m_processingFlags |= BUNDLE_IS_FRAGMENT;
   else
@@ -65,6 +67,7 @@ void
 BpHeader::SetIsAdmin (const bool value)
 { 
   NS_LOG_FUNCTION (this << " " << value);
+  m_serializedSize = 0;
   if (value)
     m_processingFlags |= BUNDLE_IS_ADMIN;
   else
@@ -75,6 +78,7 @@ void
 BpHeader::SetDonotFragment (const bool value)
 { 
   NS_LOG_FUNCTION (this << " " << value);
+  m_serializedSize = 0;
   if (value)
     m_processingFlags |= BUNDLE_DO_NOT_FRAGMENT;
   else
@@ -86,6 +90,7 @@ void
 BpHeader::SetAckbyAppReq (const bool value)
 { 
   NS_LOG_FUNCTION (this << " " << value);
+  m_serializedSize = 0;
   if (value)
     m_processingFlags |= BUNDLE_ACK_BY_APP;
   else
@@ -97,6 +102,7 @@ void
 BpHeader::SetReceptionReport (const bool value)
 { 
   NS_LOG_FUNCTION (this << " " << value);
+  m_serializedSize = 0;
   if (value)
     m_processingFlags |= REQ_REPORT_BUNDLE_RECEPTION;
   else
@@ -107,6 +113,7 @@ void
 BpHeader::SetForwardReport (const bool value)
 { 
   NS_LOG_FUNCTION (this << " " << value);
+  m_serializedSize = 0;
   if (value)
     m_processingFlags |= REQ_REPORT_BUNDLE_FORWARD;
   else
@@ -118,6 +125,7 @@ void
 BpHeader::SetDeliveryReport (const bool value)
 { 
   NS_LOG_FUNCTION (this << " " << value);
+  m_serializedSize = 0;
   if (value)
     m_processingFlags |= REQ_REPORT_BUNDLE_DELIVERY;
   else
@@ -129,6 +137,7 @@ void
 BpHeader::SetDeletionReport (const bool value)
 { 
   NS_LOG_FUNCTION (this << " " << value);
+  m_serializedSize = 0;
   if (value)
     m_processingFlags |= REQ_REPORT_BUNDLE_DELETION;
   else
@@ -196,6 +205,7 @@ void
 BpHeader::SetCreateTimestamp (const uint32_t timestamp)
 { 
   NS_LOG_FUNCTION (this << " " << timestamp);
+  m_serializedSize = 0;
   m_createTimestamp = timestamp;
 }
 
@@ -203,6 +213,7 @@ void
 BpHeader::SetSequenceNumber (const SequenceNumber32 &sequenceNumber)
 { 
   NS_LOG_FUNCTION (this << " " << sequenceNumber.GetValue ());
+  m_serializedSize = 0;
   m_timestampSeqNum = sequenceNumber;
 }
 
@@ -221,33 +232,11 @@ BpHeader::GetSequenceNumber () const
   return m_timestampSeqNum;
 }
 
-uint32_t 
-BpHeader::IpnNode(std::string &ssp) {
-  uint32_t n, s;
-  sscanf(ssp.c_str(), "%d.%d", &n, &s);
-  return n;
-}
-
-uint32_t 
-BpHeader::IpnService(std::string &ssp) {
-  uint32_t n, s;
-  sscanf(ssp.c_str(), "%d.%d", &n, &s);
-  return s;
-}
-
-std::string 
-BpHeader::IpnSsp(uint32_t node, uint32_t service) const {
-  char tmp[1024];
-  NS_LOG_DEBUG("IpnSsp: " << node << " . " << service);
-  sprintf(tmp, "%u.%u", node, service);
-  return std::string(tmp);
-}
-
-
 void 
 BpHeader::SetLifeTime (Time lifetime)
 { 
   NS_LOG_FUNCTION (this << " " << lifetime.GetSeconds());
+  m_serializedSize = 0;
   m_lifeTime = lifetime;
 }
 
@@ -263,6 +252,7 @@ void
 BpHeader::SetFragOffset (uint32_t offset)
 { 
   NS_LOG_FUNCTION (this << " " << offset);
+  m_serializedSize = 0;
   m_fragOffset = offset;
 }
 
@@ -270,6 +260,7 @@ void
 BpHeader::SetAduLength (uint32_t len)
 { 
   NS_LOG_FUNCTION (this << " " << len);
+  m_serializedSize = 0;
   m_aduLength = len;
 }
 
@@ -291,6 +282,7 @@ void
 BpHeader::SetVersion (uint8_t ver)
 { 
   NS_LOG_FUNCTION (this);
+  m_serializedSize = 0;
   m_version = ver;
 }
 
@@ -279,11 +279,7 @@ protected:
   uint32_t m_fragOffset;                  /// fragementation offset
   uint32_t m_aduLength;                   /// application data unit length
   bool m_cbhe;                            /// use CBHE compression //pTODO remove cbhe from here
-
-  //pTODO remove w/ cbhe
-  uint32_t IpnNode(std::string &ssp);
-  uint32_t IpnService(std::string &ssp);
-  std::string IpnSsp(uint32_t node, uint32_t service) const;
+  mutable uint32_t m_serializedSize;      /// cached encoded length, 0 when a setter has changed a field
 };
 
 
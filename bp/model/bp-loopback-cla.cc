@@ -0,0 +1,255 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-loopback-cla.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+
+NS_LOG_COMPONENT_DEFINE ("BpLoopbackCla");
+
+namespace ns3 {
+
+namespace {
+
+/// the loopback CLA listening on each IPv4 address and port, in the
+/// running simulation
+std::map<std::pair<uint32_t, uint16_t>, Ptr<BpLoopbackCla> > g_listeners;
+bool g_clearScheduled = false;
+
+/**
+ * Forget the listeners of a simulation as it is destroyed, so that none
+ * is found by the next one, and their CLAs can be freed.
+ */
+void
+ClearListeners (void)
+{
+  g_listeners.clear ();
+  g_clearScheduled = false;
+}
+
+} // anonymous namespace
+
+NS_OBJECT_ENSURE_REGISTERED (BpLoopbackCla);
+
+TypeId
+BpLoopbackCla::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpLoopbackCla")
+    .SetParent<BpCla> ()
+    .AddConstructor<BpLoopbackCla> ()
+    .AddAttribute ("Delay", "Time from sending a bundle to handing it to the receiving agent",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&BpLoopbackCla::m_delay),
+                   MakeTimeChecker ())
+    .AddAttribute ("Serialize", "Encode each bundle and decode it on receipt, rather than handing over a copy of the bundle object",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&BpLoopbackCla::m_serialize),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+BpLoopbackCla::BpLoopbackCla (Callback<void, Ptr<Bundle>> processBundleCallback)
+  : BpCla (processBundleCallback),
+    m_delay (Seconds (0)),
+    m_serialize (false),
+    m_sent (0),
+    m_received (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+BpLoopbackCla::~BpLoopbackCla ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+BpLoopbackCla::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Unlisten ();
+  BpCla::DoDispose ();
+}
+
+int
+BpLoopbackCla::EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode)
+{
+  NS_LOG_FUNCTION (this << " " << local.Uri ());
+
+  InetSocketAddress defaultAddr ("127.0.0.1", 0);
+  if (localAddress == defaultAddr)
+    {
+      NS_LOG_DEBUG ("BpLoopbackCla::EnableReceive (): cannot find route for local endpoint id " << local.Uri ());
+      return -1;
+    }
+
+  ListenKey key (localAddress.GetIpv4 ().Get (), localAddress.GetPort ());
+  std::map<ListenKey, Ptr<BpLoopbackCla> >::iterator it = g_listeners.find (key);
+  if (it != g_listeners.end () && it->second != this)
+    {
+      NS_LOG_WARN ("BpLoopbackCla::EnableReceive (): " << localAddress.GetIpv4 () << " port " << localAddress.GetPort ()
+                   << " is taken by another loopback CLA");
+      return -1;
+    }
+  if (!g_clearScheduled)
+    {
+      Simulator::ScheduleDestroy (&ClearListeners);
+      g_clearScheduled = true;
+    }
+  g_listeners[key] = this;
+  m_listening[local] = key;
+  return 0;
+}
+
+int
+BpLoopbackCla::DisableReceive (const BpEndpointId &local)
+{
+  NS_LOG_FUNCTION (this << " " << local.Uri ());
+  std::map<BpEndpointId, ListenKey>::iterator it = m_listening.find (local);
+  if (it == m_listening.end ())
+    return -1;
+
+  ListenKey key = it->second;
+  m_listening.erase (it);
+  for (it = m_listening.begin (); it != m_listening.end (); it++)
+    {
+      if (it->second == key)
+        return 0;
+    }
+  g_listeners.erase (key);
+  return 0;
+}
+
+void
+BpLoopbackCla::Unlisten ()
+{
+  for (std::map<BpEndpointId, ListenKey>::iterator it = m_listening.begin (); it != m_listening.end (); it++)
+    {
+      std::map<ListenKey, Ptr<BpLoopbackCla> >::iterator l = g_listeners.find (it->second);
+      if (l != g_listeners.end () && l->second == this)
+        g_listeners.erase (l);
+    }
+  m_listening.clear ();
+}
+
+Ptr<BpLoopbackCla>
+BpLoopbackCla::FindPeer (InetSocketAddress address)
+{
+  std::map<ListenKey, Ptr<BpLoopbackCla> >::iterator it = g_listeners.find (ListenKey (address.GetIpv4 ().Get (), address.GetPort ()));
+  if (it == g_listeners.end ())
+    {
+      NS_LOG_DEBUG ("no loopback CLA listens on " << address.GetIpv4 () << " port " << address.GetPort ());
+      return 0;
+    }
+  return it->second;
+}
+
+int
+BpLoopbackCla::SendBundle (Ptr<Bundle6> bundle, const BpFragmentHeader6 &fragment, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
+  NS_LOG_FUNCTION (this << " " << bundle << " size " << fragment.GetBlockLength ());
+  Ptr<BpLoopbackCla> peer = FindPeer (dstAddress);
+  if (peer == 0)
+    return -1;
+
+  m_sent++;
+  if (m_serialize)
+    {
+      Simulator::Schedule (m_delay, &BpLoopbackCla::DeliverPacket, peer, SerializeBundle (bundle, fragment));
+      return 0;
+    }
+
+  // The headers are those of the stored bundle, with the fields of the
+  // fragment sent; the ADU bytes are shared.
+  BpHeader6 *bph = bundle->GetPrimaryHeader ();
+  Ptr<Bundle6> copy = Create<Bundle6> (bundle->m_adu->CreateFragment (fragment.GetFragOffset () - bph->GetFragOffset (), fragment.GetBlockLength ()));
+  *copy->GetPrimaryHeader () = *bph;
+  copy->GetPrimaryHeader ()->SetIsFragment (fragment.IsFragment ());
+  copy->GetPrimaryHeader ()->SetFragOffset (fragment.IsFragment () ? fragment.GetFragOffset () : 0);
+  *copy->GetPayloadHeader () = *bundle->GetPayloadHeader ();
+  copy->GetPayloadHeader ()->SetBlockLength (fragment.GetBlockLength ());
+  copy->ctebPresent = bundle->ctebPresent;
+  copy->cteb = bundle->cteb;
+  Simulator::Schedule (m_delay, &BpLoopbackCla::DeliverBundle, peer, copy);
+  return 0;
+}
+
+int
+BpLoopbackCla::SendBundle (Ptr<Bundle7> bundle, const BpFragmentHeader7 &fragment, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
+  NS_LOG_FUNCTION (this << " " << bundle << " size " << fragment.GetBlockLength ());
+  Ptr<BpLoopbackCla> peer = FindPeer (dstAddress);
+  if (peer == 0)
+    return -1;
+
+  m_sent++;
+  if (m_serialize)
+    {
+      Simulator::Schedule (m_delay, &BpLoopbackCla::DeliverPacket, peer, SerializeBundle (bundle, fragment));
+      return 0;
+    }
+
+  BpHeader7 *bph = bundle->GetPrimaryHeader ();
+  Ptr<Bundle7> copy = Create<Bundle7> (bundle->m_adu->CreateFragment (fragment.GetFragOffset () - bph->GetFragOffset (), fragment.GetBlockLength ()));
+  *copy->GetPrimaryHeader () = *bph;
+  copy->GetPrimaryHeader ()->SetIsFragment (fragment.IsFragment ());
+  copy->GetPrimaryHeader ()->SetFragOffset (fragment.IsFragment () ? fragment.GetFragOffset () : 0);
+  *copy->GetPayloadHeader () = *bundle->GetPayloadHeader ();
+  Simulator::Schedule (m_delay, &BpLoopbackCla::DeliverBundle, peer, copy);
+  return 0;
+}
+
+void
+BpLoopbackCla::DeliverBundle (Ptr<Bundle> bundle)
+{
+  NS_LOG_FUNCTION (this << " " << bundle);
+  m_received++;
+  ReceiveBundle (bundle);
+}
+
+void
+BpLoopbackCla::DeliverPacket (Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << " " << packet->GetSize ());
+  m_received++;
+  ProcessReceivedBundle (packet);
+}
+
+uint64_t
+BpLoopbackCla::GetBundlesSent () const
+{
+  return m_sent;
+}
+
+uint64_t
+BpLoopbackCla::GetBundlesReceived () const
+{
+  return m_received;
+}
+
+TypeId
+BpLoopbackCla::GetSocketTypeId ()
+{
+  return TypeId ();
+}
+
+void
+BpLoopbackCla::SetL4SocketCallbacks (Ptr<Socket> socket)
+{
+}
+
+} // namespace ns3
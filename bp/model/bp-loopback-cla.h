@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_LOOPBACK_CLA_H
+#define BP_LOOPBACK_CLA_H
+
+#include "bp-cla.h"
+#include "ns3/nstime.h"
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief In-process convergence layer
+ *
+ * Connects agents in the same simulation directly, without sockets or an
+ * IP stack, so that runs measure the bundle protocol rather than the
+ * transport.  Each registration listens on its address and port, which
+ * need not belong to any node, and a bundle sent to an address is handed
+ * to the loopback CLA listening there after Delay.  The addresses are
+ * those of the running simulation: they are freed when a CLA is disposed
+ * of, and all of them by Simulator::Destroy ().
+ *
+ * By default the receiver gets a new bundle object that copies the
+ * headers and shares the ADU bytes of the fragment sent, so no encoding
+ * is done; with Serialize set, each bundle is encoded as the other CLAs
+ * send it and decoded on receipt, to include the cost of the codec.
+ *
+ * The CLA takes every bundle at once and does not fragment them
+ * (MaxBundleSize is 0).  A bundle sent to an address no loopback CLA
+ * listens on is refused, and stays forward-pending at the agent, which
+ * forwards it again after its SendRetryInterval.
+ */
+class BpLoopbackCla : public BpCla
+{
+public:
+
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Constructor
+   */
+  BpLoopbackCla (Callback<void, Ptr<Bundle>> processBundleCallback = (Callback<void, Ptr<Bundle>>)0);
+
+  /**
+   * Destroy
+   */
+  virtual ~BpLoopbackCla ();
+
+  /**
+   * Listen on the address of a registration
+   *
+   * \param local the endpoint id of registration
+   * \param localAddress the address of the local endpoint id
+   * \param bpNode the node of receiver bpAgent
+   */
+  virtual int EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode);
+
+  /**
+   * Stop listening for a registration; the address is freed once no
+   * registration uses it
+   *
+   * \param local the endpoint id of registration
+   */
+  virtual int DisableReceive (const BpEndpointId &local);
+
+  virtual int SendBundle (Ptr<Bundle6> bundle, const BpFragmentHeader6 &fragment, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+  virtual int SendBundle (Ptr<Bundle7> bundle, const BpFragmentHeader7 &fragment, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+  using BpCla::SendBundle;
+
+  /**
+   * \return the number of bundles (fragments) sent
+   */
+  uint64_t GetBundlesSent () const;
+
+  /**
+   * \return the number of bundles (fragments) handed to the agent
+   */
+  uint64_t GetBundlesReceived () const;
+
+protected:
+
+  virtual void DoDispose (void);
+
+private:
+
+  typedef std::pair<uint32_t, uint16_t> ListenKey;   /// IPv4 address and port
+
+  virtual TypeId GetSocketTypeId();
+  virtual void SetL4SocketCallbacks (Ptr<Socket> socket);
+
+  /**
+   * \return the loopback CLA listening on an address, or 0
+   */
+  static Ptr<BpLoopbackCla> FindPeer (InetSocketAddress address);
+
+  /**
+   * Stop listening on every address.
+   */
+  void Unlisten ();
+
+  void DeliverBundle (Ptr<Bundle> bundle);
+  void DeliverPacket (Ptr<Packet> packet);
+
+  Time m_delay;                      /// Delay attribute
+  bool m_serialize;                  /// Serialize attribute
+
+  std::map<BpEndpointId, ListenKey> m_listening;  /// address of each registration
+
+  uint64_t m_sent;
+  uint64_t m_received;
+};
+
+} // namespace ns3
+
+#endif /* BP_LOOPBACK_CLA_H */
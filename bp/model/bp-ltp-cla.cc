@@ -0,0 +1,857 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-ltp-cla.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/udp-socket-factory.h"
+#include <algorithm>
+
+// port assigned to LTP over UDP (RFC 5326 section 10.1)
+#define LTP_UDP_PORT 1113
+
+// client service id of the bundle protocol
+#define LTP_BUNDLE_PROTOCOL 1
+
+// IPv4 and UDP headers, counted against DataRate
+#define LTP_UDP_OVERHEAD 28
+
+NS_LOG_COMPONENT_DEFINE ("BpLtpCla");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (BpLtpCla);
+
+TypeId
+BpLtpCla::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpLtpCla")
+    .SetParent<BpCla> ()
+    .AddConstructor<BpLtpCla> ()
+    .AddAttribute ("MaxBundleSize", "Largest encoded bundle sent in one block, in bytes; larger bundles are fragmented",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&BpLtpCla::m_maxBundleSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SegmentSize", "Largest block data carried by one segment, in bytes",
+                   UintegerValue (1400),
+                   MakeUintegerAccessor (&BpLtpCla::m_segmentSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("RedPartLength", "Length of the red, reliably sent, part of each block; the rest is green",
+                   UintegerValue (0xffffffff),
+                   MakeUintegerAccessor (&BpLtpCla::m_redPartLength),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("OneWayDelay", "One-way light time to the peer engines, which sizes the retransmission timers",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&BpLtpCla::m_oneWayDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("TimerMargin", "Time added to the round trip for the peer to answer a checkpoint or report",
+                   TimeValue (MilliSeconds (500)),
+                   MakeTimeAccessor (&BpLtpCla::m_timerMargin),
+                   MakeTimeChecker ())
+    .AddAttribute ("RetransmissionLimit", "Times a checkpoint or report is sent again before its session is cancelled",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&BpLtpCla::m_retransmissionLimit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DataRate", "Rate at which segments are sent",
+                   DataRateValue (DataRate ("1Mbps")),
+                   MakeDataRateAccessor (&BpLtpCla::m_dataRate),
+                   MakeDataRateChecker ())
+  ;
+  return tid;
+}
+
+BpLtpCla::ExportSession::ExportSession ()
+  : redLength (0),
+    nextCheckpointSerial (1)
+{
+}
+
+BpLtpCla::ImportSession::ImportSession ()
+  : redKnown (false),
+    redLength (0),
+    lengthKnown (false),
+    length (0),
+    delivered (false),
+    redAcked (false),
+    nextReportSerial (1)
+{
+}
+
+BpLtpCla::BpLtpCla (Callback<void, Ptr<Bundle>> processBundleCallback)
+  : BpCla (processBundleCallback),
+    m_port (LTP_UDP_PORT),
+    m_segmentSize (1400),
+    m_redPartLength (0xffffffff),
+    m_oneWayDelay (Seconds (1)),
+    m_timerMargin (MilliSeconds (500)),
+    m_retransmissionLimit (10),
+    m_dataRate (DataRate ("1Mbps")),
+    m_engineId (0),
+    m_nextSession (1),
+    m_outgoingBytes (0),
+    m_outgoingFull (false),
+    m_retransmitted (0),
+    m_cancelled (0)
+{
+  NS_LOG_FUNCTION (this);
+  // reports come back on the sending sockets
+  m_duplex = true;
+}
+
+BpLtpCla::~BpLtpCla ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+BpLtpCla::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_sendEvent);
+  m_outgoing.clear ();
+  m_outgoingBytes = 0;
+  while (!m_exports.empty ())
+    CloseExport (m_exports.begin ()->first);
+  while (!m_imports.empty ())
+    CloseImport (m_imports.begin ()->first);
+  m_finished.clear ();
+  m_finishedExpiry.clear ();
+  m_portSockets.clear ();
+  BpCla::DoDispose ();
+}
+
+int
+BpLtpCla::EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode)
+{
+  NS_LOG_FUNCTION (this << " " << local.Uri ());
+
+  if (m_engineId == 0)
+    m_engineId = bpNode->GetId () + 1;
+
+  uint16_t port = m_port;
+  InetSocketAddress defaultAddr ("127.0.0.1", 0);
+  if (!(localAddress == defaultAddr))
+    port = localAddress.GetPort ();
+
+  std::map<BpEndpointId, Ptr<Socket> >::iterator it = m_l4RecvSockets.find (local);
+  if (it != m_l4RecvSockets.end ())
+    return -1;
+
+  // Registrations on the same port share its socket, which can only be
+  // bound once.
+  std::map<uint16_t, Ptr<Socket> >::iterator pit = m_portSockets.find (port);
+  if (pit != m_portSockets.end ())
+    {
+      m_l4RecvSockets.insert (std::pair<BpEndpointId, Ptr<Socket> >(local, pit->second));
+      return 0;
+    }
+
+  InetSocketAddress address (Ipv4Address::GetAny (), port);
+  Ptr<Socket> socket = Socket::CreateSocket (bpNode, GetSocketTypeId ());
+  if (socket->Bind (address) < 0)
+    {
+      NS_LOG_DEBUG ("BpLtpCla::EnableReceive (): Udp Bind port " << port);
+      return -1;
+    }
+
+  SetL4SocketCallbacks (socket);
+
+  m_l4RecvSockets.insert (std::pair<BpEndpointId, Ptr<Socket> >(local, socket));
+  m_portSockets[port] = socket;
+
+  return 0;
+}
+
+int
+BpLtpCla::DisableReceive (const BpEndpointId &local)
+{
+  NS_LOG_FUNCTION (this << " " << local.Uri ());
+  std::map<BpEndpointId, Ptr<Socket> >::iterator it = m_l4RecvSockets.find (local);
+  if (it == m_l4RecvSockets.end ())
+    return -1;
+  Ptr<Socket> socket = it->second;
+  m_l4RecvSockets.erase (it);
+
+  for (it = m_l4RecvSockets.begin (); it != m_l4RecvSockets.end (); it++)
+    {
+      if (it->second == socket)
+        return 0;
+    }
+  std::map<uint16_t, Ptr<Socket> >::iterator pit;
+  for (pit = m_portSockets.begin (); pit != m_portSockets.end (); pit++)
+    {
+      if (pit->second == socket)
+        {
+          m_portSockets.erase (pit);
+          break;
+        }
+    }
+  return socket->Close ();
+}
+
+Ptr<Socket>
+BpLtpCla::GetL4Socket (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
+  if (m_engineId == 0)
+    m_engineId = bpNode->GetId () + 1;
+  return BpCla::GetL4Socket (src, dst, dstAddress, bpNode);
+}
+
+void
+BpLtpCla::SetL4SocketCallbacks (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << " " << socket);
+
+  socket->SetCloseCallbacks (
+    MakeCallback (&BpLtpCla::NormalClose, this),
+    MakeCallback (&BpLtpCla::ErrorClose, this));
+
+  socket->SetDataSentCallback (
+    MakeCallback (&BpLtpCla::DataSent, this));
+
+  socket->SetSendCallback (
+    MakeCallback (&BpLtpCla::Sent, this));
+
+  socket->SetRecvCallback (
+    MakeCallback (&BpLtpCla::DataRecv, this));
+}
+
+TypeId
+BpLtpCla::GetSocketTypeId ()
+{
+  return UdpSocketFactory::GetTypeId ();
+}
+
+// Sending
+
+int
+BpLtpCla::Transmit (Ptr<Socket> socket, Ptr<Packet> bundle)
+{
+  uint64_t session = m_nextSession++;
+  ExportSession &es = m_exports[session];
+  es.socket = socket;
+  es.block = bundle;
+  uint32_t length = bundle->GetSize ();
+  es.redLength = std::min (length, m_redPartLength);
+  NS_LOG_DEBUG ("export session " << session << ": " << length << " byte block, "
+                << es.redLength << " red");
+
+  if (es.redLength > 0)
+    {
+      uint8_t type = es.redLength == length ? LtpSegmentHeader::RED_DATA_CP_EORP_EOB
+                                            : LtpSegmentHeader::RED_DATA_CP_EORP;
+      SendRange (session, es, 0, es.redLength, type, 0);
+    }
+  if (es.redLength < length)
+    SendRange (session, es, es.redLength, length, LtpSegmentHeader::GREEN_DATA_EOB, 0);
+
+  // A green block is done once it is queued.
+  if (es.redLength == 0)
+    CloseExport (session);
+  return 0;
+}
+
+Ptr<Packet>
+BpLtpCla::DataSegment (uint64_t session, const ExportSession &es, uint8_t type, uint32_t offset, uint32_t length)
+{
+  LtpSegmentHeader header (type);
+  header.SetEngineId (m_engineId);
+  header.SetSessionNumber (session);
+  header.SetClientServiceId (LTP_BUNDLE_PROTOCOL);
+  header.SetOffset (offset);
+  header.SetLength (length);
+  Ptr<Packet> segment = es.block->CreateFragment (offset, length);
+  segment->AddHeader (header);
+  return segment;
+}
+
+void
+BpLtpCla::SendRange (uint64_t session, ExportSession &es, uint32_t start, uint32_t end, uint8_t type, uint64_t reportSerial)
+{
+  bool red = start < es.redLength;
+  Outgoing out;
+  out.socket = es.socket;
+  out.reply = false;
+  out.timer = NO_TIMER;
+  out.session = SessionKey (m_engineId, session);
+  out.serial = 0;
+  for (uint32_t offset = start; offset < end; offset += m_segmentSize)
+    {
+      uint32_t length = std::min (m_segmentSize, end - offset);
+      if (offset + length < end)
+        {
+          out.packet = DataSegment (session, es, red ? LtpSegmentHeader::RED_DATA : LtpSegmentHeader::GREEN_DATA, offset, length);
+          Send (out);
+          continue;
+        }
+      LtpSegmentHeader header (type);
+      header.SetEngineId (m_engineId);
+      header.SetSessionNumber (session);
+      header.SetClientServiceId (LTP_BUNDLE_PROTOCOL);
+      header.SetOffset (offset);
+      header.SetLength (length);
+      if (header.IsCheckpoint ())
+        {
+          header.SetCheckpointSerial (es.nextCheckpointSerial++);
+          header.SetReportSerial (reportSerial);
+          out.timer = CHECKPOINT_TIMER;
+          out.serial = header.GetCheckpointSerial ();
+        }
+      out.packet = es.block->CreateFragment (offset, length);
+      out.packet->AddHeader (header);
+      if (header.IsCheckpoint ())
+        es.checkpoints[out.serial].segment = out.packet;
+      Send (out);
+    }
+}
+
+void
+BpLtpCla::Send (const Outgoing &out)
+{
+  m_outgoing.push_back (out);
+  m_outgoingBytes += out.packet->GetSize ();
+  if (GetTxQueueLimit () != 0 && m_outgoingBytes >= GetTxQueueLimit () && !m_outgoingFull)
+    {
+      NS_LOG_DEBUG ("paced queue full with " << m_outgoingBytes << " bytes");
+      m_outgoingFull = true;
+    }
+  if (!m_sendEvent.IsRunning ())
+    SendNext ();
+}
+
+void
+BpLtpCla::SendNext ()
+{
+  if (m_outgoing.empty ())
+    return;
+  Outgoing out = m_outgoing.front ();
+  m_outgoing.pop_front ();
+  m_outgoingBytes -= out.packet->GetSize ();
+
+  // The socket adds its headers to the packet it is given, and checkpoints
+  // and reports are kept to be sent again.
+  Ptr<Packet> p = out.packet->Copy ();
+  int sent = out.reply ? out.socket->SendTo (p, 0, out.to) : out.socket->Send (p);
+  if (sent < 0)
+    NS_LOG_WARN ("socket refused a " << out.packet->GetSize () << " byte segment, errno " << out.socket->GetErrno ());
+  StartTimer (out);
+
+  Time gap = m_dataRate.CalculateBytesTxTime (out.packet->GetSize () + LTP_UDP_OVERHEAD);
+  m_sendEvent = Simulator::Schedule (gap, &BpLtpCla::SendNext, this);
+
+  // Only once the next send is scheduled, so that the segments of bundles
+  // sent from the ready callback wait for it.
+  if (m_outgoingFull && (GetTxQueueLimit () == 0 || m_outgoingBytes < GetTxQueueLimit ()))
+    {
+      NS_LOG_DEBUG ("paced queue has room again");
+      m_outgoingFull = false;
+      NotifyReady ();
+    }
+}
+
+bool
+BpLtpCla::IsReady ()
+{
+  return BpCla::IsReady () && !m_outgoingFull;
+}
+
+uint64_t
+BpLtpCla::GetOutgoingBytes () const
+{
+  return m_outgoingBytes;
+}
+
+void
+BpLtpCla::StartTimer (const Outgoing &out)
+{
+  // The timers run from when the segment leaves, not when it is queued.
+  Time timeout = m_oneWayDelay * 2 + m_timerMargin;
+  if (out.timer == CHECKPOINT_TIMER)
+    {
+      std::map<uint64_t, ExportSession>::iterator it = m_exports.find (out.session.second);
+      if (it == m_exports.end ())
+        return;
+      std::map<uint64_t, Pending>::iterator cp = it->second.checkpoints.find (out.serial);
+      if (cp != it->second.checkpoints.end ())
+        cp->second.timer = Simulator::Schedule (timeout, &BpLtpCla::CheckpointTimeout, this, out.session.second, out.serial);
+    }
+  else if (out.timer == REPORT_TIMER)
+    {
+      std::map<SessionKey, ImportSession>::iterator it = m_imports.find (out.session);
+      if (it == m_imports.end ())
+        return;
+      std::map<uint64_t, Pending>::iterator rs = it->second.reports.find (out.serial);
+      if (rs != it->second.reports.end ())
+        rs->second.timer = Simulator::Schedule (timeout, &BpLtpCla::ReportTimeout, this, out.session, out.serial);
+    }
+}
+
+void
+BpLtpCla::CheckpointTimeout (uint64_t session, uint64_t serial)
+{
+  std::map<uint64_t, ExportSession>::iterator it = m_exports.find (session);
+  if (it == m_exports.end ())
+    return;
+  std::map<uint64_t, Pending>::iterator cp = it->second.checkpoints.find (serial);
+  if (cp == it->second.checkpoints.end ())
+    return;
+  if (++cp->second.retries > m_retransmissionLimit)
+    {
+      NS_LOG_WARN ("export session " << session << ": checkpoint " << serial << " not answered, cancelling");
+      SendSignal (it->second.socket, 0, LtpSegmentHeader::CANCEL_FROM_SENDER, m_engineId, session, LtpSegmentHeader::RLEXC);
+      CloseExport (session);
+      m_cancelled++;
+      return;
+    }
+  NS_LOG_DEBUG ("export session " << session << ": checkpoint " << serial << " sent again");
+  Outgoing out;
+  out.socket = it->second.socket;
+  out.packet = cp->second.segment;
+  out.reply = false;
+  out.timer = CHECKPOINT_TIMER;
+  out.session = SessionKey (m_engineId, session);
+  out.serial = serial;
+  Send (out);
+}
+
+void
+BpLtpCla::SendSignal (Ptr<Socket> socket, const Address *to, uint8_t type, uint64_t engineId, uint64_t session, uint8_t reason)
+{
+  LtpSegmentHeader header (type);
+  header.SetEngineId (engineId);
+  header.SetSessionNumber (session);
+  header.SetReason (reason);
+  Outgoing out;
+  out.socket = socket;
+  out.packet = Create<Packet> ();
+  out.packet->AddHeader (header);
+  out.reply = to != 0;
+  if (to)
+    out.to = *to;
+  out.timer = NO_TIMER;
+  out.session = SessionKey (engineId, session);
+  out.serial = 0;
+  Send (out);
+}
+
+void
+BpLtpCla::CloseExport (uint64_t session)
+{
+  std::map<uint64_t, ExportSession>::iterator it = m_exports.find (session);
+  if (it == m_exports.end ())
+    return;
+  std::map<uint64_t, Pending>::iterator cp;
+  for (cp = it->second.checkpoints.begin (); cp != it->second.checkpoints.end (); cp++)
+    Simulator::Cancel (cp->second.timer);
+  m_exports.erase (it);
+}
+
+// Receiving
+
+void
+BpLtpCla::DataRecv (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << " " << socket);
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+    ReceiveSegment (socket, from, packet);
+}
+
+void
+BpLtpCla::ReceiveSegment (Ptr<Socket> socket, const Address &from, Ptr<Packet> packet)
+{
+  LtpSegmentHeader header;
+  if (packet->RemoveHeader (header) == 0)
+    {
+      NS_LOG_WARN ("discarding a segment that could not be decoded");
+      return;
+    }
+  NS_LOG_DEBUG ("received " << header);
+
+  SessionKey key (header.GetEngineId (), header.GetSessionNumber ());
+  switch (header.GetType ())
+    {
+    case LtpSegmentHeader::REPORT:
+      ReceiveReport (socket, header);
+      break;
+    case LtpSegmentHeader::REPORT_ACK:
+      ReceiveReportAck (header);
+      break;
+    case LtpSegmentHeader::CANCEL_FROM_SENDER:
+      SendSignal (socket, &from, LtpSegmentHeader::CANCEL_ACK_TO_SENDER, key.first, key.second, 0);
+      if (m_imports.find (key) != m_imports.end ())
+        {
+          NS_LOG_WARN ("import session " << key.first << "/" << key.second << " cancelled by the sender, reason " << (uint32_t) header.GetReason ());
+          CloseImport (key);
+          m_cancelled++;
+        }
+      break;
+    case LtpSegmentHeader::CANCEL_FROM_RECEIVER:
+      SendSignal (socket, 0, LtpSegmentHeader::CANCEL_ACK_TO_RECEIVER, key.first, key.second, 0);
+      if (m_exports.find (key.second) != m_exports.end ())
+        {
+          NS_LOG_WARN ("export session " << key.second << " cancelled by the receiver, reason " << (uint32_t) header.GetReason ());
+          CloseExport (key.second);
+          m_cancelled++;
+        }
+      break;
+    case LtpSegmentHeader::CANCEL_ACK_TO_SENDER:
+    case LtpSegmentHeader::CANCEL_ACK_TO_RECEIVER:
+      break;
+    default:
+      if (header.GetClientServiceId () != LTP_BUNDLE_PROTOCOL)
+        {
+          NS_LOG_WARN ("discarding a segment for client service " << header.GetClientServiceId ());
+          return;
+        }
+      if (packet->GetSize () != header.GetLength ())
+        {
+          NS_LOG_WARN ("discarding a segment of " << packet->GetSize () << " bytes that claims " << header.GetLength ());
+          return;
+        }
+      ReceiveData (socket, from, header, packet);
+      break;
+    }
+}
+
+void
+BpLtpCla::ReceiveData (Ptr<Socket> socket, const Address &from, const LtpSegmentHeader &header, Ptr<Packet> data)
+{
+  SessionKey key (header.GetEngineId (), header.GetSessionNumber ());
+  if (m_finished.find (key) != m_finished.end ())
+    {
+      NS_LOG_DEBUG ("segment of finished import session " << key.first << "/" << key.second);
+      return;
+    }
+  // Blocks are at most 4 GB, as are the bundles this CLA sends.
+  uint64_t offset = header.GetOffset ();
+  uint64_t length = header.GetLength ();
+  if (offset > 0xffffffff || length > 0xffffffff - offset)
+    {
+      NS_LOG_WARN ("discarding a segment of " << length << " bytes at offset " << offset << ", past 4 GB");
+      return;
+    }
+  uint32_t start = offset;
+  uint32_t end = offset + length;
+  std::map<SessionKey, ImportSession>::iterator found = m_imports.find (key);
+  if (found != m_imports.end () && found->second.lengthKnown && end > found->second.length)
+    {
+      NS_LOG_WARN ("discarding a segment that ends at " << end << ", past the end of the block at " << found->second.length);
+      return;
+    }
+  ImportSession &is = m_imports[key];
+  if (!is.socket)
+    {
+      is.socket = socket;
+      is.from = from;
+    }
+
+  // A session that hears nothing for as long as the sender keeps trying
+  // is given up.
+  Simulator::Cancel (is.idle);
+  is.idle = Simulator::Schedule (GetIdleTime (), &BpLtpCla::IdleTimeout, this, key);
+
+  if (header.IsEndOfRedPart ())
+    {
+      is.redKnown = true;
+      is.redLength = end;
+    }
+  if (header.IsEndOfBlock ())
+    {
+      is.lengthKnown = true;
+      is.length = end;
+    }
+  if (!is.delivered)
+    {
+      BpRangeSet &held = header.IsRed () ? is.red : is.green;
+      if (held.Add (start, end) > 0)
+        is.data[start] = data;
+    }
+
+  if (header.IsCheckpoint ())
+    SendReport (key, is, header.GetCheckpointSerial (), end);
+
+  CheckComplete (key, is);
+}
+
+void
+BpLtpCla::SendReport (SessionKey key, ImportSession &is, uint64_t checkpointSerial, uint64_t upper)
+{
+  LtpSegmentHeader header (LtpSegmentHeader::REPORT);
+  header.SetEngineId (key.first);
+  header.SetSessionNumber (key.second);
+  header.SetReportSerial (is.nextReportSerial++);
+  header.SetCheckpointSerial (checkpointSerial);
+  header.SetBounds (0, upper);
+  BpRangeSet::const_iterator it;
+  for (it = is.red.begin (); it != is.red.end () && it->first < upper; it++)
+    header.AddClaim (it->first, std::min ((uint64_t) it->second, upper) - it->first);
+
+  Pending &report = is.reports[header.GetReportSerial ()];
+  report.segment = Create<Packet> ();
+  report.segment->AddHeader (header);
+  report.complete = is.redKnown && upper >= is.redLength && is.red.Covers (0, is.redLength);
+
+  Outgoing out;
+  out.socket = is.socket;
+  out.packet = report.segment;
+  out.reply = true;
+  out.to = is.from;
+  out.timer = REPORT_TIMER;
+  out.session = key;
+  out.serial = header.GetReportSerial ();
+  Send (out);
+}
+
+void
+BpLtpCla::ReceiveReport (Ptr<Socket> socket, const LtpSegmentHeader &header)
+{
+  uint64_t session = header.GetSessionNumber ();
+
+  // Every report is acknowledged, also those of sessions already closed.
+  LtpSegmentHeader ack (LtpSegmentHeader::REPORT_ACK);
+  ack.SetEngineId (header.GetEngineId ());
+  ack.SetSessionNumber (session);
+  ack.SetReportSerial (header.GetReportSerial ());
+  Outgoing out;
+  out.socket = socket;
+  out.packet = Create<Packet> ();
+  out.packet->AddHeader (ack);
+  out.reply = false;
+  out.timer = NO_TIMER;
+  out.session = SessionKey (header.GetEngineId (), session);
+  out.serial = 0;
+  Send (out);
+
+  std::map<uint64_t, ExportSession>::iterator it = m_exports.find (session);
+  if (it == m_exports.end () || header.GetEngineId () != m_engineId)
+    return;
+  ExportSession &es = it->second;
+  if (!es.reportsHandled.insert (header.GetReportSerial ()).second)
+    return;
+
+  std::map<uint64_t, Pending>::iterator cp = es.checkpoints.find (header.GetCheckpointSerial ());
+  if (cp != es.checkpoints.end ())
+    {
+      Simulator::Cancel (cp->second.timer);
+      es.checkpoints.erase (cp);
+    }
+
+  BpRangeSet &claimed = es.claimed;
+  uint64_t lower = header.GetLowerBound ();
+  uint64_t upper = std::min (header.GetUpperBound (), (uint64_t) es.redLength);
+  const std::vector<LtpSegmentHeader::Claim> &claims = header.GetClaims ();
+  for (uint32_t i = 0; i < claims.size (); i++)
+    claimed.Add (lower + claims[i].first, lower + claims[i].first + claims[i].second);
+  if (claimed.Covers (0, es.redLength))
+    {
+      NS_LOG_DEBUG ("export session " << session << ": red part received");
+      CloseExport (session);
+      return;
+    }
+
+  // Send the gaps between the claims again, the last segment being a new
+  // checkpoint that answers this report.
+  std::vector<std::pair<uint32_t, uint32_t> > gaps;
+  uint64_t next = lower;
+  BpRangeSet::const_iterator c;
+  for (c = claimed.begin (); c != claimed.end () && next < upper; c++)
+    {
+      if (c->first > next)
+        gaps.push_back (std::make_pair (next, std::min ((uint64_t) c->first, upper)));
+      next = std::max (next, (uint64_t) c->second);
+    }
+  if (next < upper)
+    gaps.push_back (std::make_pair (next, upper));
+  for (uint32_t i = 0; i < gaps.size (); i++)
+    {
+      uint32_t start = gaps[i].first;
+      uint32_t end = gaps[i].second;
+      uint8_t type = LtpSegmentHeader::RED_DATA;
+      if (i + 1 == gaps.size ())
+        {
+          if (end < es.redLength)
+            type = LtpSegmentHeader::RED_DATA_CP;
+          else if (es.redLength < es.block->GetSize ())
+            type = LtpSegmentHeader::RED_DATA_CP_EORP;
+          else
+            type = LtpSegmentHeader::RED_DATA_CP_EORP_EOB;
+        }
+      m_retransmitted += (end - start + m_segmentSize - 1) / m_segmentSize;
+      SendRange (session, es, start, end, type, header.GetReportSerial ());
+    }
+}
+
+void
+BpLtpCla::ReceiveReportAck (const LtpSegmentHeader &header)
+{
+  SessionKey key (header.GetEngineId (), header.GetSessionNumber ());
+  std::map<SessionKey, ImportSession>::iterator it = m_imports.find (key);
+  if (it == m_imports.end ())
+    return;
+  ImportSession &is = it->second;
+  std::map<uint64_t, Pending>::iterator rs = is.reports.find (header.GetReportSerial ());
+  if (rs == is.reports.end ())
+    return;
+  Simulator::Cancel (rs->second.timer);
+  if (rs->second.complete)
+    is.redAcked = true;
+  is.reports.erase (rs);
+  if (is.redAcked && is.delivered)
+    CloseImport (key);
+}
+
+void
+BpLtpCla::ReportTimeout (SessionKey key, uint64_t serial)
+{
+  std::map<SessionKey, ImportSession>::iterator it = m_imports.find (key);
+  if (it == m_imports.end ())
+    return;
+  ImportSession &is = it->second;
+  std::map<uint64_t, Pending>::iterator rs = is.reports.find (serial);
+  if (rs == is.reports.end ())
+    return;
+  if (++rs->second.retries > m_retransmissionLimit)
+    {
+      NS_LOG_WARN ("import session " << key.first << "/" << key.second << ": report " << serial << " not acknowledged, cancelling");
+      if (!is.delivered)
+        {
+          SendSignal (is.socket, &is.from, LtpSegmentHeader::CANCEL_FROM_RECEIVER, key.first, key.second, LtpSegmentHeader::RLEXC);
+          m_cancelled++;
+        }
+      CloseImport (key);
+      return;
+    }
+  NS_LOG_DEBUG ("import session " << key.first << "/" << key.second << ": report " << serial << " sent again");
+  Outgoing out;
+  out.socket = is.socket;
+  out.packet = rs->second.segment;
+  out.reply = true;
+  out.to = is.from;
+  out.timer = REPORT_TIMER;
+  out.session = key;
+  out.serial = serial;
+  Send (out);
+}
+
+Time
+BpLtpCla::GetIdleTime () const
+{
+  return (m_oneWayDelay * 2 + m_timerMargin) * (m_retransmissionLimit + 1);
+}
+
+void
+BpLtpCla::IdleTimeout (SessionKey key)
+{
+  std::map<SessionKey, ImportSession>::iterator it = m_imports.find (key);
+  if (it == m_imports.end ())
+    return;
+  if (!it->second.delivered)
+    {
+      NS_LOG_WARN ("import session " << key.first << "/" << key.second << " gone quiet with "
+                   << it->second.red.GetCovered () + it->second.green.GetCovered () << " bytes, dropping it");
+      m_cancelled++;
+    }
+  CloseImport (key);
+}
+
+void
+BpLtpCla::CheckComplete (SessionKey key, ImportSession &is)
+{
+  if (is.delivered || !is.lengthKnown)
+    return;
+  uint32_t red = is.redKnown ? is.redLength : 0;
+  if (!is.red.Covers (0, red) || (!is.redKnown && !is.red.IsEmpty ()) || !is.green.Covers (red, is.length))
+    return;
+
+  // Segments sent again may be split differently, so take each one from
+  // where the block so far ends.
+  Ptr<Packet> block = Create<Packet> ();
+  std::map<uint32_t, Ptr<Packet> >::iterator it;
+  for (it = is.data.begin (); it != is.data.end (); it++)
+    {
+      uint32_t pos = block->GetSize ();
+      uint32_t end = it->first + it->second->GetSize ();
+      if (end <= pos)
+        continue;
+      block->AddAtEnd (it->second->CreateFragment (pos - it->first, end - pos));
+    }
+  is.data.clear ();
+  is.delivered = true;
+  NS_LOG_DEBUG ("import session " << key.first << "/" << key.second << ": " << block->GetSize () << " byte block received");
+
+  // A red session is kept until a report that claims all of the red part
+  // is acknowledged, to answer checkpoints sent again.
+  if (!is.redKnown || is.redLength == 0 || is.redAcked)
+    CloseImport (key);
+
+  ProcessReceivedBundle (block);
+}
+
+void
+BpLtpCla::CloseImport (SessionKey key)
+{
+  std::map<SessionKey, ImportSession>::iterator it = m_imports.find (key);
+  if (it == m_imports.end ())
+    return;
+  std::map<uint64_t, Pending>::iterator rs;
+  for (rs = it->second.reports.begin (); rs != it->second.reports.end (); rs++)
+    Simulator::Cancel (rs->second.timer);
+  Simulator::Cancel (it->second.idle);
+  if (it->second.delivered)
+    {
+      // Segments of a delivered block that were sent again may still be on
+      // their way; they must not start a new session.  Finished sessions
+      // are forgotten in the order they expire.
+      Time now = Simulator::Now ();
+      while (!m_finishedExpiry.empty () && m_finishedExpiry.begin ()->first <= now)
+        {
+          m_finished.erase (m_finishedExpiry.begin ()->second);
+          m_finishedExpiry.erase (m_finishedExpiry.begin ());
+        }
+      Time expiry = now + GetIdleTime ();
+      m_finished[key] = expiry;
+      m_finishedExpiry.insert (std::make_pair (expiry, key));
+    }
+  m_imports.erase (it);
+}
+
+uint32_t
+BpLtpCla::GetExportSessions () const
+{
+  return m_exports.size ();
+}
+
+uint32_t
+BpLtpCla::GetImportSessions () const
+{
+  return m_imports.size ();
+}
+
+uint64_t
+BpLtpCla::GetRetransmittedSegments () const
+{
+  return m_retransmitted;
+}
+
+uint64_t
+BpLtpCla::GetCancelledSessions () const
+{
+  return m_cancelled;
+}
+
+} // namespace ns3
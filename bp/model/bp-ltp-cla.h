@@ -0,0 +1,308 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_LTP_CLA_H
+#define BP_LTP_CLA_H
+
+#include "bp-cla.h"
+#include "bp-ltp-header.h"
+#include "bp-range-set.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/data-rate.h"
+#include <deque>
+#include <map>
+#include <set>
+
+namespace ns3 {
+
+/**
+ * \brief LTP convergence layer
+ *
+ * Sends each bundle as one block of the Licklider Transmission Protocol
+ * (RFC 5326) over UDP, for links whose delay rules out TCP.  The first
+ * RedPartLength bytes of a block are red and the rest green.  The red part
+ * is sent as data segments of SegmentSize bytes, the last of which is a
+ * checkpoint; the receiver answers each checkpoint with a report segment
+ * that claims the red bytes it holds, and the sender sends the bytes that
+ * were not claimed again, ending with a new checkpoint, until a report
+ * claims the whole red part.  Green segments are sent once.  A block is
+ * handed to the agent once it is complete, so a block with green bytes
+ * that were lost is dropped.
+ *
+ * There is no handshake.  Checkpoints and reports are sent again if they
+ * are not answered within twice OneWayDelay plus TimerMargin of leaving
+ * this node, up to RetransmissionLimit times, after which the session is
+ * cancelled.  Segments leave at DataRate, which should not be more than
+ * the link's, since LTP has no congestion control.  Once the segments
+ * waiting for DataRate, to all peers, come to TxQueueBytes or more, the CLA
+ * is not ready, and the ready callback is called when they are below that
+ * again.
+ *
+ * A bundle is taken by the CLA as soon as it is sent, and bundles are not
+ * fragmented to fit segments (MaxBundleSize is 0).  Each registration
+ * listens on the port of its address, or on port 1113 if it has none.
+ */
+class BpLtpCla : public BpCla
+{
+public:
+
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Constructor
+   */
+  BpLtpCla (Callback<void, Ptr<Bundle>> processBundleCallback = (Callback<void, Ptr<Bundle>>)0);
+
+  /**
+   * Destroy
+   */
+  virtual ~BpLtpCla ();
+
+  /**
+   * Enable the transport layer to receive packets
+   *
+   * \param local the endpoint id of registration
+   * \param localAddress the address of the local endpoint id
+   * \param bpNode the node of receiver bpAgent
+   */
+  virtual int EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode);
+
+  /**
+   * Disable the transport layer to receive packets; the socket is closed
+   * once no registration uses it
+   *
+   * \param local the endpoint id of registration
+   */
+  virtual int DisableReceive (const BpEndpointId &local);
+
+  /**
+   * Get the sending socket, and take the local engine id from the node
+   */
+  virtual Ptr<Socket> GetL4Socket (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+  using BpCla::GetL4Socket;
+
+  /**
+   * \brief data receive callback, for segments of both export and import
+   * sessions
+   */
+  virtual void DataRecv (Ptr<Socket> socket);
+
+  /**
+   * \return the number of blocks being sent
+   */
+  uint32_t GetExportSessions () const;
+
+  /**
+   * \return the number of blocks being received
+   */
+  uint32_t GetImportSessions () const;
+
+  /**
+   * \return the number of data segments sent again after a report
+   */
+  uint64_t GetRetransmittedSegments () const;
+
+  /**
+   * \return the number of sessions cancelled, by either end, or given up
+   */
+  uint64_t GetCancelledSessions () const;
+
+  /**
+   * \return true if the CLA is ready and the segments waiting for DataRate
+   * are below TxQueueBytes
+   */
+  virtual bool IsReady ();
+
+  /**
+   * \return the bytes of the segments waiting for DataRate
+   */
+  uint64_t GetOutgoingBytes () const;
+
+protected:
+
+  virtual void DoDispose (void);
+
+  /**
+   * Start an export session for an encoded bundle
+   */
+  virtual int Transmit (Ptr<Socket> socket, Ptr<Packet> bundle);
+
+private:
+
+  /// a checkpoint or report segment waiting to be answered
+  struct Pending {
+    Pending () : retries (0), complete (false) {}
+
+    Ptr<Packet> segment;             /// as sent, to be sent again
+    EventId timer;                   /// running once the segment has left
+    uint32_t retries;
+    bool complete;                   /// a report that claims the whole red part
+  };
+
+  /// a block being sent
+  struct ExportSession {
+    ExportSession ();
+
+    Ptr<Socket> socket;              /// connected to the receiving engine
+    Ptr<Packet> block;
+    uint32_t redLength;
+    uint64_t nextCheckpointSerial;
+    std::map<uint64_t, Pending> checkpoints; /// unanswered, by serial
+    BpRangeSet claimed;              /// red bytes claimed by any report so far
+    std::set<uint64_t> reportsHandled; /// serials of the reports acted on
+  };
+
+  /// a block being received, keyed by engine id and session number
+  struct ImportSession {
+    ImportSession ();
+
+    Ptr<Socket> socket;              /// the segments came in on
+    Address from;                    /// the sending engine's address
+    std::map<uint32_t, Ptr<Packet> > data; /// segments by offset
+    BpRangeSet red;                  /// red bytes held
+    BpRangeSet green;                /// green bytes held
+    bool redKnown;                   /// the end of the red part is in
+    uint32_t redLength;
+    bool lengthKnown;                /// the end of the block is in
+    uint32_t length;
+    bool delivered;                  /// handed to the agent, kept to answer checkpoints
+    bool redAcked;                   /// a report claiming the whole red part was acknowledged
+    uint64_t nextReportSerial;
+    std::map<uint64_t, Pending> reports; /// unacknowledged, by serial
+    EventId idle;                    /// cancels a session that has gone quiet
+  };
+
+  typedef std::pair<uint64_t, uint64_t> SessionKey;
+
+  /// what to do when a paced segment leaves
+  enum Timer {
+    NO_TIMER,
+    CHECKPOINT_TIMER,
+    REPORT_TIMER
+  };
+
+  /// a segment waiting to be sent at DataRate
+  struct Outgoing {
+    Ptr<Socket> socket;
+    Ptr<Packet> packet;
+    bool reply;                      /// sent to the address below, not connected
+    Address to;
+    Timer timer;
+    SessionKey session;
+    uint64_t serial;
+  };
+
+  virtual TypeId GetSocketTypeId();
+
+  /**
+   * Set callbacks of the transport layer
+   *
+   * \param socket the transport layer socket
+   */
+  virtual void SetL4SocketCallbacks (Ptr<Socket> socket);
+
+  /**
+   * Build a data segment of the block of an export session.
+   */
+  Ptr<Packet> DataSegment (uint64_t session, const ExportSession &es, uint8_t type, uint32_t offset, uint32_t length);
+
+  /**
+   * Send the bytes of [start, end) of a block as data segments; the last
+   * one is a checkpoint if type is one.
+   *
+   * \param type the type of the last segment
+   * \param reportSerial the report a checkpoint answers, or 0
+   */
+  void SendRange (uint64_t session, ExportSession &es, uint32_t start, uint32_t end, uint8_t type, uint64_t reportSerial);
+
+  /**
+   * Add a segment to the paced queue, and start sending if it is idle.
+   */
+  void Send (const Outgoing &out);
+
+  /**
+   * Send the segment at the head of the paced queue, and schedule the next.
+   */
+  void SendNext ();
+
+  /**
+   * Start the timer of a checkpoint or report that has just left.
+   */
+  void StartTimer (const Outgoing &out);
+
+  void CheckpointTimeout (uint64_t session, uint64_t serial);
+  void ReportTimeout (SessionKey key, uint64_t serial);
+  void IdleTimeout (SessionKey key);
+
+  /**
+   * \return how long an import session may hear nothing before it is
+   * dropped: as long as the sender keeps sending a checkpoint again
+   */
+  Time GetIdleTime () const;
+
+  void ReceiveSegment (Ptr<Socket> socket, const Address &from, Ptr<Packet> packet);
+  void ReceiveData (Ptr<Socket> socket, const Address &from, const LtpSegmentHeader &header, Ptr<Packet> data);
+  void ReceiveReport (Ptr<Socket> socket, const LtpSegmentHeader &header);
+  void ReceiveReportAck (const LtpSegmentHeader &header);
+
+  /**
+   * Send a report of the red bytes of an import session up to upper.
+   */
+  void SendReport (SessionKey key, ImportSession &is, uint64_t checkpointSerial, uint64_t upper);
+
+  /**
+   * Send a segment that has no content but its type to the other end of a
+   * session.
+   */
+  void SendSignal (Ptr<Socket> socket, const Address *to, uint8_t type, uint64_t engineId, uint64_t session, uint8_t reason);
+
+  /**
+   * Hand an import session's block to the agent once all of it is in.
+   */
+  void CheckComplete (SessionKey key, ImportSession &is);
+
+  void CloseExport (uint64_t session);
+  void CloseImport (SessionKey key);
+
+  uint16_t m_port;                   /// default local UDP port
+  std::map<uint16_t, Ptr<Socket> > m_portSockets;  /// receiving socket of each port
+
+  uint32_t m_segmentSize;            /// SegmentSize attribute
+  uint32_t m_redPartLength;          /// RedPartLength attribute
+  Time m_oneWayDelay;                /// OneWayDelay attribute
+  Time m_timerMargin;                /// TimerMargin attribute
+  uint32_t m_retransmissionLimit;    /// RetransmissionLimit attribute
+  DataRate m_dataRate;               /// DataRate attribute
+
+  uint64_t m_engineId;               /// one more than the node id, 0 until known
+  uint64_t m_nextSession;
+  std::map<uint64_t, ExportSession> m_exports;
+  std::map<SessionKey, ImportSession> m_imports;
+  std::map<SessionKey, Time> m_finished;  /// delivered imports, until late segments are gone
+  std::multimap<Time, SessionKey> m_finishedExpiry;  /// m_finished by when each expires
+
+  std::deque<Outgoing> m_outgoing;   /// segments waiting for DataRate
+  uint64_t m_outgoingBytes;          /// bytes in m_outgoing
+  bool m_outgoingFull;               /// m_outgoing came to TxQueueBytes
+  EventId m_sendEvent;               /// pending SendNext (), if any
+
+  uint64_t m_retransmitted;
+  uint64_t m_cancelled;
+};
+
+} // namespace ns3
+
+#endif /* BP_LTP_CLA_H */
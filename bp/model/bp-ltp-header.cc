@@ -0,0 +1,370 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-ltp-header.h"
+#include "sdnv.h"
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("LtpSegmentHeader");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LtpSegmentHeader);
+
+LtpSegmentHeader::LtpSegmentHeader (uint8_t type)
+  : m_type (type),
+    m_engineId (0),
+    m_sessionNumber (0),
+    m_clientServiceId (0),
+    m_offset (0),
+    m_length (0),
+    m_checkpointSerial (0),
+    m_reportSerial (0),
+    m_lowerBound (0),
+    m_upperBound (0),
+    m_reason (0)
+{
+}
+
+TypeId
+LtpSegmentHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LtpSegmentHeader")
+    .SetParent<Header> ()
+    .AddConstructor<LtpSegmentHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+LtpSegmentHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+LtpSegmentHeader::GetSerializedSize (void) const
+{
+  // version and type, session id, extension counts
+  uint32_t size = 1 + Sdnv::EncodedSize (m_engineId) + Sdnv::EncodedSize (m_sessionNumber) + 1;
+  if (IsData ())
+    {
+      size += Sdnv::EncodedSize (m_clientServiceId) + Sdnv::EncodedSize (m_offset) + Sdnv::EncodedSize (m_length);
+      if (IsCheckpoint ())
+        size += Sdnv::EncodedSize (m_checkpointSerial) + Sdnv::EncodedSize (m_reportSerial);
+    }
+  else if (m_type == REPORT)
+    {
+      size += Sdnv::EncodedSize (m_reportSerial) + Sdnv::EncodedSize (m_checkpointSerial)
+        + Sdnv::EncodedSize (m_upperBound) + Sdnv::EncodedSize (m_lowerBound)
+        + Sdnv::EncodedSize (m_claims.size ());
+      for (uint32_t i = 0; i < m_claims.size (); i++)
+        size += Sdnv::EncodedSize (m_claims[i].first) + Sdnv::EncodedSize (m_claims[i].second);
+    }
+  else if (m_type == REPORT_ACK)
+    {
+      size += Sdnv::EncodedSize (m_reportSerial);
+    }
+  else if (m_type == CANCEL_FROM_SENDER || m_type == CANCEL_FROM_RECEIVER)
+    {
+      size += 1;
+    }
+  return size;
+}
+
+void
+LtpSegmentHeader::Serialize (Buffer::Iterator start) const
+{
+  // version 0 in the high nibble
+  start.WriteU8 (m_type & 0x0f);
+  Sdnv::Encode (m_engineId, start);
+  Sdnv::Encode (m_sessionNumber, start);
+  start.WriteU8 (0);
+  if (IsData ())
+    {
+      Sdnv::Encode (m_clientServiceId, start);
+      Sdnv::Encode (m_offset, start);
+      Sdnv::Encode (m_length, start);
+      if (IsCheckpoint ())
+        {
+          Sdnv::Encode (m_checkpointSerial, start);
+          Sdnv::Encode (m_reportSerial, start);
+        }
+    }
+  else if (m_type == REPORT)
+    {
+      Sdnv::Encode (m_reportSerial, start);
+      Sdnv::Encode (m_checkpointSerial, start);
+      Sdnv::Encode (m_upperBound, start);
+      Sdnv::Encode (m_lowerBound, start);
+      Sdnv::Encode (m_claims.size (), start);
+      for (uint32_t i = 0; i < m_claims.size (); i++)
+        {
+          Sdnv::Encode (m_claims[i].first, start);
+          Sdnv::Encode (m_claims[i].second, start);
+        }
+    }
+  else if (m_type == REPORT_ACK)
+    {
+      Sdnv::Encode (m_reportSerial, start);
+    }
+  else if (m_type == CANCEL_FROM_SENDER || m_type == CANCEL_FROM_RECEIVER)
+    {
+      start.WriteU8 (m_reason);
+    }
+}
+
+uint32_t
+LtpSegmentHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  uint8_t control = i.ReadU8 ();
+  if ((control >> 4) != 0)
+    {
+      NS_LOG_WARN ("LTP version " << (control >> 4) << " is not supported");
+      return 0;
+    }
+  m_type = control & 0x0f;
+  if (m_type == 0x05 || m_type == 0x06 || m_type == 0x0a || m_type == 0x0b)
+    {
+      NS_LOG_WARN ("LTP segment type " << (uint32_t) m_type << " is not supported");
+      return 0;
+    }
+  m_engineId = Sdnv::Decode (i);
+  m_sessionNumber = Sdnv::Decode (i);
+  if (i.ReadU8 () != 0)
+    {
+      NS_LOG_WARN ("LTP header and trailer extensions are not supported");
+      return 0;
+    }
+  m_claims.clear ();
+  if (IsData ())
+    {
+      m_clientServiceId = Sdnv::Decode (i);
+      m_offset = Sdnv::Decode (i);
+      m_length = Sdnv::Decode (i);
+      if (IsCheckpoint ())
+        {
+          m_checkpointSerial = Sdnv::Decode (i);
+          m_reportSerial = Sdnv::Decode (i);
+        }
+    }
+  else if (m_type == REPORT)
+    {
+      m_reportSerial = Sdnv::Decode (i);
+      m_checkpointSerial = Sdnv::Decode (i);
+      m_upperBound = Sdnv::Decode (i);
+      m_lowerBound = Sdnv::Decode (i);
+      uint64_t count = Sdnv::Decode (i);
+      for (uint64_t n = 0; n < count; n++)
+        {
+          uint64_t offset = Sdnv::Decode (i);
+          m_claims.push_back (Claim (offset, Sdnv::Decode (i)));
+        }
+    }
+  else if (m_type == REPORT_ACK)
+    {
+      m_reportSerial = Sdnv::Decode (i);
+    }
+  else if (m_type == CANCEL_FROM_SENDER || m_type == CANCEL_FROM_RECEIVER)
+    {
+      m_reason = i.ReadU8 ();
+    }
+  return i.GetDistanceFrom (start);
+}
+
+void
+LtpSegmentHeader::Print (std::ostream &os) const
+{
+  os << "type " << (uint32_t) m_type << " session " << m_engineId << "/" << m_sessionNumber;
+  if (IsData ())
+    os << " offset " << m_offset << " length " << m_length;
+  if (IsCheckpoint () || m_type == REPORT)
+    os << " checkpoint " << m_checkpointSerial << " report " << m_reportSerial;
+  if (m_type == REPORT)
+    os << " bounds " << m_lowerBound << "-" << m_upperBound << " claims " << m_claims.size ();
+}
+
+void
+LtpSegmentHeader::SetType (uint8_t type)
+{
+  m_type = type;
+}
+
+uint8_t
+LtpSegmentHeader::GetType () const
+{
+  return m_type;
+}
+
+bool
+LtpSegmentHeader::IsData () const
+{
+  return m_type <= GREEN_DATA_EOB;
+}
+
+bool
+LtpSegmentHeader::IsRed () const
+{
+  return m_type <= RED_DATA_CP_EORP_EOB;
+}
+
+bool
+LtpSegmentHeader::IsCheckpoint () const
+{
+  return m_type >= RED_DATA_CP && m_type <= RED_DATA_CP_EORP_EOB;
+}
+
+bool
+LtpSegmentHeader::IsEndOfRedPart () const
+{
+  return m_type == RED_DATA_CP_EORP || m_type == RED_DATA_CP_EORP_EOB;
+}
+
+bool
+LtpSegmentHeader::IsEndOfBlock () const
+{
+  return m_type == RED_DATA_CP_EORP_EOB || m_type == GREEN_DATA_EOB;
+}
+
+void
+LtpSegmentHeader::SetEngineId (uint64_t id)
+{
+  m_engineId = id;
+}
+
+uint64_t
+LtpSegmentHeader::GetEngineId () const
+{
+  return m_engineId;
+}
+
+void
+LtpSegmentHeader::SetSessionNumber (uint64_t number)
+{
+  m_sessionNumber = number;
+}
+
+uint64_t
+LtpSegmentHeader::GetSessionNumber () const
+{
+  return m_sessionNumber;
+}
+
+void
+LtpSegmentHeader::SetClientServiceId (uint64_t id)
+{
+  m_clientServiceId = id;
+}
+
+uint64_t
+LtpSegmentHeader::GetClientServiceId () const
+{
+  return m_clientServiceId;
+}
+
+void
+LtpSegmentHeader::SetOffset (uint64_t offset)
+{
+  m_offset = offset;
+}
+
+uint64_t
+LtpSegmentHeader::GetOffset () const
+{
+  return m_offset;
+}
+
+void
+LtpSegmentHeader::SetLength (uint64_t length)
+{
+  m_length = length;
+}
+
+uint64_t
+LtpSegmentHeader::GetLength () const
+{
+  return m_length;
+}
+
+void
+LtpSegmentHeader::SetCheckpointSerial (uint64_t serial)
+{
+  m_checkpointSerial = serial;
+}
+
+uint64_t
+LtpSegmentHeader::GetCheckpointSerial () const
+{
+  return m_checkpointSerial;
+}
+
+void
+LtpSegmentHeader::SetReportSerial (uint64_t serial)
+{
+  m_reportSerial = serial;
+}
+
+uint64_t
+LtpSegmentHeader::GetReportSerial () const
+{
+  return m_reportSerial;
+}
+
+void
+LtpSegmentHeader::SetBounds (uint64_t lower, uint64_t upper)
+{
+  m_lowerBound = lower;
+  m_upperBound = upper;
+}
+
+uint64_t
+LtpSegmentHeader::GetLowerBound () const
+{
+  return m_lowerBound;
+}
+
+uint64_t
+LtpSegmentHeader::GetUpperBound () const
+{
+  return m_upperBound;
+}
+
+void
+LtpSegmentHeader::AddClaim (uint64_t offset, uint64_t length)
+{
+  m_claims.push_back (Claim (offset, length));
+}
+
+const std::vector<LtpSegmentHeader::Claim> &
+LtpSegmentHeader::GetClaims () const
+{
+  return m_claims;
+}
+
+void
+LtpSegmentHeader::SetReason (uint8_t reason)
+{
+  m_reason = reason;
+}
+
+uint8_t
+LtpSegmentHeader::GetReason () const
+{
+  return m_reason;
+}
+
+} // namespace ns3
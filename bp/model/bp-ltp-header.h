@@ -0,0 +1,134 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_LTP_HEADER_H
+#define BP_LTP_HEADER_H
+
+#include "ns3/header.h"
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief LTP segment header
+ *
+ * The header of one Licklider Transmission Protocol segment (RFC 5326
+ * section 3): the segment type, the session id and the type's content.
+ * For a data segment the client service data follows the header.  Header
+ * and trailer extensions are not used; a segment with any is rejected by
+ * Deserialize () returning 0.
+ */
+class LtpSegmentHeader : public Header
+{
+public:
+  enum SegmentType {
+    RED_DATA = 0x00,            /// red data, not a checkpoint
+    RED_DATA_CP = 0x01,         /// red data, checkpoint
+    RED_DATA_CP_EORP = 0x02,    /// red data, checkpoint, end of red part
+    RED_DATA_CP_EORP_EOB = 0x03,/// red data, checkpoint, end of red part and of block
+    GREEN_DATA = 0x04,          /// green data
+    GREEN_DATA_EOB = 0x07,      /// green data, end of block
+    REPORT = 0x08,              /// report segment
+    REPORT_ACK = 0x09,          /// report-acknowledgment segment
+    CANCEL_FROM_SENDER = 0x0c,  /// cancel segment from the block sender
+    CANCEL_ACK_TO_SENDER = 0x0d,
+    CANCEL_FROM_RECEIVER = 0x0e,/// cancel segment from the block receiver
+    CANCEL_ACK_TO_RECEIVER = 0x0f
+  };
+
+  enum CancelReason {
+    USER_CANCELLED = 0x00,
+    UNREACHABLE = 0x01,
+    RLEXC = 0x02,               /// retransmission limit exceeded
+    MISCOLORED = 0x03,
+    SYSTEM_CANCELLED = 0x04,
+    RXMTCYCEXC = 0x05           /// retransmission cycles exceeded
+  };
+
+  /// a reception claim: offset from the report's lower bound, and length
+  typedef std::pair<uint64_t, uint64_t> Claim;
+
+  LtpSegmentHeader (uint8_t type = RED_DATA);
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  void SetType (uint8_t type);
+  uint8_t GetType () const;
+
+  /// \return true for the data segment types, red or green
+  bool IsData () const;
+  /// \return true for red data segments
+  bool IsRed () const;
+  /// \return true for red data segments that are checkpoints
+  bool IsCheckpoint () const;
+  /// \return true if the segment ends the red part
+  bool IsEndOfRedPart () const;
+  /// \return true if the segment ends the block
+  bool IsEndOfBlock () const;
+
+  void SetEngineId (uint64_t id);
+  uint64_t GetEngineId () const;
+  void SetSessionNumber (uint64_t number);
+  uint64_t GetSessionNumber () const;
+
+  // data segments
+  void SetClientServiceId (uint64_t id);
+  uint64_t GetClientServiceId () const;
+  void SetOffset (uint64_t offset);
+  uint64_t GetOffset () const;
+  void SetLength (uint64_t length);
+  uint64_t GetLength () const;
+
+  // checkpoints, reports and report-acknowledgments
+  void SetCheckpointSerial (uint64_t serial);
+  uint64_t GetCheckpointSerial () const;
+  void SetReportSerial (uint64_t serial);
+  uint64_t GetReportSerial () const;
+
+  // reports
+  void SetBounds (uint64_t lower, uint64_t upper);
+  uint64_t GetLowerBound () const;
+  uint64_t GetUpperBound () const;
+  void AddClaim (uint64_t offset, uint64_t length);
+  const std::vector<Claim> &GetClaims () const;
+
+  // cancel segments
+  void SetReason (uint8_t reason);
+  uint8_t GetReason () const;
+
+private:
+  uint8_t m_type;
+  uint64_t m_engineId;
+  uint64_t m_sessionNumber;
+  uint64_t m_clientServiceId;
+  uint64_t m_offset;
+  uint64_t m_length;
+  uint64_t m_checkpointSerial;
+  uint64_t m_reportSerial;
+  uint64_t m_lowerBound;
+  uint64_t m_upperBound;
+  std::vector<Claim> m_claims;
+  uint8_t m_reason;
+};
+
+} // namespace ns3
+
+#endif /* BP_LTP_HEADER_H */
@@ -0,0 +1,129 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-payload-hash-tag.h"
+#include "bp-range-set.h"
+#include "ns3/hash.h"
+#include "ns3/log.h"
+#include <vector>
+
+NS_LOG_COMPONENT_DEFINE ("BpPayloadHashTag");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (BpPayloadHashTag);
+
+TypeId
+BpPayloadHashTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpPayloadHashTag")
+    .SetParent<Tag> ()
+    .AddConstructor<BpPayloadHashTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+BpPayloadHashTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+BpPayloadHashTag::GetSerializedSize (void) const
+{
+  return 8;
+}
+
+void
+BpPayloadHashTag::Serialize (TagBuffer buf) const
+{
+  buf.WriteU64 (m_hash);
+}
+
+void
+BpPayloadHashTag::Deserialize (TagBuffer buf)
+{
+  m_hash = buf.ReadU64 ();
+}
+
+void
+BpPayloadHashTag::Print (std::ostream &os) const
+{
+  os << "PayloadHash=" << std::hex << m_hash << std::dec;
+}
+
+BpPayloadHashTag::BpPayloadHashTag ()
+  : Tag (),
+    m_hash (0)
+{
+}
+
+BpPayloadHashTag::BpPayloadHashTag (uint64_t hash)
+  : Tag (),
+    m_hash (hash)
+{
+}
+
+void
+BpPayloadHashTag::SetHash (uint64_t hash)
+{
+  m_hash = hash;
+}
+
+uint64_t
+BpPayloadHashTag::GetHash (void) const
+{
+  return m_hash;
+}
+
+uint64_t
+BpPayloadHashTag::Compute (Ptr<const Packet> p)
+{
+  std::vector<uint8_t> data (p->GetSize ());
+  p->CopyData (data.data (), data.size ());
+  return Hash64 (reinterpret_cast<const char *> (data.data ()), data.size ());
+}
+
+bool
+BpPayloadHashTag::Verify (Ptr<const Packet> adu)
+{
+  bool found = false;
+  uint64_t hash = 0;
+  BpRangeSet covered;
+  ByteTagIterator i = adu->GetByteTagIterator ();
+  while (i.HasNext ())
+    {
+      ByteTagIterator::Item item = i.Next ();
+      if (item.GetTypeId () != GetTypeId ())
+        {
+          continue;
+        }
+      BpPayloadHashTag tag;
+      item.GetTag (tag);
+      if (found && tag.GetHash () != hash)
+        {
+          NS_LOG_DEBUG ("hash " << std::hex << tag.GetHash () << " differs from " << hash);
+          return false;
+        }
+      found = true;
+      hash = tag.GetHash ();
+      covered.Add (item.GetStart (), item.GetEnd ());
+    }
+  return !found || covered.Covers (0, adu->GetSize ());
+}
+
+} // namespace ns3
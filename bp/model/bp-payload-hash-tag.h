@@ -0,0 +1,71 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_PAYLOAD_HASH_TAG_H
+#define BP_PAYLOAD_HASH_TAG_H
+
+#include "ns3/tag.h"
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/**
+ * \brief Hash of the original bytes of a virtual ADU
+ *
+ * With the agent's VirtualPayload attribute, an ADU is carried as a
+ * zero-filled packet of its length.  When PayloadHash is also set, the
+ * sending agent hashes the bytes the application gave it and attaches the
+ * hash as a byte tag over the whole ADU.  Byte tags follow the bytes they
+ * cover through fragmentation, the CLAs and reassembly, so the receiving
+ * application can find the hash with FindFirstMatchingByteTag () and
+ * compare it with the one it expects.
+ */
+class BpPayloadHashTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer buf) const;
+  virtual void Deserialize (TagBuffer buf);
+  virtual void Print (std::ostream &os) const;
+
+  BpPayloadHashTag ();
+  BpPayloadHashTag (uint64_t hash);
+
+  void SetHash (uint64_t hash);
+  uint64_t GetHash (void) const;
+
+  /**
+   * \return the hash of the bytes of a packet
+   */
+  static uint64_t Compute (Ptr<const Packet> p);
+
+  /**
+   * \brief check that the hash tags of an ADU put together from fragments
+   * agree
+   *
+   * \return true if the ADU has no hash tags, or if they all carry the same
+   * hash and together cover every byte of it
+   */
+  static bool Verify (Ptr<const Packet> adu);
+
+private:
+  uint64_t m_hash;
+};
+
+} // namespace ns3
+
+#endif /* BP_PAYLOAD_HASH_TAG_H */
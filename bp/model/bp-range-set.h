@@ -0,0 +1,147 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_RANGE_SET_H
+#define BP_RANGE_SET_H
+
+#include <stdint.h>
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief A set of disjoint half-open ranges [start, end) of uint32_t
+ *
+ * Overlapping and adjacent ranges are merged as they are added, so the set
+ * always holds the fewest ranges covering what was added.  Adding a range
+ * costs O(log n) plus the ranges it absorbs, and the number of values
+ * covered is kept up to date, so checking whether a range of known size is
+ * fully covered is O(1).
+ */
+class BpRangeSet
+{
+public:
+  typedef std::map<uint32_t, uint32_t>::const_iterator const_iterator;
+
+  BpRangeSet ()
+    : m_covered (0)
+    {
+    }
+
+  /**
+   * \brief add [start, end), merging it with the ranges it overlaps or touches
+   *
+   * \return the number of values that were not already covered
+   */
+  uint32_t Add (uint32_t start, uint32_t end)
+    {
+      if (start >= end)
+        {
+          return 0;
+        }
+      uint64_t before = m_covered;
+      std::map<uint32_t, uint32_t>::iterator it = m_ranges.upper_bound (start);
+      if (it != m_ranges.begin ())
+        {
+          std::map<uint32_t, uint32_t>::iterator prev = it;
+          --prev;
+          if (prev->second >= start)
+            {
+              if (prev->second >= end)
+                {
+                  return 0;
+                }
+              start = prev->first;
+              it = prev;
+            }
+        }
+      while (it != m_ranges.end () && it->first <= end)
+        {
+          if (it->second > end)
+            {
+              end = it->second;
+            }
+          m_covered -= it->second - it->first;
+          m_ranges.erase (it++);
+        }
+      m_ranges.insert (it, std::make_pair (start, end));
+      m_covered += end - start;
+      return m_covered - before;
+    }
+
+  /**
+   * \return true if every value of [start, end) is in the set
+   */
+  bool Covers (uint32_t start, uint32_t end) const
+    {
+      if (start >= end)
+        {
+          return true;
+        }
+      const_iterator it = m_ranges.upper_bound (start);
+      if (it == m_ranges.begin ())
+        {
+          return false;
+        }
+      --it;
+      return it->second >= end;
+    }
+
+  /**
+   * \return the number of values in the set
+   */
+  uint64_t GetCovered () const
+    {
+      return m_covered;
+    }
+
+  /**
+   * \return the number of disjoint ranges
+   */
+  uint32_t GetNRanges () const
+    {
+      return m_ranges.size ();
+    }
+
+  bool IsEmpty () const
+    {
+      return m_ranges.empty ();
+    }
+
+  void Clear ()
+    {
+      m_ranges.clear ();
+      m_covered = 0;
+    }
+
+  /// ranges in order, as (start, end) pairs
+  const_iterator begin () const
+    {
+      return m_ranges.begin ();
+    }
+
+  const_iterator end () const
+    {
+      return m_ranges.end ();
+    }
+
+private:
+  std::map<uint32_t, uint32_t> m_ranges;  /// start -> end
+  uint64_t m_covered;                     /// values covered by all ranges
+};
+
+} // namespace ns3
+
+#endif /* BP_RANGE_SET_H */
@@ -46,4 +46,44 @@ BpRoutingAgent::~BpRoutingAgent ()
   NS_LOG_FUNCTION (this);
 }
 
+TypeId
+BpRoutingAgent::NextHopClaType (BpEndpointId &eid)
+{
+  return TypeId ();
+}
+
+InetSocketAddress
+BpRoutingAgent::GetRoute (BpEndpointId eid)
+{
+  return InetSocketAddress ("127.0.0.1", 0);
+}
+
+void
+BpRoutingAgent::SetNextHopReadyCallback (Callback<void, BpEndpointId> cb)
+{
+  m_nextHopReadyCallback = cb;
+}
+
+void
+BpRoutingAgent::NotifyNextHopReady (BpEndpointId nextHop)
+{
+  NS_LOG_FUNCTION (this << " " << nextHop.Uri ());
+  if (!m_nextHopReadyCallback.IsNull ())
+    m_nextHopReadyCallback (nextHop);
+}
+
+void
+BpRoutingAgent::SetNextHopDownCallback (Callback<void, BpEndpointId, Ptr<BpCla>, TypeId> cb)
+{
+  m_nextHopDownCallback = cb;
+}
+
+void
+BpRoutingAgent::NotifyNextHopDown (BpEndpointId nextHop, Ptr<BpCla> cla, TypeId claType)
+{
+  NS_LOG_FUNCTION (this << " " << nextHop.Uri ());
+  if (!m_nextHopDownCallback.IsNull ())
+    m_nextHopDownCallback (nextHop, cla, claType);
+}
+
 } // namespace ns3
@@ -23,6 +23,8 @@
 #define BP_ROUTING_AGENT_H
 
 #include "ns3/object.h"
+#include "ns3/callback.h"
+#include "ns3/inet-socket-address.h"
 
 #include "bp-endpoint-id.h"
 #include "bp-cla.h"
@@ -61,6 +63,61 @@ public:
    * \param eid Next-hop Endpoint ID
    */
   virtual Ptr<BpCla> NextHopCla(BpEndpointId &eid) = 0;
+
+  /**
+   * \brief Return the type of CLA used to reach a next-hop EID, for routes
+   * that name their CLA by type rather than by instance.  The agent then
+   * uses its own CLA of that type, so that one routing agent can serve
+   * several nodes.  Only asked when NextHopCla () returns 0.
+   *
+   * \param eid Next-hop Endpoint ID
+   * \return the CLA type, or TypeId () if there is none
+   */
+  virtual TypeId NextHopClaType(BpEndpointId &eid);
+
+  /**
+   * \return the address that bundles for eid are sent to, or 127.0.0.1
+   * with port 0 if there is none
+   */
+  virtual InetSocketAddress GetRoute (BpEndpointId eid);
+
+  /**
+   * \brief Set the function to call when bundles may be sent to a next hop
+   * that could not be reached before, e.g. as a contact starts.  The agent
+   * sets it to retry the bundles waiting for a route; a routing agent that
+   * calls it serves only that agent.
+   *
+   * \param cb called with the next-hop EID
+   */
+  void SetNextHopReadyCallback (Callback<void, BpEndpointId> cb);
+
+  /**
+   * \brief Set the function to call when a next hop can no longer be
+   * reached, e.g. as its last contact ends.  The agent sets it to route
+   * the bundles waiting to be sent again.
+   *
+   * \param cb called with the next-hop EID, and the CLA and CLA type that
+   * NextHopCla () and NextHopClaType () gave for it while it could be
+   * reached
+   */
+  void SetNextHopDownCallback (Callback<void, BpEndpointId, Ptr<BpCla>, TypeId> cb);
+
+protected:
+
+  /**
+   * Call the next-hop ready callback, if it is set.
+   */
+  void NotifyNextHopReady (BpEndpointId nextHop);
+
+  /**
+   * Call the next-hop down callback, if it is set.
+   */
+  void NotifyNextHopDown (BpEndpointId nextHop, Ptr<BpCla> cla, TypeId claType);
+
+private:
+
+  Callback<void, BpEndpointId> m_nextHopReadyCallback;
+  Callback<void, BpEndpointId, Ptr<BpCla>, TypeId> m_nextHopDownCallback;
 };
 
 
@@ -0,0 +1,116 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_RTO_ESTIMATOR_H
+#define BP_RTO_ESTIMATOR_H
+
+#include "ns3/nstime.h"
+#include <algorithm>
+
+namespace ns3 {
+
+/**
+ * \brief Retransmission timeout estimate from round trip samples, per
+ * RFC 6298
+ *
+ * Keeps a smoothed round trip time and its mean deviation, and gives
+ * RTO = SRTT + 4 * RTTVAR.  Samples must only be taken from bundles that
+ * were sent once (Karn's algorithm), which is up to the caller.  Since that
+ * leaves no samples while every bundle times out, the backoff reached by
+ * retransmissions is kept until the next sample, as RFC 6298 does.
+ */
+class BpRtoEstimator
+{
+public:
+  BpRtoEstimator ()
+    : m_samples (0),
+      m_backoff (0)
+    {
+    }
+
+  /**
+   * \brief add a round trip time sample
+   */
+  void Update (Time sample)
+    {
+      if (m_samples == 0)
+        {
+          m_srtt = sample;
+          m_rttvar = sample / 2;
+        }
+      else
+        {
+          Time err = (m_srtt > sample) ? m_srtt - sample : sample - m_srtt;
+          m_rttvar = (m_rttvar * 3 + err) / 4;
+          m_srtt = (m_srtt * 7 + sample) / 8;
+        }
+      m_samples++;
+      m_backoff = 0;
+    }
+
+  /**
+   * \brief note that a bundle had to be sent again
+   *
+   * \param n times the bundle was sent before without a signal
+   */
+  void Backoff (uint32_t n)
+    {
+      m_backoff = std::max (m_backoff, std::min (n, (uint32_t) 31));
+    }
+
+  /**
+   * \return times the timeout is doubled until the next sample
+   */
+  uint32_t GetBackoff () const
+    {
+      return m_backoff;
+    }
+
+  /**
+   * \return true once there has been a sample
+   */
+  bool HasSample () const
+    {
+      return m_samples != 0;
+    }
+
+  /**
+   * \return the retransmission timeout, only meaningful with a sample
+   */
+  Time GetRto () const
+    {
+      return m_srtt + m_rttvar * 4;
+    }
+
+  Time GetSrtt () const
+    {
+      return m_srtt;
+    }
+
+  uint32_t GetNSamples () const
+    {
+      return m_samples;
+    }
+
+private:
+  Time m_srtt;        /// smoothed round trip time
+  Time m_rttvar;      /// round trip time variation
+  uint32_t m_samples; /// samples taken
+  uint32_t m_backoff; /// doublings kept until the next sample
+};
+
+} // namespace ns3
+
+#endif /* BP_RTO_ESTIMATOR_H */
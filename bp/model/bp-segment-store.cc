@@ -0,0 +1,212 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-segment-store.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "ns3/system-path.h"
+#include <algorithm>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("BpSegmentStore");
+
+namespace ns3 {
+
+BpSegmentStore::BpSegmentStore (uint64_t segmentSize)
+  : m_segmentSize (segmentSize),
+    m_active (0),
+    m_nextSegment (0),
+    m_fileBytes (0),
+    m_liveBytes (0),
+    m_fullUsed (0),
+    m_fullLive (0)
+{
+  m_dir = SystemPath::MakeTemporaryDirectoryName ();
+  SystemPath::MakeDirectories (m_dir);
+  NS_LOG_DEBUG ("payload segments in " << m_dir);
+}
+
+BpSegmentStore::~BpSegmentStore ()
+{
+  while (!m_segments.empty ())
+    {
+      CloseSegment (m_segments.begin ()->first);
+    }
+  rmdir (m_dir.c_str ());
+}
+
+uint32_t
+BpSegmentStore::OpenSegment (uint64_t capacity)
+{
+  uint32_t id = m_nextSegment++;
+  std::ostringstream path;
+  path << m_dir << "/segment-" << id;
+
+  Segment s;
+  s.path = path.str ();
+  s.capacity = capacity;
+  s.used = 0;
+  s.live = 0;
+  s.fd = open (s.path.c_str (), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (s.fd < 0 || ftruncate (s.fd, capacity) != 0)
+    {
+      NS_FATAL_ERROR ("cannot create payload segment " << s.path);
+    }
+  void *map = mmap (0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, s.fd, 0);
+  if (map == MAP_FAILED)
+    {
+      NS_FATAL_ERROR ("cannot map payload segment " << s.path);
+    }
+  s.map = static_cast<uint8_t *> (map);
+
+  m_segments[id] = s;
+  m_fileBytes += capacity;
+  NS_LOG_DEBUG ("opened segment " << id << " of " << capacity << " bytes");
+  return id;
+}
+
+void
+BpSegmentStore::CloseSegment (uint32_t id)
+{
+  std::map<uint32_t, Segment>::iterator it = m_segments.find (id);
+  if (it == m_segments.end ())
+    {
+      return;
+    }
+  Segment &s = it->second;
+  munmap (s.map, s.capacity);
+  close (s.fd);
+  unlink (s.path.c_str ());
+  m_fileBytes -= s.capacity;
+  if (id != m_active)
+    {
+      m_fullUsed -= s.used;
+      m_fullLive -= s.live;
+    }
+  m_segments.erase (it);
+  NS_LOG_DEBUG ("closed segment " << id);
+}
+
+BpSegmentStore::Extent
+BpSegmentStore::Append (Ptr<const Packet> p)
+{
+  Extent e;
+  e.length = p->GetSize ();
+  if (e.length == 0)
+    {
+      return e;
+    }
+
+  std::map<uint32_t, Segment>::iterator it = m_segments.find (m_active);
+  if (it == m_segments.end () || it->second.used + e.length > it->second.capacity)
+    {
+      if (it != m_segments.end ())
+        {
+          // The active segment is full from here on.
+          if (it->second.live == 0)
+            {
+              CloseSegment (m_active);
+            }
+          else
+            {
+              m_fullUsed += it->second.used;
+              m_fullLive += it->second.live;
+            }
+        }
+      m_active = OpenSegment (std::max (m_segmentSize, (uint64_t) e.length));
+      it = m_segments.find (m_active);
+    }
+
+  Segment &s = it->second;
+  e.segment = m_active;
+  e.offset = s.used;
+  p->CopyData (s.map + s.used, e.length);
+  s.used += e.length;
+  s.live += e.length;
+  m_liveBytes += e.length;
+  return e;
+}
+
+Ptr<Packet>
+BpSegmentStore::Read (const Extent &e) const
+{
+  std::map<uint32_t, Segment>::const_iterator it = m_segments.find (e.segment);
+  if (e.length == 0 || it == m_segments.end ())
+    {
+      return Create<Packet> ();
+    }
+  return Create<Packet> (it->second.map + e.offset, e.length);
+}
+
+void
+BpSegmentStore::Release (const Extent &e)
+{
+  std::map<uint32_t, Segment>::iterator it = m_segments.find (e.segment);
+  if (e.length == 0 || it == m_segments.end ())
+    {
+      return;
+    }
+  it->second.live -= e.length;
+  m_liveBytes -= e.length;
+  if (e.segment != m_active)
+    {
+      m_fullLive -= e.length;
+      if (it->second.live == 0)
+        {
+          CloseSegment (e.segment);
+        }
+    }
+}
+
+bool
+BpSegmentStore::IsSparse (uint32_t segment) const
+{
+  std::map<uint32_t, Segment>::const_iterator it = m_segments.find (segment);
+  if (segment == m_active || it == m_segments.end ())
+    {
+      return false;
+    }
+  return it->second.live * 2 < it->second.used;
+}
+
+bool
+BpSegmentStore::NeedsCompaction () const
+{
+  return m_fullUsed - m_fullLive > m_fullLive;
+}
+
+uint64_t
+BpSegmentStore::GetFileBytes () const
+{
+  return m_fileBytes;
+}
+
+uint64_t
+BpSegmentStore::GetLiveBytes () const
+{
+  return m_liveBytes;
+}
+
+uint32_t
+BpSegmentStore::GetNSegments () const
+{
+  return m_segments.size ();
+}
+
+} // namespace ns3
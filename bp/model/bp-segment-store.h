@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_SEGMENT_STORE_H
+#define BP_SEGMENT_STORE_H
+
+#include "ns3/packet.h"
+#include "ns3/simple-ref-count.h"
+#include <map>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief Append-only, memory-mapped segment files holding bundle payloads
+ *
+ * Payload bytes are appended to the active segment, a file of fixed size
+ * in a temporary directory that is mapped into memory, and a new segment
+ * is started when it is full.  Released extents only count as dead space;
+ * a segment is deleted as soon as nothing in it is live.  Reclaiming the
+ * space of segments that are only partly dead is up to the owner, which
+ * moves their live extents with Append () and Release () when
+ * NeedsCompaction () says so.
+ *
+ * The directory and its files are removed when the store is destroyed.
+ */
+class BpSegmentStore : public SimpleRefCount<BpSegmentStore> {
+public:
+  /// where a payload is kept
+  struct Extent {
+    Extent () : segment (0), offset (0), length (0) {}
+
+    uint32_t segment;
+    uint64_t offset;
+    uint32_t length;   /// 0 if nothing is kept
+  };
+
+  /**
+   * \param segmentSize size of each segment file; larger payloads get a
+   * segment of their own
+   */
+  BpSegmentStore (uint64_t segmentSize);
+  ~BpSegmentStore ();
+
+  /**
+   * \brief copy the bytes of a packet to the end of the active segment
+   */
+  Extent Append (Ptr<const Packet> p);
+
+  /**
+   * \return a new packet with the bytes of an extent
+   */
+  Ptr<Packet> Read (const Extent &e) const;
+
+  /**
+   * \brief mark an extent as dead
+   */
+  void Release (const Extent &e);
+
+  /**
+   * \return true if the segment is full and less than half of it is live
+   */
+  bool IsSparse (uint32_t segment) const;
+
+  /**
+   * \return true if the dead space in full segments exceeds the live data
+   * in them
+   */
+  bool NeedsCompaction () const;
+
+  uint64_t GetFileBytes () const;   /// bytes of all segment files
+  uint64_t GetLiveBytes () const;   /// bytes of the extents not released
+  uint32_t GetNSegments () const;
+
+private:
+  struct Segment {
+    std::string path;
+    int fd;
+    uint8_t *map;
+    uint64_t capacity;
+    uint64_t used;      /// bytes appended
+    uint64_t live;      /// bytes appended and not released
+  };
+
+  uint32_t OpenSegment (uint64_t capacity);
+  void CloseSegment (uint32_t id);
+
+  std::string m_dir;
+  uint64_t m_segmentSize;
+  std::map<uint32_t, Segment> m_segments;
+  uint32_t m_active;         /// segment appended to, if in m_segments
+  uint32_t m_nextSegment;
+  uint64_t m_fileBytes;
+  uint64_t m_liveBytes;
+  uint64_t m_fullUsed;       /// bytes appended to segments other than the active one
+  uint64_t m_fullLive;       /// bytes live in segments other than the active one
+};
+
+} // namespace ns3
+
+#endif /* BP_SEGMENT_STORE_H */
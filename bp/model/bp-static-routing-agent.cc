@@ -67,6 +67,14 @@ int BpStaticRoutingAgent::AddRoute (BpEndpointId &dst, BpEndpointId &nxt, bool u
   return 0;
 }
 
+int BpStaticRoutingAgent::AddRoute (BpEndpointId &dst, BpEndpointId &nxt, bool up, Ipv4Address addr, uint16_t port, TypeId claType, std::string *note) {
+  if (!claType.IsChildOf (BpCla::GetTypeId ()))
+    NS_FATAL_ERROR ("BpStaticRoutingAgent::AddRoute (): " << claType.GetName () << " is not a CLA type");
+  AddRoute (dst, nxt, up, addr, port, Ptr<BpCla> (0), note);
+  m_routes[dst]->back().claType = claType;
+  return 0;
+}
+
 InetSocketAddress 
 BpStaticRoutingAgent::GetRoute (BpEndpointId eid)
 { 
@@ -100,6 +108,16 @@ Ptr<BpCla> BpStaticRoutingAgent::NextHopCla(BpEndpointId &eid) {
   return NULL;
 }
 
+TypeId BpStaticRoutingAgent::NextHopClaType(BpEndpointId &eid) {
+  NS_LOG_FUNCTION(this << " " << eid.Uri());
+  std::map<BpEndpointId, std::list<dtnRoute>*>::iterator h = m_routes.find(eid);
+  if (h == m_routes.end()) return TypeId();
+  for (std::list<struct dtnRoute>::iterator i = (*h).second->begin(); i != (*h).second->end(); i++) {
+    if ((*i).up) return (*i).claType;
+  }
+  return TypeId();
+}
+
 void BpStaticRoutingAgent::UpRoute (BpEndpointId &dst, BpEndpointId &nxt, std::string *note) {
   NS_LOG_FUNCTION(this);
   NS_LOG_DEBUG("route UP to " << dst.Uri() << " via " << nxt.Uri());
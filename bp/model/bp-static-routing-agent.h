@@ -34,6 +34,7 @@ struct dtnRoute {
   Ipv4Address addr;
   uint16_t port;
   Ptr<BpCla> cla;  // convergence layer instance to use
+  TypeId claType;  // or the type of CLA to use on each agent, if cla is 0
 
   std::string note;
 };
@@ -59,12 +60,22 @@ public:
 
   virtual BpEndpointId NextHopEid(BpEndpointId &dst);
   virtual Ptr<BpCla> NextHopCla(BpEndpointId &eid);
+  virtual TypeId NextHopClaType(BpEndpointId &eid);
 
   virtual void UpRoute (BpEndpointId &dst, BpEndpointId &nxt, std::string *note);
   virtual void DownRoute (BpEndpointId &dst, BpEndpointId &nxt, std::string *note);
 
   virtual int AddRoute (BpEndpointId &dst, BpEndpointId &nxt, bool up, Ipv4Address addr, uint16_t port, Ptr<BpCla> cla, std::string *note=NULL);
 
+  /**
+   * Add a route that names its CLA by type, so that each agent using this
+   * routing agent sends on its own CLA of that type.
+   *
+   * \param claType the type of the CLA, e.g. BpTcpCla::GetTypeId (); see
+   * BpCla::LookupType () to find one by name
+   */
+  virtual int AddRoute (BpEndpointId &dst, BpEndpointId &nxt, bool up, Ipv4Address addr, uint16_t port, TypeId claType, std::string *note=NULL);
+
   /**
    *  \return the internet socket address of matched eid; If there is no 
    *  match route, return the 127.0.0.1 with port 0
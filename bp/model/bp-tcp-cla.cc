@@ -20,7 +20,12 @@
  */
 
 #include "bp-tcp-cla.h"
+#include "bp-tcpcl-header.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/simulator.h"
 #include "ns3/tcp-socket-factory.h"
+#include <algorithm>
 
 // default port number of dtn bundle tcp convergence layer, which is 
 // defined in draft-irtf--dtnrg-tcp-clayer-0.6
@@ -38,14 +43,70 @@ BpTcpCla::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::BpTcpCla")
     .SetParent<BpCla> ()
     .AddConstructor<BpTcpCla> ()
+    .AddAttribute ("MaxBundleSize", "Largest encoded bundle sent in one piece, in bytes; larger bundles are fragmented",
+                   UintegerValue (65536),
+                   MakeUintegerAccessor (&BpTcpCla::m_maxBundleSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SegmentMru", "Largest XFER_SEGMENT data received, and sent, in bytes",
+                   UintegerValue (65536),
+                   MakeUintegerAccessor (&BpTcpCla::m_segmentMru),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TransferMru", "Largest transfer, i.e. encoded bundle, received in bytes",
+                   UintegerValue (0xffffffff),
+                   MakeUintegerAccessor (&BpTcpCla::m_transferMru),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("KeepaliveInterval", "Keepalive interval offered in SESS_INIT, in whole seconds, or 0 to disable keepalives",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&BpTcpCla::m_keepaliveInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("Connections", "Number of parallel sessions to each peer",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&BpTcpCla::m_connections),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("PoolPolicy", "How the session to a peer is picked for each bundle",
+                   EnumValue (ROUND_ROBIN),
+                   MakeEnumAccessor (&BpTcpCla::m_poolPolicy),
+                   MakeEnumChecker (ROUND_ROBIN, "RoundRobin",
+                                    LEAST_QUEUED, "LeastQueued"))
   ;
   return tid;
 }
 
+BpTcpCla::Session::Session ()
+  : active (false),
+    contactReceived (false),
+    established (false),
+    rxBuffer (Create<Packet> ()),
+    rxTransferId (0),
+    nextTransferId (0),
+    peerSegmentMru (0),
+    peerTransferMru (0),
+    serial (0)
+{
+}
+
+BpTcpCla::SessionStats::SessionStats ()
+  : sessions (1),
+    active (false),
+    bundlesSent (0),
+    bytesSent (0),
+    bundlesAcked (0),
+    bundlesReceived (0),
+    bytesReceived (0)
+{
+}
+
 BpTcpCla::BpTcpCla (Callback<void, Ptr<Bundle>> processBundleCallback)
-: BpCla(processBundleCallback)
+: BpCla(processBundleCallback),
+  m_sessionsOpened(0),
+  m_connections(1),
+  m_poolPolicy(ROUND_ROBIN),
+  m_segmentMru(65536),
+  m_transferMru(0xffffffff)
 { 
   NS_LOG_FUNCTION (this);
+  // The session messages go both ways on every connection.
+  m_duplex = true;
 }
 
 BpTcpCla::~BpTcpCla ()
@@ -53,6 +114,18 @@ BpTcpCla::~BpTcpCla ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+BpTcpCla::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::map<Ptr<Socket>, Session>::iterator it;
+  for (it = m_sessions.begin (); it != m_sessions.end (); it++)
+    Simulator::Cancel (it->second.keepaliveEvent);
+  m_sessions.clear ();
+  m_pools.clear ();
+  BpCla::DoDispose ();
+}
+
 int
 BpTcpCla::EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode)
 { 
@@ -73,10 +146,10 @@ BpTcpCla::EnableReceive (const BpEndpointId &local, InetSocketAddress localAddre
     return -1;
   if (socket->Listen () < 0)
     return -1;
-  if (socket->ShutdownSend () < 0)
-    return -1; 
 
   SetL4SocketCallbacks (socket);
+  if (m_nodeId.empty ())
+    m_nodeId = local.Uri ();
  
   // store the sending socket so that the convergence layer can dispatch the hundles to different tcp connections
   std::map<BpEndpointId, Ptr<Socket> >::iterator it = m_l4RecvSockets.end ();
@@ -90,6 +163,121 @@ BpTcpCla::EnableReceive (const BpEndpointId &local, InetSocketAddress localAddre
   return 0;
 }
 
+int
+BpTcpCla::EnableSend (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
+  NS_LOG_FUNCTION (this << " " << src.Uri () << " " << dst.Uri ());
+  return GetL4Socket (src, dst, dstAddress, bpNode) == NULL ? -1 : 0;
+}
+
+Ptr<Socket>
+BpTcpCla::GetL4Socket (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode)
+{
+  NS_LOG_FUNCTION (this << " " << src.Uri () << " " << dst.Uri ());
+  InetSocketAddress defaultAddr ("127.0.0.1", 0);
+  if (dstAddress == defaultAddr)
+    {
+      NS_LOG_DEBUG ("BpTcpCla::GetL4Socket (): cannot find route for destination endpoint id " << dst.Uri ());
+      return NULL;
+    }
+  if (m_nodeId.empty ())
+    m_nodeId = src.Uri ();
+
+  Pool &pool = m_pools[PeerKey (dstAddress.GetIpv4 ().Get (), dstAddress.GetPort ())];
+  while (pool.sockets.size () < m_connections)
+    {
+      Ptr<Socket> socket = OpenSendSocket (dstAddress, bpNode);
+      if (socket == NULL)
+        break;
+      StartSession (socket, true);
+      pool.sockets.push_back (socket);
+    }
+  uint32_t n = pool.sockets.size ();
+  if (n == 0)
+    return NULL;
+
+  // Both policies start looking at the session after the last one picked,
+  // so that sessions with equal queues are still used in turn.
+  uint32_t pick = pool.next % n;
+  if (m_poolPolicy == LEAST_QUEUED)
+    {
+      for (uint32_t i = 1; i < n; i++)
+        {
+          uint32_t k = (pool.next + i) % n;
+          if (GetTxQueueBytes (pool.sockets[k]) < GetTxQueueBytes (pool.sockets[pick]))
+            pick = k;
+        }
+    }
+  pool.next = pick + 1;
+  return pool.sockets[pick];
+}
+
+std::vector<BpTcpCla::SessionStats>
+BpTcpCla::GetSessionStats () const
+{
+  std::map<uint64_t, SessionStats> opened;
+  std::map<Ptr<Socket>, Session>::const_iterator it;
+  for (it = m_sessions.begin (); it != m_sessions.end (); it++)
+    opened[it->second.serial] = it->second.stats;
+  std::vector<SessionStats> stats;
+  std::map<uint64_t, SessionStats>::iterator oit;
+  for (oit = opened.begin (); oit != opened.end (); oit++)
+    stats.push_back (oit->second);
+  return stats;
+}
+
+std::map<std::string, BpTcpCla::SessionStats>
+BpTcpCla::GetPeerStats () const
+{
+  std::map<std::string, SessionStats> totals = m_peerStats;
+  std::map<Ptr<Socket>, Session>::const_iterator it;
+  for (it = m_sessions.begin (); it != m_sessions.end (); it++)
+    AddStats (totals, it->second.stats);
+  return totals;
+}
+
+void
+BpTcpCla::AddStats (std::map<std::string, SessionStats> &totals, const SessionStats &stats)
+{
+  std::map<std::string, SessionStats>::iterator it = totals.find (stats.peerNodeId);
+  if (it == totals.end ())
+    {
+      totals[stats.peerNodeId] = stats;
+      return;
+    }
+  SessionStats &total = it->second;
+  total.sessions += stats.sessions;
+  total.active = total.active || stats.active;
+  total.start = std::min (total.start, stats.start);
+  // zero while any of the sessions is up
+  if (total.stop.IsZero () || stats.stop.IsZero ())
+    total.stop = Time (0);
+  else
+    total.stop = std::max (total.stop, stats.stop);
+  total.bundlesSent += stats.bundlesSent;
+  total.bytesSent += stats.bytesSent;
+  total.bundlesAcked += stats.bundlesAcked;
+  total.bundlesReceived += stats.bundlesReceived;
+  total.bytesReceived += stats.bytesReceived;
+}
+
+void
+BpTcpCla::StartSession (Ptr<Socket> socket, bool active)
+{
+  NS_LOG_FUNCTION (this << " " << socket << " " << active);
+  Session &s = m_sessions[socket];
+  s.active = active;
+  s.serial = m_sessionsOpened++;
+  s.stats.active = active;
+  s.stats.start = Simulator::Now ();
+  if (active)
+    {
+      // Bundles wait in the transmit queue until the session is up.
+      HoldTxQueue (socket, true);
+      SendContactHeader (socket);
+    }
+}
+
 void 
 BpTcpCla::SetL4SocketCallbacks (Ptr<Socket> socket)
 { 
@@ -126,6 +314,7 @@ void
 BpTcpCla::ConnectionFailed (Ptr<Socket> socket)
 { 
   NS_LOG_FUNCTION (this << " " << socket);
+  EndSession (socket);
 }
 
 bool
@@ -140,6 +329,409 @@ BpTcpCla::NewConnectionCreated (Ptr<Socket> socket, const Address &address)
 { 
   NS_LOG_FUNCTION (this << " " << socket << " " << address);
   SetL4SocketCallbacks (socket);  // reset the callbacks due to fork in TcpSocketBase
+  StartSession (socket, false);  // wait for the contact header
+}
+
+void
+BpTcpCla::NormalClose (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << " " << socket);
+  BpCla::NormalClose (socket);
+  EndSession (socket);
+}
+
+void
+BpTcpCla::ErrorClose (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << " " << socket);
+  BpCla::ErrorClose (socket);
+  EndSession (socket);
+}
+
+void
+BpTcpCla::DataRecv (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << " " << socket);
+  std::map<Ptr<Socket>, Session>::iterator it = m_sessions.find (socket);
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+    {
+      if (it == m_sessions.end ())
+        {
+          NS_LOG_DEBUG ("discarding " << packet->GetSize () << " bytes received after the session ended");
+          continue;
+        }
+      it->second.rxBuffer->AddAtEnd (packet);
+      it->second.lastRx = Simulator::Now ();
+    }
+
+  // A message may take several reads to come in, and one read may bring
+  // several messages.
+  while (m_sessions.find (socket) != m_sessions.end () && ProcessMessage (socket))
+    ;
+}
+
+bool
+BpTcpCla::ProcessMessage (Ptr<Socket> socket)
+{
+  Session &s = m_sessions[socket];
+  Ptr<Packet> buffer = s.rxBuffer;
+
+  if (!s.contactReceived)
+    {
+      if (buffer->GetSize () < TcpclContactHeader::SIZE)
+        return false;
+      TcpclContactHeader contact;
+      buffer->RemoveHeader (contact);
+      if (!contact.IsValid ())
+        {
+          NS_LOG_WARN ("no TCPCL contact header, closing the connection");
+          EndSession (socket);
+          socket->Close ();
+          return false;
+        }
+      if (contact.GetVersion () != TcpclContactHeader::VERSION)
+        {
+          NS_LOG_WARN ("peer speaks TCPCL version " << (uint32_t) contact.GetVersion ());
+          Terminate (socket, TcpclSessTermHeader::VERSION_MISMATCH);
+          return false;
+        }
+      s.contactReceived = true;
+      // The connecting end sends SESS_INIT first, and the other end replies
+      // to it.
+      if (s.active)
+        SendSessInit (socket);
+      else
+        SendContactHeader (socket);
+      return true;
+    }
+
+  if (buffer->GetSize () == 0)
+    return false;
+  uint8_t type = 0;
+  buffer->CopyData (&type, 1);
+  if (type < TcpclMessageHeader::XFER_SEGMENT || type > TcpclMessageHeader::SESS_INIT)
+    {
+      // The length of an unknown message is unknown too, so the stream
+      // cannot be followed past it.
+      NS_LOG_WARN ("unknown TCPCL message type " << (uint32_t) type);
+      Ptr<Packet> reject = Create<Packet> ();
+      reject->AddHeader (TcpclMsgRejectHeader (TcpclMsgRejectHeader::TYPE_UNKNOWN, type));
+      SendMessageNow (socket, reject, TcpclMessageHeader::MSG_REJECT);
+      Terminate (socket, TcpclSessTermHeader::UNKNOWN);
+      return false;
+    }
+  uint64_t length = TcpclMessageHeader::GetMessageLength (buffer);
+  if (length == 0 || buffer->GetSize () < length)
+    return false;
+
+  Ptr<Packet> message = buffer->CreateFragment (0, length);
+  buffer->RemoveAtStart (length);
+  TcpclMessageHeader header;
+  message->RemoveHeader (header);
+
+  if (!s.established && type != TcpclMessageHeader::SESS_INIT
+      && type != TcpclMessageHeader::SESS_TERM && type != TcpclMessageHeader::MSG_REJECT)
+    {
+      NS_LOG_WARN ("TCPCL message type " << (uint32_t) type << " before SESS_INIT");
+      Terminate (socket, TcpclSessTermHeader::CONTACT_FAILURE);
+      return false;
+    }
+
+  switch (type)
+    {
+    case TcpclMessageHeader::SESS_INIT:
+      ReceiveSessInit (socket, message);
+      break;
+    case TcpclMessageHeader::XFER_SEGMENT:
+      ReceiveSegment (socket, message);
+      break;
+    case TcpclMessageHeader::XFER_ACK:
+      ReceiveAck (socket, message);
+      break;
+    case TcpclMessageHeader::XFER_REFUSE:
+      {
+        TcpclXferRefuseHeader refuse;
+        message->RemoveHeader (refuse);
+        NS_LOG_WARN ("peer refused transfer " << refuse.GetTransferId ()
+                     << " with reason " << (uint32_t) refuse.GetReason ());
+        break;
+      }
+    case TcpclMessageHeader::KEEPALIVE:
+      NS_LOG_DEBUG ("keepalive");
+      break;
+    case TcpclMessageHeader::MSG_REJECT:
+      {
+        TcpclMsgRejectHeader reject;
+        message->RemoveHeader (reject);
+        NS_LOG_WARN ("peer rejected message type " << (uint32_t) reject.GetRejectedType ()
+                     << " with reason " << (uint32_t) reject.GetReason ());
+        break;
+      }
+    case TcpclMessageHeader::SESS_TERM:
+      {
+        TcpclSessTermHeader term;
+        message->RemoveHeader (term);
+        NS_LOG_DEBUG ("peer terminated the session with reason " << (uint32_t) term.GetReason ());
+        if (term.GetFlags () & TcpclSessTermHeader::REPLY)
+          {
+            EndSession (socket);
+            socket->Close ();
+          }
+        else
+          {
+            Ptr<Packet> reply = Create<Packet> ();
+            reply->AddHeader (TcpclSessTermHeader (TcpclSessTermHeader::REPLY, term.GetReason ()));
+            SendMessageNow (socket, reply, TcpclMessageHeader::SESS_TERM);
+            EndSession (socket);
+            socket->Close ();
+          }
+        return false;
+      }
+    }
+
+  // Handing a bundle to the agent may have ended the session.
+  return m_sessions.find (socket) != m_sessions.end ();
+}
+
+void
+BpTcpCla::ReceiveSessInit (Ptr<Socket> socket, Ptr<Packet> message)
+{
+  Session &s = m_sessions[socket];
+  TcpclSessInitHeader init;
+  message->RemoveHeader (init);
+  if (s.established)
+    {
+      NS_LOG_WARN ("ignoring a second SESS_INIT");
+      return;
+    }
+  NS_LOG_DEBUG ("SESS_INIT from " << init.GetNodeId () << " segment MRU " << init.GetSegmentMru ()
+                << " transfer MRU " << init.GetTransferMru () << " keepalive " << init.GetKeepalive ());
+  s.peerSegmentMru = init.GetSegmentMru ();
+  s.peerTransferMru = init.GetTransferMru ();
+  s.peerNodeId = init.GetNodeId ();
+  s.stats.peerNodeId = s.peerNodeId;
+  if (!s.active)
+    SendSessInit (socket);
+  s.established = true;
+
+  uint16_t local = std::min (m_keepaliveInterval.GetSeconds (), 65535.0);
+  uint16_t keepalive = std::min (local, init.GetKeepalive ());
+  if (keepalive != 0)
+    {
+      s.keepalive = Seconds (keepalive);
+      s.keepaliveEvent = Simulator::Schedule (s.keepalive, &BpTcpCla::Keepalive, this, socket);
+    }
+
+  if (s.active)
+    HoldTxQueue (socket, false);
+}
+
+void
+BpTcpCla::ReceiveSegment (Ptr<Socket> socket, Ptr<Packet> message)
+{
+  Session &s = m_sessions[socket];
+  TcpclXferSegmentHeader segment;
+  message->RemoveHeader (segment);
+  uint64_t id = segment.GetTransferId ();
+
+  if (segment.GetFlags () & TcpclXferSegmentHeader::START)
+    {
+      s.rxTransfer = Create<Packet> ();
+      s.rxTransferId = id;
+    }
+  else if (!s.rxTransfer || id != s.rxTransferId)
+    {
+      NS_LOG_DEBUG ("discarding a segment of transfer " << id << ", which is not in progress");
+      return;
+    }
+
+  if ((uint64_t) s.rxTransfer->GetSize () + message->GetSize () > m_transferMru)
+    {
+      NS_LOG_WARN ("transfer " << id << " is larger than TransferMru, refusing it");
+      s.rxTransfer = 0;
+      Ptr<Packet> refuse = Create<Packet> ();
+      refuse->AddHeader (TcpclXferRefuseHeader (TcpclXferRefuseHeader::NO_RESOURCES, id));
+      SendMessage (socket, refuse, TcpclMessageHeader::XFER_REFUSE);
+      return;
+    }
+  s.rxTransfer->AddAtEnd (message);
+
+  TcpclXferAckHeader ack;
+  ack.SetFlags (segment.GetFlags ());
+  ack.SetTransferId (id);
+  ack.SetAckLength (s.rxTransfer->GetSize ());
+  Ptr<Packet> body = Create<Packet> ();
+  body->AddHeader (ack);
+  SendMessage (socket, body, TcpclMessageHeader::XFER_ACK);
+
+  if (segment.GetFlags () & TcpclXferSegmentHeader::END)
+    {
+      NS_LOG_DEBUG ("transfer " << id << " complete with " << s.rxTransfer->GetSize () << " bytes");
+      Ptr<Packet> bundle = s.rxTransfer;
+      s.rxTransfer = 0;
+      s.stats.bundlesReceived++;
+      s.stats.bytesReceived += bundle->GetSize ();
+      ProcessReceivedBundle (bundle);
+    }
+}
+
+void
+BpTcpCla::ReceiveAck (Ptr<Socket> socket, Ptr<Packet> message)
+{
+  TcpclXferAckHeader ack;
+  message->RemoveHeader (ack);
+  std::map<Ptr<Socket>, Session>::iterator it = m_sessions.find (socket);
+  if (it != m_sessions.end () && (ack.GetFlags () & TcpclXferSegmentHeader::END))
+    it->second.stats.bundlesAcked++;
+  NS_LOG_DEBUG ("transfer " << ack.GetTransferId () << " acknowledged up to " << ack.GetAckLength ()
+                << ((ack.GetFlags () & TcpclXferSegmentHeader::END) ? ", complete" : ""));
+}
+
+int
+BpTcpCla::Transmit (Ptr<Socket> socket, Ptr<Packet> bundle)
+{
+  NS_LOG_FUNCTION (this << " " << socket << " " << bundle->GetSize ());
+  std::map<Ptr<Socket>, Session>::iterator it = m_sessions.find (socket);
+  if (it == m_sessions.end ())
+    return -1;
+  Session &s = it->second;
+  if (s.established && bundle->GetSize () > s.peerTransferMru)
+    {
+      NS_LOG_WARN ("a " << bundle->GetSize () << " byte bundle is larger than the peer's transfer MRU");
+      return -1;
+    }
+
+  uint64_t segmentSize = m_segmentMru;
+  if (s.peerSegmentMru != 0)
+    segmentSize = std::min (segmentSize, s.peerSegmentMru);
+
+  uint64_t id = s.nextTransferId++;
+  uint32_t size = bundle->GetSize ();
+  uint32_t offset = 0;
+  do
+    {
+      uint32_t length = std::min (segmentSize, (uint64_t) (size - offset));
+      uint8_t flags = 0;
+      if (offset == 0)
+        flags |= TcpclXferSegmentHeader::START;
+      if (offset + length == size)
+        flags |= TcpclXferSegmentHeader::END;
+
+      TcpclXferSegmentHeader header;
+      header.SetFlags (flags);
+      header.SetTransferId (id);
+      header.SetDataLength (length);
+      Ptr<Packet> segment = bundle->CreateFragment (offset, length);
+      segment->AddHeader (header);
+      segment->AddHeader (TcpclMessageHeader (TcpclMessageHeader::XFER_SEGMENT));
+      Enqueue (socket, segment);
+      offset += length;
+    }
+  while (offset < size);
+
+  s.lastTx = Simulator::Now ();
+  s.stats.bundlesSent++;
+  s.stats.bytesSent += size;
+  return 0;
+}
+
+void
+BpTcpCla::SendContactHeader (Ptr<Socket> socket)
+{
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (TcpclContactHeader ());
+  socket->Send (p);
+  m_sessions[socket].lastTx = Simulator::Now ();
+}
+
+void
+BpTcpCla::SendSessInit (Ptr<Socket> socket)
+{
+  TcpclSessInitHeader init;
+  init.SetKeepalive (std::min (m_keepaliveInterval.GetSeconds (), 65535.0));
+  init.SetSegmentMru (m_segmentMru);
+  init.SetTransferMru (m_transferMru);
+  init.SetNodeId (m_nodeId);
+  Ptr<Packet> body = Create<Packet> ();
+  body->AddHeader (init);
+  SendMessageNow (socket, body, TcpclMessageHeader::SESS_INIT);
+}
+
+void
+BpTcpCla::SendMessage (Ptr<Socket> socket, Ptr<Packet> body, uint8_t type)
+{
+  body->AddHeader (TcpclMessageHeader (type));
+  Enqueue (socket, body);
+  m_sessions[socket].lastTx = Simulator::Now ();
+}
+
+void
+BpTcpCla::SendMessageNow (Ptr<Socket> socket, Ptr<Packet> body, uint8_t type)
+{
+  body->AddHeader (TcpclMessageHeader (type));
+  socket->Send (body);
+  std::map<Ptr<Socket>, Session>::iterator it = m_sessions.find (socket);
+  if (it != m_sessions.end ())
+    it->second.lastTx = Simulator::Now ();
+}
+
+void
+BpTcpCla::Keepalive (Ptr<Socket> socket)
+{
+  std::map<Ptr<Socket>, Session>::iterator it = m_sessions.find (socket);
+  if (it == m_sessions.end ())
+    return;
+  Session &s = it->second;
+  Time now = Simulator::Now ();
+  if (now - s.lastRx >= s.keepalive + s.keepalive)
+    {
+      NS_LOG_WARN ("nothing received for " << (now - s.lastRx).GetSeconds () << " s, ending the session");
+      Terminate (socket, TcpclSessTermHeader::IDLE_TIMEOUT);
+      return;
+    }
+  if (now - s.lastTx >= s.keepalive)
+    SendMessage (socket, Create<Packet> (), TcpclMessageHeader::KEEPALIVE);
+  s.keepaliveEvent = Simulator::Schedule (s.keepalive, &BpTcpCla::Keepalive, this, socket);
+}
+
+void
+BpTcpCla::Terminate (Ptr<Socket> socket, uint8_t reason)
+{
+  NS_LOG_FUNCTION (this << " " << socket << " " << (uint32_t) reason);
+  Ptr<Packet> term = Create<Packet> ();
+  term->AddHeader (TcpclSessTermHeader (0, reason));
+  SendMessageNow (socket, term, TcpclMessageHeader::SESS_TERM);
+  EndSession (socket);
+  socket->Close ();
+}
+
+void
+BpTcpCla::EndSession (Ptr<Socket> socket)
+{
+  std::map<Ptr<Socket>, Session>::iterator it = m_sessions.find (socket);
+  if (it == m_sessions.end ())
+    return;
+  NS_LOG_FUNCTION (this << " " << socket);
+  Simulator::Cancel (it->second.keepaliveEvent);
+  it->second.stats.stop = Simulator::Now ();
+  AddStats (m_peerStats, it->second.stats);
+  m_sessions.erase (it);
+  FlushTxQueue (socket);
+
+  // The next bundle for this peer opens a new connection in its place.
+  std::map<PeerKey, Pool>::iterator pit;
+  for (pit = m_pools.begin (); pit != m_pools.end (); pit++)
+    {
+      std::vector<Ptr<Socket> > &sockets = pit->second.sockets;
+      std::vector<Ptr<Socket> >::iterator sit = std::find (sockets.begin (), sockets.end (), socket);
+      if (sit != sockets.end ())
+        {
+          sockets.erase (sit);
+          break;
+        }
+    }
 }
 
 TypeId
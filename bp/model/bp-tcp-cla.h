@@ -22,15 +22,76 @@
 #define BP_TCP_CLA_H
 
 #include "bp-cla.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include <map>
+#include <vector>
 
 namespace ns3 {
 
+/**
+ * \brief TCP convergence layer
+ *
+ * Runs a session of the TCP convergence layer protocol, version 4 (RFC
+ * 9174), over each connection: both ends exchange a contact header and a
+ * SESS_INIT message, and each bundle is then sent as one transfer of
+ * XFER_SEGMENT messages of at most SegmentMru data bytes (or the peer's
+ * segment MRU, if smaller).  The receiver takes the messages out of the
+ * byte stream however TCP delivers it, puts the segments of a transfer
+ * back together, acknowledges each with XFER_ACK and hands the bundle to
+ * the agent when the last one is in.  Bundles are thus not limited by the
+ * TCP segment size, and MaxBundleSize may be raised to megabytes.
+ *
+ * The connecting end holds its bundles in its transmit queue until the
+ * peer's SESS_INIT arrives.  Bundles queued before then are segmented with
+ * the local SegmentMru, so the two ends should use the same value.
+ * KeepaliveInterval, if not zero, is offered in SESS_INIT; the smaller of
+ * the two offers is used, and a session that receives nothing for twice
+ * that long is terminated.  A terminated session drops what is still
+ * queued on it, and the next bundle opens a new connection.
+ *
+ * Bundles for one peer address go over a pool of Connections parallel
+ * sessions, so that a link with a large bandwidth-delay product is not
+ * limited to the congestion window of one TCP connection.  PoolPolicy picks
+ * the session for each bundle: in turn, or the one with the fewest queued
+ * bytes.  The pool is opened in full with the first bundle for the peer,
+ * and topped up again when a session ends.  TxQueueBytes applies to each
+ * session.  Bundles sent over different sessions may arrive out of order.
+ * GetSessionStats () reports the transfers of the sessions that are up, and
+ * GetPeerStats () the totals of every session run with each peer; the stats
+ * of a session are added to the totals of its peer when it ends.
+ *
+ * TLS, session and transfer extension items and the reuse of a session in
+ * both directions are not implemented.
+ */
 class BpTcpCla : public BpCla
 {
 public:
 
   static TypeId GetTypeId (void);
 
+  /// how the sessions to a peer are picked for each bundle
+  enum PoolPolicy {
+    ROUND_ROBIN,   /// each session in turn
+    LEAST_QUEUED   /// the session with the fewest bytes in its transmit queue
+  };
+
+  /// transfers over one session, or added up over the sessions with a peer
+  struct SessionStats {
+    SessionStats ();
+
+    uint32_t sessions;            /// sessions added up, 1 for a single session
+    bool active;                  /// this end connected
+    std::string peerNodeId;       /// from the peer's SESS_INIT
+    Time start;                   /// when the (first) connection was opened or accepted
+    Time stop;                    /// when the (last) session ended, zero while it is up
+    uint64_t bundlesSent;         /// transfers started
+    uint64_t bytesSent;
+    uint64_t bundlesAcked;        /// transfers whose last segment the peer acknowledged
+    uint64_t bundlesReceived;     /// complete transfers received
+    uint64_t bytesReceived;
+  };
+
   /**
    * \brief Constructor
    */
@@ -50,6 +111,42 @@ public:
    */
   virtual int EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode);
 
+  /**
+   * Open the pool of sessions to a peer
+   *
+   * \param src the source endpoint id
+   * \param dst the destination endpoint id
+   * \param dstAddress the address of the destination endpoint id
+   * \param bpNode the node of the sender bpAgent
+   */
+  virtual int EnableSend (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+
+  /**
+   * Get a session of the pool to a peer for one bundle, opening the pool
+   * first if needed
+   *
+   * \param src the source endpoint id
+   * \param dst the destination endpoint id
+   * \param dstAddress the address of the destination endpoint id
+   * \param bpNode the node of the sender bpAgent
+   *
+   * \return the socket of the session, or 0 if no connection could be
+   * opened
+   */
+  virtual Ptr<Socket> GetL4Socket (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode);
+
+  /**
+   * \return the stats of the sessions that are up, in the order they were
+   * opened
+   */
+  std::vector<SessionStats> GetSessionStats () const;
+
+  /**
+   * \return the stats of every session, up or ended, added up by peer node
+   * ID; sessions that ended before SESS_INIT are under an empty ID
+   */
+  std::map<std::string, SessionStats> GetPeerStats () const;
+
   /**
    *  Callbacks methods callded by NotifyXXX methods in TcpSocketBase
    *
@@ -78,11 +175,136 @@ public:
    * \brief new connection created callback
    */
   void NewConnectionCreated (Ptr<Socket>, const Address &);
-  
+
+  /**
+   * \brief normal close callback
+   */
+  virtual void NormalClose (Ptr<Socket> socket);
+
+  /**
+   * \brief error close callback
+   */
+  virtual void ErrorClose (Ptr<Socket> socket);
+
+  /**
+   * \brief data receive callback; takes the session messages out of the
+   * received bytes
+   */
+  virtual void DataRecv (Ptr<Socket> socket);
+
+protected:
+
+  virtual void DoDispose (void);
+
+  /**
+   * Send an encoded bundle as one transfer of XFER_SEGMENT messages
+   */
+  virtual int Transmit (Ptr<Socket> socket, Ptr<Packet> bundle);
+
 private:
 
+  /// the state of the session on one connection
+  struct Session {
+    Session ();
+
+    bool active;                  /// this end connected
+    bool contactReceived;         /// the peer's contact header is in
+    bool established;             /// SESS_INIT has been exchanged
+    Ptr<Packet> rxBuffer;         /// received bytes not yet taken as a message
+    Ptr<Packet> rxTransfer;       /// segments of the incoming transfer so far
+    uint64_t rxTransferId;
+    uint64_t nextTransferId;
+    uint64_t peerSegmentMru;      /// 0 until the peer's SESS_INIT is in
+    uint64_t peerTransferMru;
+    std::string peerNodeId;
+    Time keepalive;               /// negotiated interval, zero if disabled
+    Time lastRx;
+    Time lastTx;
+    EventId keepaliveEvent;
+    uint64_t serial;              /// sessions this CLA opened or accepted before this one
+    SessionStats stats;
+  };
+
+  /// the sessions to one peer address
+  struct Pool {
+    Pool () : next (0) {}
+
+    std::vector<Ptr<Socket> > sockets;
+    uint32_t next;                /// where the next choice starts
+  };
+
+  /// a peer address as IPv4 address and port
+  typedef std::pair<uint32_t, uint16_t> PeerKey;
+
   virtual TypeId GetSocketTypeId();
 
+  /**
+   * Take the next message out of the receive buffer of a session and act
+   * on it.
+   *
+   * \return true if there may be another message in the buffer
+   */
+  bool ProcessMessage (Ptr<Socket> socket);
+
+  void ReceiveSessInit (Ptr<Socket> socket, Ptr<Packet> message);
+  void ReceiveSegment (Ptr<Socket> socket, Ptr<Packet> message);
+  void ReceiveAck (Ptr<Socket> socket, Ptr<Packet> message);
+
+  /**
+   * Set up the session of a socket, accepted or connected by this end; the
+   * connecting end also sends its contact header.
+   */
+  void StartSession (Ptr<Socket> socket, bool active);
+
+  void SendContactHeader (Ptr<Socket> socket);
+  void SendSessInit (Ptr<Socket> socket);
+
+  /**
+   * Queue a message behind the transfers already queued on a socket.
+   *
+   * \param body the message fields, without the message header
+   */
+  void SendMessage (Ptr<Socket> socket, Ptr<Packet> body, uint8_t type);
+
+  /**
+   * Send a message ahead of anything queued on a socket, for the messages
+   * that start and end a session.
+   */
+  void SendMessageNow (Ptr<Socket> socket, Ptr<Packet> body, uint8_t type);
+
+  /**
+   * Send KEEPALIVE if nothing else went out in the last interval, and end
+   * the session if nothing came in for two.
+   */
+  void Keepalive (Ptr<Socket> socket);
+
+  /**
+   * Send SESS_TERM, end the session and close its connection.
+   */
+  void Terminate (Ptr<Socket> socket, uint8_t reason);
+
+  /**
+   * Add the stats of one session to the totals of its peer.
+   */
+  static void AddStats (std::map<std::string, SessionStats> &totals, const SessionStats &stats);
+
+  /**
+   * Forget a session whose connection is closed or closing: drop its
+   * queue, and take it out of its pool.
+   */
+  void EndSession (Ptr<Socket> socket);
+
+  std::map<Ptr<Socket>, Session> m_sessions;
+  uint64_t m_sessionsOpened;
+  std::map<std::string, SessionStats> m_peerStats;  /// totals of the sessions that ended
+  std::map<PeerKey, Pool> m_pools;
+  uint32_t m_connections;       /// Connections attribute
+  PoolPolicy m_poolPolicy;      /// PoolPolicy attribute
+  std::string m_nodeId;         /// node ID sent in SESS_INIT, the first local endpoint id used
+  uint32_t m_segmentMru;        /// SegmentMru attribute
+  uint32_t m_transferMru;       /// TransferMru attribute
+  Time m_keepaliveInterval;     /// KeepaliveInterval attribute
+
   /**
    * Set callbacks of the transport layer
    *
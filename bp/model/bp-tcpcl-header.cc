@@ -0,0 +1,730 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "bp-tcpcl-header.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <vector>
+
+NS_LOG_COMPONENT_DEFINE ("TcpclHeader");
+
+namespace ns3 {
+
+namespace {
+
+/**
+ * \return the big-endian integer of size bytes at offset in data
+ */
+uint64_t
+ReadNetwork (const std::vector<uint8_t> &data, uint32_t offset, uint32_t size)
+{
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < size; i++)
+    value = (value << 8) | data[offset + i];
+  return value;
+}
+
+} // anonymous namespace
+
+NS_OBJECT_ENSURE_REGISTERED (TcpclContactHeader);
+NS_OBJECT_ENSURE_REGISTERED (TcpclMessageHeader);
+NS_OBJECT_ENSURE_REGISTERED (TcpclSessInitHeader);
+NS_OBJECT_ENSURE_REGISTERED (TcpclXferSegmentHeader);
+NS_OBJECT_ENSURE_REGISTERED (TcpclXferAckHeader);
+NS_OBJECT_ENSURE_REGISTERED (TcpclXferRefuseHeader);
+NS_OBJECT_ENSURE_REGISTERED (TcpclSessTermHeader);
+NS_OBJECT_ENSURE_REGISTERED (TcpclMsgRejectHeader);
+
+// TcpclContactHeader
+
+TcpclContactHeader::TcpclContactHeader ()
+  : m_version (VERSION),
+    m_flags (0)
+{
+  m_magic[0] = 'd';
+  m_magic[1] = 't';
+  m_magic[2] = 'n';
+  m_magic[3] = '!';
+}
+
+TypeId
+TcpclContactHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpclContactHeader")
+    .SetParent<Header> ()
+    .AddConstructor<TcpclContactHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpclContactHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpclContactHeader::GetSerializedSize (void) const
+{
+  return SIZE;
+}
+
+void
+TcpclContactHeader::Serialize (Buffer::Iterator start) const
+{
+  start.Write (m_magic, 4);
+  start.WriteU8 (m_version);
+  start.WriteU8 (m_flags);
+}
+
+uint32_t
+TcpclContactHeader::Deserialize (Buffer::Iterator start)
+{
+  start.Read (m_magic, 4);
+  m_version = start.ReadU8 ();
+  m_flags = start.ReadU8 ();
+  return SIZE;
+}
+
+void
+TcpclContactHeader::Print (std::ostream &os) const
+{
+  os << "version " << (uint32_t) m_version << " flags " << (uint32_t) m_flags;
+}
+
+bool
+TcpclContactHeader::IsValid () const
+{
+  return m_magic[0] == 'd' && m_magic[1] == 't' && m_magic[2] == 'n' && m_magic[3] == '!';
+}
+
+uint8_t
+TcpclContactHeader::GetVersion () const
+{
+  return m_version;
+}
+
+uint8_t
+TcpclContactHeader::GetFlags () const
+{
+  return m_flags;
+}
+
+// TcpclMessageHeader
+
+TcpclMessageHeader::TcpclMessageHeader (uint8_t type)
+  : m_type (type)
+{
+}
+
+TypeId
+TcpclMessageHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpclMessageHeader")
+    .SetParent<Header> ()
+    .AddConstructor<TcpclMessageHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpclMessageHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpclMessageHeader::GetSerializedSize (void) const
+{
+  return 1;
+}
+
+void
+TcpclMessageHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_type);
+}
+
+uint32_t
+TcpclMessageHeader::Deserialize (Buffer::Iterator start)
+{
+  m_type = start.ReadU8 ();
+  return 1;
+}
+
+void
+TcpclMessageHeader::Print (std::ostream &os) const
+{
+  os << "type " << (uint32_t) m_type;
+}
+
+uint8_t
+TcpclMessageHeader::GetType () const
+{
+  return m_type;
+}
+
+uint64_t
+TcpclMessageHeader::GetMessageLength (Ptr<const Packet> buffer)
+{
+  uint32_t available = buffer->GetSize ();
+  if (available == 0)
+    return 0;
+
+  // The length fields of the variable-size messages are read from a copy of
+  // as many leading bytes as are needed to reach them.
+  std::vector<uint8_t> data (std::min (available, (uint32_t) 25));
+  buffer->CopyData (data.data (), data.size ());
+
+  switch (data[0])
+    {
+    case KEEPALIVE:
+      return 1;
+    case SESS_TERM:
+    case MSG_REJECT:
+      return 3;
+    case XFER_REFUSE:
+      return 10;
+    case XFER_ACK:
+      return 18;
+    case XFER_SEGMENT:
+      {
+        if (available < 10)
+          return 0;
+        uint64_t offset = 10;
+        if (data[1] & TcpclXferSegmentHeader::START)
+          {
+            if (available < 14)
+              return 0;
+            offset = 14 + ReadNetwork (data, 10, 4);
+          }
+        if (available < offset + 8)
+          return 0;
+        data.resize (offset + 8);
+        buffer->CopyData (data.data (), data.size ());
+        return offset + 8 + ReadNetwork (data, offset, 8);
+      }
+    case SESS_INIT:
+      {
+        if (available < 21)
+          return 0;
+        uint64_t offset = 21 + ReadNetwork (data, 19, 2);
+        if (available < offset + 4)
+          return 0;
+        data.resize (offset + 4);
+        buffer->CopyData (data.data (), data.size ());
+        return offset + 4 + ReadNetwork (data, offset, 4);
+      }
+    default:
+      return 0;
+    }
+}
+
+// TcpclSessInitHeader
+
+TcpclSessInitHeader::TcpclSessInitHeader ()
+  : m_keepalive (0),
+    m_segmentMru (0),
+    m_transferMru (0)
+{
+}
+
+TypeId
+TcpclSessInitHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpclSessInitHeader")
+    .SetParent<Header> ()
+    .AddConstructor<TcpclSessInitHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpclSessInitHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpclSessInitHeader::GetSerializedSize (void) const
+{
+  return 2 + 8 + 8 + 2 + m_nodeId.length () + 4;
+}
+
+void
+TcpclSessInitHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU16 (m_keepalive);
+  start.WriteHtonU64 (m_segmentMru);
+  start.WriteHtonU64 (m_transferMru);
+  start.WriteHtonU16 (m_nodeId.length ());
+  start.Write (reinterpret_cast<const uint8_t *> (m_nodeId.data ()), m_nodeId.length ());
+  start.WriteHtonU32 (0);
+}
+
+uint32_t
+TcpclSessInitHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_keepalive = i.ReadNtohU16 ();
+  m_segmentMru = i.ReadNtohU64 ();
+  m_transferMru = i.ReadNtohU64 ();
+  m_nodeId.resize (i.ReadNtohU16 ());
+  if (!m_nodeId.empty ())
+    i.Read (reinterpret_cast<uint8_t *> (&m_nodeId[0]), m_nodeId.length ());
+  uint32_t extLength = i.ReadNtohU32 ();
+  i.Next (extLength);
+  return i.GetDistanceFrom (start);
+}
+
+void
+TcpclSessInitHeader::Print (std::ostream &os) const
+{
+  os << "keepalive " << m_keepalive << " segment MRU " << m_segmentMru
+     << " transfer MRU " << m_transferMru << " node " << m_nodeId;
+}
+
+void
+TcpclSessInitHeader::SetKeepalive (uint16_t seconds)
+{
+  m_keepalive = seconds;
+}
+
+uint16_t
+TcpclSessInitHeader::GetKeepalive () const
+{
+  return m_keepalive;
+}
+
+void
+TcpclSessInitHeader::SetSegmentMru (uint64_t mru)
+{
+  m_segmentMru = mru;
+}
+
+uint64_t
+TcpclSessInitHeader::GetSegmentMru () const
+{
+  return m_segmentMru;
+}
+
+void
+TcpclSessInitHeader::SetTransferMru (uint64_t mru)
+{
+  m_transferMru = mru;
+}
+
+uint64_t
+TcpclSessInitHeader::GetTransferMru () const
+{
+  return m_transferMru;
+}
+
+void
+TcpclSessInitHeader::SetNodeId (const std::string &nodeId)
+{
+  m_nodeId = nodeId;
+}
+
+std::string
+TcpclSessInitHeader::GetNodeId () const
+{
+  return m_nodeId;
+}
+
+// TcpclXferSegmentHeader
+
+TcpclXferSegmentHeader::TcpclXferSegmentHeader ()
+  : m_flags (0),
+    m_transferId (0),
+    m_dataLength (0)
+{
+}
+
+TypeId
+TcpclXferSegmentHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpclXferSegmentHeader")
+    .SetParent<Header> ()
+    .AddConstructor<TcpclXferSegmentHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpclXferSegmentHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpclXferSegmentHeader::GetSerializedSize (void) const
+{
+  uint32_t size = 1 + 8 + 8;
+  if (m_flags & START)
+    size += 4;
+  return size;
+}
+
+void
+TcpclXferSegmentHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_flags);
+  start.WriteHtonU64 (m_transferId);
+  if (m_flags & START)
+    start.WriteHtonU32 (0);
+  start.WriteHtonU64 (m_dataLength);
+}
+
+uint32_t
+TcpclXferSegmentHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_flags = i.ReadU8 ();
+  m_transferId = i.ReadNtohU64 ();
+  if (m_flags & START)
+    {
+      uint32_t extLength = i.ReadNtohU32 ();
+      i.Next (extLength);
+    }
+  m_dataLength = i.ReadNtohU64 ();
+  return i.GetDistanceFrom (start);
+}
+
+void
+TcpclXferSegmentHeader::Print (std::ostream &os) const
+{
+  os << "transfer " << m_transferId << " flags " << (uint32_t) m_flags
+     << " length " << m_dataLength;
+}
+
+void
+TcpclXferSegmentHeader::SetFlags (uint8_t flags)
+{
+  m_flags = flags;
+}
+
+uint8_t
+TcpclXferSegmentHeader::GetFlags () const
+{
+  return m_flags;
+}
+
+void
+TcpclXferSegmentHeader::SetTransferId (uint64_t id)
+{
+  m_transferId = id;
+}
+
+uint64_t
+TcpclXferSegmentHeader::GetTransferId () const
+{
+  return m_transferId;
+}
+
+void
+TcpclXferSegmentHeader::SetDataLength (uint64_t length)
+{
+  m_dataLength = length;
+}
+
+uint64_t
+TcpclXferSegmentHeader::GetDataLength () const
+{
+  return m_dataLength;
+}
+
+// TcpclXferAckHeader
+
+TcpclXferAckHeader::TcpclXferAckHeader ()
+  : m_flags (0),
+    m_transferId (0),
+    m_ackLength (0)
+{
+}
+
+TypeId
+TcpclXferAckHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpclXferAckHeader")
+    .SetParent<Header> ()
+    .AddConstructor<TcpclXferAckHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpclXferAckHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpclXferAckHeader::GetSerializedSize (void) const
+{
+  return 1 + 8 + 8;
+}
+
+void
+TcpclXferAckHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_flags);
+  start.WriteHtonU64 (m_transferId);
+  start.WriteHtonU64 (m_ackLength);
+}
+
+uint32_t
+TcpclXferAckHeader::Deserialize (Buffer::Iterator start)
+{
+  m_flags = start.ReadU8 ();
+  m_transferId = start.ReadNtohU64 ();
+  m_ackLength = start.ReadNtohU64 ();
+  return GetSerializedSize ();
+}
+
+void
+TcpclXferAckHeader::Print (std::ostream &os) const
+{
+  os << "transfer " << m_transferId << " flags " << (uint32_t) m_flags
+     << " acked " << m_ackLength;
+}
+
+void
+TcpclXferAckHeader::SetFlags (uint8_t flags)
+{
+  m_flags = flags;
+}
+
+uint8_t
+TcpclXferAckHeader::GetFlags () const
+{
+  return m_flags;
+}
+
+void
+TcpclXferAckHeader::SetTransferId (uint64_t id)
+{
+  m_transferId = id;
+}
+
+uint64_t
+TcpclXferAckHeader::GetTransferId () const
+{
+  return m_transferId;
+}
+
+void
+TcpclXferAckHeader::SetAckLength (uint64_t length)
+{
+  m_ackLength = length;
+}
+
+uint64_t
+TcpclXferAckHeader::GetAckLength () const
+{
+  return m_ackLength;
+}
+
+// TcpclXferRefuseHeader
+
+TcpclXferRefuseHeader::TcpclXferRefuseHeader (uint8_t reason, uint64_t transferId)
+  : m_reason (reason),
+    m_transferId (transferId)
+{
+}
+
+TypeId
+TcpclXferRefuseHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpclXferRefuseHeader")
+    .SetParent<Header> ()
+    .AddConstructor<TcpclXferRefuseHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpclXferRefuseHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpclXferRefuseHeader::GetSerializedSize (void) const
+{
+  return 1 + 8;
+}
+
+void
+TcpclXferRefuseHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_reason);
+  start.WriteHtonU64 (m_transferId);
+}
+
+uint32_t
+TcpclXferRefuseHeader::Deserialize (Buffer::Iterator start)
+{
+  m_reason = start.ReadU8 ();
+  m_transferId = start.ReadNtohU64 ();
+  return GetSerializedSize ();
+}
+
+void
+TcpclXferRefuseHeader::Print (std::ostream &os) const
+{
+  os << "transfer " << m_transferId << " reason " << (uint32_t) m_reason;
+}
+
+uint8_t
+TcpclXferRefuseHeader::GetReason () const
+{
+  return m_reason;
+}
+
+uint64_t
+TcpclXferRefuseHeader::GetTransferId () const
+{
+  return m_transferId;
+}
+
+// TcpclSessTermHeader
+
+TcpclSessTermHeader::TcpclSessTermHeader (uint8_t flags, uint8_t reason)
+  : m_flags (flags),
+    m_reason (reason)
+{
+}
+
+TypeId
+TcpclSessTermHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpclSessTermHeader")
+    .SetParent<Header> ()
+    .AddConstructor<TcpclSessTermHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpclSessTermHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpclSessTermHeader::GetSerializedSize (void) const
+{
+  return 2;
+}
+
+void
+TcpclSessTermHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_flags);
+  start.WriteU8 (m_reason);
+}
+
+uint32_t
+TcpclSessTermHeader::Deserialize (Buffer::Iterator start)
+{
+  m_flags = start.ReadU8 ();
+  m_reason = start.ReadU8 ();
+  return 2;
+}
+
+void
+TcpclSessTermHeader::Print (std::ostream &os) const
+{
+  os << "flags " << (uint32_t) m_flags << " reason " << (uint32_t) m_reason;
+}
+
+uint8_t
+TcpclSessTermHeader::GetFlags () const
+{
+  return m_flags;
+}
+
+uint8_t
+TcpclSessTermHeader::GetReason () const
+{
+  return m_reason;
+}
+
+// TcpclMsgRejectHeader
+
+TcpclMsgRejectHeader::TcpclMsgRejectHeader (uint8_t reason, uint8_t rejectedType)
+  : m_reason (reason),
+    m_rejectedType (rejectedType)
+{
+}
+
+TypeId
+TcpclMsgRejectHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpclMsgRejectHeader")
+    .SetParent<Header> ()
+    .AddConstructor<TcpclMsgRejectHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpclMsgRejectHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpclMsgRejectHeader::GetSerializedSize (void) const
+{
+  return 2;
+}
+
+void
+TcpclMsgRejectHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_reason);
+  start.WriteU8 (m_rejectedType);
+}
+
+uint32_t
+TcpclMsgRejectHeader::Deserialize (Buffer::Iterator start)
+{
+  m_reason = start.ReadU8 ();
+  m_rejectedType = start.ReadU8 ();
+  return 2;
+}
+
+void
+TcpclMsgRejectHeader::Print (std::ostream &os) const
+{
+  os << "reason " << (uint32_t) m_reason << " type " << (uint32_t) m_rejectedType;
+}
+
+uint8_t
+TcpclMsgRejectHeader::GetReason () const
+{
+  return m_reason;
+}
+
+uint8_t
+TcpclMsgRejectHeader::GetRejectedType () const
+{
+  return m_rejectedType;
+}
+
+} // namespace ns3
@@ -0,0 +1,307 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BP_TCPCL_HEADER_H
+#define BP_TCPCL_HEADER_H
+
+#include "ns3/header.h"
+#include "ns3/packet.h"
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief TCPCL contact header
+ *
+ * The first bytes sent by each end of a TCP convergence layer session, as
+ * defined in section 4.2 of RFC 9174: the magic "dtn!", the protocol
+ * version and the contact flags.
+ */
+class TcpclContactHeader : public Header
+{
+public:
+  /// the TCPCL version spoken by BpTcpCla
+  static const uint8_t VERSION = 4;
+  static const uint32_t SIZE = 6;
+
+  TcpclContactHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * \return true if the header starts with the magic "dtn!"
+   */
+  bool IsValid () const;
+
+  uint8_t GetVersion () const;
+  uint8_t GetFlags () const;
+
+private:
+  uint8_t m_magic[4];
+  uint8_t m_version;
+  uint8_t m_flags;
+};
+
+/**
+ * \brief TCPCL message header
+ *
+ * The type code that starts every message after the contact header (RFC
+ * 9174 section 4.7).  The message fields follow it as a header of their
+ * own type below.
+ */
+class TcpclMessageHeader : public Header
+{
+public:
+  enum MessageType {
+    XFER_SEGMENT = 0x01,
+    XFER_ACK = 0x02,
+    XFER_REFUSE = 0x03,
+    KEEPALIVE = 0x04,
+    SESS_TERM = 0x05,
+    MSG_REJECT = 0x06,
+    SESS_INIT = 0x07
+  };
+
+  TcpclMessageHeader (uint8_t type = KEEPALIVE);
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  uint8_t GetType () const;
+
+  /**
+   * \brief the length of the message at the start of a receive buffer
+   *
+   * \param buffer received bytes, starting with a message header
+   * \return the length of the whole message, including the data of a
+   * transfer segment, or 0 if the buffer does not hold enough bytes to tell
+   * or the type is unknown
+   */
+  static uint64_t GetMessageLength (Ptr<const Packet> buffer);
+
+private:
+  uint8_t m_type;
+};
+
+/**
+ * \brief Fields of a SESS_INIT message (RFC 9174 section 4.6)
+ *
+ * Session extension items are not used; received ones are skipped.
+ */
+class TcpclSessInitHeader : public Header
+{
+public:
+  TcpclSessInitHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  void SetKeepalive (uint16_t seconds);
+  uint16_t GetKeepalive () const;
+  void SetSegmentMru (uint64_t mru);
+  uint64_t GetSegmentMru () const;
+  void SetTransferMru (uint64_t mru);
+  uint64_t GetTransferMru () const;
+  void SetNodeId (const std::string &nodeId);
+  std::string GetNodeId () const;
+
+private:
+  uint16_t m_keepalive;
+  uint64_t m_segmentMru;
+  uint64_t m_transferMru;
+  std::string m_nodeId;
+};
+
+/**
+ * \brief Fields of an XFER_SEGMENT message (RFC 9174 section 5.2.2)
+ *
+ * The segment data follows the header.  Transfer extension items are not
+ * used; received ones are skipped.
+ */
+class TcpclXferSegmentHeader : public Header
+{
+public:
+  enum Flags {
+    END = 0x01,
+    START = 0x02
+  };
+
+  TcpclXferSegmentHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  void SetFlags (uint8_t flags);
+  uint8_t GetFlags () const;
+  void SetTransferId (uint64_t id);
+  uint64_t GetTransferId () const;
+  void SetDataLength (uint64_t length);
+  uint64_t GetDataLength () const;
+
+private:
+  uint8_t m_flags;
+  uint64_t m_transferId;
+  uint64_t m_dataLength;
+};
+
+/**
+ * \brief Fields of an XFER_ACK message (RFC 9174 section 5.2.3)
+ *
+ * The flags are those of the segment acknowledged, and the length is the
+ * number of bytes of the transfer received so far.
+ */
+class TcpclXferAckHeader : public Header
+{
+public:
+  TcpclXferAckHeader ();
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  void SetFlags (uint8_t flags);
+  uint8_t GetFlags () const;
+  void SetTransferId (uint64_t id);
+  uint64_t GetTransferId () const;
+  void SetAckLength (uint64_t length);
+  uint64_t GetAckLength () const;
+
+private:
+  uint8_t m_flags;
+  uint64_t m_transferId;
+  uint64_t m_ackLength;
+};
+
+/**
+ * \brief Fields of an XFER_REFUSE message (RFC 9174 section 5.2.4)
+ */
+class TcpclXferRefuseHeader : public Header
+{
+public:
+  enum Reason {
+    UNKNOWN = 0x00,
+    COMPLETED = 0x01,
+    NO_RESOURCES = 0x02,
+    RETRANSMIT = 0x03,
+    NOT_ACCEPTABLE = 0x04,
+    EXTENSION_FAILURE = 0x05,
+    SESSION_TERMINATING = 0x06
+  };
+
+  TcpclXferRefuseHeader (uint8_t reason = UNKNOWN, uint64_t transferId = 0);
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  uint8_t GetReason () const;
+  uint64_t GetTransferId () const;
+
+private:
+  uint8_t m_reason;
+  uint64_t m_transferId;
+};
+
+/**
+ * \brief Fields of a SESS_TERM message (RFC 9174 section 6.1)
+ */
+class TcpclSessTermHeader : public Header
+{
+public:
+  enum Flags {
+    REPLY = 0x01
+  };
+
+  enum Reason {
+    UNKNOWN = 0x00,
+    IDLE_TIMEOUT = 0x01,
+    VERSION_MISMATCH = 0x02,
+    BUSY = 0x03,
+    CONTACT_FAILURE = 0x04,
+    RESOURCE_EXHAUSTION = 0x05
+  };
+
+  TcpclSessTermHeader (uint8_t flags = 0, uint8_t reason = UNKNOWN);
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  uint8_t GetFlags () const;
+  uint8_t GetReason () const;
+
+private:
+  uint8_t m_flags;
+  uint8_t m_reason;
+};
+
+/**
+ * \brief Fields of a MSG_REJECT message (RFC 9174 section 4.8)
+ */
+class TcpclMsgRejectHeader : public Header
+{
+public:
+  enum Reason {
+    TYPE_UNKNOWN = 0x01,
+    UNSUPPORTED = 0x02,
+    UNEXPECTED = 0x03
+  };
+
+  TcpclMsgRejectHeader (uint8_t reason = TYPE_UNKNOWN, uint8_t rejectedType = 0);
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  uint8_t GetReason () const;
+  uint8_t GetRejectedType () const;
+
+private:
+  uint8_t m_reason;
+  uint8_t m_rejectedType;
+};
+
+} // namespace ns3
+
+#endif /* BP_TCPCL_HEADER_H */
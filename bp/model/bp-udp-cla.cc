@@ -20,7 +20,11 @@
  */
 
 #include "bp-udp-cla.h"
+#include "ns3/uinteger.h"
+#include "ns3/header.h"
+#include "ns3/simulator.h"
 #include "ns3/udp-socket-factory.h"
+#include <algorithm>
 
 #define DTN_BUNDLE_UDP_PORT 4556 
 
@@ -28,6 +32,61 @@ NS_LOG_COMPONENT_DEFINE ("BpUdpCla");
 
 namespace ns3 {
 
+namespace {
+
+/**
+ * \brief The header of a datagram that carries one segment of a bundle
+ */
+class UdpSegmentHeader : public Header
+{
+public:
+  /// first byte of a segment, which is neither a BPv6 version nor the
+  /// start of a BPv7 bundle
+  static const uint8_t TYPE = 0xd5;
+  static const uint32_t SIZE = 13;
+
+  UdpSegmentHeader (uint32_t id = 0, uint32_t offset = 0, uint32_t total = 0)
+    : m_id (id), m_offset (offset), m_total (total)
+    {
+    }
+
+  static TypeId GetTypeId (void)
+    {
+      static TypeId tid = TypeId ("ns3::UdpSegmentHeader")
+        .SetParent<Header> ()
+        .AddConstructor<UdpSegmentHeader> ()
+      ;
+      return tid;
+    }
+
+  virtual TypeId GetInstanceTypeId (void) const { return GetTypeId (); }
+  virtual void Print (std::ostream &os) const { os << "bundle " << m_id << " offset " << m_offset << " total " << m_total; }
+  virtual uint32_t GetSerializedSize (void) const { return SIZE; }
+
+  virtual void Serialize (Buffer::Iterator start) const
+    {
+      start.WriteU8 (TYPE);
+      start.WriteHtonU32 (m_id);
+      start.WriteHtonU32 (m_offset);
+      start.WriteHtonU32 (m_total);
+    }
+
+  virtual uint32_t Deserialize (Buffer::Iterator start)
+    {
+      start.ReadU8 ();
+      m_id = start.ReadNtohU32 ();
+      m_offset = start.ReadNtohU32 ();
+      m_total = start.ReadNtohU32 ();
+      return SIZE;
+    }
+
+  uint32_t m_id;
+  uint32_t m_offset;
+  uint32_t m_total;
+};
+
+} // anonymous namespace
+
 NS_OBJECT_ENSURE_REGISTERED (BpUdpCla);
 
 TypeId 
@@ -36,13 +95,35 @@ BpUdpCla::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::BpUdpCla")
     .SetParent<BpCla> ()
     .AddConstructor<BpUdpCla> ()
+    .AddAttribute ("MaxBundleSize", "Largest encoded bundle sent in one piece, in bytes; larger bundles are fragmented (default fits a 1500 byte IPv4 MTU)",
+                   UintegerValue (1472),
+                   MakeUintegerAccessor (&BpUdpCla::m_maxBundleSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SegmentSize", "Largest datagram the CLA splits a bundle into, segment header included, or 0 to send each bundle as one datagram",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&BpUdpCla::m_segmentSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ReassemblyTimeout", "How long to wait for the rest of a segmented bundle after its first segment",
+                   TimeValue (Seconds (5)),
+                   MakeTimeAccessor (&BpUdpCla::m_reassemblyTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("ReassemblyBytes", "Largest total length of the segmented bundles held for reassembly",
+                   UintegerValue (16 << 20),
+                   MakeUintegerAccessor (&BpUdpCla::m_reassemblyLimit),
+                   MakeUintegerChecker<uint64_t> ())
   ;
   return tid;
 }
 
 BpUdpCla::BpUdpCla (Callback<void, Ptr<Bundle>> processBundleCallback)
 : BpCla(processBundleCallback),
-  m_port (DTN_BUNDLE_UDP_PORT)
+  m_port (DTN_BUNDLE_UDP_PORT),
+  m_segmentSize (0),
+  m_reassemblyTimeout (Seconds (5)),
+  m_reassemblyLimit (16 << 20),
+  m_nextBundleId (0),
+  m_reassemblyBytes (0),
+  m_reassemblyDrops (0)
 { 
   NS_LOG_FUNCTION (this);
 }
@@ -52,15 +133,44 @@ BpUdpCla::~BpUdpCla ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+BpUdpCla::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::map<SegmentKey, Partial>::iterator it;
+  for (it = m_partials.begin (); it != m_partials.end (); it++)
+    Simulator::Cancel (it->second.timeout);
+  m_partials.clear ();
+  m_reassemblyBytes = 0;
+  m_portSockets.clear ();
+  BpCla::DoDispose ();
+}
+
 int
 BpUdpCla::EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode)
 { 
   NS_LOG_FUNCTION (this << " " << local.Uri ());
   
   uint16_t port = m_port;
-  InetSocketAddress address (Ipv4Address::GetAny (), port);
+  InetSocketAddress defaultAddr ("127.0.0.1", 0);
+  if (!(localAddress == defaultAddr))
+    port = localAddress.GetPort ();
+
+  std::map<BpEndpointId, Ptr<Socket> >::iterator it = m_l4RecvSockets.find (local);
+  if (it != m_l4RecvSockets.end ())
+    return -1;
+
+  // Registrations on the same port share its socket, which can only be
+  // bound once.
+  std::map<uint16_t, Ptr<Socket> >::iterator pit = m_portSockets.find (port);
+  if (pit != m_portSockets.end ())
+    {
+      m_l4RecvSockets.insert (std::pair<BpEndpointId, Ptr<Socket> >(local, pit->second));
+      return 0;
+    }
 
   // set udp socket in listen state
+  InetSocketAddress address (Ipv4Address::GetAny (), port);
   Ptr<Socket> socket = Socket::CreateSocket (bpNode, GetSocketTypeId());
   if (socket->Bind (address) < 0) {
     NS_LOG_DEBUG ("BpUdpCla::EnableReceive (): Udp Bind port " << port);
@@ -70,14 +180,37 @@ BpUdpCla::EnableReceive (const BpEndpointId &local, InetSocketAddress localAddre
   SetL4SocketCallbacks (socket);
  
   // store the sending socket so that the convergence layer can dispatch the hundles to different udp connections
-  std::map<BpEndpointId, Ptr<Socket> >::iterator it = m_l4RecvSockets.end ();
-  it = m_l4RecvSockets.find (local);
+  m_l4RecvSockets.insert (std::pair<BpEndpointId, Ptr<Socket> >(local, socket));  
+  m_portSockets[port] = socket;
+
+  return 0;
+}
+
+int
+BpUdpCla::DisableReceive (const BpEndpointId &local)
+{
+  NS_LOG_FUNCTION (this << " " << local.Uri ());
+  std::map<BpEndpointId, Ptr<Socket> >::iterator it = m_l4RecvSockets.find (local);
   if (it == m_l4RecvSockets.end ())
-    m_l4RecvSockets.insert (std::pair<BpEndpointId, Ptr<Socket> >(local, socket));  
-  else
     return -1;
+  Ptr<Socket> socket = it->second;
+  m_l4RecvSockets.erase (it);
 
-  return 0;
+  for (it = m_l4RecvSockets.begin (); it != m_l4RecvSockets.end (); it++)
+    {
+      if (it->second == socket)
+        return 0;
+    }
+  std::map<uint16_t, Ptr<Socket> >::iterator pit;
+  for (pit = m_portSockets.begin (); pit != m_portSockets.end (); pit++)
+    {
+      if (pit->second == socket)
+        {
+          m_portSockets.erase (pit);
+          break;
+        }
+    }
+  return socket->Close ();
 }
 
 void 
@@ -99,6 +232,164 @@ BpUdpCla::SetL4SocketCallbacks (Ptr<Socket> socket)
     MakeCallback (&BpUdpCla::DataRecv, this));
 }
 
+int
+BpUdpCla::Transmit (Ptr<Socket> socket, Ptr<Packet> bundle)
+{
+  uint32_t size = bundle->GetSize ();
+  if (m_segmentSize <= UdpSegmentHeader::SIZE || size <= m_segmentSize)
+    return Enqueue (socket, bundle);
+
+  uint32_t id = m_nextBundleId++;
+  uint32_t room = m_segmentSize - UdpSegmentHeader::SIZE;
+  NS_LOG_DEBUG ("sending a " << size << " byte bundle as " << (size + room - 1) / room << " segments with id " << id);
+  for (uint32_t offset = 0; offset < size; offset += room)
+    {
+      Ptr<Packet> segment = bundle->CreateFragment (offset, std::min (room, size - offset));
+      segment->AddHeader (UdpSegmentHeader (id, offset, size));
+      // The bundle is sent again in full, so the rest of it need not go.
+      if (Enqueue (socket, segment) < 0)
+        return -1;
+    }
+  return 0;
+}
+
+void
+BpUdpCla::DataRecv (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << " " << socket);
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+    {
+      uint8_t initial = 0;
+      packet->CopyData (&initial, 1);
+      if (initial == UdpSegmentHeader::TYPE)
+        ReceiveSegment (from, packet);
+      else
+        ProcessReceivedBundle (packet);
+    }
+}
+
+bool
+BpUdpCla::SegmentKey::operator< (const SegmentKey &other) const
+{
+  if (address != other.address)
+    return address < other.address;
+  if (port != other.port)
+    return port < other.port;
+  return id < other.id;
+}
+
+void
+BpUdpCla::ReceiveSegment (const Address &from, Ptr<Packet> packet)
+{
+  UdpSegmentHeader header;
+  packet->RemoveHeader (header);
+  uint32_t length = packet->GetSize ();
+  if (length == 0 || header.m_offset + length > header.m_total || header.m_offset + length < header.m_offset)
+    {
+      NS_LOG_WARN ("discarding a malformed segment: " << header.m_offset << "+" << length << " of " << header.m_total);
+      return;
+    }
+
+  InetSocketAddress sender = InetSocketAddress::ConvertFrom (from);
+  SegmentKey key;
+  key.address = sender.GetIpv4 ().Get ();
+  key.port = sender.GetPort ();
+  key.id = header.m_id;
+
+  std::map<SegmentKey, Partial>::iterator it = m_partials.find (key);
+  if (it == m_partials.end ())
+    {
+      Partial partial;
+      partial.total = header.m_total;
+      partial.refused = m_reassemblyBytes + header.m_total > m_reassemblyLimit;
+      partial.timeout = Simulator::Schedule (m_reassemblyTimeout, &BpUdpCla::ReassemblyTimeout, this, key);
+      it = m_partials.insert (std::make_pair (key, partial)).first;
+      if (partial.refused)
+        {
+          // Remember the bundle until its timeout so that its other
+          // segments are discarded rather than starting it again.
+          NS_LOG_WARN ("no room to reassemble a " << header.m_total << " byte bundle, "
+                       << m_reassemblyBytes << " bytes held");
+          m_reassemblyDrops++;
+        }
+      else
+        {
+          m_reassemblyBytes += header.m_total;
+        }
+    }
+  Partial &partial = it->second;
+  if (partial.refused)
+    return;
+  if (header.m_total != partial.total)
+    {
+      NS_LOG_WARN ("segment of bundle " << key.id << " gives total " << header.m_total << ", not " << partial.total);
+      return;
+    }
+  // Segments sent again may be split at other offsets, so count only the
+  // bytes not held yet, and keep the longer of two segments at one offset.
+  if (partial.received.Add (header.m_offset, header.m_offset + length) == 0)
+    return;
+  Ptr<Packet> &held = partial.segments[header.m_offset];
+  if (!held || held->GetSize () < length)
+    held = packet;
+  if (!partial.received.Covers (0, partial.total))
+    return;
+
+  // Take each segment from where the bundle so far ends.
+  Ptr<Packet> bundle = Create<Packet> ();
+  std::map<uint32_t, Ptr<Packet> >::iterator sit;
+  for (sit = partial.segments.begin (); sit != partial.segments.end (); sit++)
+    {
+      uint32_t pos = bundle->GetSize ();
+      uint32_t end = sit->first + sit->second->GetSize ();
+      if (end <= pos)
+        continue;
+      bundle->AddAtEnd (sit->second->CreateFragment (pos - sit->first, end - pos));
+    }
+  Simulator::Cancel (partial.timeout);
+  m_reassemblyBytes -= partial.total;
+  m_partials.erase (it);
+  NS_LOG_DEBUG ("bundle " << key.id << " reassembled from segments, " << bundle->GetSize () << " bytes");
+  ProcessReceivedBundle (bundle);
+}
+
+void
+BpUdpCla::ReassemblyTimeout (SegmentKey key)
+{
+  std::map<SegmentKey, Partial>::iterator it = m_partials.find (key);
+  if (it == m_partials.end ())
+    return;
+  if (!it->second.refused)
+    {
+      NS_LOG_DEBUG ("bundle " << key.id << " timed out with " << it->second.received.GetCovered ()
+                    << " of " << it->second.total << " bytes");
+      m_reassemblyBytes -= it->second.total;
+      m_reassemblyDrops++;
+    }
+  m_partials.erase (it);
+}
+
+uint32_t
+BpUdpCla::GetPendingBundles () const
+{
+  uint32_t count = 0;
+  std::map<SegmentKey, Partial>::const_iterator it;
+  for (it = m_partials.begin (); it != m_partials.end (); it++)
+    {
+      if (!it->second.refused)
+        count++;
+    }
+  return count;
+}
+
+uint64_t
+BpUdpCla::GetReassemblyDrops () const
+{
+  return m_reassemblyDrops;
+}
+
 TypeId
 BpUdpCla::GetSocketTypeId() {
   return UdpSocketFactory::GetTypeId();
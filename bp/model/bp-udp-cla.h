@@ -22,9 +22,32 @@
 #define BP_UDP_CLA_PROTOCOL_H
 
 #include "bp-cla.h"
+#include "bp-range-set.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
 
 namespace ns3 {
 
+/**
+ * \brief UDP convergence layer
+ *
+ * By default each encoded bundle is sent as one datagram, so bundles are
+ * fragmented by the agent to MaxBundleSize, or by IP if that is raised
+ * past the MTU.  With SegmentSize set, a bundle that does not fit in one
+ * datagram of that size is instead split by the CLA into datagrams that
+ * each start with a segment header: the bundle's id, the offset of the
+ * segment and the bundle's total length.  The receiver puts the segments
+ * of each bundle back together, from each sender separately, in any
+ * order.  A bundle that is not complete within ReassemblyTimeout of its
+ * first segment is dropped, as is a new bundle that would take the bytes
+ * held for reassembly over ReassemblyBytes.  Raise MaxBundleSize (or set
+ * it to 0) along with SegmentSize so that the agent hands the CLA whole
+ * bundles.  A receiver takes segmented and whole bundles alike.
+ *
+ * Each registration listens on the port of its address, or on the port
+ * set by SetPort () if it has none; registrations on the same port share
+ * one socket.
+ */
 class BpUdpCla : public BpCla
 {
 public:
@@ -43,6 +66,14 @@ public:
    */
   virtual int EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode);
 
+  /**
+   * Disable the transport layer to receive packets; the socket is closed
+   * once no registration uses it
+   *
+   * \param local the endpoint id of registration
+   */
+  virtual int DisableReceive (const BpEndpointId &local);
+
   /**
    *  Callbacks methods callded by NotifyXXX methods in TcpSocketBase
    *
@@ -57,10 +88,63 @@ public:
    */
   void SetPort(uint16_t port) { m_port = port; };
 
+  /**
+   * \brief data receive callback; reassembles segmented bundles
+   */
+  virtual void DataRecv (Ptr<Socket> socket);
+
+  /**
+   * \return the number of bundles with segments held for reassembly
+   */
+  uint32_t GetPendingBundles () const;
+
+  /**
+   * \return the number of bundles dropped incomplete, on timeout or for
+   * lack of reassembly space
+   */
+  uint64_t GetReassemblyDrops () const;
+
+protected:
+
+  virtual void DoDispose (void);
+
+  /**
+   * Send an encoded bundle as one datagram, or as segments of SegmentSize
+   */
+  virtual int Transmit (Ptr<Socket> socket, Ptr<Packet> bundle);
+
 private:
 
+  /// a bundle being reassembled: its sender's address and port, and its id
+  struct SegmentKey {
+    uint32_t address;
+    uint16_t port;
+    uint32_t id;
+
+    bool operator< (const SegmentKey &other) const;
+  };
+
+  /// the segments of one bundle received so far
+  struct Partial {
+    uint32_t total;                         /// length of the whole bundle
+    BpRangeSet received;                    /// bytes held
+    std::map<uint32_t, Ptr<Packet> > segments; /// by offset
+    bool refused;                           /// no room; later segments are discarded
+    EventId timeout;
+  };
+
   virtual TypeId GetSocketTypeId();
 
+  /**
+   * Add a received segment, and pass its bundle on once it is complete.
+   */
+  void ReceiveSegment (const Address &from, Ptr<Packet> packet);
+
+  /**
+   * Drop a bundle that is still incomplete.
+   */
+  void ReassemblyTimeout (SegmentKey key);
+
   /**
    * Set callbacks of the transport layer
    *
@@ -69,6 +153,15 @@ private:
   virtual void SetL4SocketCallbacks (Ptr<Socket> socket);
 
   uint16_t m_port;  // A local UDP port to listen on.
+  std::map<uint16_t, Ptr<Socket> > m_portSockets;  /// receiving socket of each port
+
+  uint32_t m_segmentSize;            /// SegmentSize attribute
+  Time m_reassemblyTimeout;          /// ReassemblyTimeout attribute
+  uint64_t m_reassemblyLimit;        /// ReassemblyBytes attribute
+  uint32_t m_nextBundleId;           /// id of the next segmented bundle sent
+  std::map<SegmentKey, Partial> m_partials;
+  uint64_t m_reassemblyBytes;        /// total length of the bundles in m_partials
+  uint64_t m_reassemblyDrops;
 };
 
 } // namespace ns3
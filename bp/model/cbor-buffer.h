@@ -0,0 +1,245 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef CBOR_BUFFER_H
+#define CBOR_BUFFER_H
+
+#include <stdint.h>
+#include <string>
+#include <iterator>
+#include <cstddef>
+#include "ns3/buffer.h"
+
+namespace ns3 {
+
+/**
+ * \brief Output "container" for the CborLite encoders in codec.h that
+ * writes straight into a Buffer::Iterator.
+ *
+ * CborLite only needs push_back, reserve, size, end and insert-at-end, so
+ * this provides exactly that and nothing is ever stored.
+ */
+class CborBufferWriter
+{
+public:
+  /// stands in for the end iterator; only used as an insert position
+  struct End {};
+
+  explicit CborBufferWriter (Buffer::Iterator &i)
+    : m_it (i), m_size (0)
+    {
+    }
+
+  void push_back (char c)
+    {
+      m_it.WriteU8 (c);
+      m_size++;
+    }
+
+  void reserve (size_t)
+    {
+    }
+
+  size_t size () const
+    {
+      return m_size;
+    }
+
+  End end ()
+    {
+      return End ();
+    }
+
+  template <typename InputIterator>
+  void insert (End, InputIterator first, InputIterator last)
+    {
+      for (; first != last; ++first)
+        {
+          push_back (*first);
+        }
+    }
+
+  void insert (End, std::string::const_iterator first, std::string::const_iterator last)
+    {
+      if (first == last) return;
+      m_it.Write (reinterpret_cast<const uint8_t *> (&*first), last - first);
+      m_size += last - first;
+    }
+
+private:
+  Buffer::Iterator &m_it;
+  size_t m_size;
+};
+
+/**
+ * \brief Output "container" for the CborLite encoders that only counts
+ * bytes, for computing an encoded size without encoding.
+ */
+class CborSizeCounter
+{
+public:
+  /// stands in for the end iterator; only used as an insert position
+  struct End {};
+
+  CborSizeCounter ()
+    : m_size (0)
+    {
+    }
+
+  void push_back (char)
+    {
+      m_size++;
+    }
+
+  void reserve (size_t)
+    {
+    }
+
+  size_t size () const
+    {
+      return m_size;
+    }
+
+  End end ()
+    {
+      return End ();
+    }
+
+  template <typename InputIterator>
+  void insert (End, InputIterator first, InputIterator last)
+    {
+      m_size += std::distance (first, last);
+    }
+
+private:
+  size_t m_size;
+};
+
+/**
+ * \brief Input iterator for the CborLite decoders in codec.h that reads
+ * straight from a Buffer::Iterator.
+ *
+ * Only the bytes the decoder actually consumes are read, so parsing a
+ * header does not touch the payload behind it.  The end of the input is
+ * given as an offset, which CborLite uses for its length checks.
+ */
+class CborBufferReader
+{
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef uint8_t value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const uint8_t *pointer;
+  typedef const uint8_t &reference;
+
+  /**
+   * \param i where to start reading
+   * \param offset position of i relative to the start of the input
+   */
+  explicit CborBufferReader (Buffer::Iterator i, uint32_t offset = 0)
+    : m_it (i), m_offset (offset), m_byte (0)
+    {
+    }
+
+  /**
+   * \returns an end marker for input starting at i and running to the end
+   * of its buffer
+   */
+  static CborBufferReader End (Buffer::Iterator i)
+    {
+      return CborBufferReader (i, i.GetRemainingSize ());
+    }
+
+  reference operator* () const
+    {
+      Buffer::Iterator peek = m_it;
+      m_byte = peek.ReadU8 ();
+      return m_byte;
+    }
+
+  CborBufferReader &operator++ ()
+    {
+      m_it.Next ();
+      m_offset++;
+      return *this;
+    }
+
+  CborBufferReader operator++ (int)
+    {
+      CborBufferReader old = *this;
+      ++(*this);
+      return old;
+    }
+
+  CborBufferReader &operator-- ()
+    {
+      m_it.Prev ();
+      m_offset--;
+      return *this;
+    }
+
+  CborBufferReader &operator+= (difference_type n)
+    {
+      if (n >= 0)
+        {
+          m_it.Next (n);
+        }
+      else
+        {
+          m_it.Prev (-n);
+        }
+      m_offset += n;
+      return *this;
+    }
+
+  CborBufferReader operator+ (difference_type n) const
+    {
+      CborBufferReader r = *this;
+      r += n;
+      return r;
+    }
+
+  difference_type operator- (const CborBufferReader &o) const
+    {
+      return static_cast<difference_type> (m_offset) - static_cast<difference_type> (o.m_offset);
+    }
+
+  bool operator== (const CborBufferReader &o) const
+    {
+      return m_offset == o.m_offset;
+    }
+
+  bool operator!= (const CborBufferReader &o) const
+    {
+      return m_offset != o.m_offset;
+    }
+
+  /**
+   * \returns the number of bytes consumed since offset 0
+   */
+  uint32_t GetOffset () const
+    {
+      return m_offset;
+    }
+
+private:
+  Buffer::Iterator m_it;
+  uint32_t m_offset;
+  mutable uint8_t m_byte;
+};
+
+} // namespace ns3
+
+#endif /* CBOR_BUFFER_H */
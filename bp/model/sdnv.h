@@ -21,7 +21,6 @@
 #ifndef SDNV_H
 #define SDNV_H
 
-#include <vector>
 #include <stdint.h>
 #include "ns3/buffer.h"
 
@@ -29,19 +28,32 @@ namespace ns3 {
 
 /**
  * \brief an implementation class of self-delimiting numeric values based on RFC 6256
+ *
+ * All methods are static and allocation free.  Values are written straight
+ * into a Buffer::Iterator or a caller-provided byte array, and the encoded
+ * length is known up front from the bit length of the value.
  */
 class Sdnv
 {
 public:
   /**
-   * Constructor
+   * \brief number of significant bits in a value (at least 1)
    */
-  Sdnv ();
+  static constexpr uint32_t BitLength (uint64_t val)
+  {
+    return (val == 0) ? 1 : 64 - __builtin_clzll (val);
+  }
 
   /**
-   * Destroy
+   * \brief number of bytes the SDNV encoding of a value takes
+   *
+   * \param val value to be encoded
+   * \return encoded length, from 1 to 10 bytes
    */
-  virtual ~Sdnv ();
+  static constexpr uint32_t EncodedSize (uint64_t val)
+  {
+    return (BitLength (val) + 6) / 7;
+  }
 
   /**
    * \brief SDNV encoding algorithm
@@ -49,32 +61,85 @@ public:
    * The encoding algorithm is based on section 3.1, RFC 6256
    *
    * \param val value need to be encoded
-   * \return a uint8_t vector
+   * \param start iterator to write to; it is advanced past the encoding
+   * \return number of bytes written
    */
-  std::vector<uint8_t> Encode (uint64_t val);
+  static uint32_t Encode (uint64_t val, Buffer::Iterator &start)
+  {
+    uint32_t len = EncodedSize (val);
+    for (uint32_t k = len - 1; k > 0; k--)
+      {
+        start.WriteU8 (((val >> (7 * k)) & 0x7F) | 0x80);
+      }
+    start.WriteU8 (val & 0x7F);
+    return len;
+  }
 
   /**
-   * \brief SDNV decoding algorithm for an integer
-   *
-   * The decoding algorithm is based on section 3.2, RFC 6256
+   * \brief SDNV encoding algorithm, into a byte array
    *
-   * \param val value need to be decoded
-   * \return uint64_t decoded integer; It is user's responsibility to 
-   *         convert the return type to the type of variables in use
+   * \param val value need to be encoded
+   * \param out array of at least EncodedSize (val) bytes
+   * \return number of bytes written
    */
-  uint64_t Decode (std::vector<uint8_t> val);
+  static uint32_t Encode (uint64_t val, uint8_t *out)
+  {
+    uint32_t len = EncodedSize (val);
+    for (uint32_t k = len - 1; k > 0; k--)
+      {
+        *out++ = ((val >> (7 * k)) & 0x7F) | 0x80;
+      }
+    *out = val & 0x7F;
+    return len;
+  }
 
   /**
    * \brief SDNV decoding algorithm for a Buffer
    *
-   * This method read an integer from the Buffer and decodes it by 
-   * Decode (std::vector<uint8_t val>)
+   * The decoding algorithm is based on section 3.2, RFC 6256
    *
-   * \param start buffer start iterator reference
+   * \param start buffer start iterator reference; it is advanced past the
+   *        encoded integer
    * \return uint64_t decoded integer; It is user's responsibility to 
    *         convert the return type to the type of variables in use
    */
-  uint64_t Decode (Buffer::Iterator &start);
+  static uint64_t Decode (Buffer::Iterator &start)
+  {
+    uint64_t decoded = 0;
+    uint8_t val;
+    do
+      {
+        val = start.ReadU8 ();
+        decoded = (decoded << 7) | (val & 0x7F);
+      }
+    while (!IsLast (val));
+    return decoded;
+  }
+
+  /**
+   * \brief SDNV decoding algorithm for a byte array
+   *
+   * \param in encoded bytes
+   * \param len number of bytes available at in
+   * \param used set to the number of bytes consumed, or 0 if the encoding
+   *        runs past len
+   * \return uint64_t decoded integer
+   */
+  static uint64_t Decode (const uint8_t *in, uint32_t len, uint32_t &used)
+  {
+    uint64_t decoded = 0;
+    for (uint32_t k = 0; k < len; k++)
+      {
+        decoded = (decoded << 7) | (in[k] & 0x7F);
+        if (IsLast (in[k]))
+          {
+            used = k + 1;
+            return decoded;
+          }
+      }
+    used = 0;
+    return decoded;
+  }
 
   /**
    * \brief is this the bolder of an encoded integer?
@@ -82,7 +147,10 @@ public:
    * \param val an entry of encoded vector
    * \return return true if it is the bolder
    */
-  bool IsLast (uint8_t &val);
+  static constexpr bool IsLast (uint8_t val)
+  {
+    return (val & 0x80) == 0;
+  }
 };
 
 } // namespace ns3
@@ -0,0 +1,216 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/acs-cteb.h"
+#include "ns3/bp-acs-aggregator.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * A CTEB decodes to the custody ID and creator it was encoded with.
+ */
+class BpCtebCodingTestCase : public TestCase
+{
+public:
+  BpCtebCodingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpCtebCodingTestCase::BpCtebCodingTestCase ()
+  : TestCase ("Encode and decode CTEBs")
+{
+}
+
+void
+BpCtebCodingTestCase::DoRun (void)
+{
+  // custody IDs of one and several SDNV bytes
+  uint64_t ids[] = { 0, 127, 128, 300000, 0xffffffff };
+  for (uint32_t n = 0; n < sizeof (ids) / sizeof (ids[0]); n++)
+    {
+      CTEB cteb;
+      cteb.custodyID = ids[n];
+      cteb.creatorEID = "ipn:12.0";
+      Ptr<Packet> p = Create<Packet> (10);
+      p->AddHeader (cteb);
+      NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 10 + cteb.GetSerializedSize (), "wrong encoded size of custody ID " << ids[n]);
+
+      CTEB decoded;
+      NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (decoded), cteb.GetSerializedSize (), "wrong decoded size of custody ID " << ids[n]);
+      NS_TEST_EXPECT_MSG_EQ (decoded.custodyID, ids[n], "wrong custody ID");
+      NS_TEST_EXPECT_MSG_EQ (decoded.creatorEID, "ipn:12.0", "wrong creator of custody ID " << ids[n]);
+      NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 10, "CTEB decoding took payload bytes");
+    }
+}
+
+/**
+ * An ACS decodes to the fills it was encoded with, and the fills to the
+ * custody IDs they were set from.
+ */
+class BpAcsCodingTestCase : public TestCase
+{
+public:
+  BpAcsCodingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpAcsCodingTestCase::BpAcsCodingTestCase ()
+  : TestCase ("Encode and decode ACSs")
+{
+}
+
+void
+BpAcsCodingTestCase::DoRun (void)
+{
+  ACS empty;
+  empty.status = 0x80;
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (empty);
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 1, "ACS without fills is more than a status");
+  ACS decoded;
+  p->RemoveHeader (decoded);
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) decoded.status, 0x80, "wrong status");
+  NS_TEST_EXPECT_MSG_EQ (decoded.lenFirstFill, 0, "fills out of nothing");
+
+  BpRangeSet ids;
+  ids.Add (5, 10);
+  ids.Add (12, 13);
+  ids.Add (200, 500);
+  ids.Add (0xfffff000, 0xfffff010);
+  ACS acs;
+  acs.status = 0x80;
+  acs.SetFills (ids);
+  NS_TEST_EXPECT_MSG_EQ (acs.leftEdgeFirstFill, 5, "wrong left edge of the first fill");
+  NS_TEST_EXPECT_MSG_EQ (acs.lenFirstFill, 5, "wrong length of the first fill");
+  NS_TEST_ASSERT_MSG_EQ (acs.nextEdgeLenPairs.size (), 3, "wrong number of fills");
+  NS_TEST_EXPECT_MSG_EQ (acs.nextEdgeLenPairs[0].first, 2, "fill edge not relative to the previous fill");
+  NS_TEST_EXPECT_MSG_EQ (acs.nextEdgeLenPairs[1].first, 187, "fill edge not relative to the previous fill");
+
+  p = Create<Packet> ();
+  p->AddHeader (acs);
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), acs.GetSerializedSize (), "wrong encoded size");
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (decoded), acs.GetSerializedSize (), "wrong decoded size");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) decoded.status, 0x80, "wrong status");
+
+  BpRangeSet decodedIds;
+  decoded.GetFills (decodedIds);
+  NS_TEST_EXPECT_MSG_EQ (decodedIds.GetNRanges (), ids.GetNRanges (), "wrong number of fills");
+  NS_TEST_EXPECT_MSG_EQ (decodedIds.GetCovered (), ids.GetCovered (), "wrong number of custody IDs");
+  for (BpRangeSet::const_iterator it = ids.begin (); it != ids.end (); it++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (decodedIds.Covers (it->first, it->second), true, "custody IDs " << it->first << " - " << it->second << " lost");
+    }
+}
+
+/**
+ * The aggregator signals each custodian once per batch: when the first
+ * custody ID has waited for the delay, or at once when the count reaches
+ * the maximum.
+ */
+class BpAcsAggregatorTestCase : public TestCase
+{
+public:
+  BpAcsAggregatorTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Sent (const BpEndpointId &custodian, const ACS &acs);
+
+  struct Signal
+  {
+    Time time;
+    BpEndpointId custodian;
+    BpRangeSet ids;
+  };
+  std::vector<Signal> m_sent;
+};
+
+BpAcsAggregatorTestCase::BpAcsAggregatorTestCase ()
+  : TestCase ("Aggregate custody IDs per custodian")
+{
+}
+
+void
+BpAcsAggregatorTestCase::Sent (const BpEndpointId &custodian, const ACS &acs)
+{
+  Signal s;
+  s.time = Simulator::Now ();
+  s.custodian = custodian;
+  acs.GetFills (s.ids);
+  m_sent.push_back (s);
+}
+
+void
+BpAcsAggregatorTestCase::DoRun (void)
+{
+  BpEndpointId a (1, 0);
+  BpEndpointId b (2, 0);
+  AcsAggregator acs;
+  acs.SetSendCallback (MakeCallback (&BpAcsAggregatorTestCase::Sent, this));
+  acs.SetDelay (Seconds (1));
+  acs.SetMaxCount (4);
+
+  Simulator::Schedule (Seconds (0.5), &AcsAggregator::Add, &acs, a, 1);
+  Simulator::Schedule (Seconds (0.6), &AcsAggregator::Add, &acs, a, 2);
+  Simulator::Schedule (Seconds (0.7), &AcsAggregator::Add, &acs, a, 7);
+  Simulator::Schedule (Seconds (0.7), &AcsAggregator::Add, &acs, a, 2);
+  for (uint32_t id = 10; id < 14; id++)
+    {
+      Simulator::Schedule (Seconds (0.8), &AcsAggregator::Add, &acs, b, id);
+    }
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_sent.size (), 2, "wrong number of signals");
+  // b reached the maximum count before a's delay ran out
+  NS_TEST_EXPECT_MSG_EQ (m_sent[0].custodian, b, "wrong custodian");
+  NS_TEST_EXPECT_MSG_EQ (m_sent[0].time, Seconds (0.8), "full batch not signalled at once");
+  NS_TEST_EXPECT_MSG_EQ (m_sent[0].ids.Covers (10, 14), true, "custody IDs lost");
+  NS_TEST_EXPECT_MSG_EQ (m_sent[1].custodian, a, "wrong custodian");
+  NS_TEST_EXPECT_MSG_EQ (m_sent[1].time, Seconds (1.5), "not signalled a delay after the first custody ID");
+  NS_TEST_EXPECT_MSG_EQ (m_sent[1].ids.GetCovered (), 3, "duplicate custody ID counted");
+  NS_TEST_EXPECT_MSG_EQ (m_sent[1].ids.GetNRanges (), 2, "wrong fills");
+
+  m_sent.clear ();
+  acs.Add (a, 20);
+  acs.Flush (a);
+  acs.Add (b, 21);
+  acs.Clear ();
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_sent.size (), 1, "flushed or cleared custody IDs signalled again");
+  NS_TEST_EXPECT_MSG_EQ (m_sent[0].ids.Covers (20, 21), true, "flushed custody ID lost");
+  Simulator::Destroy ();
+}
+
+class BpAcsTestSuite : public TestSuite
+{
+public:
+  BpAcsTestSuite ()
+    : TestSuite ("bp-acs", UNIT)
+  {
+    AddTestCase (new BpCtebCodingTestCase, TestCase::QUICK);
+    AddTestCase (new BpAcsCodingTestCase, TestCase::QUICK);
+    AddTestCase (new BpAcsAggregatorTestCase, TestCase::QUICK);
+  }
+} g_bpAcsTestSuite;
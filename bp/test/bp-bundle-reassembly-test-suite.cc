@@ -0,0 +1,369 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-bundle-7.h"
+#include "ns3/bp-bundle-reassembly.h"
+#include "ns3/test.h"
+
+NS_LOG_COMPONENT_DEFINE ("BpBundleReassemblyTestSuite");
+
+using namespace ns3;
+
+namespace {
+
+const uint32_t ADU_LENGTH = 1000;
+
+/**
+ * \return an ADU whose byte i is i modulo 251
+ */
+std::vector<uint8_t>
+AduBytes (uint32_t length)
+{
+  std::vector<uint8_t> data (length);
+  for (uint32_t i = 0; i < length; i++)
+    {
+      data[i] = i % 251;
+    }
+  return data;
+}
+
+/**
+ * \return the fragment of bundle seqno of [offset, offset + length) of an
+ * ADU of aduLength bytes
+ */
+Ptr<Bundle7>
+Fragment (uint32_t seqno, uint32_t offset, uint32_t length, uint32_t aduLength = ADU_LENGTH)
+{
+  std::vector<uint8_t> data = AduBytes (aduLength);
+  Ptr<Bundle7> fragment = Create<Bundle7> (Create<Packet> (data.data () + offset, length));
+  BpHeader7 *bph = fragment->GetPrimaryHeader ();
+  bph->SetSourceEid (BpEndpointId ("dtn", "source"));
+  bph->SetDestinationEid (BpEndpointId ("dtn", "destination"));
+  bph->SetCreateTimestamp (0);
+  bph->SetSequenceNumber (SequenceNumber32 (seqno));
+  bph->SetLifeTime (Seconds (0));
+  bph->SetIsFragment (true);
+  bph->SetFragOffset (offset);
+  bph->SetAduLength (aduLength);
+  return fragment;
+}
+
+bool
+SameBytes (Ptr<Packet> adu, uint32_t length)
+{
+  std::vector<uint8_t> expected = AduBytes (length);
+  std::vector<uint8_t> data (adu->GetSize ());
+  adu->CopyData (data.data (), data.size ());
+  return data == expected;
+}
+
+} // anonymous namespace
+
+/**
+ * A byte tag of one value, to follow through reassembly.
+ */
+class BpReassemblyTestTag : public Tag
+{
+public:
+  BpReassemblyTestTag (uint8_t value = 0) : m_value (value) {}
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  uint8_t m_value;
+};
+
+TypeId
+BpReassemblyTestTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpReassemblyTestTag")
+    .SetParent<Tag> ()
+    .AddConstructor<BpReassemblyTestTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+BpReassemblyTestTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+BpReassemblyTestTag::GetSerializedSize (void) const
+{
+  return 1;
+}
+
+void
+BpReassemblyTestTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_value);
+}
+
+void
+BpReassemblyTestTag::Deserialize (TagBuffer i)
+{
+  m_value = i.ReadU8 ();
+}
+
+void
+BpReassemblyTestTag::Print (std::ostream &os) const
+{
+  os << "value=" << (uint32_t) m_value;
+}
+
+/**
+ * Fragments in order, out of order and overlapping make up the ADU once
+ * all of its bytes are in, and not before.
+ */
+class BpReassemblyOrderTestCase : public TestCase
+{
+public:
+  BpReassemblyOrderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpReassemblyOrderTestCase::BpReassemblyOrderTestCase ()
+  : TestCase ("Reassemble fragments that arrive out of order and overlap")
+{
+}
+
+void
+BpReassemblyOrderTestCase::DoRun (void)
+{
+  BundleReassembly reassembly;
+
+  // in order
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (1, 0, 400), Seconds (0)), 0, "incomplete bundle assembled");
+  Ptr<Packet> adu = reassembly.Add (Fragment (1, 400, 600), Seconds (0));
+  NS_TEST_ASSERT_MSG_NE (adu, 0, "complete bundle not assembled");
+  NS_TEST_EXPECT_MSG_EQ (adu->GetSize (), ADU_LENGTH, "wrong ADU length");
+  NS_TEST_EXPECT_MSG_EQ (SameBytes (adu, ADU_LENGTH), true, "wrong ADU bytes");
+
+  // out of order, overlapping and duplicated
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (2, 700, 300), Seconds (0)), 0, "incomplete bundle assembled");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (2, 100, 300), Seconds (0)), 0, "incomplete bundle assembled");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (2, 100, 300), Seconds (0)), 0, "duplicate completed the bundle");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (2, 350, 400), Seconds (0)), 0, "incomplete bundle assembled");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.GetPendingBytes (), 900, "overlapping bytes held twice");
+  adu = reassembly.Add (Fragment (2, 0, 150), Seconds (0));
+  NS_TEST_ASSERT_MSG_NE (adu, 0, "complete bundle not assembled");
+  NS_TEST_EXPECT_MSG_EQ (SameBytes (adu, ADU_LENGTH), true, "wrong ADU bytes");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.GetPendingBundles (), 0, "assembled bundle still held");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.GetPendingBytes (), 0, "assembled bytes still held");
+}
+
+/**
+ * A fragment that gives another ADU length than the first one of its
+ * bundle is dropped.
+ */
+class BpReassemblyAduLengthTestCase : public TestCase
+{
+public:
+  BpReassemblyAduLengthTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpReassemblyAduLengthTestCase::BpReassemblyAduLengthTestCase ()
+  : TestCase ("Drop fragments that disagree on the ADU length")
+{
+}
+
+void
+BpReassemblyAduLengthTestCase::DoRun (void)
+{
+  BundleReassembly reassembly;
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (1, 0, 500), Seconds (0)), 0, "incomplete bundle assembled");
+
+  // would complete a 1200 byte ADU with the first fragment
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (1, 500, 700, 1200), Seconds (0)), 0, "inconsistent fragment accepted");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.GetPendingBytes (), 500, "inconsistent fragment held");
+
+  Ptr<Packet> adu = reassembly.Add (Fragment (1, 500, 500), Seconds (0));
+  NS_TEST_ASSERT_MSG_NE (adu, 0, "complete bundle not assembled");
+  NS_TEST_EXPECT_MSG_EQ (SameBytes (adu, ADU_LENGTH), true, "wrong ADU bytes");
+}
+
+/**
+ * An incomplete bundle is dropped at its timeout, and the callback gets
+ * its first fragment.
+ */
+class BpReassemblyTimeoutTestCase : public TestCase
+{
+public:
+  BpReassemblyTimeoutTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void TimedOut (Ptr<Bundle> first);
+
+  std::vector<Ptr<Bundle> > m_timedOut;
+};
+
+BpReassemblyTimeoutTestCase::BpReassemblyTimeoutTestCase ()
+  : TestCase ("Drop incomplete bundles at their timeout")
+{
+}
+
+void
+BpReassemblyTimeoutTestCase::TimedOut (Ptr<Bundle> first)
+{
+  m_timedOut.push_back (first);
+}
+
+void
+BpReassemblyTimeoutTestCase::DoRun (void)
+{
+  BundleReassembly reassembly;
+  reassembly.SetTimeoutCallback (MakeCallback (&BpReassemblyTimeoutTestCase::TimedOut, this));
+  Ptr<Bundle7> first = Fragment (1, 0, 100);
+  reassembly.Add (first, Seconds (5));
+  Simulator::Schedule (Seconds (1), &BundleReassembly::Add, &reassembly, Fragment (1, 300, 100), Seconds (5));
+  Simulator::Stop (Seconds (4));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_timedOut.size (), 0, "timed out early");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.GetPendingBytes (), 200, "fragments not held");
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_timedOut.size (), 1, "did not time out");
+  NS_TEST_EXPECT_MSG_EQ (m_timedOut[0], first, "callback not given the first fragment");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.GetPendingBundles (), 0, "timed out bundle held");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.GetPendingBytes (), 0, "timed out bytes held");
+  Simulator::Destroy ();
+}
+
+/**
+ * With virtual payloads, the ADU is put together from the lengths of the
+ * fragments.
+ */
+class BpReassemblyVirtualTestCase : public TestCase
+{
+public:
+  BpReassemblyVirtualTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpReassemblyVirtualTestCase::BpReassemblyVirtualTestCase ()
+  : TestCase ("Reassemble virtual payloads")
+{
+}
+
+void
+BpReassemblyVirtualTestCase::DoRun (void)
+{
+  BundleReassembly reassembly;
+  reassembly.SetVirtualPayload (true);
+  std::vector<Ptr<Bundle7> > fragments;
+  for (uint32_t offset = 0; offset < ADU_LENGTH; offset += 250)
+    {
+      Ptr<Bundle7> fragment = Fragment (1, offset, 0);
+      fragment->m_adu = Create<Packet> (250);
+      fragments.push_back (fragment);
+    }
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (fragments[3], Seconds (0)), 0, "incomplete bundle assembled");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (fragments[1], Seconds (0)), 0, "incomplete bundle assembled");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (fragments[0], Seconds (0)), 0, "incomplete bundle assembled");
+  Ptr<Packet> adu = reassembly.Add (fragments[2], Seconds (0));
+  NS_TEST_ASSERT_MSG_NE (adu, 0, "complete bundle not assembled");
+  NS_TEST_EXPECT_MSG_EQ (adu->GetSize (), ADU_LENGTH, "wrong ADU length");
+}
+
+/**
+ * The byte tags of the fragments are kept on the bytes of the ADU they
+ * were held for.
+ */
+class BpReassemblyByteTagTestCase : public TestCase
+{
+public:
+  BpReassemblyByteTagTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpReassemblyByteTagTestCase::BpReassemblyByteTagTestCase ()
+  : TestCase ("Keep the byte tags of fragments")
+{
+}
+
+void
+BpReassemblyByteTagTestCase::DoRun (void)
+{
+  BundleReassembly reassembly;
+  uint32_t fragments[][2] = { { 600, 400 }, { 0, 300 }, { 200, 400 } };
+  Ptr<Packet> adu;
+  for (uint32_t k = 0; k < 3; k++)
+    {
+      Ptr<Bundle7> fragment = Fragment (1, fragments[k][0], fragments[k][1]);
+      fragment->m_adu->AddByteTag (BpReassemblyTestTag (k + 1));
+      adu = reassembly.Add (fragment, Seconds (0));
+    }
+  NS_TEST_ASSERT_MSG_NE (adu, 0, "complete bundle not assembled");
+  NS_TEST_EXPECT_MSG_EQ (SameBytes (adu, ADU_LENGTH), true, "wrong ADU bytes");
+
+  // the third fragment only added [300, 600)
+  uint32_t expected[][3] = { { 2, 0, 300 }, { 3, 300, 600 }, { 1, 600, 1000 } };
+  uint32_t found[4] = { 0, 0, 0, 0 };
+  ByteTagIterator it = adu->GetByteTagIterator ();
+  while (it.HasNext ())
+    {
+      ByteTagIterator::Item item = it.Next ();
+      NS_TEST_ASSERT_MSG_EQ (item.GetTypeId (), BpReassemblyTestTag::GetTypeId (), "unexpected tag type");
+      BpReassemblyTestTag tag;
+      item.GetTag (tag);
+      for (uint32_t k = 0; k < 3; k++)
+        {
+          if (tag.m_value != expected[k][0])
+            continue;
+          NS_TEST_EXPECT_MSG_EQ (item.GetStart (), expected[k][1], "tag " << expected[k][0] << " moved");
+          NS_TEST_EXPECT_MSG_EQ (item.GetEnd (), expected[k][2], "tag " << expected[k][0] << " moved");
+          found[tag.m_value]++;
+        }
+    }
+  for (uint32_t k = 1; k <= 3; k++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (found[k], 1, "tag " << k << " not kept once");
+    }
+}
+
+class BpBundleReassemblyTestSuite : public TestSuite
+{
+public:
+  BpBundleReassemblyTestSuite ()
+    : TestSuite ("bp-bundle-reassembly", UNIT)
+  {
+    AddTestCase (new BpReassemblyOrderTestCase, TestCase::QUICK);
+    AddTestCase (new BpReassemblyAduLengthTestCase, TestCase::QUICK);
+    AddTestCase (new BpReassemblyTimeoutTestCase, TestCase::QUICK);
+    AddTestCase (new BpReassemblyVirtualTestCase, TestCase::QUICK);
+    AddTestCase (new BpReassemblyByteTagTestCase, TestCase::QUICK);
+  }
+} g_bpBundleReassemblyTestSuite;
@@ -0,0 +1,548 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-bundle-6.h"
+#include "ns3/bp-bundle-store.h"
+#include "ns3/bp-segment-store.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+namespace {
+
+/**
+ * \return a bundle of size bytes from dtn:source to dtn:destination,
+ * created at timestamp seconds
+ */
+Ptr<Bundle6>
+MakeBundle (uint32_t seqno, uint32_t size, Time lifetime, uint32_t timestamp = 0, uint8_t priority = 0)
+{
+  Ptr<Bundle6> bundle = Create<Bundle6> (Create<Packet> (size));
+  BpHeader6 *bph = bundle->GetPrimaryHeader ();
+  bph->SetSourceEid (BpEndpointId ("dtn", "source"));
+  bph->SetDestinationEid (BpEndpointId ("dtn", "destination"));
+  bph->SetCreateTimestamp (timestamp);
+  bph->SetSequenceNumber (SequenceNumber32 (seqno));
+  bph->SetLifeTime (lifetime);
+  bph->SetPriority (priority);
+  return bundle;
+}
+
+} // anonymous namespace
+
+/**
+ * A byte tag of one value, to follow through the disk store.
+ */
+class BpBundleStoreTestTag : public Tag
+{
+public:
+  BpBundleStoreTestTag (uint8_t value = 0) : m_value (value) {}
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  uint8_t m_value;
+};
+
+TypeId
+BpBundleStoreTestTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpBundleStoreTestTag")
+    .SetParent<Tag> ()
+    .AddConstructor<BpBundleStoreTestTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+BpBundleStoreTestTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+BpBundleStoreTestTag::GetSerializedSize (void) const
+{
+  return 1;
+}
+
+void
+BpBundleStoreTestTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_value);
+}
+
+void
+BpBundleStoreTestTag::Deserialize (TagBuffer i)
+{
+  m_value = i.ReadU8 ();
+}
+
+void
+BpBundleStoreTestTag::Print (std::ostream &os) const
+{
+  os << "value=" << (uint32_t) m_value;
+}
+
+/**
+ * The same tag registered without a constructor.
+ */
+class BpBundleStoreBareTestTag : public BpBundleStoreTestTag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+};
+
+TypeId
+BpBundleStoreBareTestTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpBundleStoreBareTestTag")
+    .SetParent<Tag> ()
+  ;
+  return tid;
+}
+
+TypeId
+BpBundleStoreBareTestTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+/**
+ * Bundles expire at their creation time plus lifetime, whether from the
+ * expiry index or from their own events, and bundles removed before then
+ * are not expired again.  The remove callback sees every bundle that
+ * leaves.
+ */
+class BpBundleStoreExpiryTestCase : public TestCase
+{
+public:
+  BpBundleStoreExpiryTestCase (bool batch);
+
+private:
+  virtual void DoRun (void);
+  void Removed (Ptr<Bundle> bundle);
+  void Check (BundleStore *store, uint32_t bundles);
+
+  bool m_batch;
+  uint32_t m_removed;
+};
+
+BpBundleStoreExpiryTestCase::BpBundleStoreExpiryTestCase (bool batch)
+  : TestCase (batch ? "Expire bundles from the expiry index" : "Expire bundles from their own events"),
+    m_batch (batch),
+    m_removed (0)
+{
+}
+
+void
+BpBundleStoreExpiryTestCase::Removed (Ptr<Bundle> bundle)
+{
+  m_removed++;
+}
+
+void
+BpBundleStoreExpiryTestCase::Check (BundleStore *store, uint32_t bundles)
+{
+  NS_TEST_EXPECT_MSG_EQ (store->GetStoredByteCount (), bundles * 10, "wrong bundles left at " << Simulator::Now ().GetSeconds () << " s");
+}
+
+void
+BpBundleStoreExpiryTestCase::DoRun (void)
+{
+  BundleStore store;
+  store.SetBatchExpiry (m_batch);
+  store.SetRemoveCallback (MakeCallback (&BpBundleStoreExpiryTestCase::Removed, this));
+
+  // ten bundles each with lifetimes of 1 to 10 s, in no order, and some
+  // that never expire
+  std::vector<Ptr<Bundle6> > bundles;
+  for (uint32_t n = 0; n < 100; n++)
+    {
+      Ptr<Bundle6> bundle = MakeBundle (n, 10, Seconds (1 + (n * 7) % 10));
+      NS_TEST_ASSERT_MSG_EQ (store.Store (bundle), true, "bundle not stored");
+      bundles.push_back (bundle);
+    }
+  for (uint32_t n = 100; n < 105; n++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (store.Store (MakeBundle (n, 10, Seconds (0))), true, "bundle without a lifetime not stored");
+    }
+
+  // bundle 0 has the shortest lifetime, bundle 7 the longest
+  Simulator::Schedule (Seconds (0.5), &BundleStore::Remove, &store, bundles[0]);
+  Simulator::Schedule (Seconds (0.5), &BundleStore::Remove, &store, bundles[7]);
+  for (uint32_t s = 0; s <= 10; s++)
+    {
+      // the bundles with a lifetime up to s have expired at s + 0.5
+      uint32_t left = 5 + 10 * (10 - s) - (s < 1 ? 1 : 0) - (s < 10 ? 1 : 0);
+      Simulator::Schedule (Seconds (s + 0.5), &BpBundleStoreExpiryTestCase::Check, this, &store, left);
+    }
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_removed, 100, "remove callback missed bundles");
+  NS_TEST_EXPECT_MSG_EQ (store.GetStoredByteCount (), 50, "bundles without a lifetime expired");
+
+  // nothing is stored once it has expired
+  NS_TEST_EXPECT_MSG_EQ (store.Store (MakeBundle (200, 10, Seconds (5))), false, "expired bundle stored");
+  Simulator::Destroy ();
+}
+
+/**
+ * Fills a store of 50 bytes with five 10 byte bundles, numbered 1 to 5 in
+ * order of creation:
+ *
+ *   bundle    1    2    3    4    5
+ *   priority  2    0    1    2    0
+ *   expiry    101  -    13   -    55
+ */
+class BpBundleStoreEvictionTestCaseBase : public TestCase
+{
+public:
+  BpBundleStoreEvictionTestCaseBase (std::string name);
+
+protected:
+  void Fill (BundleStore &store);
+  void Evicted (Ptr<Bundle> bundle);
+  void Removed (Ptr<Bundle> bundle);
+
+  /**
+   * \return the bundles evicted or refused since the last call, by number
+   */
+  std::vector<uint32_t> TakeEvicted ();
+
+  /**
+   * \return the bundles removed from the store since the last call, by
+   * number
+   */
+  std::vector<uint32_t> TakeRemoved ();
+
+  std::vector<Ptr<Bundle6> > m_bundles;
+
+private:
+  std::vector<uint32_t> m_evicted;
+  std::vector<uint32_t> m_removed;
+};
+
+BpBundleStoreEvictionTestCaseBase::BpBundleStoreEvictionTestCaseBase (std::string name)
+  : TestCase (name)
+{
+}
+
+void
+BpBundleStoreEvictionTestCaseBase::Fill (BundleStore &store)
+{
+  store.SetMaxBytes (50);
+  store.SetEvictCallback (MakeCallback (&BpBundleStoreEvictionTestCaseBase::Evicted, this));
+  store.SetRemoveCallback (MakeCallback (&BpBundleStoreEvictionTestCaseBase::Removed, this));
+  m_bundles.clear ();
+  m_bundles.push_back (MakeBundle (1, 10, Seconds (100), 1, 2));
+  m_bundles.push_back (MakeBundle (2, 10, Seconds (0), 2, 0));
+  m_bundles.push_back (MakeBundle (3, 10, Seconds (10), 3, 1));
+  m_bundles.push_back (MakeBundle (4, 10, Seconds (0), 4, 2));
+  m_bundles.push_back (MakeBundle (5, 10, Seconds (50), 5, 0));
+  for (uint32_t n = 0; n < m_bundles.size (); n++)
+    {
+      store.Store (m_bundles[n]);
+    }
+}
+
+void
+BpBundleStoreEvictionTestCaseBase::Evicted (Ptr<Bundle> bundle)
+{
+  m_evicted.push_back (bundle->GetPrimaryHeader ()->GetSequenceNumber ().GetValue ());
+}
+
+std::vector<uint32_t>
+BpBundleStoreEvictionTestCaseBase::TakeEvicted ()
+{
+  std::vector<uint32_t> evicted;
+  evicted.swap (m_evicted);
+  return evicted;
+}
+
+void
+BpBundleStoreEvictionTestCaseBase::Removed (Ptr<Bundle> bundle)
+{
+  m_removed.push_back (bundle->GetPrimaryHeader ()->GetSequenceNumber ().GetValue ());
+}
+
+std::vector<uint32_t>
+BpBundleStoreEvictionTestCaseBase::TakeRemoved ()
+{
+  std::vector<uint32_t> removed;
+  removed.swap (m_removed);
+  return removed;
+}
+
+/**
+ * Each policy drops the bundles it should to make room, and no more.
+ */
+class BpBundleStoreEvictionTestCase : public BpBundleStoreEvictionTestCaseBase
+{
+public:
+  BpBundleStoreEvictionTestCase (BundleStore::EvictionPolicy policy, std::string name,
+                                 uint32_t first, uint32_t second, uint32_t third);
+
+private:
+  virtual void DoRun (void);
+
+  BundleStore::EvictionPolicy m_policy;
+  uint32_t m_first;   /// the bundle dropped for a 10 byte bundle, or 6 for the new one
+  uint32_t m_second;  /// the bundles dropped next for a 20 byte bundle
+  uint32_t m_third;
+};
+
+BpBundleStoreEvictionTestCase::BpBundleStoreEvictionTestCase (BundleStore::EvictionPolicy policy, std::string name,
+                                                              uint32_t first, uint32_t second, uint32_t third)
+  : BpBundleStoreEvictionTestCaseBase ("Evict " + name),
+    m_policy (policy),
+    m_first (first),
+    m_second (second),
+    m_third (third)
+{
+}
+
+void
+BpBundleStoreEvictionTestCase::DoRun (void)
+{
+  BundleStore store;
+  store.SetEvictionPolicy (m_policy);
+  Fill (store);
+  NS_TEST_ASSERT_MSG_EQ (TakeEvicted ().size (), 0, "evicted within the quota");
+
+  bool refuse = (m_policy == BundleStore::REFUSE_NEW);
+  NS_TEST_EXPECT_MSG_EQ (store.Store (MakeBundle (6, 10, Seconds (0), 6, 2)), !refuse, "wrong outcome for the new bundle");
+  std::vector<uint32_t> evicted = TakeEvicted ();
+  NS_TEST_ASSERT_MSG_EQ (evicted.size (), 1, "wrong number of bundles evicted");
+  NS_TEST_EXPECT_MSG_EQ (evicted[0], m_first, "wrong bundle evicted");
+  NS_TEST_EXPECT_MSG_EQ (store.GetStoredByteCount (), 50, "quota not kept");
+
+  // a 20 byte bundle takes two, or none are evicted for it
+  NS_TEST_EXPECT_MSG_EQ (store.Store (MakeBundle (7, 20, Seconds (0), 7, 2)), !refuse, "wrong outcome for the new bundle");
+  evicted = TakeEvicted ();
+  if (refuse)
+    {
+      NS_TEST_ASSERT_MSG_EQ (evicted.size (), 1, "evicted for a refused bundle");
+      NS_TEST_EXPECT_MSG_EQ (evicted[0], 7, "new bundle not refused");
+      NS_TEST_EXPECT_MSG_EQ (store.GetStoredByteCount (), 50, "refused bundle stored");
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_EQ (evicted.size (), 2, "wrong number of bundles evicted");
+      NS_TEST_EXPECT_MSG_EQ (evicted[0], m_second, "wrong bundle evicted");
+      NS_TEST_EXPECT_MSG_EQ (evicted[1], m_third, "wrong bundle evicted");
+      NS_TEST_EXPECT_MSG_EQ (store.GetStoredByteCount (), 50, "quota not kept");
+    }
+  Simulator::Destroy ();
+}
+
+/**
+ * Bundles in custody are never evicted, and nothing is evicted for a new
+ * bundle that would not fit or that the policy would drop first.
+ */
+class BpBundleStoreCustodyEvictionTestCase : public BpBundleStoreEvictionTestCaseBase
+{
+public:
+  BpBundleStoreCustodyEvictionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpBundleStoreCustodyEvictionTestCase::BpBundleStoreCustodyEvictionTestCase ()
+  : BpBundleStoreEvictionTestCaseBase ("Keep bundles in custody, and evict nothing for a refused bundle")
+{
+}
+
+void
+BpBundleStoreCustodyEvictionTestCase::DoRun (void)
+{
+  BundleStore store;
+  store.SetEvictionPolicy (BundleStore::EVICT_OLDEST);
+  Fill (store);
+  m_bundles[0]->retentionConstraints |= _BP_CUSTODY_ACCEPTED;
+  m_bundles[1]->retentionConstraints |= _BP_CUSTODY_ACCEPTED;
+
+  NS_TEST_EXPECT_MSG_EQ (store.Store (MakeBundle (6, 10, Seconds (0), 6)), true, "new bundle refused");
+  std::vector<uint32_t> evicted = TakeEvicted ();
+  NS_TEST_ASSERT_MSG_EQ (evicted.size (), 1, "wrong number of bundles evicted");
+  NS_TEST_EXPECT_MSG_EQ (evicted[0], 3, "bundle in custody evicted");
+  std::vector<uint32_t> removed = TakeRemoved ();
+  NS_TEST_ASSERT_MSG_EQ (removed.size (), 1, "wrong number of bundles removed");
+  NS_TEST_EXPECT_MSG_EQ (removed[0], 3, "evicted bundle not removed");
+
+  // older than everything that may be evicted, and never taken, so not
+  // removed either
+  NS_TEST_EXPECT_MSG_EQ (store.Store (MakeBundle (7, 10, Seconds (0), 0)), false, "oldest bundle stored");
+  evicted = TakeEvicted ();
+  NS_TEST_ASSERT_MSG_EQ (evicted.size (), 1, "evicted for a refused bundle");
+  NS_TEST_EXPECT_MSG_EQ (evicted[0], 7, "new bundle not refused");
+  NS_TEST_EXPECT_MSG_EQ (TakeRemoved ().size (), 0, "removal of a refused bundle told");
+
+  // bundles 4, 5 and 6 do not make room for 40 bytes
+  NS_TEST_EXPECT_MSG_EQ (store.Store (MakeBundle (8, 40, Seconds (0), 8)), false, "bundle stored over the quota");
+  evicted = TakeEvicted ();
+  NS_TEST_ASSERT_MSG_EQ (evicted.size (), 1, "evicted for a bundle that does not fit");
+  NS_TEST_EXPECT_MSG_EQ (evicted[0], 8, "new bundle not refused");
+  NS_TEST_EXPECT_MSG_EQ (TakeRemoved ().size (), 0, "removal of a refused bundle told");
+  NS_TEST_EXPECT_MSG_EQ (store.GetStoredByteCount (), 50, "wrong bytes stored");
+
+  // a quota in bundles
+  store.SetMaxBytes (0);
+  store.SetMaxBundles (5);
+  NS_TEST_EXPECT_MSG_EQ (store.Store (MakeBundle (9, 1000, Seconds (0), 9)), true, "new bundle refused");
+  evicted = TakeEvicted ();
+  NS_TEST_ASSERT_MSG_EQ (evicted.size (), 1, "wrong number of bundles evicted");
+  NS_TEST_EXPECT_MSG_EQ (evicted[0], 4, "wrong bundle evicted");
+  Simulator::Destroy ();
+}
+
+/**
+ * With the disk store, stored ADUs are left in memory as placeholders that
+ * keep their byte tags and ranges, Load () reads the bytes back, and
+ * removals compact the segment files once most of them is dead.
+ */
+class BpBundleStoreDiskTestCase : public TestCase
+{
+public:
+  BpBundleStoreDiskTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CheckTags (Ptr<const Packet> adu, std::string what);
+  bool HasContent (Ptr<const Packet> adu, uint8_t value);
+};
+
+BpBundleStoreDiskTestCase::BpBundleStoreDiskTestCase ()
+  : TestCase ("Keep ADUs in the disk store")
+{
+}
+
+void
+BpBundleStoreDiskTestCase::CheckTags (Ptr<const Packet> adu, std::string what)
+{
+  uint32_t n = 0;
+  ByteTagIterator it = adu->GetByteTagIterator ();
+  while (it.HasNext ())
+    {
+      ByteTagIterator::Item item = it.Next ();
+      NS_TEST_ASSERT_MSG_EQ (item.GetTypeId (), BpBundleStoreTestTag::GetTypeId (), "tag without a constructor kept " << what);
+      BpBundleStoreTestTag tag;
+      item.GetTag (tag);
+      NS_TEST_EXPECT_MSG_EQ (item.GetStart (), tag.m_value == 1 ? 0 : 100, "wrong start of tag " << (uint32_t) tag.m_value << " " << what);
+      NS_TEST_EXPECT_MSG_EQ (item.GetEnd (), tag.m_value == 1 ? 100 : 300, "wrong end of tag " << (uint32_t) tag.m_value << " " << what);
+      n++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (n, 2, "wrong number of tags " << what);
+}
+
+bool
+BpBundleStoreDiskTestCase::HasContent (Ptr<const Packet> adu, uint8_t value)
+{
+  std::vector<uint8_t> data (adu->GetSize ());
+  adu->CopyData (data.data (), data.size ());
+  return data == std::vector<uint8_t> (300, value);
+}
+
+void
+BpBundleStoreDiskTestCase::DoRun (void)
+{
+  BundleStore store;
+  store.SetDiskStore (true);
+  store.SetDiskSegmentSize (1000);
+  std::vector<Ptr<Bundle6> > bundles;
+  for (uint32_t n = 0; n < 10; n++)
+    {
+      Ptr<Bundle6> bundle = MakeBundle (n, 300, Seconds (0), n);
+      std::vector<uint8_t> data (300, n + 1);
+      bundle->m_adu = Create<Packet> (data.data (), data.size ());
+      bundles.push_back (bundle);
+    }
+  Ptr<Packet> adu = bundles[0]->m_adu;
+  adu->AddByteTag (BpBundleStoreTestTag (1), 0, 100);
+  adu->AddByteTag (BpBundleStoreTestTag (2), 100, 300);
+  adu->AddByteTag (BpBundleStoreBareTestTag ());
+  for (uint32_t n = 0; n < bundles.size (); n++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (store.Store (bundles[n]), true, "bundle " << n << " refused");
+    }
+
+  Ptr<BpSegmentStore> disk = store.GetSegmentStore ();
+  NS_TEST_ASSERT_MSG_NE (disk, 0, "no disk store");
+  // three ADUs to a segment
+  NS_TEST_EXPECT_MSG_EQ (disk->GetNSegments (), 4, "wrong number of segments");
+  NS_TEST_EXPECT_MSG_EQ (disk->GetLiveBytes (), 3000, "wrong bytes on disk");
+  NS_TEST_EXPECT_MSG_EQ (bundles[0]->m_adu->GetSize (), 300, "wrong size of the placeholder");
+  NS_TEST_EXPECT_MSG_EQ (HasContent (bundles[0]->m_adu, 1), false, "ADU kept in memory");
+  CheckTags (bundles[0]->m_adu, "on the placeholder");
+
+  store.Load (bundles[0]);
+  NS_TEST_EXPECT_MSG_EQ (HasContent (bundles[0]->m_adu, 1), true, "wrong ADU loaded");
+  CheckTags (bundles[0]->m_adu, "on the loaded ADU");
+  store.Unload (bundles[0]);
+  NS_TEST_EXPECT_MSG_EQ (HasContent (bundles[0]->m_adu, 1), false, "ADU kept in memory");
+
+  // dead space in the first three segments, until it exceeds the live data
+  uint32_t removed[] = { 0, 1, 3, 4 };
+  for (uint32_t n = 0; n < 4; n++)
+    {
+      store.Remove (bundles[removed[n]]);
+    }
+  NS_TEST_EXPECT_MSG_EQ (disk->GetNSegments (), 4, "compacted with less dead space than live");
+  store.Remove (bundles[6]);
+  // the live ADUs of the first two segments are moved to the last one
+  NS_TEST_EXPECT_MSG_EQ (disk->GetNSegments (), 2, "sparse segments not compacted");
+  NS_TEST_EXPECT_MSG_EQ (disk->GetFileBytes (), 2000, "wrong size of the segment files");
+  NS_TEST_EXPECT_MSG_EQ (disk->NeedsCompaction (), false, "compaction left dead space");
+
+  uint32_t kept[] = { 2, 5, 7, 8, 9 };
+  for (uint32_t n = 0; n < 5; n++)
+    {
+      store.Load (bundles[kept[n]]);
+      NS_TEST_EXPECT_MSG_EQ (HasContent (bundles[kept[n]]->m_adu, kept[n] + 1), true, "wrong ADU of bundle " << kept[n] << " after compaction");
+    }
+  for (uint32_t n = 0; n < 5; n++)
+    {
+      store.Remove (bundles[kept[n]]);
+    }
+  NS_TEST_EXPECT_MSG_EQ (disk->GetLiveBytes (), 0, "ADUs left on disk");
+  Simulator::Destroy ();
+}
+
+class BpBundleStoreTestSuite : public TestSuite
+{
+public:
+  BpBundleStoreTestSuite ()
+    : TestSuite ("bp-bundle-store", UNIT)
+  {
+    AddTestCase (new BpBundleStoreExpiryTestCase (true), TestCase::QUICK);
+    AddTestCase (new BpBundleStoreExpiryTestCase (false), TestCase::QUICK);
+    AddTestCase (new BpBundleStoreEvictionTestCase (BundleStore::EVICT_OLDEST, "the oldest bundles", 1, 2, 3), TestCase::QUICK);
+    AddTestCase (new BpBundleStoreEvictionTestCase (BundleStore::EVICT_LOWEST_PRIORITY, "the lowest priority bundles", 2, 5, 3), TestCase::QUICK);
+    AddTestCase (new BpBundleStoreEvictionTestCase (BundleStore::EVICT_SOONEST_EXPIRING, "the bundles that expire first", 3, 5, 1), TestCase::QUICK);
+    AddTestCase (new BpBundleStoreEvictionTestCase (BundleStore::REFUSE_NEW, "nothing, refusing new bundles", 6, 0, 0), TestCase::QUICK);
+    AddTestCase (new BpBundleStoreCustodyEvictionTestCase, TestCase::QUICK);
+    AddTestCase (new BpBundleStoreDiskTestCase, TestCase::QUICK);
+  }
+} g_bpBundleStoreTestSuite;
@@ -0,0 +1,413 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <fstream>
+#include <map>
+#include <utility>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-agent-7.h"
+#include "ns3/bp-cgr-routing-agent.h"
+#include "ns3/bp-loopback-cla.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+namespace {
+
+/**
+ * \return a routing agent for ipn:1.0
+ */
+Ptr<BpCgrRoutingAgent>
+MakeAgent (uint32_t expectedBundleSize)
+{
+  Ptr<BpCgrRoutingAgent> agent = CreateObject<BpCgrRoutingAgent> ();
+  agent->SetAttribute ("ExpectedBundleSize", UintegerValue (expectedBundleSize));
+  agent->SetLocalEid (BpEndpointId (1, 0));
+  return agent;
+}
+
+/**
+ * \return the next-hop URI of the routing agent to an endpoint
+ */
+std::string
+NextHop (Ptr<BpCgrRoutingAgent> agent, BpEndpointId dst)
+{
+  return agent->NextHopEid (dst).Uri ();
+}
+
+} // anonymous namespace
+
+/**
+ * The route taken is the one of earliest arrival, over contacts that
+ * follow each other in time and leave time to send ExpectedBundleSize
+ * bytes.
+ */
+class BpCgrDijkstraTestCase : public TestCase
+{
+public:
+  BpCgrDijkstraTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpCgrDijkstraTestCase::BpCgrDijkstraTestCase ()
+  : TestCase ("Route by earliest arrival")
+{
+}
+
+void
+BpCgrDijkstraTestCase::DoRun (void)
+{
+  BpEndpointId n1 (1, 0), n2 (2, 0), n3 (3, 0), n4 (4, 0), n5 (5, 0), n6 (6, 0);
+
+  Ptr<BpCgrRoutingAgent> agent = MakeAgent (0);
+  uint32_t slow = agent->AddContact (n1, n2, Seconds (0), Seconds (100), 0, Seconds (10));
+  agent->AddContact (n2, n3, Seconds (0), Seconds (100), 0, Seconds (1));
+  agent->AddContact (n1, n3, Seconds (50), Seconds (100), 0, Seconds (0));
+  agent->AddContact (n2, n4, Seconds (0), Seconds (5), 0, Seconds (0));
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (3, 7)), "ipn:2.0", "two hops arriving at 11 s not taken");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (4, 1)), "dtn:none", "contact taken after it ended");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (6, 1)), "dtn:none", "route to a node with no contacts");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (1, 5)), "dtn:none", "route to the local node");
+
+  agent->RemoveContact (slow);
+  agent->AddContact (n1, n2, Seconds (0), Seconds (100), 0, Seconds (60));
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (3, 7)), "ipn:3.0", "direct contact arriving at 50 s not taken");
+  Simulator::Destroy ();
+
+  // 1000 bytes take 10 s at 100 bytes per second
+  agent = MakeAgent (1000);
+  agent->AddContact (n1, n5, Seconds (0), Seconds (5), 100, Seconds (0));
+  agent->AddContact (n1, n6, Seconds (0), Seconds (100), 100, Seconds (0));
+  agent->AddContact (n6, n5, Seconds (0), Seconds (100), 1000, Seconds (0));
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (5, 1)), "ipn:6.0", "contact too short for the bundle taken");
+  Simulator::Destroy ();
+}
+
+/**
+ * A contact plan file is read in whole, with comments and blank lines,
+ * or not at all.
+ */
+class BpCgrContactPlanTestCase : public TestCase
+{
+public:
+  BpCgrContactPlanTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \return the result of loading a plan of the lines given
+   */
+  int Load (Ptr<BpCgrRoutingAgent> agent, std::string lines);
+};
+
+BpCgrContactPlanTestCase::BpCgrContactPlanTestCase ()
+  : TestCase ("Load contact plans")
+{
+}
+
+int
+BpCgrContactPlanTestCase::Load (Ptr<BpCgrRoutingAgent> agent, std::string lines)
+{
+  std::string filename = CreateTempDirFilename ("bp-cgr-contact-plan.txt");
+  std::ofstream file (filename.c_str ());
+  file << lines;
+  file.close ();
+  return agent->LoadContactPlan (filename);
+}
+
+void
+BpCgrContactPlanTestCase::DoRun (void)
+{
+  Ptr<BpCgrRoutingAgent> agent = MakeAgent (0);
+  NS_TEST_EXPECT_MSG_EQ (Load (agent, "# from to start end rate owlt\n"
+                                      "1 2 0 100 1000 1   # ipn node numbers\n"
+                                      "\n"
+                                      "   \n"
+                                      "ipn:2.0 ipn:3.0 10 100 0 0.5\n"
+                                      "dtn:a dtn:b 0 10 0 0\n"), 0, "plan not loaded");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetNContacts (), 3, "wrong number of contacts");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (3, 1)), "ipn:2.0", "loaded contacts not routed on");
+
+  const char *malformed[] = {
+    "1 2 0 100 1000\n",
+    "1 2 0 100 1000 1 7\n",
+    "1 2 5 5 0 0\n",
+    "1 2 -1 5 0 0\n",
+    "1 2 0 5 0 -1\n",
+    "x 2 0 5 0 0\n",
+    "1 2 zero 5 0 0\n",
+  };
+  for (uint32_t i = 0; i < sizeof (malformed) / sizeof (malformed[0]); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (Load (agent, std::string ("1 4 0 100 0 0\n") + malformed[i]), -1,
+                             "malformed line " << malformed[i] << "taken");
+      NS_TEST_EXPECT_MSG_EQ (agent->GetNContacts (), 3, "contacts of a malformed plan added");
+    }
+  NS_TEST_EXPECT_MSG_EQ (agent->LoadContactPlan (CreateTempDirFilename ("bp-cgr-no-such-plan.txt")), -1, "missing plan loaded");
+
+  agent->ClearContactPlan ();
+  NS_TEST_EXPECT_MSG_EQ (agent->GetNContacts (), 0, "contacts left after clearing the plan");
+  Simulator::Destroy ();
+}
+
+/**
+ * Routes are found once for a destination and used until the plan
+ * changes, or a contact they take is gone or too short for the bundle.
+ */
+class BpCgrRouteCacheTestCase : public TestCase
+{
+public:
+  BpCgrRouteCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpCgrRouteCacheTestCase::BpCgrRouteCacheTestCase ()
+  : TestCase ("Cache routes until they cannot be taken")
+{
+}
+
+void
+BpCgrRouteCacheTestCase::DoRun (void)
+{
+  BpEndpointId n1 (1, 0), n2 (2, 0), n3 (3, 0), n4 (4, 0);
+
+  // 1000 bytes take 10 s on each contact, so the route through ipn:2.0
+  // arrives at 20 s, and the one through ipn:3.0 at 21 s
+  Ptr<BpCgrRoutingAgent> agent = MakeAgent (1000);
+  agent->AddContact (n1, n2, Seconds (0), Seconds (100), 100, Seconds (0));
+  agent->AddContact (n2, n4, Seconds (0), Seconds (200), 100, Seconds (0));
+  uint32_t alternate = agent->AddContact (n1, n3, Seconds (0), Seconds (200), 100, Seconds (1));
+  agent->AddContact (n3, n4, Seconds (0), Seconds (200), 100, Seconds (0));
+
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (4, 1)), "ipn:2.0", "not the earliest arrival");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (4, 2)), "ipn:2.0", "not the earliest arrival");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetRouteComputations (), 1, "routes to a node not cached");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (3, 1)), "ipn:3.0", "no direct route");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetRouteComputations (), 2, "routes to another node taken from the cache");
+
+  agent->AddContact (BpEndpointId (5, 0), BpEndpointId (6, 0), Seconds (0), Seconds (10), 0, Seconds (0));
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (4, 1)), "ipn:2.0", "not the earliest arrival");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetRouteComputations (), 3, "cached routes used after a contact was added");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (3, 1)), "ipn:3.0", "no direct route");
+
+  // at 95 s the contact to ipn:2.0 has not ended, but ends before the
+  // bundle could be sent on it
+  Simulator::Stop (Seconds (95));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (agent->GetRouteComputations (), 4, "routes found without a bundle");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (4, 1)), "ipn:3.0", "route over a contact ending too soon");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetRouteComputations (), 5, "routes not found again");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (4, 1)), "ipn:3.0", "route changed");
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (3, 1)), "ipn:3.0", "route changed");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetRouteComputations (), 5, "usable routes found again");
+
+  agent->RemoveContact (alternate);
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (4, 1)), "dtn:none", "route over a removed contact");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetRouteComputations (), 6, "routes over a removed contact kept");
+
+  // once the contact to ipn:2.0 ends, the empty route to it is found again
+  NS_TEST_EXPECT_MSG_EQ (NextHop (agent, BpEndpointId (2, 1)), "dtn:none", "route over a contact ending too soon");
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (agent->GetNContacts (), 2, "contacts not ended");
+  Simulator::Destroy ();
+}
+
+/**
+ * The agent is told as contacts from the local node start, and as the
+ * last contact to a neighbor ends or is removed.
+ */
+class BpCgrContactEventsTestCase : public TestCase
+{
+public:
+  BpCgrContactEventsTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Ready (BpEndpointId nextHop);
+  void Down (BpEndpointId nextHop, Ptr<BpCla> cla, TypeId claType);
+
+  std::vector<std::pair<Time, std::string> > m_ready;
+  std::vector<std::pair<Time, std::string> > m_down;
+  std::vector<TypeId> m_downClaTypes;
+};
+
+BpCgrContactEventsTestCase::BpCgrContactEventsTestCase ()
+  : TestCase ("Tell the agent as next hops come and go")
+{
+}
+
+void
+BpCgrContactEventsTestCase::Ready (BpEndpointId nextHop)
+{
+  m_ready.push_back (std::make_pair (Simulator::Now (), nextHop.Uri ()));
+}
+
+void
+BpCgrContactEventsTestCase::Down (BpEndpointId nextHop, Ptr<BpCla> cla, TypeId claType)
+{
+  m_down.push_back (std::make_pair (Simulator::Now (), nextHop.Uri ()));
+  m_downClaTypes.push_back (claType);
+}
+
+void
+BpCgrContactEventsTestCase::DoRun (void)
+{
+  BpEndpointId n1 (1, 0), n2 (2, 0), n3 (3, 0), n5 (5, 0);
+  Ptr<BpCgrRoutingAgent> agent = MakeAgent (0);
+  agent->SetNextHopReadyCallback (MakeCallback (&BpCgrContactEventsTestCase::Ready, this));
+  agent->SetNextHopDownCallback (MakeCallback (&BpCgrContactEventsTestCase::Down, this));
+  agent->AddNode (n2, Ipv4Address ("10.0.0.2"), 4556, BpLoopbackCla::GetTypeId ());
+
+  agent->AddContact (n1, n3, Seconds (0), Seconds (1), 0, Seconds (0));
+  agent->AddContact (n1, n2, Seconds (1), Seconds (3), 0, Seconds (0));
+  agent->AddContact (n1, n2, Seconds (2), Seconds (4), 0, Seconds (0));
+  agent->AddContact (n2, n1, Seconds (0), Seconds (5), 0, Seconds (0));
+
+  Simulator::Stop (Seconds (0.5));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (agent->NextHopClaType (n2), TypeId (), "CLA of a neighbor with no contact on");
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (agent->NextHopClaType (n2), BpLoopbackCla::GetTypeId (), "no CLA of a neighbor with a contact on");
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (agent->NextHopClaType (n2), TypeId (), "CLA of a neighbor after its last contact");
+
+  NS_TEST_ASSERT_MSG_EQ (m_ready.size (), 3, "wrong number of contact starts told");
+  NS_TEST_EXPECT_MSG_EQ (m_ready[0].first, Seconds (0), "start of the contact to ipn:3.0 not told at 0 s");
+  NS_TEST_EXPECT_MSG_EQ (m_ready[0].second, "ipn:3.0", "start of the contact to ipn:3.0 not told");
+  NS_TEST_EXPECT_MSG_EQ (m_ready[1].first, Seconds (1), "start of the first contact to ipn:2.0 not told at 1 s");
+  NS_TEST_EXPECT_MSG_EQ (m_ready[2].first, Seconds (2), "start of the second contact to ipn:2.0 not told at 2 s");
+  NS_TEST_ASSERT_MSG_EQ (m_down.size (), 2, "wrong number of next hops told down");
+  NS_TEST_EXPECT_MSG_EQ (m_down[0].first, Seconds (1), "ipn:3.0 not told down at 1 s");
+  NS_TEST_EXPECT_MSG_EQ (m_down[0].second, "ipn:3.0", "ipn:3.0 not told down");
+  NS_TEST_EXPECT_MSG_EQ (m_downClaTypes[0], TypeId (), "CLA type told for a node with none");
+  NS_TEST_EXPECT_MSG_EQ (m_down[1].first, Seconds (4), "ipn:2.0 not told down at 4 s, when its last contact ends");
+  NS_TEST_EXPECT_MSG_EQ (m_down[1].second, "ipn:2.0", "ipn:2.0 not told down");
+  NS_TEST_EXPECT_MSG_EQ (m_downClaTypes[1], BpLoopbackCla::GetTypeId (), "CLA type of ipn:2.0 not told");
+
+  uint32_t removed = agent->AddContact (n1, n5, Seconds (6), Seconds (20), 0, Seconds (0));
+  Simulator::Stop (Seconds (2.5));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (agent->RemoveContact (removed), 0, "contact not removed");
+  NS_TEST_EXPECT_MSG_EQ (agent->RemoveContact (removed), -1, "contact removed twice");
+  NS_TEST_ASSERT_MSG_EQ (m_down.size (), 3, "removed contact not told");
+  NS_TEST_EXPECT_MSG_EQ (m_down[2].first, Seconds (8), "ipn:5.0 not told down as its contact was removed");
+  NS_TEST_EXPECT_MSG_EQ (m_down[2].second, "ipn:5.0", "ipn:5.0 not told down");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetNContacts (), 0, "contacts left");
+  Simulator::Destroy ();
+}
+
+/**
+ * A contact graph routing agent that counts the routes asked for, by
+ * destination.
+ */
+class BpCgrCountingRoutingAgent : public BpCgrRoutingAgent
+{
+public:
+  virtual BpEndpointId NextHopEid (BpEndpointId &dst);
+
+  std::map<std::string, uint32_t> m_lookups;
+};
+
+BpEndpointId
+BpCgrCountingRoutingAgent::NextHopEid (BpEndpointId &dst)
+{
+  m_lookups[dst.Uri ()]++;
+  return BpCgrRoutingAgent::NextHopEid (dst);
+}
+
+/**
+ * As its last contact ends, the bundles waiting on the CLA of a neighbor
+ * are routed again, and those waiting on the CLA of another are not.
+ */
+class BpCgrNextHopDownTestCase : public TestCase
+{
+public:
+  BpCgrNextHopDownTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpCgrNextHopDownTestCase::BpCgrNextHopDownTestCase ()
+  : TestCase ("Route again only the bundles waiting for a next hop gone down")
+{
+}
+
+void
+BpCgrNextHopDownTestCase::DoRun (void)
+{
+  BpEndpointId n1 (1, 0), n2 (2, 0), n3 (3, 0), dst2 (2, 1), dst3 (3, 1);
+  Ptr<BpCgrCountingRoutingAgent> routing = CreateObject<BpCgrCountingRoutingAgent> ();
+  routing->SetAttribute ("ExpectedBundleSize", UintegerValue (0));
+  routing->SetLocalEid (n1);
+  // CLAs that are never ready, so that each bundle waits on the CLA of
+  // its route
+  Ptr<BpLoopbackCla> cla2 = CreateObject<BpLoopbackCla> ();
+  Ptr<BpLoopbackCla> cla3 = CreateObject<BpLoopbackCla> ();
+  routing->AddNode (n2, Ipv4Address ("10.0.0.2"), 4556, cla2);
+  routing->AddNode (n3, Ipv4Address ("10.0.0.3"), 4556, cla3);
+  routing->AddContact (n1, n2, Seconds (0), Seconds (1), 0, Seconds (0));
+  routing->AddContact (n1, n3, Seconds (0), Seconds (10), 0, Seconds (0));
+
+  Ptr<BpAgent7> agent = CreateObject<BpAgent7> ();
+  agent->SetAttribute ("BundleSize", UintegerValue (0));
+  agent->AddCla (cla2);
+  agent->AddCla (cla3);
+  agent->SetRoutingAgent (routing);
+  agent->SetBpEndpointId (n1);
+  BpRegisterInfo info;
+  agent->Register (n1, info);
+  NS_TEST_EXPECT_MSG_EQ (agent->Send (Create<Packet> (100), n1, dst2, Seconds (100)), 0, "bundle to ipn:2.1 not sent");
+  NS_TEST_EXPECT_MSG_EQ (agent->Send (Create<Packet> (100), n1, dst3, Seconds (100)), 0, "bundle to ipn:3.1 not sent");
+  Simulator::Stop (Seconds (0.5));
+  Simulator::Run ();
+  uint32_t lookups2 = routing->m_lookups[dst2.Uri ()];
+  uint32_t lookups3 = routing->m_lookups[dst3.Uri ()];
+  NS_TEST_EXPECT_MSG_GT (lookups3, 0, "bundle to ipn:3.1 not routed");
+
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_GT (routing->m_lookups[dst2.Uri ()], lookups2, "bundle waiting for ipn:2.0 not routed again");
+  NS_TEST_EXPECT_MSG_EQ (routing->m_lookups[dst3.Uri ()], lookups3, "bundle waiting on the CLA of ipn:3.0 routed again");
+  agent->Dispose ();
+  Simulator::Destroy ();
+}
+
+class BpCgrTestSuite : public TestSuite
+{
+public:
+  BpCgrTestSuite ()
+    : TestSuite ("bp-cgr", UNIT)
+  {
+    AddTestCase (new BpCgrDijkstraTestCase, TestCase::QUICK);
+    AddTestCase (new BpCgrContactPlanTestCase, TestCase::QUICK);
+    AddTestCase (new BpCgrRouteCacheTestCase, TestCase::QUICK);
+    AddTestCase (new BpCgrContactEventsTestCase, TestCase::QUICK);
+    AddTestCase (new BpCgrNextHopDownTestCase, TestCase::QUICK);
+  }
+} g_bpCgrTestSuite;
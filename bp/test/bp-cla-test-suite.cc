@@ -64,12 +64,108 @@ private:
    
 
 protected:
-  uint8_t p_size;
+  uint32_t p_size;
   uint32_t m_encodedBundleSize;
   uint32_t m_decodedBundleSize;
   bool isFragment;
 };
 
+/**
+ * CLA types are found by TypeId name, with or without "ns3::", or by the
+ * short name of a Bp<name>Cla, and only subclasses of BpCla are found.
+ */
+class BpClaLookupTypeTestCase : public TestCase
+{
+public:
+  BpClaLookupTypeTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpClaLookupTypeTestCase::BpClaLookupTypeTestCase ()
+  : TestCase ("Look up CLA types by name")
+{
+}
+
+void
+BpClaLookupTypeTestCase::DoRun (void)
+{
+  const char *names[][2] = {
+    { "ns3::BpTcpCla", "ns3::BpTcpCla" },
+    { "BpUdpCla", "ns3::BpUdpCla" },
+    { "Tcp", "ns3::BpTcpCla" },
+    { "Udp", "ns3::BpUdpCla" },
+    { "Ltp", "ns3::BpLtpCla" },
+    { "Loopback", "ns3::BpLoopbackCla" },
+  };
+  for (uint32_t k = 0; k < sizeof (names) / sizeof (names[0]); k++)
+    {
+      TypeId tid;
+      NS_TEST_EXPECT_MSG_EQ (BpCla::LookupType (names[k][0], &tid), true, names[k][0] << " not found");
+      NS_TEST_EXPECT_MSG_EQ (tid.GetName (), names[k][1], "wrong type for " << names[k][0]);
+      ObjectFactory factory;
+      factory.SetTypeId (tid);
+      NS_TEST_EXPECT_MSG_NE (factory.Create<BpCla> (), 0, names[k][0] << " not made by a factory");
+    }
+
+  // the abstract base, types that are not CLAs, and unknown names
+  const char *rejected[] = { "ns3::BpCla", "BpCla", "ns3::Object", "Object", "ns3::BpStaticRoutingAgent", "Tcpcl", "tcp", "" };
+  for (uint32_t k = 0; k < sizeof (rejected) / sizeof (rejected[0]); k++)
+    {
+      TypeId tid = Object::GetTypeId ();
+      NS_TEST_EXPECT_MSG_EQ (BpCla::LookupType (rejected[k], &tid), false, "\"" << rejected[k] << "\" found");
+      NS_TEST_EXPECT_MSG_EQ (tid, Object::GetTypeId (), "type set for \"" << rejected[k] << "\"");
+    }
+}
+
+/**
+ * Encodings cut short anywhere, so that a length runs past the end of the
+ * packet, or that do not start a bundle, decode to no bundle.
+ */
+class BpClaMalformedBundleTestCase : public TestCase
+{
+public:
+  BpClaMalformedBundleTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpClaMalformedBundleTestCase::BpClaMalformedBundleTestCase ()
+  : TestCase ("Decode no bundle from malformed input")
+{
+}
+
+void
+BpClaMalformedBundleTestCase::DoRun (void)
+{
+  Ptr<Bundle7> bundle = Create<Bundle7> (Create<Packet> (100));
+  BpHeader7 *bph = bundle->GetPrimaryHeader ();
+  bph->SetSourceEid (defaultEid);
+  bph->SetDestinationEid (defaultEid);
+  bph->SetReportEid (defaultEid);
+  bph->SetCreateTimestamp (13);
+  bph->SetSequenceNumber (SequenceNumber32 (15));
+  bph->SetLifeTime (Time ("128ms"));
+  Ptr<Packet> encoded = BpCla::SerializeBundle (bundle);
+  NS_TEST_ASSERT_MSG_NE (BpCla::DeserializeBundle (encoded->Copy ()), 0, "well-formed bundle not decoded");
+
+  for (uint32_t size = 0; size < encoded->GetSize (); size++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (BpCla::DeserializeBundle (encoded->CreateFragment (0, size)), 0,
+                             "bundle decoded from its first " << size << " bytes");
+    }
+
+  // a definite-length array, and a byte string, are not bundles
+  uint8_t notBundles[][2] = { { 0x82, 0x01 }, { 0x41, 0x00 } };
+  for (uint32_t k = 0; k < sizeof (notBundles) / sizeof (notBundles[0]); k++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (BpCla::DeserializeBundle (Create<Packet> (notBundles[k], 2)), 0,
+                             "bundle decoded from initial byte " << (uint32_t) notBundles[k][0]);
+    }
+}
+
 /**
  * TestSuite class names the test and identifies the type of test
  * Enables specific test cases to run
@@ -87,6 +183,9 @@ public:
       AddTestCase(new Bp7SerializeTestCase(0, true), TestCase::QUICK);
       AddTestCase(new Bp7SerializeTestCase(32, true), TestCase::QUICK);
       AddTestCase(new Bp7SerializeTestCase(1024, true), TestCase::QUICK);
+      AddTestCase(new Bp7SerializeTestCase(10 * 1024 * 1024, false), TestCase::EXTENSIVE);
+      AddTestCase(new BpClaLookupTypeTestCase, TestCase::QUICK);
+      AddTestCase(new BpClaMalformedBundleTestCase, TestCase::QUICK);
     }
 }g_bpClaTestSuite;
 
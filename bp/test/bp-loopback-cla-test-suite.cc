@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-bundle-7.h"
+#include "ns3/bp-loopback-cla.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+namespace {
+
+const uint32_t ADU_LENGTH = 2000;
+
+/**
+ * \return a bundle of ADU_LENGTH payload bytes, byte i of which is i
+ * times 3, modulo 256
+ */
+Ptr<Bundle7>
+MakeBundle (void)
+{
+  std::vector<uint8_t> data (ADU_LENGTH);
+  for (uint32_t i = 0; i < ADU_LENGTH; i++)
+    {
+      data[i] = i * 3;
+    }
+  Ptr<Bundle7> bundle = Create<Bundle7> (Create<Packet> (data.data (), ADU_LENGTH));
+  BpHeader7 *bph = bundle->GetPrimaryHeader ();
+  bph->SetSourceEid (BpEndpointId ("dtn", "source"));
+  bph->SetDestinationEid (BpEndpointId ("dtn", "destination"));
+  bph->SetCreateTimestamp (0);
+  bph->SetSequenceNumber (SequenceNumber32 (1));
+  bph->SetLifeTime (Seconds (0));
+  return bundle;
+}
+
+} // anonymous namespace
+
+/**
+ * A bundle sent to the address of a registration is handed to the CLA
+ * listening there after Delay, as a copy or encoded.
+ */
+class BpLoopbackDeliveryTestCase : public TestCase
+{
+public:
+  BpLoopbackDeliveryTestCase (bool serialize);
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Bundle> bundle);
+
+  bool m_serialize;
+  std::vector<Ptr<Bundle> > m_bundles;
+};
+
+BpLoopbackDeliveryTestCase::BpLoopbackDeliveryTestCase (bool serialize)
+  : TestCase (serialize ? "Deliver encoded bundles" : "Deliver copies of bundles"),
+    m_serialize (serialize)
+{
+}
+
+void
+BpLoopbackDeliveryTestCase::Receive (Ptr<Bundle> bundle)
+{
+  m_bundles.push_back (bundle);
+}
+
+void
+BpLoopbackDeliveryTestCase::DoRun (void)
+{
+  InetSocketAddress address (Ipv4Address ("10.0.0.2"), 4556);
+  Ptr<BpLoopbackCla> sender = CreateObject<BpLoopbackCla> ();
+  Ptr<BpLoopbackCla> receiver = CreateObject<BpLoopbackCla> (MakeCallback (&BpLoopbackDeliveryTestCase::Receive, this));
+  sender->SetAttribute ("Delay", TimeValue (Seconds (1)));
+  sender->SetAttribute ("Serialize", BooleanValue (m_serialize));
+  NS_TEST_ASSERT_MSG_EQ (receiver->EnableReceive (BpEndpointId ("dtn", "destination"), address, 0), 0, "cannot listen");
+
+  Ptr<Bundle7> bundle = MakeBundle ();
+  NS_TEST_EXPECT_MSG_EQ (sender->SendBundle (bundle, address, 0), 0, "bundle refused");
+  NS_TEST_EXPECT_MSG_EQ (sender->GetBundlesSent (), 1, "bundle not counted as sent");
+  Simulator::Stop (MilliSeconds (999));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 0, "bundle delivered before Delay");
+  Simulator::Stop (MilliSeconds (1));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_bundles.size (), 1, "bundle not delivered after Delay");
+  NS_TEST_EXPECT_MSG_EQ (receiver->GetBundlesReceived (), 1, "bundle not counted as received");
+
+  Ptr<Bundle7> received = DynamicCast<Bundle7> (m_bundles[0]);
+  NS_TEST_ASSERT_MSG_NE (received, 0, "not a BPv7 bundle");
+  NS_TEST_EXPECT_MSG_NE (PeekPointer (received), PeekPointer (bundle), "bundle object of the sender handed over");
+  NS_TEST_EXPECT_MSG_EQ (received->GetPrimaryHeader ()->GetSequenceNumber ().GetValue (), 1, "wrong sequence number");
+  NS_TEST_ASSERT_MSG_EQ (received->m_adu->GetSize (), ADU_LENGTH, "wrong ADU length");
+  std::vector<uint8_t> data (ADU_LENGTH);
+  received->m_adu->CopyData (data.data (), ADU_LENGTH);
+  for (uint32_t i = 0; i < ADU_LENGTH; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t) data[i], (i * 3) % 256, "wrong ADU byte " << i);
+    }
+  Simulator::Destroy ();
+}
+
+/**
+ * One CLA listens on an address at a time, a send to an address nobody
+ * listens on is refused, and the addresses are freed as registrations go
+ * and as the simulation is destroyed.
+ */
+class BpLoopbackListenTestCase : public TestCase
+{
+public:
+  BpLoopbackListenTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpLoopbackListenTestCase::BpLoopbackListenTestCase ()
+  : TestCase ("Listen on addresses of the running simulation")
+{
+}
+
+void
+BpLoopbackListenTestCase::DoRun (void)
+{
+  InetSocketAddress address (Ipv4Address ("10.0.0.3"), 4556);
+  BpEndpointId first ("dtn", "first");
+  BpEndpointId second ("dtn", "second");
+  Ptr<BpLoopbackCla> sender = CreateObject<BpLoopbackCla> ();
+  Ptr<BpLoopbackCla> receiver = CreateObject<BpLoopbackCla> ();
+  Ptr<BpLoopbackCla> other = CreateObject<BpLoopbackCla> ();
+
+  NS_TEST_EXPECT_MSG_EQ (sender->SendBundle (MakeBundle (), address, 0), -1, "bundle taken with no listener");
+  NS_TEST_EXPECT_MSG_EQ (sender->GetBundlesSent (), 0, "refused bundle counted");
+
+  // two registrations of one CLA share the address
+  NS_TEST_EXPECT_MSG_EQ (receiver->EnableReceive (first, address, 0), 0, "cannot listen");
+  NS_TEST_EXPECT_MSG_EQ (receiver->EnableReceive (second, address, 0), 0, "cannot listen again");
+  NS_TEST_EXPECT_MSG_EQ (other->EnableReceive (first, address, 0), -1, "address taken from another CLA");
+  NS_TEST_EXPECT_MSG_EQ (sender->SendBundle (MakeBundle (), address, 0), 0, "bundle refused");
+  receiver->DisableReceive (first);
+  NS_TEST_EXPECT_MSG_EQ (sender->SendBundle (MakeBundle (), address, 0), 0, "address freed with a registration left");
+  receiver->DisableReceive (second);
+  NS_TEST_EXPECT_MSG_EQ (sender->SendBundle (MakeBundle (), address, 0), -1, "address kept after the last registration");
+
+  // disposing of a CLA frees its address
+  NS_TEST_EXPECT_MSG_EQ (other->EnableReceive (first, address, 0), 0, "free address not taken");
+  other->Dispose ();
+  NS_TEST_EXPECT_MSG_EQ (sender->SendBundle (MakeBundle (), address, 0), -1, "address of a disposed CLA kept");
+
+  // the next simulation starts with no listeners
+  NS_TEST_EXPECT_MSG_EQ (receiver->EnableReceive (first, address, 0), 0, "free address not taken");
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (sender->SendBundle (MakeBundle (), address, 0), -1, "listener kept after Simulator::Destroy ()");
+  Ptr<BpLoopbackCla> next = CreateObject<BpLoopbackCla> ();
+  NS_TEST_EXPECT_MSG_EQ (next->EnableReceive (first, address, 0), 0, "address of the last simulation taken");
+  NS_TEST_EXPECT_MSG_EQ (sender->SendBundle (MakeBundle (), address, 0), 0, "bundle refused");
+  Simulator::Destroy ();
+}
+
+class BpLoopbackClaTestSuite : public TestSuite
+{
+public:
+  BpLoopbackClaTestSuite ()
+    : TestSuite ("bp-loopback-cla", UNIT)
+  {
+    AddTestCase (new BpLoopbackDeliveryTestCase (false), TestCase::QUICK);
+    AddTestCase (new BpLoopbackDeliveryTestCase (true), TestCase::QUICK);
+    AddTestCase (new BpLoopbackListenTestCase, TestCase::QUICK);
+  }
+} g_bpLoopbackClaTestSuite;
@@ -0,0 +1,547 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include <deque>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-bundle-7.h"
+#include "ns3/bp-ltp-cla.h"
+#include "ns3/bp-ltp-header.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * A datagram socket of an LTP CLA.  It keeps the type of each segment it
+ * is sent, and hands the datagrams that arrive at it to its CLA.  Once
+ * linked to the socket of another CLA, what it is sent arrives there after
+ * the delay, unless it is one of the segments set to be lost.
+ */
+class BpLtpTestSocket : public Socket
+{
+public:
+  BpLtpTestSocket (BpLtpCla *cla);
+
+  /**
+   * Send to peer from now on.
+   */
+  void Link (BpLtpTestSocket *peer, Time delay);
+
+  /**
+   * Lose the segments sent numbered [first, last), counting from 0.
+   */
+  void Lose (uint32_t first, uint32_t last);
+
+  /**
+   * Hand a datagram to the CLA as if it had come in.
+   */
+  void Arrive (Ptr<Packet> p);
+
+  virtual int Send (Ptr<Packet> p, uint32_t flags);
+  virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress);
+  virtual uint32_t GetTxAvailable (void) const { return 65535; }
+  virtual SocketType GetSocketType (void) const { return NS3_SOCK_DGRAM; }
+
+  virtual SocketErrno GetErrno (void) const { return ERROR_NOTERROR; }
+  virtual Ptr<Node> GetNode (void) const { return 0; }
+  virtual int Bind (const Address &address) { return 0; }
+  virtual int Bind () { return 0; }
+  virtual int Bind6 () { return 0; }
+  virtual int Close (void) { return 0; }
+  virtual int ShutdownSend (void) { return 0; }
+  virtual int ShutdownRecv (void) { return 0; }
+  virtual int Connect (const Address &address) { return 0; }
+  virtual int Listen (void) { return 0; }
+  virtual int SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress) { return Send (p, flags); }
+  virtual uint32_t GetRxAvailable (void) const { return m_inbox.empty () ? 0 : m_inbox.front ()->GetSize (); }
+  virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags) { Address from; return RecvFrom (maxSize, flags, from); }
+  virtual int GetSockName (Address &address) const { return 0; }
+  virtual int GetPeerName (Address &address) const { return 0; }
+  virtual bool SetAllowBroadcast (bool allowBroadcast) { return false; }
+  virtual bool GetAllowBroadcast () const { return false; }
+
+  std::vector<uint8_t> m_types;       /// type of each segment sent, in order
+
+private:
+  BpLtpCla *m_cla;
+  std::deque<Ptr<Packet> > m_inbox;
+  BpLtpTestSocket *m_peer;
+  Time m_delay;
+  uint32_t m_loseFirst;
+  uint32_t m_loseLast;
+};
+
+BpLtpTestSocket::BpLtpTestSocket (BpLtpCla *cla)
+  : m_cla (cla),
+    m_peer (0),
+    m_loseFirst (0),
+    m_loseLast (0)
+{
+}
+
+void
+BpLtpTestSocket::Link (BpLtpTestSocket *peer, Time delay)
+{
+  m_peer = peer;
+  m_delay = delay;
+}
+
+void
+BpLtpTestSocket::Lose (uint32_t first, uint32_t last)
+{
+  m_loseFirst = first;
+  m_loseLast = last;
+}
+
+void
+BpLtpTestSocket::Arrive (Ptr<Packet> p)
+{
+  m_inbox.push_back (p);
+  m_cla->DataRecv (this);
+}
+
+int
+BpLtpTestSocket::Send (Ptr<Packet> p, uint32_t flags)
+{
+  LtpSegmentHeader header;
+  p->PeekHeader (header);
+  uint32_t n = m_types.size ();
+  m_types.push_back (header.GetType ());
+  if (m_peer && (n < m_loseFirst || n >= m_loseLast))
+    {
+      Simulator::Schedule (m_delay, &BpLtpTestSocket::Arrive, m_peer, p);
+    }
+  return p->GetSize ();
+}
+
+Ptr<Packet>
+BpLtpTestSocket::RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress)
+{
+  if (m_inbox.empty ())
+    {
+      return 0;
+    }
+  Ptr<Packet> p = m_inbox.front ();
+  m_inbox.pop_front ();
+  fromAddress = InetSocketAddress (Ipv4Address ("10.0.0.1"), 1113);
+  return p;
+}
+
+namespace {
+
+/**
+ * \return a bundle of length payload bytes, encoded as a CLA sends it
+ */
+Ptr<Packet>
+Encoded (uint32_t length)
+{
+  std::vector<uint8_t> data (length);
+  for (uint32_t i = 0; i < length; i++)
+    {
+      data[i] = i * 7;
+    }
+  Ptr<Bundle7> bundle = Create<Bundle7> (Create<Packet> (data.data (), length));
+  BpHeader7 *bph = bundle->GetPrimaryHeader ();
+  bph->SetSourceEid (BpEndpointId ("dtn", "source"));
+  bph->SetDestinationEid (BpEndpointId ("dtn", "destination"));
+  bph->SetCreateTimestamp (0);
+  bph->SetSequenceNumber (SequenceNumber32 (1));
+  bph->SetLifeTime (Seconds (0));
+  return BpCla::SerializeBundle (bundle);
+}
+
+/**
+ * \return a data segment of a session of engine 1 that carries data
+ */
+Ptr<Packet>
+DataSegment (uint8_t type, uint64_t offset, Ptr<Packet> data, uint64_t session = 1)
+{
+  LtpSegmentHeader header (type);
+  header.SetEngineId (1);
+  header.SetSessionNumber (session);
+  header.SetClientServiceId (1);
+  header.SetOffset (offset);
+  header.SetLength (data->GetSize ());
+  Ptr<Packet> segment = data->Copy ();
+  segment->AddHeader (header);
+  return segment;
+}
+
+} // anonymous namespace
+
+/**
+ * An LTP CLA whose Transmit () can be called directly.
+ */
+class BpLtpTestCla : public BpLtpCla
+{
+public:
+  int Send (Ptr<Socket> socket, Ptr<Packet> bundle) { return Transmit (socket, bundle); }
+};
+
+/**
+ * A CLA that receives segments put together by the test, and keeps the
+ * bundles it passes on.
+ */
+class BpLtpClaReceiveTestCase : public TestCase
+{
+public:
+  BpLtpClaReceiveTestCase (std::string name);
+
+protected:
+  virtual void DoSetup (void);
+  virtual void DoTeardown (void);
+
+  Ptr<BpLtpCla> m_cla;
+  Ptr<BpLtpTestSocket> m_socket;
+  std::vector<Ptr<Bundle> > m_bundles;
+
+private:
+  void Receive (Ptr<Bundle> bundle);
+};
+
+BpLtpClaReceiveTestCase::BpLtpClaReceiveTestCase (std::string name)
+  : TestCase (name)
+{
+}
+
+void
+BpLtpClaReceiveTestCase::DoSetup (void)
+{
+  m_bundles.clear ();
+  m_cla = CreateObject<BpLtpCla> (MakeCallback (&BpLtpClaReceiveTestCase::Receive, this));
+  m_cla->SetAttribute ("OneWayDelay", TimeValue (MilliSeconds (100)));
+  m_cla->SetAttribute ("TimerMargin", TimeValue (MilliSeconds (50)));
+  m_cla->SetAttribute ("RetransmissionLimit", UintegerValue (3));
+  m_socket = CreateObject<BpLtpTestSocket> (PeekPointer (m_cla));
+}
+
+void
+BpLtpClaReceiveTestCase::DoTeardown (void)
+{
+  m_cla->Dispose ();
+  m_cla = 0;
+  m_socket = 0;
+  Simulator::Destroy ();
+}
+
+void
+BpLtpClaReceiveTestCase::Receive (Ptr<Bundle> bundle)
+{
+  m_bundles.push_back (bundle);
+}
+
+/**
+ * Segments whose offset and length do not fit 32 bits, or that go past
+ * the end of the block once it is known, are discarded.
+ */
+class BpLtpClaBoundsTestCase : public BpLtpClaReceiveTestCase
+{
+public:
+  BpLtpClaBoundsTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpLtpClaBoundsTestCase::BpLtpClaBoundsTestCase ()
+  : BpLtpClaReceiveTestCase ("Discard segments past 4 GB or past the end of the block")
+{
+}
+
+void
+BpLtpClaBoundsTestCase::DoRun (void)
+{
+  m_socket->Arrive (DataSegment (LtpSegmentHeader::GREEN_DATA, 0x100000000ULL, Create<Packet> (100)));
+  m_socket->Arrive (DataSegment (LtpSegmentHeader::GREEN_DATA, 0xffffff00, Create<Packet> (0x200)));
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetImportSessions (), 0, "segment past 4 GB started a session");
+
+  Ptr<Packet> bundle = Encoded (500);
+  uint32_t length = bundle->GetSize ();
+  m_socket->Arrive (DataSegment (LtpSegmentHeader::GREEN_DATA_EOB, length - 100, bundle->CreateFragment (length - 100, 100)));
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetImportSessions (), 1, "end of the block not taken");
+  // zeros that would otherwise be taken in place of the end of the block
+  m_socket->Arrive (DataSegment (LtpSegmentHeader::GREEN_DATA, length - 150, Create<Packet> (200)));
+  m_socket->Arrive (DataSegment (LtpSegmentHeader::GREEN_DATA, 0, bundle->CreateFragment (0, length - 150)));
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 0, "incomplete block passed on");
+  m_socket->Arrive (DataSegment (LtpSegmentHeader::GREEN_DATA, length - 150, bundle->CreateFragment (length - 150, 50)));
+  NS_TEST_ASSERT_MSG_EQ (m_bundles.size (), 1, "block not passed on");
+  Ptr<Bundle7> received = DynamicCast<Bundle7> (m_bundles[0]);
+  NS_TEST_ASSERT_MSG_NE (received, 0, "block not decoded");
+  NS_TEST_ASSERT_MSG_EQ (received->m_adu->GetSize (), 500, "block not as sent");
+  std::vector<uint8_t> data (500);
+  received->m_adu->CopyData (data.data (), data.size ());
+  for (uint32_t i = 0; i < data.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t) data[i], (uint8_t) (i * 7), "byte " << i << " not as sent");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetImportSessions (), 0, "green session kept");
+}
+
+/**
+ * Late segments of a block that was passed on do not start a new session
+ * until as long as the sender keeps trying has gone by.
+ */
+class BpLtpClaFinishedTestCase : public BpLtpClaReceiveTestCase
+{
+public:
+  BpLtpClaFinishedTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Check (uint32_t sessions, std::string when);
+};
+
+BpLtpClaFinishedTestCase::BpLtpClaFinishedTestCase ()
+  : BpLtpClaReceiveTestCase ("Ignore late segments of a block passed on")
+{
+}
+
+void
+BpLtpClaFinishedTestCase::Check (uint32_t sessions, std::string when)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetImportSessions (), sessions, "wrong number of sessions " << when);
+}
+
+void
+BpLtpClaFinishedTestCase::DoRun (void)
+{
+  // the CLA waits 1 s: twice 100 ms plus 50 ms, for 3 retransmissions and
+  // the first transmission
+  Ptr<Packet> bundle = Encoded (100);
+  uint32_t length = bundle->GetSize ();
+  m_socket->Arrive (DataSegment (LtpSegmentHeader::GREEN_DATA_EOB, 0, bundle, 1));
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 1, "block not passed on");
+  Ptr<Packet> late = DataSegment (LtpSegmentHeader::GREEN_DATA, 0, bundle->CreateFragment (0, length / 2), 1);
+  Simulator::Schedule (MilliSeconds (500), &BpLtpTestSocket::Arrive, m_socket, late->Copy ());
+  Simulator::Schedule (MilliSeconds (600), &BpLtpClaFinishedTestCase::Check, this, 0, "after a late segment");
+
+  // another block finishes after the first has expired
+  Simulator::Schedule (Seconds (2), &BpLtpTestSocket::Arrive, m_socket, DataSegment (LtpSegmentHeader::GREEN_DATA_EOB, 0, bundle, 2));
+  Simulator::Schedule (Seconds (3), &BpLtpTestSocket::Arrive, m_socket, late->Copy ());
+  Simulator::Schedule (MilliSeconds (3100), &BpLtpClaFinishedTestCase::Check, this, 1, "once the first session expired");
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 2, "second block not passed on");
+}
+
+/**
+ * A sending CLA linked to the receiving one, 100 ms apart, whose timers
+ * are set to match, with segments of 1000 bytes.
+ */
+class BpLtpClaLinkTestCase : public BpLtpClaReceiveTestCase
+{
+public:
+  BpLtpClaLinkTestCase (std::string name);
+
+protected:
+  virtual void DoSetup (void);
+  virtual void DoTeardown (void);
+
+  /**
+   * \return true if the bundles passed on are the one bundle of length
+   * payload bytes of Encoded ()
+   */
+  bool Received (uint32_t length);
+
+  Ptr<BpLtpTestCla> m_sender;
+  Ptr<BpLtpTestSocket> m_senderSocket;
+};
+
+BpLtpClaLinkTestCase::BpLtpClaLinkTestCase (std::string name)
+  : BpLtpClaReceiveTestCase (name)
+{
+}
+
+void
+BpLtpClaLinkTestCase::DoSetup (void)
+{
+  BpLtpClaReceiveTestCase::DoSetup ();
+  m_cla->SetAttribute ("SegmentSize", UintegerValue (1000));
+  m_sender = CreateObject<BpLtpTestCla> ();
+  m_sender->SetAttribute ("SegmentSize", UintegerValue (1000));
+  m_sender->SetAttribute ("OneWayDelay", TimeValue (MilliSeconds (100)));
+  m_sender->SetAttribute ("TimerMargin", TimeValue (MilliSeconds (50)));
+  m_sender->SetAttribute ("RetransmissionLimit", UintegerValue (3));
+  m_senderSocket = CreateObject<BpLtpTestSocket> (PeekPointer (m_sender));
+  m_senderSocket->Link (PeekPointer (m_socket), MilliSeconds (100));
+  m_socket->Link (PeekPointer (m_senderSocket), MilliSeconds (100));
+}
+
+void
+BpLtpClaLinkTestCase::DoTeardown (void)
+{
+  m_sender->Dispose ();
+  m_sender = 0;
+  m_senderSocket = 0;
+  BpLtpClaReceiveTestCase::DoTeardown ();
+}
+
+bool
+BpLtpClaLinkTestCase::Received (uint32_t length)
+{
+  if (m_bundles.size () != 1)
+    {
+      return false;
+    }
+  Ptr<Bundle7> bundle = DynamicCast<Bundle7> (m_bundles[0]);
+  if (!bundle || bundle->m_adu->GetSize () != length)
+    {
+      return false;
+    }
+  std::vector<uint8_t> data (length);
+  bundle->m_adu->CopyData (data.data (), length);
+  for (uint32_t i = 0; i < length; i++)
+    {
+      if (data[i] != (uint8_t) (i * 7))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/**
+ * A lost red segment is sent again after the report of the checkpoint,
+ * and a lost report is sent again after its timer, until both sessions
+ * are done with the block.
+ */
+class BpLtpClaLossTestCase : public BpLtpClaLinkTestCase
+{
+public:
+  BpLtpClaLossTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpLtpClaLossTestCase::BpLtpClaLossTestCase ()
+  : BpLtpClaLinkTestCase ("Send a block again around a lost segment and report")
+{
+}
+
+void
+BpLtpClaLossTestCase::DoRun (void)
+{
+  // the second of six segments, and the report that claims the whole block
+  m_senderSocket->Lose (1, 2);
+  m_socket->Lose (1, 2);
+  NS_TEST_EXPECT_MSG_EQ (m_sender->Send (m_senderSocket, Encoded (5000)), 0, "block refused");
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_GT (m_senderSocket->m_types.size (), 6, "block not sent");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_senderSocket->m_types[1], LtpSegmentHeader::RED_DATA, "lost segment not red data");
+  NS_TEST_ASSERT_MSG_GT (m_socket->m_types.size (), 1, "no report sent again");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_socket->m_types[1], LtpSegmentHeader::REPORT, "lost segment not a report");
+  NS_TEST_EXPECT_MSG_EQ (Received (5000), true, "block not passed on whole");
+  NS_TEST_EXPECT_MSG_EQ (m_sender->GetRetransmittedSegments (), 1, "wrong number of segments sent again");
+  NS_TEST_EXPECT_MSG_EQ (m_sender->GetExportSessions (), 0, "export session not closed");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetImportSessions (), 0, "import session not closed");
+  NS_TEST_EXPECT_MSG_EQ (m_sender->GetCancelledSessions (), 0, "export session cancelled");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetCancelledSessions (), 0, "import session cancelled");
+}
+
+/**
+ * A sender whose checkpoint is not answered RetransmissionLimit times
+ * cancels its session, and the receiver drops its part of the block.
+ */
+class BpLtpClaCancelTestCase : public BpLtpClaLinkTestCase
+{
+public:
+  BpLtpClaCancelTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpLtpClaCancelTestCase::BpLtpClaCancelTestCase ()
+  : BpLtpClaLinkTestCase ("Cancel a session whose checkpoint is not answered")
+{
+}
+
+void
+BpLtpClaCancelTestCase::DoRun (void)
+{
+  // all but the first of six segments, and the checkpoint sent again three
+  // times, but not the cancel segment
+  m_senderSocket->Lose (1, 9);
+  m_sender->Send (m_senderSocket, Encoded (5000));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_senderSocket->m_types.size (), 10, "wrong number of segments sent");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_senderSocket->m_types[8], LtpSegmentHeader::RED_DATA_CP_EORP_EOB, "checkpoint not sent again");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_senderSocket->m_types[9], LtpSegmentHeader::CANCEL_FROM_SENDER, "session not cancelled");
+  NS_TEST_ASSERT_MSG_EQ (m_socket->m_types.size (), 1, "wrong number of segments answered");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) m_socket->m_types[0], LtpSegmentHeader::CANCEL_ACK_TO_SENDER, "cancel not acknowledged");
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 0, "part of a block passed on");
+  NS_TEST_EXPECT_MSG_EQ (m_sender->GetExportSessions (), 0, "export session not closed");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetImportSessions (), 0, "import session not closed");
+  NS_TEST_EXPECT_MSG_EQ (m_sender->GetCancelledSessions (), 1, "export session not cancelled");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetCancelledSessions (), 1, "import session not cancelled");
+}
+
+/**
+ * A receiver that hears nothing from the sender for as long as the
+ * sender would keep trying drops its part of the block.
+ */
+class BpLtpClaIdleTestCase : public BpLtpClaLinkTestCase
+{
+public:
+  BpLtpClaIdleTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpLtpClaIdleTestCase::BpLtpClaIdleTestCase ()
+  : BpLtpClaLinkTestCase ("Drop an import session that has gone quiet")
+{
+}
+
+void
+BpLtpClaIdleTestCase::DoRun (void)
+{
+  m_senderSocket->Lose (1, 100);
+  m_sender->Send (m_senderSocket, Encoded (5000));
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetImportSessions (), 1, "import session dropped early");
+
+  // 1 s after the first segment came in, at 100 ms
+  Simulator::Stop (MilliSeconds (200));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetImportSessions (), 0, "import session not dropped");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetCancelledSessions (), 1, "import session not counted as cancelled");
+  NS_TEST_EXPECT_MSG_EQ (m_socket->m_types.size (), 0, "segments sent for a session gone quiet");
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 0, "part of a block passed on");
+  NS_TEST_EXPECT_MSG_EQ (m_sender->GetCancelledSessions (), 1, "export session not cancelled");
+}
+
+class BpLtpClaTestSuite : public TestSuite
+{
+public:
+  BpLtpClaTestSuite ()
+    : TestSuite ("bp-ltp-cla", UNIT)
+  {
+    AddTestCase (new BpLtpClaBoundsTestCase, TestCase::QUICK);
+    AddTestCase (new BpLtpClaFinishedTestCase, TestCase::QUICK);
+    AddTestCase (new BpLtpClaLossTestCase, TestCase::QUICK);
+    AddTestCase (new BpLtpClaCancelTestCase, TestCase::QUICK);
+    AddTestCase (new BpLtpClaIdleTestCase, TestCase::QUICK);
+  }
+} g_bpLtpClaTestSuite;
@@ -0,0 +1,255 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-ltp-header.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+namespace {
+
+std::vector<uint8_t>
+Bytes (Ptr<const Packet> p)
+{
+  std::vector<uint8_t> data (p->GetSize ());
+  p->CopyData (data.data (), data.size ());
+  return data;
+}
+
+/**
+ * \return header encoded, in front of dataLength bytes of data
+ */
+Ptr<Packet>
+Segment (const LtpSegmentHeader &header, uint32_t dataLength = 0)
+{
+  Ptr<Packet> p = Create<Packet> (dataLength);
+  p->AddHeader (header);
+  return p;
+}
+
+} // anonymous namespace
+
+/**
+ * Data segments carry the client service id, offset and length, and
+ * checkpoints the checkpoint and report serial numbers, all as SDNVs.
+ */
+class LtpDataSegmentTestCase : public TestCase
+{
+public:
+  LtpDataSegmentTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LtpDataSegmentTestCase::LtpDataSegmentTestCase ()
+  : TestCase ("Encode and decode data segments")
+{
+}
+
+void
+LtpDataSegmentTestCase::DoRun (void)
+{
+  LtpSegmentHeader header (LtpSegmentHeader::RED_DATA_CP_EORP);
+  header.SetEngineId (1);
+  header.SetSessionNumber (300);
+  header.SetClientServiceId (1);
+  header.SetOffset (0);
+  header.SetLength (200);
+  header.SetCheckpointSerial (1);
+  header.SetReportSerial (0);
+  uint8_t expected[] = { 0x02, 0x01, 0x82, 0x2c, 0x00, 0x01, 0x00, 0x81, 0x48, 0x01, 0x00 };
+  Ptr<Packet> p = Segment (header);
+  NS_TEST_EXPECT_MSG_EQ ((Bytes (p) == std::vector<uint8_t> (expected, expected + sizeof (expected))), true, "wrong checkpoint encoding");
+  NS_TEST_EXPECT_MSG_EQ (header.GetSerializedSize (), sizeof (expected), "wrong serialized size");
+
+  // every data type, with large values, in front of its data
+  uint8_t types[] = { LtpSegmentHeader::RED_DATA, LtpSegmentHeader::RED_DATA_CP, LtpSegmentHeader::RED_DATA_CP_EORP,
+                      LtpSegmentHeader::RED_DATA_CP_EORP_EOB, LtpSegmentHeader::GREEN_DATA, LtpSegmentHeader::GREEN_DATA_EOB };
+  for (uint32_t k = 0; k < sizeof (types); k++)
+    {
+      LtpSegmentHeader sent (types[k]);
+      sent.SetEngineId (0x123456789ULL);
+      sent.SetSessionNumber (1ULL << 40);
+      sent.SetClientServiceId (1);
+      sent.SetOffset (70000);
+      sent.SetLength (1400);
+      sent.SetCheckpointSerial (99);
+      sent.SetReportSerial (1ULL << 33);
+      p = Segment (sent, 1400);
+      LtpSegmentHeader received;
+      NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), sent.GetSerializedSize (), "wrong decoded size of type " << k);
+      NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 1400, "data not left behind the header of type " << k);
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t) received.GetType (), (uint32_t) types[k], "wrong type");
+      NS_TEST_EXPECT_MSG_EQ (received.IsData (), true, "data segment not data");
+      NS_TEST_EXPECT_MSG_EQ (received.GetEngineId (), 0x123456789ULL, "wrong engine id");
+      NS_TEST_EXPECT_MSG_EQ (received.GetSessionNumber (), 1ULL << 40, "wrong session number");
+      NS_TEST_EXPECT_MSG_EQ (received.GetClientServiceId (), 1, "wrong client service id");
+      NS_TEST_EXPECT_MSG_EQ (received.GetOffset (), 70000, "wrong offset");
+      NS_TEST_EXPECT_MSG_EQ (received.GetLength (), 1400, "wrong length");
+      if (received.IsCheckpoint ())
+        {
+          NS_TEST_EXPECT_MSG_EQ (received.GetCheckpointSerial (), 99, "wrong checkpoint serial");
+          NS_TEST_EXPECT_MSG_EQ (received.GetReportSerial (), 1ULL << 33, "wrong report serial");
+        }
+    }
+
+  // what each type says about the block
+  LtpSegmentHeader red (LtpSegmentHeader::RED_DATA);
+  NS_TEST_EXPECT_MSG_EQ (red.IsRed () && !red.IsCheckpoint () && !red.IsEndOfRedPart () && !red.IsEndOfBlock (), true, "wrong red data flags");
+  LtpSegmentHeader last (LtpSegmentHeader::RED_DATA_CP_EORP_EOB);
+  NS_TEST_EXPECT_MSG_EQ (last.IsRed () && last.IsCheckpoint () && last.IsEndOfRedPart () && last.IsEndOfBlock (), true, "wrong last red segment flags");
+  LtpSegmentHeader green (LtpSegmentHeader::GREEN_DATA_EOB);
+  NS_TEST_EXPECT_MSG_EQ (!green.IsRed () && !green.IsCheckpoint () && !green.IsEndOfRedPart () && green.IsEndOfBlock (), true, "wrong last green segment flags");
+  LtpSegmentHeader report (LtpSegmentHeader::REPORT);
+  NS_TEST_EXPECT_MSG_EQ (report.IsData () || report.IsRed (), false, "report taken for data");
+}
+
+/**
+ * Reports carry their claims, report-acknowledgments the report serial
+ * number, cancel segments a reason and cancel acknowledgments nothing.
+ */
+class LtpSignalSegmentTestCase : public TestCase
+{
+public:
+  LtpSignalSegmentTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LtpSignalSegmentTestCase::LtpSignalSegmentTestCase ()
+  : TestCase ("Encode and decode reports and cancel segments")
+{
+}
+
+void
+LtpSignalSegmentTestCase::DoRun (void)
+{
+  LtpSegmentHeader report (LtpSegmentHeader::REPORT);
+  report.SetEngineId (2);
+  report.SetSessionNumber (7);
+  report.SetReportSerial (5);
+  report.SetCheckpointSerial (3);
+  report.SetBounds (1000, 90000);
+  report.AddClaim (0, 4000);
+  report.AddClaim (6000, 80000);
+  report.AddClaim (88000, 2000);
+  Ptr<Packet> p = Segment (report);
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), report.GetSerializedSize (), "wrong serialized size");
+  LtpSegmentHeader received;
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), report.GetSerializedSize (), "wrong decoded size");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) received.GetType (), (uint32_t) LtpSegmentHeader::REPORT, "wrong type");
+  NS_TEST_EXPECT_MSG_EQ (received.GetReportSerial (), 5, "wrong report serial");
+  NS_TEST_EXPECT_MSG_EQ (received.GetCheckpointSerial (), 3, "wrong checkpoint serial");
+  NS_TEST_EXPECT_MSG_EQ (received.GetLowerBound (), 1000, "wrong lower bound");
+  NS_TEST_EXPECT_MSG_EQ (received.GetUpperBound (), 90000, "wrong upper bound");
+  NS_TEST_ASSERT_MSG_EQ (received.GetClaims ().size (), 3, "wrong number of claims");
+  NS_TEST_EXPECT_MSG_EQ (received.GetClaims ()[1].first, 6000, "wrong claim offset");
+  NS_TEST_EXPECT_MSG_EQ (received.GetClaims ()[1].second, 80000, "wrong claim length");
+
+  // decoding a report replaces the claims of the last one
+  p = Segment (report);
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), report.GetSerializedSize (), "wrong decoded size");
+  NS_TEST_EXPECT_MSG_EQ (received.GetClaims ().size (), 3, "claims of two reports added up");
+
+  LtpSegmentHeader ack (LtpSegmentHeader::REPORT_ACK);
+  ack.SetEngineId (2);
+  ack.SetSessionNumber (7);
+  ack.SetReportSerial (5);
+  uint8_t expected[] = { 0x09, 0x02, 0x07, 0x00, 0x05 };
+  p = Segment (ack);
+  NS_TEST_EXPECT_MSG_EQ ((Bytes (p) == std::vector<uint8_t> (expected, expected + sizeof (expected))), true, "wrong report-acknowledgment encoding");
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), sizeof (expected), "wrong decoded size");
+  NS_TEST_EXPECT_MSG_EQ (received.GetReportSerial (), 5, "wrong report serial");
+
+  uint8_t cancels[] = { LtpSegmentHeader::CANCEL_FROM_SENDER, LtpSegmentHeader::CANCEL_FROM_RECEIVER };
+  for (uint32_t k = 0; k < sizeof (cancels); k++)
+    {
+      LtpSegmentHeader cancel (cancels[k]);
+      cancel.SetEngineId (2);
+      cancel.SetSessionNumber (7);
+      cancel.SetReason (LtpSegmentHeader::RLEXC);
+      p = Segment (cancel);
+      NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 5, "wrong cancel segment size");
+      NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), 5, "wrong decoded size");
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t) received.GetReason (), (uint32_t) LtpSegmentHeader::RLEXC, "wrong reason");
+    }
+
+  uint8_t cancelAcks[] = { LtpSegmentHeader::CANCEL_ACK_TO_SENDER, LtpSegmentHeader::CANCEL_ACK_TO_RECEIVER };
+  for (uint32_t k = 0; k < sizeof (cancelAcks); k++)
+    {
+      p = Segment (LtpSegmentHeader (cancelAcks[k]), 10);
+      NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), 4, "cancel acknowledgment with content");
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t) received.GetType (), (uint32_t) cancelAcks[k], "wrong type");
+      NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 10, "bytes after the header taken");
+    }
+}
+
+/**
+ * Segments of another LTP version, of the types that are not used, or
+ * with extensions are rejected.
+ */
+class LtpUnsupportedSegmentTestCase : public TestCase
+{
+public:
+  LtpUnsupportedSegmentTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LtpUnsupportedSegmentTestCase::LtpUnsupportedSegmentTestCase ()
+  : TestCase ("Reject unsupported segments")
+{
+}
+
+void
+LtpUnsupportedSegmentTestCase::DoRun (void)
+{
+  LtpSegmentHeader received;
+  uint8_t version[] = { 0x10, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00 };
+  Ptr<Packet> p = Create<Packet> (version, sizeof (version));
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), 0, "version 1 accepted");
+
+  uint8_t types[] = { 0x05, 0x06, 0x0a, 0x0b };
+  for (uint32_t k = 0; k < sizeof (types); k++)
+    {
+      uint8_t segment[] = { types[k], 0x01, 0x01, 0x00, 0x01, 0x00, 0x00 };
+      p = Create<Packet> (segment, sizeof (segment));
+      NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), 0, "type " << (uint32_t) types[k] << " accepted");
+    }
+
+  // one header extension
+  uint8_t extension[] = { 0x04, 0x01, 0x01, 0x10, 0x00, 0x00, 0x01, 0x00, 0x00 };
+  p = Create<Packet> (extension, sizeof (extension));
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (received), 0, "header extension accepted");
+}
+
+class LtpHeaderTestSuite : public TestSuite
+{
+public:
+  LtpHeaderTestSuite ()
+    : TestSuite ("bp-ltp-header", UNIT)
+  {
+    AddTestCase (new LtpDataSegmentTestCase, TestCase::QUICK);
+    AddTestCase (new LtpSignalSegmentTestCase, TestCase::QUICK);
+    AddTestCase (new LtpUnsupportedSegmentTestCase, TestCase::QUICK);
+  }
+} g_ltpHeaderTestSuite;
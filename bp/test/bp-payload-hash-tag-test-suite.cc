@@ -0,0 +1,218 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-bundle-7.h"
+#include "ns3/bp-bundle-reassembly.h"
+#include "ns3/bp-payload-hash-tag.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+namespace {
+
+const uint32_t ADU_LENGTH = 1000;
+
+/**
+ * \return an ADU of length bytes whose byte i is i plus seed, modulo 256
+ */
+Ptr<Packet>
+Adu (uint32_t length, uint8_t seed)
+{
+  std::vector<uint8_t> data (length);
+  for (uint32_t i = 0; i < length; i++)
+    {
+      data[i] = i + seed;
+    }
+  return Create<Packet> (data.data (), length);
+}
+
+/**
+ * \return a placeholder of adu, tagged with the hash of its bytes as the
+ * sending agent does with virtual payloads
+ */
+Ptr<Packet>
+Virtual (Ptr<const Packet> adu)
+{
+  Ptr<Packet> p = Create<Packet> (adu->GetSize ());
+  p->AddByteTag (BpPayloadHashTag (BpPayloadHashTag::Compute (adu)));
+  return p;
+}
+
+/**
+ * \return the fragment of bundle seqno that carries [offset, offset +
+ * length) of adu
+ */
+Ptr<Bundle7>
+Fragment (uint32_t seqno, Ptr<const Packet> adu, uint32_t offset, uint32_t length)
+{
+  Ptr<Bundle7> fragment = Create<Bundle7> (adu->CreateFragment (offset, length));
+  BpHeader7 *bph = fragment->GetPrimaryHeader ();
+  bph->SetSourceEid (BpEndpointId ("dtn", "source"));
+  bph->SetDestinationEid (BpEndpointId ("dtn", "destination"));
+  bph->SetCreateTimestamp (0);
+  bph->SetSequenceNumber (SequenceNumber32 (seqno));
+  bph->SetLifeTime (Seconds (0));
+  bph->SetIsFragment (true);
+  bph->SetFragOffset (offset);
+  bph->SetAduLength (adu->GetSize ());
+  return fragment;
+}
+
+} // anonymous namespace
+
+/**
+ * The hash depends on the bytes of a packet alone.
+ */
+class BpPayloadHashComputeTestCase : public TestCase
+{
+public:
+  BpPayloadHashComputeTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpPayloadHashComputeTestCase::BpPayloadHashComputeTestCase ()
+  : TestCase ("Hash the bytes of a packet")
+{
+}
+
+void
+BpPayloadHashComputeTestCase::DoRun (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Compute (Adu (ADU_LENGTH, 0)), BpPayloadHashTag::Compute (Adu (ADU_LENGTH, 0)),
+                         "same bytes, different hashes");
+  NS_TEST_EXPECT_MSG_NE (BpPayloadHashTag::Compute (Adu (ADU_LENGTH, 0)), BpPayloadHashTag::Compute (Adu (ADU_LENGTH, 1)),
+                         "different bytes, same hash");
+  NS_TEST_EXPECT_MSG_NE (BpPayloadHashTag::Compute (Adu (ADU_LENGTH, 0)), BpPayloadHashTag::Compute (Adu (ADU_LENGTH - 1, 0)),
+                         "different lengths, same hash");
+
+  // a zero-filled packet hashes as the zero bytes it stands for
+  std::vector<uint8_t> zeros (ADU_LENGTH, 0);
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Compute (Create<Packet> (ADU_LENGTH)),
+                         BpPayloadHashTag::Compute (Create<Packet> (zeros.data (), zeros.size ())),
+                         "zero area hashed differently from zero bytes");
+
+  BpPayloadHashTag tag (0x0123456789abcdefULL);
+  Ptr<Packet> p = Create<Packet> (10);
+  p->AddByteTag (tag);
+  BpPayloadHashTag found;
+  NS_TEST_ASSERT_MSG_EQ (p->FindFirstMatchingByteTag (found), true, "hash tag lost");
+  NS_TEST_EXPECT_MSG_EQ (found.GetHash (), 0x0123456789abcdefULL, "wrong hash read back");
+}
+
+/**
+ * An ADU passes verification if it has no hash tags, or if its hash tags
+ * agree and cover all of it.
+ */
+class BpPayloadHashVerifyTestCase : public TestCase
+{
+public:
+  BpPayloadHashVerifyTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpPayloadHashVerifyTestCase::BpPayloadHashVerifyTestCase ()
+  : TestCase ("Verify the hash tags of an ADU")
+{
+}
+
+void
+BpPayloadHashVerifyTestCase::DoRun (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Verify (Create<Packet> (ADU_LENGTH)), true, "untagged ADU rejected");
+  Ptr<Packet> adu = Virtual (Adu (ADU_LENGTH, 0));
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Verify (adu), true, "tagged ADU rejected");
+
+  // fragments of the same ADU, put together
+  Ptr<Packet> joined = adu->CreateFragment (0, 300);
+  joined->AddAtEnd (adu->CreateFragment (300, 700));
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Verify (joined), true, "fragments of one ADU rejected");
+
+  // a fragment of another ADU of the same length
+  Ptr<Packet> other = Virtual (Adu (ADU_LENGTH, 1));
+  Ptr<Packet> mixed = adu->CreateFragment (0, 300);
+  mixed->AddAtEnd (other->CreateFragment (300, 700));
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Verify (mixed), false, "fragments of two ADUs accepted");
+
+  // bytes without a hash
+  Ptr<Packet> gap = adu->CreateFragment (0, 300);
+  gap->AddAtEnd (Create<Packet> (400));
+  gap->AddAtEnd (adu->CreateFragment (700, 300));
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Verify (gap), false, "ADU with untagged bytes accepted");
+}
+
+/**
+ * Virtual fragments reassembled out of order keep the hash tags of every
+ * fragment.
+ */
+class BpPayloadHashReassemblyTestCase : public TestCase
+{
+public:
+  BpPayloadHashReassemblyTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpPayloadHashReassemblyTestCase::BpPayloadHashReassemblyTestCase ()
+  : TestCase ("Keep hash tags through reassembly of virtual payloads")
+{
+}
+
+void
+BpPayloadHashReassemblyTestCase::DoRun (void)
+{
+  Ptr<Packet> original = Adu (ADU_LENGTH, 0);
+  Ptr<Packet> adu = Virtual (original);
+  Ptr<Packet> other = Virtual (Adu (ADU_LENGTH, 1));
+
+  BundleReassembly reassembly;
+  reassembly.SetVirtualPayload (true);
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (1, adu, 600, 400), Seconds (0)), 0, "incomplete bundle assembled");
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (1, adu, 0, 250), Seconds (0)), 0, "incomplete bundle assembled");
+  Ptr<Packet> whole = reassembly.Add (Fragment (1, adu, 250, 350), Seconds (0));
+  NS_TEST_ASSERT_MSG_NE (whole, 0, "complete bundle not assembled");
+  NS_TEST_EXPECT_MSG_EQ (whole->GetSize (), ADU_LENGTH, "wrong ADU length");
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Verify (whole), true, "reassembled ADU rejected");
+  BpPayloadHashTag tag;
+  NS_TEST_ASSERT_MSG_EQ (whole->FindFirstMatchingByteTag (tag), true, "hash tag lost");
+  NS_TEST_EXPECT_MSG_EQ (tag.GetHash (), BpPayloadHashTag::Compute (original), "wrong hash after reassembly");
+
+  // one fragment of another ADU
+  NS_TEST_EXPECT_MSG_EQ (reassembly.Add (Fragment (2, adu, 0, 500), Seconds (0)), 0, "incomplete bundle assembled");
+  whole = reassembly.Add (Fragment (2, other, 500, 500), Seconds (0));
+  NS_TEST_ASSERT_MSG_NE (whole, 0, "complete bundle not assembled");
+  NS_TEST_EXPECT_MSG_EQ (BpPayloadHashTag::Verify (whole), false, "ADU of mixed fragments accepted");
+}
+
+class BpPayloadHashTagTestSuite : public TestSuite
+{
+public:
+  BpPayloadHashTagTestSuite ()
+    : TestSuite ("bp-payload-hash-tag", UNIT)
+  {
+    AddTestCase (new BpPayloadHashComputeTestCase, TestCase::QUICK);
+    AddTestCase (new BpPayloadHashVerifyTestCase, TestCase::QUICK);
+    AddTestCase (new BpPayloadHashReassemblyTestCase, TestCase::QUICK);
+  }
+} g_bpPayloadHashTagTestSuite;
@@ -0,0 +1,142 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <vector>
+#include "ns3/bp-range-set.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * Overlapping and adjacent ranges merge, and what is new is counted once.
+ */
+class BpRangeSetMergeTestCase : public TestCase
+{
+public:
+  BpRangeSetMergeTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpRangeSetMergeTestCase::BpRangeSetMergeTestCase ()
+  : TestCase ("Merge overlapping and adjacent ranges")
+{
+}
+
+void
+BpRangeSetMergeTestCase::DoRun (void)
+{
+  BpRangeSet set;
+  NS_TEST_EXPECT_MSG_EQ (set.IsEmpty (), true, "new set not empty");
+  NS_TEST_EXPECT_MSG_EQ (set.Add (5, 5), 0, "empty range added");
+  NS_TEST_EXPECT_MSG_EQ (set.Add (10, 20), 10, "wrong count of new values");
+  NS_TEST_EXPECT_MSG_EQ (set.Add (30, 40), 10, "wrong count of new values");
+  NS_TEST_EXPECT_MSG_EQ (set.GetNRanges (), 2, "disjoint ranges merged");
+
+  NS_TEST_EXPECT_MSG_EQ (set.Add (12, 18), 0, "covered range counted");
+  NS_TEST_EXPECT_MSG_EQ (set.Add (20, 25), 5, "wrong count of new values");
+  NS_TEST_EXPECT_MSG_EQ (set.GetNRanges (), 2, "adjacent range not merged");
+
+  // spans the gap and both ranges
+  NS_TEST_EXPECT_MSG_EQ (set.Add (5, 45), 15, "wrong count of new values");
+  NS_TEST_EXPECT_MSG_EQ (set.GetNRanges (), 1, "overlapping ranges not merged");
+  NS_TEST_EXPECT_MSG_EQ (set.GetCovered (), 40, "wrong count of values");
+  NS_TEST_EXPECT_MSG_EQ (set.begin ()->first, 5, "wrong start");
+  NS_TEST_EXPECT_MSG_EQ (set.begin ()->second, 45, "wrong end");
+
+  NS_TEST_EXPECT_MSG_EQ (set.Covers (5, 45), true, "range not covered");
+  NS_TEST_EXPECT_MSG_EQ (set.Covers (4, 10), false, "value before the range covered");
+  NS_TEST_EXPECT_MSG_EQ (set.Covers (40, 46), false, "value after the range covered");
+  NS_TEST_EXPECT_MSG_EQ (set.Covers (50, 50), true, "empty range not covered");
+
+  set.Clear ();
+  NS_TEST_EXPECT_MSG_EQ (set.IsEmpty (), true, "cleared set not empty");
+  NS_TEST_EXPECT_MSG_EQ (set.GetCovered (), 0, "cleared set covers values");
+}
+
+/**
+ * Random ranges give the same set as a bitmap of the values added.
+ */
+class BpRangeSetRandomTestCase : public TestCase
+{
+public:
+  BpRangeSetRandomTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpRangeSetRandomTestCase::BpRangeSetRandomTestCase ()
+  : TestCase ("Agree with a bitmap over random ranges")
+{
+}
+
+void
+BpRangeSetRandomTestCase::DoRun (void)
+{
+  const uint32_t size = 2000;
+  BpRangeSet set;
+  std::vector<bool> bitmap (size, false);
+  uint32_t state = 1;
+  for (uint32_t i = 0; i < 500; i++)
+    {
+      state = state * 1103515245 + 12345;
+      uint32_t start = (state >> 8) % size;
+      state = state * 1103515245 + 12345;
+      uint32_t end = std::min (size, start + (state >> 8) % 40);
+
+      uint32_t fresh = 0;
+      for (uint32_t v = start; v < end; v++)
+        {
+          fresh += bitmap[v] ? 0 : 1;
+          bitmap[v] = true;
+        }
+      NS_TEST_ASSERT_MSG_EQ (set.Add (start, end), fresh, "wrong count of new values adding " << start << " - " << end);
+    }
+
+  uint64_t covered = 0;
+  uint32_t ranges = 0;
+  for (uint32_t v = 0; v < size; v++)
+    {
+      covered += bitmap[v] ? 1 : 0;
+      ranges += (bitmap[v] && (v == 0 || !bitmap[v - 1])) ? 1 : 0;
+      NS_TEST_ASSERT_MSG_EQ (set.Covers (v, v + 1), (bool) bitmap[v], "wrong cover of " << v);
+    }
+  NS_TEST_EXPECT_MSG_EQ (set.GetCovered (), covered, "wrong count of values");
+  NS_TEST_EXPECT_MSG_EQ (set.GetNRanges (), ranges, "ranges not merged");
+
+  uint32_t last = 0;
+  for (BpRangeSet::const_iterator it = set.begin (); it != set.end (); it++)
+    {
+      NS_TEST_ASSERT_MSG_LT (it->first, it->second, "empty range held");
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (it->first, last, "ranges out of order");
+      NS_TEST_ASSERT_MSG_EQ (set.Covers (it->first, it->second), true, "held range not covered");
+      last = it->second + 1;
+    }
+}
+
+class BpRangeSetTestSuite : public TestSuite
+{
+public:
+  BpRangeSetTestSuite ()
+    : TestSuite ("bp-range-set", UNIT)
+  {
+    AddTestCase (new BpRangeSetMergeTestCase, TestCase::QUICK);
+    AddTestCase (new BpRangeSetRandomTestCase, TestCase::QUICK);
+  }
+} g_bpRangeSetTestSuite;
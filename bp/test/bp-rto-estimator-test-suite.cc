@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/nstime.h"
+#include "ns3/bp-rto-estimator.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * The estimate follows RFC 6298: the first sample sets SRTT and half of it
+ * RTTVAR, and later ones are smoothed with gains of 1/8 and 1/4.
+ */
+class BpRtoEstimatorUpdateTestCase : public TestCase
+{
+public:
+  BpRtoEstimatorUpdateTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpRtoEstimatorUpdateTestCase::BpRtoEstimatorUpdateTestCase ()
+  : TestCase ("Smooth round trip samples")
+{
+}
+
+void
+BpRtoEstimatorUpdateTestCase::DoRun (void)
+{
+  BpRtoEstimator est;
+  NS_TEST_EXPECT_MSG_EQ (est.HasSample (), false, "sample out of nothing");
+
+  est.Update (Seconds (4));
+  NS_TEST_EXPECT_MSG_EQ (est.HasSample (), true, "sample not taken");
+  NS_TEST_EXPECT_MSG_EQ (est.GetSrtt (), Seconds (4), "first sample is not the SRTT");
+  // RTTVAR = 2 s
+  NS_TEST_EXPECT_MSG_EQ (est.GetRto (), Seconds (12), "wrong RTO after the first sample");
+
+  est.Update (Seconds (12));
+  // SRTT = (7 * 4 + 12) / 8 = 5 s, RTTVAR = (3 * 2 + 8) / 4 = 3.5 s
+  NS_TEST_EXPECT_MSG_EQ (est.GetSrtt (), Seconds (5), "wrong SRTT");
+  NS_TEST_EXPECT_MSG_EQ (est.GetRto (), Seconds (19), "wrong RTO");
+  NS_TEST_EXPECT_MSG_EQ (est.GetNSamples (), 2, "wrong count of samples");
+
+  // a steady round trip wears the variation down
+  for (uint32_t n = 0; n < 100; n++)
+    {
+      est.Update (Seconds (2));
+    }
+  NS_TEST_EXPECT_MSG_EQ_TOL (est.GetSrtt ().GetSeconds (), 2.0, 0.001, "SRTT does not converge");
+  NS_TEST_EXPECT_MSG_EQ_TOL (est.GetRto ().GetSeconds (), 2.0, 0.001, "variation does not decay");
+}
+
+/**
+ * Under Karn's algorithm retransmitted bundles give no samples, so the
+ * backoff they reach is kept until a bundle sent once is signalled.
+ */
+class BpRtoEstimatorBackoffTestCase : public TestCase
+{
+public:
+  BpRtoEstimatorBackoffTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpRtoEstimatorBackoffTestCase::BpRtoEstimatorBackoffTestCase ()
+  : TestCase ("Keep the backoff until a sample from a bundle sent once")
+{
+}
+
+void
+BpRtoEstimatorBackoffTestCase::DoRun (void)
+{
+  BpRtoEstimator est;
+  est.Update (Seconds (1));
+  NS_TEST_EXPECT_MSG_EQ (est.GetBackoff (), 0, "backoff without retransmissions");
+
+  // a bundle sent three times; its signal is ambiguous and gives no sample
+  est.Backoff (1);
+  est.Backoff (2);
+  NS_TEST_EXPECT_MSG_EQ (est.GetBackoff (), 2, "backoff not kept");
+  est.Backoff (1);
+  NS_TEST_EXPECT_MSG_EQ (est.GetBackoff (), 2, "backoff taken back by an earlier retransmission");
+  NS_TEST_EXPECT_MSG_EQ (est.GetNSamples (), 1, "retransmission taken as a sample");
+  NS_TEST_EXPECT_MSG_EQ (est.GetRto (), Seconds (3), "RTO changed without a sample");
+
+  est.Backoff (1000);
+  NS_TEST_EXPECT_MSG_EQ (est.GetBackoff (), 31, "backoff not bounded");
+
+  // the next bundle sent once
+  est.Update (Seconds (1));
+  NS_TEST_EXPECT_MSG_EQ (est.GetBackoff (), 0, "backoff kept past a sample");
+}
+
+class BpRtoEstimatorTestSuite : public TestSuite
+{
+public:
+  BpRtoEstimatorTestSuite ()
+    : TestSuite ("bp-rto-estimator", UNIT)
+  {
+    AddTestCase (new BpRtoEstimatorUpdateTestCase, TestCase::QUICK);
+    AddTestCase (new BpRtoEstimatorBackoffTestCase, TestCase::QUICK);
+  }
+} g_bpRtoEstimatorTestSuite;
@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-segment-store.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+namespace {
+
+/**
+ * \return a packet of length bytes, each of them value
+ */
+Ptr<Packet>
+Filled (uint8_t value, uint32_t length)
+{
+  std::vector<uint8_t> data (length, value);
+  return Create<Packet> (data.data (), length);
+}
+
+bool
+IsFilled (Ptr<Packet> p, uint8_t value, uint32_t length)
+{
+  std::vector<uint8_t> data (p->GetSize ());
+  p->CopyData (data.data (), data.size ());
+  return data == std::vector<uint8_t> (length, value);
+}
+
+} // anonymous namespace
+
+/**
+ * Payloads are read back as they were appended, a new segment is started
+ * when one is full, and a segment file goes once nothing in it is live.
+ */
+class BpSegmentStoreAppendTestCase : public TestCase
+{
+public:
+  BpSegmentStoreAppendTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpSegmentStoreAppendTestCase::BpSegmentStoreAppendTestCase ()
+  : TestCase ("Append, read and release payloads")
+{
+}
+
+void
+BpSegmentStoreAppendTestCase::DoRun (void)
+{
+  BpSegmentStore store (1000);
+  std::vector<BpSegmentStore::Extent> extents;
+  for (uint32_t n = 0; n < 10; n++)
+    {
+      extents.push_back (store.Append (Filled (n, 300)));
+    }
+  // three to a segment
+  NS_TEST_EXPECT_MSG_EQ (store.GetNSegments (), 4, "wrong number of segments");
+  NS_TEST_EXPECT_MSG_EQ (store.GetFileBytes (), 4000, "wrong size of the segment files");
+  NS_TEST_EXPECT_MSG_EQ (store.GetLiveBytes (), 3000, "wrong live bytes");
+  NS_TEST_EXPECT_MSG_EQ (extents[3].segment, extents[5].segment, "segment not filled");
+  NS_TEST_EXPECT_MSG_NE (extents[2].segment, extents[3].segment, "segment overfilled");
+  for (uint32_t n = 0; n < 10; n++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (IsFilled (store.Read (extents[n]), n, 300), true, "wrong bytes read back for " << n);
+    }
+
+  NS_TEST_EXPECT_MSG_EQ (store.Append (Create<Packet> ()).length, 0, "empty payload kept");
+  BpSegmentStore::Extent large = store.Append (Filled (99, 2500));
+  NS_TEST_EXPECT_MSG_EQ (store.GetFileBytes (), 6500, "large payload not given a segment of its own");
+  NS_TEST_EXPECT_MSG_EQ (IsFilled (store.Read (large), 99, 2500), true, "wrong bytes read back");
+
+  // the first segment, once all of it is dead
+  store.Release (extents[0]);
+  store.Release (extents[1]);
+  NS_TEST_EXPECT_MSG_EQ (store.GetNSegments (), 5, "segment with live data deleted");
+  store.Release (extents[2]);
+  NS_TEST_EXPECT_MSG_EQ (store.GetNSegments (), 4, "dead segment kept");
+  NS_TEST_EXPECT_MSG_EQ (store.GetLiveBytes (), 2100 + 2500, "wrong live bytes");
+  NS_TEST_EXPECT_MSG_EQ (IsFilled (store.Read (extents[3]), 3, 300), true, "wrong bytes read back");
+}
+
+/**
+ * A full segment is sparse once less than half of it is live, and the
+ * store asks for compaction once the dead space in full segments exceeds
+ * the live data in them.
+ */
+class BpSegmentStoreSparseTestCase : public TestCase
+{
+public:
+  BpSegmentStoreSparseTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpSegmentStoreSparseTestCase::BpSegmentStoreSparseTestCase ()
+  : TestCase ("Find sparse segments")
+{
+}
+
+void
+BpSegmentStoreSparseTestCase::DoRun (void)
+{
+  BpSegmentStore store (1000);
+  std::vector<BpSegmentStore::Extent> extents;
+  for (uint32_t n = 0; n < 10; n++)
+    {
+      extents.push_back (store.Append (Filled (n, 300)));
+    }
+
+  store.Release (extents[0]);
+  NS_TEST_EXPECT_MSG_EQ (store.IsSparse (extents[0].segment), false, "segment sparse with most of it live");
+  store.Release (extents[1]);
+  NS_TEST_EXPECT_MSG_EQ (store.IsSparse (extents[0].segment), true, "segment not sparse");
+  NS_TEST_EXPECT_MSG_EQ (store.NeedsCompaction (), false, "compaction with little dead space");
+
+  // the active segment is never sparse
+  store.Release (extents[9]);
+  NS_TEST_EXPECT_MSG_EQ (store.IsSparse (extents[9].segment), false, "active segment sparse");
+
+  store.Release (extents[3]);
+  store.Release (extents[4]);
+  NS_TEST_EXPECT_MSG_EQ (store.NeedsCompaction (), false, "compaction with less dead space than live");
+  store.Release (extents[6]);
+  NS_TEST_EXPECT_MSG_EQ (store.NeedsCompaction (), true, "no compaction with more dead space than live");
+
+  // moving the live payloads of the sparse segments deletes them
+  for (uint32_t n = 2; n < 6; n += 3)
+    {
+      NS_TEST_EXPECT_MSG_EQ (store.IsSparse (extents[n].segment), true, "segment of " << n << " not sparse");
+      BpSegmentStore::Extent moved = store.Append (store.Read (extents[n]));
+      store.Release (extents[n]);
+      extents[n] = moved;
+    }
+  NS_TEST_EXPECT_MSG_EQ (store.IsSparse (extents[7].segment), false, "segment with most of it live sparse");
+  NS_TEST_EXPECT_MSG_EQ (store.NeedsCompaction (), false, "compaction after moving the live data");
+  NS_TEST_EXPECT_MSG_EQ (store.GetNSegments (), 2, "sparse segments kept");
+  NS_TEST_EXPECT_MSG_EQ (store.GetLiveBytes (), 1200, "wrong live bytes");
+  for (uint32_t n = 2; n < 9; n += 3)
+    {
+      NS_TEST_EXPECT_MSG_EQ (IsFilled (store.Read (extents[n]), n, 300), true, "wrong bytes read back for " << n);
+    }
+  NS_TEST_EXPECT_MSG_EQ (IsFilled (store.Read (extents[7]), 7, 300), true, "wrong bytes read back");
+}
+
+class BpSegmentStoreTestSuite : public TestSuite
+{
+public:
+  BpSegmentStoreTestSuite ()
+    : TestSuite ("bp-segment-store", UNIT)
+  {
+    AddTestCase (new BpSegmentStoreAppendTestCase, TestCase::QUICK);
+    AddTestCase (new BpSegmentStoreSparseTestCase, TestCase::QUICK);
+  }
+} g_bpSegmentStoreTestSuite;
@@ -0,0 +1,278 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-tcp-cla.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * A stream socket that takes everything it is sent.
+ */
+class BpTcpTestSocket : public Socket
+{
+public:
+  virtual int Send (Ptr<Packet> p, uint32_t flags) { return p->GetSize (); }
+  virtual uint32_t GetTxAvailable (void) const { return 1 << 30; }
+  virtual SocketType GetSocketType (void) const { return NS3_SOCK_STREAM; }
+
+  virtual SocketErrno GetErrno (void) const { return ERROR_NOTERROR; }
+  virtual Ptr<Node> GetNode (void) const { return 0; }
+  virtual int Bind (const Address &address) { return 0; }
+  virtual int Bind () { return 0; }
+  virtual int Bind6 () { return 0; }
+  virtual int Close (void) { return 0; }
+  virtual int ShutdownSend (void) { return 0; }
+  virtual int ShutdownRecv (void) { return 0; }
+  virtual int Connect (const Address &address) { return 0; }
+  virtual int Listen (void) { return 0; }
+  virtual int SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress) { return Send (p, flags); }
+  virtual uint32_t GetRxAvailable (void) const { return 0; }
+  virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags) { return 0; }
+  virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress) { return 0; }
+  virtual int GetSockName (Address &address) const { return 0; }
+  virtual int GetPeerName (Address &address) const { return 0; }
+  virtual bool SetAllowBroadcast (bool allowBroadcast) { return false; }
+  virtual bool GetAllowBroadcast () const { return false; }
+};
+
+/**
+ * A socket factory that keeps the test sockets it creates, in order.
+ */
+class BpTcpTestSocketFactory : public SocketFactory
+{
+public:
+  static TypeId GetTypeId (void);
+
+  virtual Ptr<Socket> CreateSocket (void);
+
+  std::vector<Ptr<Socket> > m_sockets;
+};
+
+TypeId
+BpTcpTestSocketFactory::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BpTcpTestSocketFactory")
+    .SetParent<SocketFactory> ()
+    .SetGroupName ("Bp")
+  ;
+  return tid;
+}
+
+Ptr<Socket>
+BpTcpTestSocketFactory::CreateSocket (void)
+{
+  Ptr<Socket> socket = CreateObject<BpTcpTestSocket> ();
+  m_sockets.push_back (socket);
+  return socket;
+}
+
+/**
+ * A TCP CLA that connects with the test socket factory, and whose
+ * Transmit () and session queues can be reached directly.
+ */
+class BpTestTcpCla : public BpTcpCla
+{
+public:
+  int Send (Ptr<Socket> socket, Ptr<Packet> bundle) { return Transmit (socket, bundle); }
+  uint64_t GetQueued (Ptr<Socket> socket) const { return GetTxQueueBytes (socket); }
+
+private:
+  virtual TypeId GetSocketTypeId () { return BpTcpTestSocketFactory::GetTypeId (); }
+};
+
+/**
+ * Sessions to one peer over three connections, whose sessions never come
+ * up, so that every bundle stays in the transmit queue of its session.
+ */
+class BpTcpClaPoolTestCase : public TestCase
+{
+public:
+  BpTcpClaPoolTestCase (std::string name, BpTcpCla::PoolPolicy policy);
+
+protected:
+  virtual void DoSetup (void);
+  virtual void DoTeardown (void);
+
+  /**
+   * Pick the session for one bundle and queue the bundle on it.
+   *
+   * \return the socket of the session picked
+   */
+  Ptr<Socket> Queue (uint32_t size);
+
+  /**
+   * \return the number of the socket, in the order the factory created
+   * them
+   */
+  uint32_t Index (Ptr<Socket> socket) const;
+
+  BpTcpCla::PoolPolicy m_policy;
+  Ptr<BpTestTcpCla> m_cla;
+  Ptr<BpTcpTestSocketFactory> m_factory;
+  Ptr<Node> m_node;
+};
+
+BpTcpClaPoolTestCase::BpTcpClaPoolTestCase (std::string name, BpTcpCla::PoolPolicy policy)
+  : TestCase (name),
+    m_policy (policy)
+{
+}
+
+void
+BpTcpClaPoolTestCase::DoSetup (void)
+{
+  m_factory = CreateObject<BpTcpTestSocketFactory> ();
+  m_node = CreateObject<Node> ();
+  m_node->AggregateObject (m_factory);
+  m_cla = CreateObject<BpTestTcpCla> ();
+  m_cla->SetAttribute ("Connections", UintegerValue (3));
+  m_cla->SetAttribute ("PoolPolicy", EnumValue (m_policy));
+  m_cla->SetAttribute ("TxQueueBytes", UintegerValue (0));
+}
+
+void
+BpTcpClaPoolTestCase::DoTeardown (void)
+{
+  m_cla = 0;
+  m_factory = 0;
+  m_node = 0;
+  Simulator::Destroy ();
+}
+
+Ptr<Socket>
+BpTcpClaPoolTestCase::Queue (uint32_t size)
+{
+  BpEndpointId local ("dtn", "local");
+  BpEndpointId remote ("dtn", "remote");
+  Ptr<Socket> socket = m_cla->GetL4Socket (local, remote, InetSocketAddress (Ipv4Address ("10.0.0.2"), 4556), m_node);
+  if (socket != 0)
+    {
+      m_cla->Send (socket, Create<Packet> (size));
+    }
+  return socket;
+}
+
+uint32_t
+BpTcpClaPoolTestCase::Index (Ptr<Socket> socket) const
+{
+  for (uint32_t i = 0; i < m_factory->m_sockets.size (); i++)
+    {
+      if (m_factory->m_sockets[i] == socket)
+        {
+          return i;
+        }
+    }
+  return m_factory->m_sockets.size ();
+}
+
+/**
+ * The pool is opened in full with the first bundle, and its sessions are
+ * used in turn.  A session that ends is replaced with the next bundle.
+ */
+class BpTcpClaRoundRobinTestCase : public BpTcpClaPoolTestCase
+{
+public:
+  BpTcpClaRoundRobinTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpTcpClaRoundRobinTestCase::BpTcpClaRoundRobinTestCase ()
+  : BpTcpClaPoolTestCase ("Use the sessions of a pool in turn, and top the pool up", BpTcpCla::ROUND_ROBIN)
+{
+}
+
+void
+BpTcpClaRoundRobinTestCase::DoRun (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (Index (Queue (1000)), 0, "first session not picked");
+  NS_TEST_EXPECT_MSG_EQ (m_factory->m_sockets.size (), 3, "pool not opened in full");
+  for (uint32_t n = 1; n < 7; n++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (Index (Queue (1000)), n % 3, "bundle " << n << " not on the next session");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_factory->m_sockets.size (), 3, "pool opened again");
+  uint64_t queued = m_cla->GetQueued (m_factory->m_sockets[0]);
+  NS_TEST_EXPECT_MSG_GT (queued, 3000, "bundles not queued on the first session");
+
+  // the second session ends, and the next bundle opens one in its place
+  m_cla->NormalClose (m_factory->m_sockets[1]);
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetQueued (m_factory->m_sockets[1]), 0, "queue of the ended session kept");
+  Ptr<Socket> socket = Queue (1000);
+  NS_TEST_EXPECT_MSG_EQ (m_factory->m_sockets.size (), 4, "pool not topped up");
+  NS_TEST_EXPECT_MSG_NE (Index (socket), 1, "ended session picked");
+  for (uint32_t n = 0; n < 3; n++)
+    {
+      Queue (1000);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_factory->m_sockets.size (), 4, "pool topped up past Connections");
+  NS_TEST_EXPECT_MSG_NE (m_cla->GetQueued (m_factory->m_sockets[3]), 0, "new session not used");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetQueued (m_factory->m_sockets[1]), 0, "ended session used");
+}
+
+/**
+ * Each bundle goes to the session with the fewest bytes queued, the first
+ * of them after the last one picked if several have as few.
+ */
+class BpTcpClaLeastQueuedTestCase : public BpTcpClaPoolTestCase
+{
+public:
+  BpTcpClaLeastQueuedTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpTcpClaLeastQueuedTestCase::BpTcpClaLeastQueuedTestCase ()
+  : BpTcpClaPoolTestCase ("Pick the session of a pool with the fewest bytes queued", BpTcpCla::LEAST_QUEUED)
+{
+}
+
+void
+BpTcpClaLeastQueuedTestCase::DoRun (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (Index (Queue (3000)), 0, "empty sessions not used in turn");
+  NS_TEST_EXPECT_MSG_EQ (Index (Queue (1000)), 1, "empty sessions not used in turn");
+  NS_TEST_EXPECT_MSG_EQ (Index (Queue (2000)), 2, "empty sessions not used in turn");
+  NS_TEST_EXPECT_MSG_EQ (Index (Queue (1000)), 1, "session with the fewest bytes not picked");
+  // the third session now holds fewer bytes than the second
+  NS_TEST_EXPECT_MSG_EQ (Index (Queue (5000)), 2, "session with the fewest bytes not picked");
+  NS_TEST_EXPECT_MSG_EQ (Index (Queue (1000)), 1, "session with the fewest bytes not picked");
+  NS_TEST_EXPECT_MSG_EQ (Index (Queue (1000)), 0, "session with the fewest bytes not picked");
+
+  // a new session in place of an ended one is empty, and picked first
+  m_cla->NormalClose (m_factory->m_sockets[2]);
+  NS_TEST_EXPECT_MSG_EQ (Index (Queue (1000)), 3, "new session not picked");
+  NS_TEST_EXPECT_MSG_EQ (m_factory->m_sockets.size (), 4, "pool not topped up");
+}
+
+class BpTcpClaTestSuite : public TestSuite
+{
+public:
+  BpTcpClaTestSuite ()
+    : TestSuite ("bp-tcp-cla", UNIT)
+  {
+    AddTestCase (new BpTcpClaRoundRobinTestCase, TestCase::QUICK);
+    AddTestCase (new BpTcpClaLeastQueuedTestCase, TestCase::QUICK);
+  }
+} g_bpTcpClaTestSuite;
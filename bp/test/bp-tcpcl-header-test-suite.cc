@@ -0,0 +1,271 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/bp-tcpcl-header.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+namespace {
+
+/**
+ * \return a message of the given type with its fields and data
+ */
+Ptr<Packet>
+Message (uint8_t type, const Header &fields, uint32_t dataLength = 0)
+{
+  Ptr<Packet> p = Create<Packet> (dataLength);
+  p->AddHeader (fields);
+  p->AddHeader (TcpclMessageHeader (type));
+  return p;
+}
+
+std::vector<uint8_t>
+Bytes (Ptr<const Packet> p)
+{
+  std::vector<uint8_t> data (p->GetSize ());
+  p->CopyData (data.data (), data.size ());
+  return data;
+}
+
+} // anonymous namespace
+
+/**
+ * The contact header is "dtn!", the version and the flags, and a header
+ * without the magic is not valid.
+ */
+class TcpclContactHeaderTestCase : public TestCase
+{
+public:
+  TcpclContactHeaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+TcpclContactHeaderTestCase::TcpclContactHeaderTestCase ()
+  : TestCase ("Encode and decode the contact header")
+{
+}
+
+void
+TcpclContactHeaderTestCase::DoRun (void)
+{
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (TcpclContactHeader ());
+  uint8_t expected[] = { 'd', 't', 'n', '!', 4, 0 };
+  NS_TEST_EXPECT_MSG_EQ ((Bytes (p) == std::vector<uint8_t> (expected, expected + sizeof (expected))), true, "wrong contact header");
+
+  TcpclContactHeader contact;
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (contact), 6, "wrong decoded size");
+  NS_TEST_EXPECT_MSG_EQ (contact.IsValid (), true, "contact header not valid");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) contact.GetVersion (), 4, "wrong version");
+
+  // e.g. an HTTP request to the TCPCL port
+  uint8_t other[] = { 'G', 'E', 'T', ' ', '/', ' ' };
+  p = Create<Packet> (other, sizeof (other));
+  p->RemoveHeader (contact);
+  NS_TEST_EXPECT_MSG_EQ (contact.IsValid (), false, "contact header without the magic valid");
+}
+
+/**
+ * The fields of each message decode to what they were encoded from.
+ */
+class TcpclMessageCodingTestCase : public TestCase
+{
+public:
+  TcpclMessageCodingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+TcpclMessageCodingTestCase::TcpclMessageCodingTestCase ()
+  : TestCase ("Encode and decode messages")
+{
+}
+
+void
+TcpclMessageCodingTestCase::DoRun (void)
+{
+  TcpclSessInitHeader init;
+  init.SetKeepalive (30);
+  init.SetSegmentMru (100000);
+  init.SetTransferMru (0x100000000ULL);
+  init.SetNodeId ("ipn:7.0");
+  Ptr<Packet> p = Message (TcpclMessageHeader::SESS_INIT, init);
+  // type, keepalive, two MRUs, node ID length and bytes, extension length
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 1 + 2 + 8 + 8 + 2 + 7 + 4, "wrong SESS_INIT length");
+  TcpclMessageHeader type;
+  p->RemoveHeader (type);
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) type.GetType (), TcpclMessageHeader::SESS_INIT, "wrong type");
+  TcpclSessInitHeader decodedInit;
+  p->RemoveHeader (decodedInit);
+  NS_TEST_EXPECT_MSG_EQ (decodedInit.GetKeepalive (), 30, "wrong keepalive");
+  NS_TEST_EXPECT_MSG_EQ (decodedInit.GetSegmentMru (), 100000, "wrong segment MRU");
+  NS_TEST_EXPECT_MSG_EQ (decodedInit.GetTransferMru (), 0x100000000ULL, "wrong transfer MRU");
+  NS_TEST_EXPECT_MSG_EQ (decodedInit.GetNodeId (), "ipn:7.0", "wrong node ID");
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 0, "SESS_INIT not decoded to its end");
+
+  // only the first segment of a transfer has extension items
+  for (uint8_t flags = 0; flags < 4; flags++)
+    {
+      TcpclXferSegmentHeader segment;
+      segment.SetFlags (flags);
+      segment.SetTransferId (0x0102030405060708ULL);
+      segment.SetDataLength (500);
+      p = Message (TcpclMessageHeader::XFER_SEGMENT, segment, 500);
+      uint32_t length = (flags & TcpclXferSegmentHeader::START) ? 22 : 18;
+      NS_TEST_EXPECT_MSG_EQ (p->GetSize (), length + 500, "wrong XFER_SEGMENT length with flags " << (uint32_t) flags);
+      p->RemoveHeader (type);
+      TcpclXferSegmentHeader decoded;
+      p->RemoveHeader (decoded);
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t) decoded.GetFlags (), (uint32_t) flags, "wrong flags");
+      NS_TEST_EXPECT_MSG_EQ (decoded.GetTransferId (), 0x0102030405060708ULL, "wrong transfer ID");
+      NS_TEST_EXPECT_MSG_EQ (decoded.GetDataLength (), 500, "wrong data length");
+      NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 500, "segment data not left");
+    }
+
+  TcpclXferAckHeader ack;
+  ack.SetFlags (TcpclXferSegmentHeader::END);
+  ack.SetTransferId (9);
+  ack.SetAckLength (123456);
+  p = Message (TcpclMessageHeader::XFER_ACK, ack);
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 18, "wrong XFER_ACK length");
+  p->RemoveHeader (type);
+  TcpclXferAckHeader decodedAck;
+  p->RemoveHeader (decodedAck);
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) decodedAck.GetFlags (), TcpclXferSegmentHeader::END, "wrong flags");
+  NS_TEST_EXPECT_MSG_EQ (decodedAck.GetTransferId (), 9, "wrong transfer ID");
+  NS_TEST_EXPECT_MSG_EQ (decodedAck.GetAckLength (), 123456, "wrong acknowledged length");
+
+  p = Message (TcpclMessageHeader::XFER_REFUSE, TcpclXferRefuseHeader (TcpclXferRefuseHeader::NO_RESOURCES, 11));
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 10, "wrong XFER_REFUSE length");
+  p->RemoveHeader (type);
+  TcpclXferRefuseHeader refuse;
+  p->RemoveHeader (refuse);
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) refuse.GetReason (), TcpclXferRefuseHeader::NO_RESOURCES, "wrong reason");
+  NS_TEST_EXPECT_MSG_EQ (refuse.GetTransferId (), 11, "wrong transfer ID");
+
+  p = Message (TcpclMessageHeader::SESS_TERM, TcpclSessTermHeader (TcpclSessTermHeader::REPLY, TcpclSessTermHeader::IDLE_TIMEOUT));
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 3, "wrong SESS_TERM length");
+  p->RemoveHeader (type);
+  TcpclSessTermHeader term;
+  p->RemoveHeader (term);
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) term.GetFlags (), TcpclSessTermHeader::REPLY, "wrong flags");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) term.GetReason (), TcpclSessTermHeader::IDLE_TIMEOUT, "wrong reason");
+
+  p = Message (TcpclMessageHeader::MSG_REJECT, TcpclMsgRejectHeader (TcpclMsgRejectHeader::TYPE_UNKNOWN, 0x42));
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 3, "wrong MSG_REJECT length");
+  p->RemoveHeader (type);
+  TcpclMsgRejectHeader reject;
+  p->RemoveHeader (reject);
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) reject.GetReason (), TcpclMsgRejectHeader::TYPE_UNKNOWN, "wrong reason");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) reject.GetRejectedType (), 0x42, "wrong rejected type");
+}
+
+/**
+ * The length of the message at the start of a receive buffer is known
+ * once enough of it has arrived, and is never mistaken before that.
+ */
+class TcpclMessageLengthTestCase : public TestCase
+{
+public:
+  TcpclMessageLengthTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CheckLength (Ptr<const Packet> message, std::string name);
+};
+
+TcpclMessageLengthTestCase::TcpclMessageLengthTestCase ()
+  : TestCase ("Find the length of received messages")
+{
+}
+
+void
+TcpclMessageLengthTestCase::CheckLength (Ptr<const Packet> message, std::string name)
+{
+  uint32_t length = message->GetSize ();
+  for (uint32_t n = 1; n < length; n++)
+    {
+      uint64_t found = TcpclMessageHeader::GetMessageLength (message->CreateFragment (0, n));
+      NS_TEST_ASSERT_MSG_EQ ((found == 0 || found == length), true, "wrong length of " << name << " from " << n << " bytes");
+    }
+  NS_TEST_EXPECT_MSG_EQ (TcpclMessageHeader::GetMessageLength (message), length, "wrong length of " << name);
+  // with the start of the next message behind it
+  Ptr<Packet> buffer = message->Copy ();
+  Ptr<Packet> next = Create<Packet> ();
+  next->AddHeader (TcpclMessageHeader (TcpclMessageHeader::KEEPALIVE));
+  buffer->AddAtEnd (next);
+  NS_TEST_EXPECT_MSG_EQ (TcpclMessageHeader::GetMessageLength (buffer), length, "wrong length of " << name << " with more bytes");
+}
+
+void
+TcpclMessageLengthTestCase::DoRun (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (TcpclMessageHeader::GetMessageLength (Create<Packet> ()), 0, "length of nothing");
+
+  TcpclSessInitHeader init;
+  init.SetNodeId ("dtn://node-with-a-long-name/");
+  CheckLength (Message (TcpclMessageHeader::SESS_INIT, init), "SESS_INIT");
+
+  TcpclXferSegmentHeader segment;
+  segment.SetFlags (TcpclXferSegmentHeader::START | TcpclXferSegmentHeader::END);
+  segment.SetDataLength (40);
+  CheckLength (Message (TcpclMessageHeader::XFER_SEGMENT, segment, 40), "a whole transfer");
+  segment.SetFlags (0);
+  CheckLength (Message (TcpclMessageHeader::XFER_SEGMENT, segment, 40), "a middle segment");
+  CheckLength (Message (TcpclMessageHeader::XFER_ACK, TcpclXferAckHeader ()), "XFER_ACK");
+  CheckLength (Message (TcpclMessageHeader::XFER_REFUSE, TcpclXferRefuseHeader ()), "XFER_REFUSE");
+  CheckLength (Message (TcpclMessageHeader::SESS_TERM, TcpclSessTermHeader ()), "SESS_TERM");
+  CheckLength (Message (TcpclMessageHeader::MSG_REJECT, TcpclMsgRejectHeader ()), "MSG_REJECT");
+  Ptr<Packet> keepalive = Create<Packet> ();
+  keepalive->AddHeader (TcpclMessageHeader (TcpclMessageHeader::KEEPALIVE));
+  CheckLength (keepalive, "KEEPALIVE");
+
+  // extension items of a peer are counted and skipped
+  uint8_t withItems[] = { TcpclMessageHeader::XFER_SEGMENT, TcpclXferSegmentHeader::START, 0, 0, 0, 0, 0, 0, 0, 5,
+                          0, 0, 0, 3, 0xaa, 0xbb, 0xcc,
+                          0, 0, 0, 0, 0, 0, 0, 2, 'h', 'i' };
+  Ptr<Packet> p = Create<Packet> (withItems, sizeof (withItems));
+  CheckLength (p, "a segment with extension items");
+  TcpclMessageHeader type;
+  p->RemoveHeader (type);
+  TcpclXferSegmentHeader decoded;
+  p->RemoveHeader (decoded);
+  NS_TEST_EXPECT_MSG_EQ (decoded.GetTransferId (), 5, "wrong transfer ID");
+  NS_TEST_EXPECT_MSG_EQ (decoded.GetDataLength (), 2, "extension items not skipped");
+  NS_TEST_EXPECT_MSG_EQ (p->GetSize (), 2, "extension items not skipped");
+
+  uint8_t unknown[] = { 0x99, 0, 0, 0 };
+  NS_TEST_EXPECT_MSG_EQ (TcpclMessageHeader::GetMessageLength (Create<Packet> (unknown, sizeof (unknown))), 0, "length of an unknown type");
+}
+
+class TcpclHeaderTestSuite : public TestSuite
+{
+public:
+  TcpclHeaderTestSuite ()
+    : TestSuite ("bp-tcpcl-header", UNIT)
+  {
+    AddTestCase (new TcpclContactHeaderTestCase, TestCase::QUICK);
+    AddTestCase (new TcpclMessageCodingTestCase, TestCase::QUICK);
+    AddTestCase (new TcpclMessageLengthTestCase, TestCase::QUICK);
+  }
+} g_tcpclHeaderTestSuite;
@@ -0,0 +1,549 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-cla.h"
+#include "ns3/bp-ltp-cla.h"
+#include "ns3/bp-agent-6.h"
+#include "ns3/bp-agent-7.h"
+#include "ns3/bp-header-6.h"
+#include "ns3/bp-admin-record.h"
+#include "ns3/bp-custody-signal.h"
+#include "ns3/bp-static-routing-agent.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * A socket that keeps what it is sent.  A stream socket has room for
+ * bufferSize bytes until the peer acknowledges them, a datagram socket
+ * takes each packet unless it is set to refuse them.
+ */
+class BpTestSocket : public Socket
+{
+public:
+  BpTestSocket (SocketType type, uint32_t bufferSize);
+
+  /**
+   * Free the room of bytes acknowledged by the peer.
+   */
+  void Ack (uint32_t bytes);
+
+  virtual int Send (Ptr<Packet> p, uint32_t flags);
+  virtual uint32_t GetTxAvailable (void) const;
+  virtual SocketType GetSocketType (void) const;
+
+  virtual SocketErrno GetErrno (void) const { return m_refuse ? ERROR_AGAIN : ERROR_NOTERROR; }
+  virtual Ptr<Node> GetNode (void) const { return 0; }
+  virtual int Bind (const Address &address) { return 0; }
+  virtual int Bind () { return 0; }
+  virtual int Bind6 () { return 0; }
+  virtual int Close (void) { return 0; }
+  virtual int ShutdownSend (void) { return 0; }
+  virtual int ShutdownRecv (void) { return 0; }
+  virtual int Connect (const Address &address) { return 0; }
+  virtual int Listen (void) { return 0; }
+  virtual int SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress) { return Send (p, flags); }
+  virtual uint32_t GetRxAvailable (void) const { return 0; }
+  virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags) { return 0; }
+  virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress) { return 0; }
+  virtual int GetSockName (Address &address) const { return 0; }
+  virtual int GetPeerName (Address &address) const { return 0; }
+  virtual bool SetAllowBroadcast (bool allowBroadcast) { return false; }
+  virtual bool GetAllowBroadcast () const { return false; }
+
+  bool m_refuse;                 /// refuse datagrams
+  uint32_t m_sends;              /// calls of Send ()
+  std::vector<uint8_t> m_bytes;  /// bytes taken, in order
+
+private:
+  SocketType m_type;
+  uint32_t m_bufferSize;
+  uint32_t m_buffered;
+};
+
+BpTestSocket::BpTestSocket (SocketType type, uint32_t bufferSize)
+  : m_refuse (false),
+    m_sends (0),
+    m_type (type),
+    m_bufferSize (bufferSize),
+    m_buffered (0)
+{
+}
+
+void
+BpTestSocket::Ack (uint32_t bytes)
+{
+  m_buffered -= std::min (bytes, m_buffered);
+}
+
+int
+BpTestSocket::Send (Ptr<Packet> p, uint32_t flags)
+{
+  m_sends++;
+  if (m_type == NS3_SOCK_STREAM ? p->GetSize () > GetTxAvailable () : m_refuse)
+    {
+      return -1;
+    }
+  std::vector<uint8_t> data (p->GetSize ());
+  p->CopyData (data.data (), data.size ());
+  m_bytes.insert (m_bytes.end (), data.begin (), data.end ());
+  if (m_type == NS3_SOCK_STREAM)
+    {
+      m_buffered += p->GetSize ();
+    }
+  return p->GetSize ();
+}
+
+uint32_t
+BpTestSocket::GetTxAvailable (void) const
+{
+  return m_bufferSize - m_buffered;
+}
+
+Socket::SocketType
+BpTestSocket::GetSocketType (void) const
+{
+  return m_type;
+}
+
+/**
+ * A CLA that sends everything on one test socket.
+ */
+class BpTestCla : public BpCla
+{
+public:
+  BpTestCla (Ptr<BpTestSocket> socket);
+
+  int Queue (Ptr<Packet> p) { return Enqueue (m_socket, p); }
+  void Hold (bool hold) { HoldTxQueue (m_socket, hold); }
+
+  /**
+   * Let the peer acknowledge bytes, and tell the CLA the socket has room.
+   */
+  void Ack (uint32_t bytes);
+
+  virtual int EnableReceive (const BpEndpointId &local, InetSocketAddress localAddress, Ptr<Node> bpNode) { return 0; }
+  virtual Ptr<Socket> GetL4Socket (const BpEndpointId &src, const BpEndpointId &dst, InetSocketAddress dstAddress, Ptr<Node> bpNode) { return m_socket; }
+
+  Ptr<BpTestSocket> m_socket;
+
+protected:
+  virtual void SetL4SocketCallbacks (Ptr<Socket> socket) {}
+  virtual TypeId GetSocketTypeId () { return UdpSocketFactory::GetTypeId (); }
+};
+
+BpTestCla::BpTestCla (Ptr<BpTestSocket> socket)
+  : BpCla (MakeNullCallback<void, Ptr<Bundle> > ()),
+    m_socket (socket)
+{
+}
+
+void
+BpTestCla::Ack (uint32_t bytes)
+{
+  m_socket->Ack (bytes);
+  Sent (m_socket, m_socket->GetTxAvailable ());
+}
+
+/**
+ * An LTP CLA whose Transmit () can be called directly.
+ */
+class BpTestLtpCla : public BpLtpCla
+{
+public:
+  int Send (Ptr<Socket> socket, Ptr<Packet> bundle) { return Transmit (socket, bundle); }
+};
+
+namespace {
+
+/**
+ * \return a packet of length bytes, each of them value
+ */
+Ptr<Packet>
+Filled (uint8_t value, uint32_t length)
+{
+  std::vector<uint8_t> data (length, value);
+  return Create<Packet> (data.data (), length);
+}
+
+} // anonymous namespace
+
+/**
+ * Bundles wait in the transmit queue while a stream socket is full, are
+ * sent in order as the socket has room, and the CLA is not ready while the
+ * queue holds TxQueueBytes or more.
+ */
+class BpTxQueueStreamTestCase : public TestCase
+{
+public:
+  BpTxQueueStreamTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Ready (Ptr<BpCla> cla);
+
+  uint32_t m_ready;
+};
+
+BpTxQueueStreamTestCase::BpTxQueueStreamTestCase ()
+  : TestCase ("Queue bundles behind a full stream socket"),
+    m_ready (0)
+{
+}
+
+void
+BpTxQueueStreamTestCase::Ready (Ptr<BpCla> cla)
+{
+  m_ready++;
+}
+
+void
+BpTxQueueStreamTestCase::DoRun (void)
+{
+  Ptr<BpTestSocket> socket = CreateObject<BpTestSocket> (Socket::NS3_SOCK_STREAM, 3000);
+  Ptr<BpTestCla> cla = CreateObject<BpTestCla> (socket);
+  cla->SetAttribute ("TxQueueBytes", UintegerValue (5000));
+  cla->SetReady (true);
+  cla->SetReadyCallback (MakeCallback (&BpTxQueueStreamTestCase::Ready, this));
+
+  for (uint32_t n = 0; n < 7; n++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (cla->Queue (Filled (n, 1000)), 0, "packet " << n << " refused");
+    }
+  NS_TEST_EXPECT_MSG_EQ (socket->m_bytes.size (), 3000, "socket not filled");
+  NS_TEST_EXPECT_MSG_EQ (cla->GetTxQueueBytes (), 4000, "wrong bytes queued");
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), true, "not ready below TxQueueBytes");
+  cla->Queue (Filled (7, 1000));
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), false, "ready with a full queue");
+
+  // the socket takes one packet and the part of another it has room for
+  cla->Ack (1500);
+  NS_TEST_EXPECT_MSG_EQ (socket->m_bytes.size (), 4500, "socket not filled again");
+  NS_TEST_EXPECT_MSG_EQ (cla->GetTxQueueBytes (), 3500, "wrong bytes queued");
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), true, "not ready again as the queue drains");
+  NS_TEST_EXPECT_MSG_EQ (m_ready, 1, "ready callback not called once");
+
+  for (uint32_t n = 0; n < 10 && cla->GetTxQueueBytes () != 0; n++)
+    {
+      cla->Ack (3000);
+    }
+  NS_TEST_ASSERT_MSG_EQ (socket->m_bytes.size (), 8000, "queue not drained");
+  for (uint32_t i = 0; i < 8000; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t) socket->m_bytes[i], i / 1000, "byte " << i << " out of order");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_ready, 1, "ready callback called without a change");
+
+  // a held queue is not sent, but counts against TxQueueBytes
+  cla->Ack (3000);
+  cla->Hold (true);
+  for (uint32_t n = 0; n < 5; n++)
+    {
+      cla->Queue (Filled (n, 1000));
+    }
+  NS_TEST_EXPECT_MSG_EQ (socket->m_bytes.size (), 8000, "held queue sent");
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), false, "ready with a full held queue");
+  cla->Hold (false);
+  NS_TEST_EXPECT_MSG_EQ (socket->m_bytes.size (), 11000, "queue not sent once let go");
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), true, "not ready again");
+  NS_TEST_EXPECT_MSG_EQ (m_ready, 2, "ready callback not called");
+
+  // closing the socket drops its queue
+  for (uint32_t n = 0; n < 3; n++)
+    {
+      cla->Queue (Filled (n, 1000));
+    }
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), false, "ready with a full queue");
+  cla->NormalClose (socket);
+  NS_TEST_EXPECT_MSG_EQ (cla->GetTxQueueBytes (), 0, "queue of a closed socket kept");
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), true, "not ready after the queue was dropped");
+  NS_TEST_EXPECT_MSG_EQ (m_ready, 3, "ready callback not called");
+}
+
+/**
+ * A datagram socket takes or refuses each packet at once, and a refusal is
+ * returned to the sender.
+ */
+class BpTxQueueDatagramTestCase : public TestCase
+{
+public:
+  BpTxQueueDatagramTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpTxQueueDatagramTestCase::BpTxQueueDatagramTestCase ()
+  : TestCase ("Return the refusal of a datagram")
+{
+}
+
+void
+BpTxQueueDatagramTestCase::DoRun (void)
+{
+  Ptr<BpTestSocket> socket = CreateObject<BpTestSocket> (Socket::NS3_SOCK_DGRAM, 0);
+  Ptr<BpTestCla> cla = CreateObject<BpTestCla> (socket);
+  cla->SetReady (true);
+
+  NS_TEST_EXPECT_MSG_EQ (cla->Queue (Filled (1, 1000)), 0, "datagram refused");
+  NS_TEST_EXPECT_MSG_EQ (socket->m_bytes.size (), 1000, "datagram not sent");
+  socket->m_refuse = true;
+  NS_TEST_EXPECT_MSG_EQ (cla->Queue (Filled (2, 1000)), -1, "refused datagram taken");
+  NS_TEST_EXPECT_MSG_EQ (cla->GetTxQueueBytes (), 0, "refused datagram queued");
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), true, "refusal took the CLA out of contact");
+}
+
+/**
+ * A bundle that a CLA refuses while staying ready gets no ready callback,
+ * so the agent forwards it again after the SendRetryInterval until the
+ * CLA takes it.
+ */
+class BpTxQueueRetryTestCase : public TestCase
+{
+public:
+  BpTxQueueRetryTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Accept (Ptr<BpTestSocket> socket);
+};
+
+BpTxQueueRetryTestCase::BpTxQueueRetryTestCase ()
+  : TestCase ("Forward a refused bundle again while the CLA stays ready")
+{
+}
+
+void
+BpTxQueueRetryTestCase::Accept (Ptr<BpTestSocket> socket)
+{
+  socket->m_refuse = false;
+}
+
+void
+BpTxQueueRetryTestCase::DoRun (void)
+{
+  BpEndpointId local ("dtn", "local");
+  BpEndpointId remote ("dtn", "remote");
+  Ptr<BpTestSocket> socket = CreateObject<BpTestSocket> (Socket::NS3_SOCK_DGRAM, 0);
+  socket->m_refuse = true;
+  Ptr<BpTestCla> cla = CreateObject<BpTestCla> (socket);
+  cla->SetReady (true);
+
+  Ptr<BpAgent7> agent = CreateObject<BpAgent7> ();
+  agent->SetAttribute ("BundleSize", UintegerValue (0));
+  agent->SetAttribute ("SendRetryInterval", TimeValue (Seconds (2)));
+  agent->AddCla (cla);
+  Ptr<BpStaticRoutingAgent> routing = CreateObject<BpStaticRoutingAgent> ();
+  routing->AddRoute (remote, remote, true, Ipv4Address ("10.0.0.2"), 4556, cla);
+  agent->SetRoutingAgent (routing);
+  agent->SetBpEndpointId (local);
+  BpRegisterInfo info;
+  agent->Register (local, info);
+
+  NS_TEST_EXPECT_MSG_EQ (agent->Send (Create<Packet> (100), local, remote), 0, "bundle not sent");
+  NS_TEST_EXPECT_MSG_EQ (socket->m_sends, 1, "bundle not given to the socket");
+  NS_TEST_EXPECT_MSG_NE (agent->GetStoredByteCount (), 0, "refused bundle not kept");
+
+  // refused again at 2 s, taken at 4 s
+  Simulator::Schedule (Seconds (3), &BpTxQueueRetryTestCase::Accept, this, socket);
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (socket->m_sends, 3, "wrong number of attempts");
+  NS_TEST_EXPECT_MSG_NE (socket->m_bytes.size (), 0, "bundle never sent");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetStoredByteCount (), 0, "sent bundle kept");
+  Simulator::Destroy ();
+}
+
+/**
+ * A custody bundle its CLA refuses is not counted as a custody
+ * retransmission: the round trip estimate is not backed off by the
+ * refusals, and the custody signal for the bundle once taken still gives
+ * a round trip sample.
+ */
+class BpTxQueueCustodyTestCase : public TestCase
+{
+public:
+  BpTxQueueCustodyTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Accept (Ptr<BpTestSocket> socket);
+};
+
+BpTxQueueCustodyTestCase::BpTxQueueCustodyTestCase ()
+  : TestCase ("Do not back off custody transfer for bundles the CLA refused")
+{
+}
+
+void
+BpTxQueueCustodyTestCase::Accept (Ptr<BpTestSocket> socket)
+{
+  socket->m_refuse = false;
+}
+
+void
+BpTxQueueCustodyTestCase::DoRun (void)
+{
+  BpEndpointId local ("dtn", "local");
+  BpEndpointId remote ("dtn", "remote");
+  Ptr<BpTestSocket> socket = CreateObject<BpTestSocket> (Socket::NS3_SOCK_DGRAM, 0);
+  socket->m_refuse = true;
+  Ptr<BpTestCla> cla = CreateObject<BpTestCla> (socket);
+  cla->SetReady (true);
+
+  Ptr<BpAgent6> agent = CreateObject<BpAgent6> ();
+  agent->SetAttribute ("BundleSize", UintegerValue (0));
+  agent->SetAttribute ("SendRetryInterval", TimeValue (Seconds (1)));
+  agent->SetAttribute ("CustodyTransferRto", TimeValue (Seconds (10)));
+  agent->SetAttribute ("CustodyTransferRtoMin", TimeValue (Seconds (1)));
+  agent->SetAttribute ("CustodyTransferRtoMax", TimeValue (Seconds (60)));
+  agent->AddCla (cla);
+  Ptr<BpStaticRoutingAgent> routing = CreateObject<BpStaticRoutingAgent> ();
+  routing->AddRoute (remote, remote, true, Ipv4Address ("10.0.0.2"), 4556, cla);
+  agent->SetRoutingAgent (routing);
+  agent->SetBpEndpointId (local);
+  BpRegisterInfo info;
+  agent->Register (local, info);
+  Time rto = agent->GetCustodyRto (remote, 0);
+
+  // refused at 0, 1, 2 and 3 s, taken at 4 s
+  NS_TEST_EXPECT_MSG_EQ (agent->Send (Create<Packet> (100), local, remote, Seconds (100), true), 0, "bundle not sent");
+  Simulator::Schedule (MilliSeconds (3500), &BpTxQueueCustodyTestCase::Accept, this, socket);
+  Simulator::Stop (MilliSeconds (4500));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (socket->m_sends, 5, "wrong number of attempts");
+  NS_TEST_ASSERT_MSG_NE (socket->m_bytes.size (), 0, "bundle never sent");
+  NS_TEST_EXPECT_MSG_EQ (agent->GetCustodyRto (remote, 0), rto, "refusals backed off the custody RTO");
+  NS_TEST_EXPECT_MSG_NE (agent->GetStoredByteCount (), 0, "custody bundle not kept");
+
+  // the next hop takes custody 1.5 s after the bundle was taken
+  Ptr<Packet> sent = Create<Packet> (socket->m_bytes.data (), socket->m_bytes.size ());
+  BpHeader6 header;
+  sent->RemoveHeader (header);
+  CustodySignal cs;
+  cs.status = _BP_CS_SUCCEEDED;
+  cs.fragmentOffset = 0;
+  cs.fragmentLength = 0;
+  cs.timeOfSignal = Seconds (5);
+  cs.creationTimestamp = header.GetCreateTimestamp ();
+  cs.seqNo = header.GetSequenceNumber ();
+  cs.srcEidLen = local.Uri ().length ();
+  cs.srcEid = local.Uri ();
+  AdminRecord ar;
+  ar.typeFlags = _BP_AR_CS<<4;
+  Ptr<Packet> s = Create<Packet> ();
+  s->AddHeader (cs);
+  s->AddHeader (ar);
+  Ptr<Bundle6> signal = Create<Bundle6> (s);
+  BpHeader6 *sh = signal->GetPrimaryHeader ();
+  sh->SetSourceEid (remote);
+  sh->SetDestinationEid (local);
+  sh->SetIsAdmin (true);
+  sh->SetCreateTimestamp (5);
+  sh->SetLifeTime (Seconds (100));
+  sh->SetAduLength (s->GetSize ());
+  Simulator::Schedule (Seconds (1), &BpAgent::ProcessBundle, agent, signal);
+  Simulator::Stop (Seconds (1.5));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (agent->GetStoredByteCount (), 0, "custody not released");
+  NS_TEST_EXPECT_MSG_EQ (socket->m_sends, 5, "bundle sent again");
+  NS_TEST_EXPECT_MSG_NE (agent->GetCustodyRto (remote, 0), rto, "no round trip sample taken");
+  Simulator::Destroy ();
+}
+
+/**
+ * The segments an LTP CLA paces out at DataRate count against
+ * TxQueueBytes, and the CLA is ready again as they leave.
+ */
+class BpTxQueueLtpTestCase : public TestCase
+{
+public:
+  BpTxQueueLtpTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Ready (Ptr<BpCla> cla);
+
+  uint32_t m_ready;
+};
+
+BpTxQueueLtpTestCase::BpTxQueueLtpTestCase ()
+  : TestCase ("Stop taking bundles while LTP segments wait for DataRate"),
+    m_ready (0)
+{
+}
+
+void
+BpTxQueueLtpTestCase::Ready (Ptr<BpCla> cla)
+{
+  m_ready++;
+}
+
+void
+BpTxQueueLtpTestCase::DoRun (void)
+{
+  Ptr<BpTestSocket> socket = CreateObject<BpTestSocket> (Socket::NS3_SOCK_DGRAM, 0);
+  Ptr<BpTestLtpCla> cla = CreateObject<BpTestLtpCla> ();
+  cla->SetAttribute ("TxQueueBytes", UintegerValue (5000));
+  cla->SetAttribute ("SegmentSize", UintegerValue (1000));
+  cla->SetAttribute ("RedPartLength", UintegerValue (0));
+  cla->SetReady (true);
+  cla->SetReadyCallback (MakeCallback (&BpTxQueueLtpTestCase::Ready, this));
+
+  // the first segment leaves at once
+  NS_TEST_EXPECT_MSG_EQ (cla->Send (socket, Filled (1, 3000)), 0, "bundle refused");
+  NS_TEST_EXPECT_MSG_EQ (socket->m_sends, 1, "first segment not sent");
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), true, "not ready below TxQueueBytes");
+  cla->Send (socket, Filled (2, 3000));
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), false, "ready with a full paced queue");
+  uint64_t waiting = cla->GetOutgoingBytes ();
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (waiting, 5000, "wrong bytes waiting");
+
+  // one more segment out, some 8 ms later at the default 1 Mb/s, takes
+  // the queue below the limit
+  Simulator::Stop (MilliSeconds (9));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (socket->m_sends, 2, "segment not paced");
+  NS_TEST_EXPECT_MSG_LT (cla->GetOutgoingBytes (), waiting, "queue not drained");
+  NS_TEST_EXPECT_MSG_EQ (cla->IsReady (), true, "not ready again as the queue drains");
+  NS_TEST_EXPECT_MSG_EQ (m_ready, 1, "ready callback not called once");
+
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (socket->m_sends, 6, "segments not all sent");
+  NS_TEST_EXPECT_MSG_EQ (cla->GetOutgoingBytes (), 0, "queue not empty");
+  NS_TEST_EXPECT_MSG_EQ (m_ready, 1, "ready callback called without a change");
+  Simulator::Destroy ();
+}
+
+class BpTxQueueTestSuite : public TestSuite
+{
+public:
+  BpTxQueueTestSuite ()
+    : TestSuite ("bp-tx-queue", UNIT)
+  {
+    AddTestCase (new BpTxQueueStreamTestCase, TestCase::QUICK);
+    AddTestCase (new BpTxQueueDatagramTestCase, TestCase::QUICK);
+    AddTestCase (new BpTxQueueRetryTestCase, TestCase::QUICK);
+    AddTestCase (new BpTxQueueCustodyTestCase, TestCase::QUICK);
+    AddTestCase (new BpTxQueueLtpTestCase, TestCase::QUICK);
+  }
+} g_bpTxQueueTestSuite;
@@ -0,0 +1,395 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+#include <deque>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/bp-endpoint-id.h"
+#include "ns3/bp-bundle-7.h"
+#include "ns3/bp-udp-cla.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * A datagram socket that keeps the datagrams it is sent, and hands out
+ * the datagrams put in its inbox as if they came from one sender.
+ */
+class BpUdpTestSocket : public Socket
+{
+public:
+  BpUdpTestSocket () {}
+
+  virtual int Send (Ptr<Packet> p, uint32_t flags) { m_sent.push_back (p->Copy ()); return p->GetSize (); }
+  virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress);
+  virtual uint32_t GetTxAvailable (void) const { return 65535; }
+  virtual SocketType GetSocketType (void) const { return NS3_SOCK_DGRAM; }
+
+  virtual SocketErrno GetErrno (void) const { return ERROR_NOTERROR; }
+  virtual Ptr<Node> GetNode (void) const { return 0; }
+  virtual int Bind (const Address &address) { return 0; }
+  virtual int Bind () { return 0; }
+  virtual int Bind6 () { return 0; }
+  virtual int Close (void) { return 0; }
+  virtual int ShutdownSend (void) { return 0; }
+  virtual int ShutdownRecv (void) { return 0; }
+  virtual int Connect (const Address &address) { return 0; }
+  virtual int Listen (void) { return 0; }
+  virtual int SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress) { return Send (p, flags); }
+  virtual uint32_t GetRxAvailable (void) const { return m_inbox.empty () ? 0 : m_inbox.front ()->GetSize (); }
+  virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags) { Address from; return RecvFrom (maxSize, flags, from); }
+  virtual int GetSockName (Address &address) const { return 0; }
+  virtual int GetPeerName (Address &address) const { return 0; }
+  virtual bool SetAllowBroadcast (bool allowBroadcast) { return false; }
+  virtual bool GetAllowBroadcast () const { return false; }
+
+  std::vector<Ptr<Packet> > m_sent;   /// datagrams sent, in order
+  std::deque<Ptr<Packet> > m_inbox;   /// datagrams to receive
+};
+
+Ptr<Packet>
+BpUdpTestSocket::RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress)
+{
+  if (m_inbox.empty ())
+    {
+      return 0;
+    }
+  Ptr<Packet> p = m_inbox.front ();
+  m_inbox.pop_front ();
+  fromAddress = InetSocketAddress (Ipv4Address ("10.0.0.1"), 4556);
+  return p;
+}
+
+/**
+ * A UDP CLA whose Transmit () can be called directly.
+ */
+class BpUdpTestCla : public BpUdpCla
+{
+public:
+  BpUdpTestCla (Callback<void, Ptr<Bundle> > processBundleCallback)
+    : BpUdpCla (processBundleCallback)
+  {
+  }
+
+  int Send (Ptr<Socket> socket, Ptr<Packet> bundle) { return Transmit (socket, bundle); }
+};
+
+namespace {
+
+/**
+ * \return a bundle of length payload bytes, encoded as a CLA sends it
+ */
+Ptr<Packet>
+Encoded (uint32_t length)
+{
+  std::vector<uint8_t> data (length);
+  for (uint32_t i = 0; i < length; i++)
+    {
+      data[i] = i * 7;
+    }
+  Ptr<Bundle7> bundle = Create<Bundle7> (Create<Packet> (data.data (), length));
+  BpHeader7 *bph = bundle->GetPrimaryHeader ();
+  bph->SetSourceEid (BpEndpointId ("dtn", "source"));
+  bph->SetDestinationEid (BpEndpointId ("dtn", "destination"));
+  bph->SetCreateTimestamp (0);
+  bph->SetSequenceNumber (SequenceNumber32 (1));
+  bph->SetLifeTime (Seconds (0));
+  return BpCla::SerializeBundle (bundle);
+}
+
+/**
+ * \return the datagrams a CLA with segmentSize sends for bundle
+ */
+std::vector<Ptr<Packet> >
+Segments (Ptr<Packet> bundle, uint32_t segmentSize)
+{
+  Ptr<BpUdpTestCla> cla = CreateObject<BpUdpTestCla> (MakeNullCallback<void, Ptr<Bundle> > ());
+  cla->SetAttribute ("SegmentSize", UintegerValue (segmentSize));
+  Ptr<BpUdpTestSocket> socket = CreateObject<BpUdpTestSocket> ();
+  cla->Send (socket, bundle);
+  return socket->m_sent;
+}
+
+} // anonymous namespace
+
+/**
+ * The receiving side of the tests: a CLA whose socket is fed datagrams by
+ * the test, and the bundles it passes on.
+ */
+class BpUdpClaTestCase : public TestCase
+{
+public:
+  BpUdpClaTestCase (std::string name);
+
+protected:
+  /**
+   * Set up a receiving CLA that holds up to limit bytes for reassembly.
+   */
+  void Setup (uint64_t limit);
+
+  /**
+   * Hand a datagram to the receiving CLA.
+   */
+  void Deliver (Ptr<Packet> datagram);
+
+  /**
+   * \return true if the bundles passed on are count bundles of length
+   * payload bytes each, with the payload of Encoded ()
+   */
+  bool Received (uint32_t count, uint32_t length);
+
+  Ptr<BpUdpCla> m_cla;
+  Ptr<BpUdpTestSocket> m_socket;
+  std::vector<Ptr<Bundle> > m_bundles;
+
+private:
+  void Receive (Ptr<Bundle> bundle);
+};
+
+BpUdpClaTestCase::BpUdpClaTestCase (std::string name)
+  : TestCase (name)
+{
+}
+
+void
+BpUdpClaTestCase::Setup (uint64_t limit)
+{
+  m_bundles.clear ();
+  m_cla = CreateObject<BpUdpCla> (MakeCallback (&BpUdpClaTestCase::Receive, this));
+  m_cla->SetAttribute ("ReassemblyTimeout", TimeValue (Seconds (5)));
+  m_cla->SetAttribute ("ReassemblyBytes", UintegerValue (limit));
+  m_socket = CreateObject<BpUdpTestSocket> ();
+}
+
+void
+BpUdpClaTestCase::Deliver (Ptr<Packet> datagram)
+{
+  m_socket->m_inbox.push_back (datagram->Copy ());
+  m_cla->DataRecv (m_socket);
+}
+
+bool
+BpUdpClaTestCase::Received (uint32_t count, uint32_t length)
+{
+  if (m_bundles.size () != count)
+    {
+      return false;
+    }
+  for (uint32_t n = 0; n < count; n++)
+    {
+      Ptr<Bundle7> bundle = DynamicCast<Bundle7> (m_bundles[n]);
+      if (!bundle || bundle->m_adu->GetSize () != length)
+        {
+          return false;
+        }
+      std::vector<uint8_t> data (length);
+      bundle->m_adu->CopyData (data.data (), length);
+      for (uint32_t i = 0; i < length; i++)
+        {
+          if (data[i] != (uint8_t) (i * 7))
+            {
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
+void
+BpUdpClaTestCase::Receive (Ptr<Bundle> bundle)
+{
+  m_bundles.push_back (bundle);
+}
+
+/**
+ * Segments put back together in any order, with duplicates, make the
+ * bundle they were split from; a bundle that fits one datagram is sent
+ * whole.
+ */
+class BpUdpClaReassemblyTestCase : public BpUdpClaTestCase
+{
+public:
+  BpUdpClaReassemblyTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpUdpClaReassemblyTestCase::BpUdpClaReassemblyTestCase ()
+  : BpUdpClaTestCase ("Reassemble segments in any order")
+{
+}
+
+void
+BpUdpClaReassemblyTestCase::DoRun (void)
+{
+  Ptr<Packet> bundle = Encoded (3000);
+  std::vector<Ptr<Packet> > segments = Segments (bundle, 413);
+  uint32_t expected = (bundle->GetSize () + 399) / 400;
+  NS_TEST_ASSERT_MSG_EQ (segments.size (), expected, "wrong number of segments");
+  for (uint32_t k = 0; k < segments.size (); k++)
+    {
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (segments[k]->GetSize (), 413, "segment " << k << " larger than SegmentSize");
+    }
+
+  Setup (1 << 20);
+  for (uint32_t k = segments.size () - 1; k > 0; k--)
+    {
+      Deliver (segments[k]);
+      Deliver (segments[k]);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 0, "incomplete bundle passed on");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetPendingBundles (), 1, "bundle not held for reassembly");
+  Deliver (segments[0]);
+  NS_TEST_EXPECT_MSG_EQ (Received (1, 3000), true, "bundle not reassembled");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetPendingBundles (), 0, "reassembled bundle still held");
+
+  // a bundle that fits one datagram
+  std::vector<Ptr<Packet> > whole = Segments (Encoded (100), 413);
+  NS_TEST_ASSERT_MSG_EQ (whole.size (), 1, "small bundle segmented");
+  Deliver (whole[0]);
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 2, "whole bundle not passed on");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetReassemblyDrops (), 0, "bundle dropped");
+  Simulator::Destroy ();
+}
+
+/**
+ * A bundle sent again may be split at other offsets; overlapping segments
+ * count their bytes once, and the bundle is passed on only when every byte
+ * is in.
+ */
+class BpUdpClaOverlapTestCase : public BpUdpClaTestCase
+{
+public:
+  BpUdpClaOverlapTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpUdpClaOverlapTestCase::BpUdpClaOverlapTestCase ()
+  : BpUdpClaTestCase ("Reassemble overlapping segments")
+{
+}
+
+void
+BpUdpClaOverlapTestCase::DoRun (void)
+{
+  // the first bundle of each sender, so with the same id
+  Ptr<Packet> bundle = Encoded (3000);
+  std::vector<Ptr<Packet> > small = Segments (bundle, 413);
+  std::vector<Ptr<Packet> > large = Segments (bundle, 713);
+  NS_TEST_ASSERT_MSG_GT (small.size (), 4, "too few segments");
+
+  // [700, 1400) of the large ones, then all of the small ones but [800,
+  // 1200), which the large one covers
+  Setup (1 << 20);
+  Deliver (large[1]);
+  for (uint32_t k = 0; k < small.size (); k++)
+    {
+      if (k == 2)
+        {
+          continue;
+        }
+      NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 0, "bundle passed on before segment " << k);
+      Deliver (small[k]);
+    }
+  NS_TEST_EXPECT_MSG_EQ (Received (1, 3000), true, "bundle not reassembled from overlapping segments");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetPendingBundles (), 0, "reassembled bundle still held");
+
+  // a segment covered by two others adds nothing
+  Setup (1 << 20);
+  Deliver (small[1]);
+  Deliver (small[2]);
+  Deliver (small[3]);
+  Deliver (large[1]);
+  for (uint32_t k = 0; k < large.size (); k++)
+    {
+      if (k != 1)
+        {
+          Deliver (large[k]);
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (Received (1, 3000), true, "bundle not reassembled from overlapping segments");
+  Simulator::Destroy ();
+}
+
+/**
+ * An incomplete bundle is dropped after ReassemblyTimeout, and a bundle
+ * that would take the bytes held over ReassemblyBytes is refused.
+ */
+class BpUdpClaTimeoutTestCase : public BpUdpClaTestCase
+{
+public:
+  BpUdpClaTimeoutTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+BpUdpClaTimeoutTestCase::BpUdpClaTimeoutTestCase ()
+  : BpUdpClaTestCase ("Drop incomplete bundles")
+{
+}
+
+void
+BpUdpClaTimeoutTestCase::DoRun (void)
+{
+  Ptr<Packet> bundle = Encoded (3000);
+  std::vector<Ptr<Packet> > segments = Segments (bundle, 413);
+
+  Setup (1 << 20);
+  for (uint32_t k = 1; k < segments.size (); k++)
+    {
+      Deliver (segments[k]);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetPendingBundles (), 1, "bundle not held for reassembly");
+  Simulator::Stop (Seconds (6));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetPendingBundles (), 0, "bundle held past the timeout");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetReassemblyDrops (), 1, "timeout not counted");
+
+  // the missing segment alone starts the bundle again
+  Deliver (segments[0]);
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 0, "bundle passed on after its timeout");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetPendingBundles (), 1, "segment not held");
+  Simulator::Destroy ();
+
+  // no room for the bundle: its segments are discarded
+  Setup (bundle->GetSize () - 1);
+  for (uint32_t k = 0; k < segments.size (); k++)
+    {
+      Deliver (segments[k]);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_bundles.size (), 0, "bundle passed on without room");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetPendingBundles (), 0, "refused bundle held");
+  NS_TEST_EXPECT_MSG_EQ (m_cla->GetReassemblyDrops (), 1, "refusal not counted once");
+  Simulator::Destroy ();
+}
+
+class BpUdpClaTestSuite : public TestSuite
+{
+public:
+  BpUdpClaTestSuite ()
+    : TestSuite ("bp-udp-cla", UNIT)
+  {
+    AddTestCase (new BpUdpClaReassemblyTestCase, TestCase::QUICK);
+    AddTestCase (new BpUdpClaOverlapTestCase, TestCase::QUICK);
+    AddTestCase (new BpUdpClaTimeoutTestCase, TestCase::QUICK);
+  }
+} g_bpUdpClaTestSuite;